@@ -0,0 +1,473 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <gsl/gsl>
+
+#include <Chip8Core/Chip8.hpp>
+#include <Chip8Core/Debugger.hpp>
+#include <Chip8Core/ExecutionHistory.hpp>
+#include <Chip8Core/Memory.hpp>
+#include <Chip8Core/VectorMachine.hpp>
+#include <Chip8Core/Environment.hpp>
+#include <Chip8Core/RomStore.hpp>
+#include <Chip8Core/Opcodes.hpp>
+#include <Chip8Core/FrameCodec.hpp>
+#include <Chip8Core/InstructionTrace.hpp>
+
+using namespace Chip8;
+
+namespace {
+	using Memory = Chip8Memory<::Chip8::Chip8::MemoryUnderlyingType>;
+
+	// a machine with a (fake) ROM spanning four pages, as if a ROM had just been loaded
+	::Chip8::Chip8 createLoadedMachine() {
+		::Chip8::Chip8 chip8;
+		chip8.reset();
+		for (uint16_t address = ::Chip8::Chip8::ProgramOffset; address < ::Chip8::Chip8::ProgramOffset + 0x400; ++address)
+			chip8.getMemory().write(address, gsl::narrow_cast<uint8_t>(address * 7));
+		return chip8;
+	}
+
+	size_t getInstanceFootprint(const ::Chip8::Chip8& chip8) {
+		return sizeof(::Chip8::Chip8) + chip8.getMemory().getPrivatePageCount() * Memory::PageSize;
+	}
+
+	// forks a machine and writes to the given number of bytes (spread over the stack area and the
+	// display buffer region that ROMs usually touch)
+	void BM_ForkChip8(benchmark::State& state) {
+		const auto original = createLoadedMachine();
+		const auto writes = static_cast<uint16_t>(state.range(0));
+		size_t footprint = 0;
+		for (auto _ : state) {
+			auto fork = original;
+			for (uint16_t i = 0; i < writes; ++i)
+				fork.getMemory().write(gsl::narrow_cast<uint16_t>(0xE00 + i % 0x200), 0xFF);
+			benchmark::DoNotOptimize(fork);
+			footprint = getInstanceFootprint(fork);
+		}
+		state.counters["bytes_per_instance"] = static_cast<double>(footprint);
+		state.counters["forks_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_ForkChip8)->Arg(0)->Arg(1)->Arg(16)->Arg(256);
+
+	// for comparison: forking by copying the complete flat machine state
+	void BM_ForkFlatState(benchmark::State& state) {
+		const auto original = createLoadedMachine();
+		::Chip8::Chip8::State flatState;
+		original.saveState(flatState);
+		for (auto _ : state) {
+			auto fork = flatState;
+			benchmark::DoNotOptimize(fork);
+		}
+		state.counters["bytes_per_instance"] = static_cast<double>(sizeof(flatState));
+		state.counters["forks_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_ForkFlatState);
+
+	constexpr int CyclesPerFrame = 10;
+
+	// a small game loop: moves a sprite depending on the pressed keys and random numbers
+	::Chip8::Chip8 createGameMachine() {
+		const uint16_t program[] = {
+			0x6000, 0x6100, 0xA220, 0xC20F, 0xE29E, 0x7001, 0x8024, 0x3040, // 0x200
+			0x7101, 0x8316, 0x8434, 0xF315, 0xD013, 0x1206, 0x0000, 0x0000, // 0x210
+			0xFF81, 0xFF00,                                                 // 0x220 (sprite)
+		};
+		::Chip8::Chip8 chip8;
+		chip8.reset();
+		uint16_t address = ::Chip8::Chip8::ProgramOffset;
+		for (const auto instruction : program) {
+			chip8.getMemory().write(address++, gsl::narrow_cast<uint8_t>(instruction >> 8));
+			chip8.getMemory().write(address++, gsl::narrow_cast<uint8_t>(instruction & 0xFF));
+		}
+		return chip8;
+	}
+
+	uint8_t getKey(size_t lane, int64_t frame) {
+		return gsl::narrow_cast<uint8_t>((lane * 7 + static_cast<size_t>(frame) * 3) % 0x10);
+	}
+
+	// one frame of N independent machines
+	void BM_IndependentMachines(benchmark::State& state) {
+		const auto laneCount = static_cast<size_t>(state.range(0));
+		std::vector<::Chip8::Chip8> machines(laneCount, createGameMachine());
+		for (size_t lane = 0; lane < laneCount; ++lane)
+			machines[lane].seedRandom(lane);
+		int64_t frame = 0;
+		for (auto _ : state) {
+			for (size_t lane = 0; lane < laneCount; ++lane) {
+				auto& machine = machines[lane];
+				machine.triggerKeyUp(getKey(lane, frame - 1));
+				machine.triggerKeyDown(getKey(lane, frame));
+				for (int cycle = 0; cycle < CyclesPerFrame; ++cycle)
+					machine.step();
+				machine.clockTimers();
+			}
+			++frame;
+		}
+		state.counters["frames_per_second"] = benchmark::Counter(static_cast<double>(state.iterations() * laneCount), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_IndependentMachines)->Arg(32)->Arg(256)->Arg(1024);
+
+	// one frame of N lanes of a vector machine
+	void BM_VectorMachine(benchmark::State& state) {
+		const auto laneCount = static_cast<size_t>(state.range(0));
+		VectorMachine vectorMachine(laneCount, createGameMachine());
+		for (size_t lane = 0; lane < laneCount; ++lane)
+			vectorMachine.seedRandom(lane, lane);
+		int64_t frame = 0;
+		for (auto _ : state) {
+			for (size_t lane = 0; lane < laneCount; ++lane) {
+				vectorMachine.triggerKeyUp(lane, getKey(lane, frame - 1));
+				vectorMachine.triggerKeyDown(lane, getKey(lane, frame));
+			}
+			for (int cycle = 0; cycle < CyclesPerFrame; ++cycle)
+				vectorMachine.step();
+			vectorMachine.clockTimers();
+			++frame;
+		}
+		const auto& statistics = vectorMachine.getStatistics();
+		state.counters["frames_per_second"] = benchmark::Counter(static_cast<double>(state.iterations() * laneCount), benchmark::Counter::kIsRate);
+		state.counters["vector_fraction"] = static_cast<double>(statistics.vectorLaneSteps)
+			/ static_cast<double>(std::max<uint64_t>(statistics.vectorLaneSteps + statistics.scalarLaneSteps, 1));
+	}
+	BENCHMARK(BM_VectorMachine)->Arg(32)->Arg(256)->Arg(1024);
+
+	// building observations pixel by pixel, as agents had to do before the environment API existed
+	void BM_ObservationsFromPixels(benchmark::State& state) {
+		const auto laneCount = static_cast<size_t>(state.range(0));
+		std::vector<::Chip8::Chip8> machines(laneCount, createGameMachine());
+		std::vector<uint8_t> observations(laneCount * ::Chip8::Chip8::DisplayWidth * ::Chip8::Chip8::DisplayHeight);
+		for (auto _ : state) {
+			auto observation = observations.begin();
+			for (auto& machine : machines) {
+				for (int cycle = 0; cycle < CyclesPerFrame; ++cycle)
+					machine.step();
+				machine.clockTimers();
+				for (size_t y = 0; y < ::Chip8::Chip8::DisplayHeight; ++y) {
+					for (size_t x = 0; x < ::Chip8::Chip8::DisplayWidth; ++x)
+						*observation++ = (machine.getPixel(x, y) ? 0x1 : 0x0);
+				}
+			}
+			benchmark::DoNotOptimize(observations.data());
+		}
+		state.counters["frames_per_second"] = benchmark::Counter(static_cast<double>(state.iterations() * laneCount), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_ObservationsFromPixels)->Arg(32)->Arg(256);
+
+	void BM_VectorEnvironment(benchmark::State& state) {
+		const auto laneCount = static_cast<size_t>(state.range(0));
+		VectorEnvironment environment(laneCount, createGameMachine(), CyclesPerFrame);
+		std::vector<uint8_t> observations(environment.getObservationBufferSize());
+		std::vector<uint16_t> actions(laneCount, 0x0);
+		environment.reset(observations.data());
+		for (auto _ : state) {
+			environment.step(actions.data(), 1, observations.data(), nullptr);
+			benchmark::DoNotOptimize(observations.data());
+		}
+		state.counters["frames_per_second"] = benchmark::Counter(static_cast<double>(state.iterations() * laneCount), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_VectorEnvironment)->Arg(32)->Arg(256);
+
+	// a ROM file of the given size for the loading benchmarks (removed when the benchmark ends)
+	class TemporaryROM {
+	public:
+		explicit TemporaryROM(size_t size)
+			: mFilename("bench_rom.ch8")
+		{
+			std::ofstream file(mFilename, std::ios::binary);
+			for (size_t i = 0; i < size; ++i)
+				file.put(static_cast<char>(i * 7));
+		}
+
+		~TemporaryROM() {
+			std::remove(mFilename.c_str());
+		}
+
+		const std::string& getFilename() const noexcept {
+			return mFilename;
+		}
+
+	private:
+		std::string mFilename;
+	};
+
+	void BM_LoadROMFromFile(benchmark::State& state) {
+		const TemporaryROM rom(static_cast<size_t>(state.range(0)));
+		::Chip8::Chip8 chip8;
+		for (auto _ : state) {
+			chip8.loadROM(rom.getFilename());
+			benchmark::DoNotOptimize(chip8);
+		}
+		state.counters["loads_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_LoadROMFromFile)->Arg(0x100)->Arg(0xE00);
+
+	void BM_LoadROMFromStore(benchmark::State& state) {
+		const TemporaryROM rom(static_cast<size_t>(state.range(0)));
+		RomStore romStore;
+		::Chip8::Chip8 chip8;
+		for (auto _ : state) {
+			chip8.loadROM(*romStore.load(rom.getFilename()));
+			benchmark::DoNotOptimize(chip8);
+		}
+		state.counters["loads_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_LoadROMFromStore)->Arg(0x100)->Arg(0xE00);
+
+	// a machine whose whole program memory repeats the given instruction, followed by a jump back
+	// to the start, so that stepping runs (almost) nothing but that instruction
+	::Chip8::Chip8 createOpcodeMachine(uint16_t instruction) {
+		::Chip8::Chip8 chip8;
+		chip8.reset();
+		chip8.setLoggingEnabled(false);
+		for (uint16_t address = ::Chip8::Chip8::ProgramOffset; address < ::Chip8::Chip8::MemorySize - 2; address += 2) {
+			chip8.getMemory().write(address, gsl::narrow_cast<uint8_t>(instruction >> 8));
+			chip8.getMemory().write(address + 1, gsl::narrow_cast<uint8_t>(instruction & 0xFF));
+		}
+		chip8.getMemory().write(::Chip8::Chip8::MemorySize - 2, 0x12);
+		chip8.getMemory().write(::Chip8::Chip8::MemorySize - 1, 0x00);
+		return chip8;
+	}
+
+	void BM_StepOpcode(benchmark::State& state, uint16_t instruction) {
+		auto chip8 = createOpcodeMachine(instruction);
+		for (auto _ : state)
+			benchmark::DoNotOptimize(chip8.step());
+		state.counters["steps_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK_CAPTURE(BM_StepOpcode, clear_screen, uint16_t{ 0x00E0 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, jump, uint16_t{ 0x1200 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, skip_if_equal, uint16_t{ 0x3105 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, load_immediate, uint16_t{ 0x6105 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, add_immediate, uint16_t{ 0x7105 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, alu_add, uint16_t{ 0x8124 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, alu_shift, uint16_t{ 0x810E });
+	BENCHMARK_CAPTURE(BM_StepOpcode, set_index, uint16_t{ 0xA300 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, random, uint16_t{ 0xC1FF });
+	BENCHMARK_CAPTURE(BM_StepOpcode, draw, uint16_t{ 0xD015 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, skip_if_key, uint16_t{ 0xE19E });
+	BENCHMARK_CAPTURE(BM_StepOpcode, set_delay_timer, uint16_t{ 0xF115 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, add_to_index, uint16_t{ 0xF11E });
+	BENCHMARK_CAPTURE(BM_StepOpcode, bcd, uint16_t{ 0xF133 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, store_registers, uint16_t{ 0xF355 });
+	BENCHMARK_CAPTURE(BM_StepOpcode, load_registers, uint16_t{ 0xF365 });
+
+	// subroutine call and return (plus the jump that closes the loop)
+	void BM_StepCallReturn(benchmark::State& state) {
+		const std::array<uint8_t, 6> program = { 0x22, 0x04, 0x12, 0x00, 0x00, 0xEE };
+		::Chip8::Chip8 chip8;
+		chip8.loadROM(program.data(), program.size());
+		for (auto _ : state)
+			benchmark::DoNotOptimize(chip8.step());
+		state.counters["steps_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_StepCallReturn);
+
+	// the game loop without and with an instruction tracer attached (the trace is written to a file that is removed afterwards)
+	void BM_StepTraced(benchmark::State& state) {
+		const bool traced = (state.range(0) != 0);
+		const std::string filename = "bench_trace.c8trace";
+		auto chip8 = createGameMachine();
+		{
+			std::unique_ptr<InstructionTracer> tracer;
+			if (traced) {
+				tracer = std::make_unique<InstructionTracer>(filename);
+				chip8.setTracer(tracer.get());
+			}
+			for (auto _ : state)
+				benchmark::DoNotOptimize(chip8.step());
+			chip8.setTracer(nullptr);
+		}
+		std::remove(filename.c_str());
+		state.counters["steps_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_StepTraced)->ArgName("traced")->Arg(0)->Arg(1);
+
+	// the game loop with a debugger attached, without breakpoints (the fast path) and with one that is never hit
+	void BM_StepDebugged(benchmark::State& state) {
+		auto chip8 = createGameMachine();
+		Debugger debugger;
+		debugger.attach(&chip8);
+		if (state.range(0) != 0)
+			debugger.setBreakpoint(0xFFE);
+		for (auto _ : state)
+			benchmark::DoNotOptimize(chip8.step());
+		debugger.attach(nullptr);
+		state.counters["steps_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_StepDebugged)->ArgName("breakpoints")->Arg(0)->Arg(1);
+
+	// restoring a cycle of the last five minutes (at 60 frames per second) of the game loop, which re-executes
+	// up to one checkpoint interval; the history is extended while the timer is paused once the seeks have
+	// consumed it
+	void BM_HistorySeek(benchmark::State& state) {
+		constexpr int64_t historyFrames = 5 * 60 * 60;
+		auto chip8 = createGameMachine();
+		ExecutionHistory history;
+		history.start(chip8);
+		int64_t frame = 0;
+		const auto runFrames = [&](int64_t count) {
+			for (int64_t i = 0; i < count; ++i, ++frame) {
+				chip8.triggerKeyUp(getKey(0, frame - 1));
+				chip8.triggerKeyDown(getKey(0, frame));
+				for (int cycle = 0; cycle < CyclesPerFrame; ++cycle) {
+					chip8.step();
+					history.update(chip8);
+				}
+				chip8.clockTimers();
+			}
+		};
+		runFrames(historyFrames);
+		std::minstd_rand random(1);
+		for (auto _ : state) {
+			if (chip8.getCycleCount() - history.getFirstCycle() < 4 * ExecutionHistory::DefaultCheckpointInterval) {
+				state.PauseTiming();
+				runFrames(historyFrames / 10);
+				state.ResumeTiming();
+			}
+			const uint64_t distance = 1 + random() % (2 * ExecutionHistory::DefaultCheckpointInterval);
+			benchmark::DoNotOptimize(history.seek(chip8, chip8.getCycleCount() - distance));
+		}
+		state.counters["history_cycles"] = static_cast<double>(historyFrames * CyclesPerFrame);
+		state.counters["seeks_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_HistorySeek)->Unit(benchmark::kMicrosecond);
+
+	// the lookup of the opcode table entry that Chip8::step() does for every instruction
+	void BM_OpcodeLookup(benchmark::State& state) {
+		std::vector<uint16_t> instructions;
+		for (const auto& opcode : Opcodes)
+			instructions.push_back(gsl::narrow_cast<uint16_t>(std::get<1>(opcode) | (0x1234 & std::get<3>(opcode))));
+		for (auto _ : state) {
+			for (const auto instruction : instructions)
+				benchmark::DoNotOptimize(getOpcodeIndex(instruction));
+		}
+		state.counters["lookups_per_second"] = benchmark::Counter(static_cast<double>(state.iterations() * instructions.size()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_OpcodeLookup);
+
+	// DXYN with the sprite at (x, y) and the given height (wrapping at the right and bottom edges)
+	void BM_DrawSprite(benchmark::State& state) {
+		auto chip8 = createOpcodeMachine(gsl::narrow_cast<uint16_t>(0xD010 | state.range(2)));
+		chip8.setRegister(0x0, gsl::narrow_cast<uint8_t>(state.range(0)));
+		chip8.setRegister(0x1, gsl::narrow_cast<uint8_t>(state.range(1)));
+		for (auto _ : state)
+			benchmark::DoNotOptimize(chip8.step());
+		state.counters["sprites_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK(BM_DrawSprite)->ArgNames({ "x", "y", "height" })
+		->Args({ 0, 0, 1 })->Args({ 0, 0, 5 })->Args({ 0, 0, 15 })
+		->Args({ 3, 0, 5 })->Args({ 3, 0, 15 })
+		->Args({ 60, 30, 5 })->Args({ 60, 30, 15 });
+
+	void BM_ClockTimers(benchmark::State& state) {
+		auto chip8 = createGameMachine();
+		for (auto _ : state) {
+			chip8.clockTimers();
+			benchmark::DoNotOptimize(chip8);
+		}
+	}
+	BENCHMARK(BM_ClockTimers);
+
+	// resetting a machine that has a ROM loaded, with and without clearing the memory
+	void BM_Reset(benchmark::State& state) {
+		const bool alsoResetMemory = (state.range(0) != 0);
+		auto chip8 = createLoadedMachine();
+		for (auto _ : state) {
+			chip8.reset(alsoResetMemory);
+			benchmark::DoNotOptimize(chip8);
+		}
+	}
+	BENCHMARK(BM_Reset)->ArgName("memory")->Arg(0)->Arg(1);
+
+	// copying the display out of a machine: packed, pixel by pixel, as part of the state and as stream frame
+	void BM_ExportPackedDisplay(benchmark::State& state) {
+		const auto chip8 = createGameMachine();
+		for (auto _ : state) {
+			auto display = chip8.getPackedDisplay();
+			benchmark::DoNotOptimize(display);
+		}
+	}
+	BENCHMARK(BM_ExportPackedDisplay);
+
+	void BM_ExportPixels(benchmark::State& state) {
+		const auto chip8 = createGameMachine();
+		std::vector<uint8_t> pixels(::Chip8::Chip8::DisplayWidth * ::Chip8::Chip8::DisplayHeight);
+		for (auto _ : state) {
+			auto pixel = pixels.begin();
+			for (size_t y = 0; y < ::Chip8::Chip8::DisplayHeight; ++y) {
+				for (size_t x = 0; x < ::Chip8::Chip8::DisplayWidth; ++x)
+					*pixel++ = (chip8.getPixel(x, y) ? 0x1 : 0x0);
+			}
+			benchmark::DoNotOptimize(pixels.data());
+		}
+	}
+	BENCHMARK(BM_ExportPixels);
+
+	void BM_SaveState(benchmark::State& state) {
+		const auto chip8 = createLoadedMachine();
+		::Chip8::Chip8::State flatState;
+		for (auto _ : state) {
+			chip8.saveState(flatState);
+			benchmark::DoNotOptimize(flatState);
+		}
+	}
+	BENCHMARK(BM_SaveState);
+
+	void BM_EncodeStreamFrame(benchmark::State& state) {
+		auto chip8 = createGameMachine();
+		FrameEncoder encoder(0);
+		std::vector<uint8_t> message;
+		size_t bytes = 0;
+		for (auto _ : state) {
+			for (int cycle = 0; cycle < CyclesPerFrame; ++cycle)
+				chip8.step();
+			message.clear();
+			encoder.encode(chip8.getPackedDisplay(), 0, message);
+			bytes += message.size();
+		}
+		state.counters["bytes_per_frame"] = static_cast<double>(bytes) / static_cast<double>(std::max<int64_t>(state.iterations(), 1));
+	}
+	BENCHMARK(BM_EncodeStreamFrame);
+
+	// full frames of the ROMs of the regression suite (with a key tapped every 30 frames)
+	void BM_RomFrame(benchmark::State& state, const char* rom) {
+		const std::string path = std::string(CHIP8_BENCH_ROM_DIRECTORY) + "/" + rom;
+		::Chip8::Chip8 chip8;
+		chip8.setLoggingEnabled(false);
+		if (!chip8.loadROM(path)) {
+			state.SkipWithError(("could not load " + path).c_str());
+			return;
+		}
+		::Chip8::Chip8::State initialState;
+		chip8.saveState(initialState);
+		uint64_t frame = 0;
+		for (auto _ : state) {
+			if (frame % 30 == 0)
+				chip8.triggerKeyDown(0x5);
+			else if (frame % 30 == 5)
+				chip8.triggerKeyUp(0x5);
+			bool running = true;
+			for (int cycle = 0; cycle < CyclesPerFrame && running; ++cycle)
+				running = chip8.step();
+			chip8.clockTimers();
+			if (!running)
+				chip8.loadState(initialState); // start over once the program has stopped
+			++frame;
+		}
+		state.counters["frames_per_second"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+	}
+	BENCHMARK_CAPTURE(BM_RomFrame, alu, "alu.ch8");
+	BENCHMARK_CAPTURE(BM_RomFrame, flags, "flags.ch8");
+	BENCHMARK_CAPTURE(BM_RomFrame, quirks, "quirks.ch8");
+	BENCHMARK_CAPTURE(BM_RomFrame, keypad, "keypad.ch8");
+	BENCHMARK_CAPTURE(BM_RomFrame, game, "game.ch8");
+}
@@ -0,0 +1,153 @@
+// Runs the benchmarks like BENCHMARK_MAIN() does. With --compare, the results are compared against a
+// baseline that has been written by an earlier run with --benchmark_out=<file> --benchmark_out_format=json.
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Chip8Core/Json.hpp>
+
+namespace {
+
+	// CPU time per iteration in seconds, averaged over repetitions
+	using Timings = std::map<std::string, double>;
+
+	class CollectingReporter : public benchmark::ConsoleReporter {
+	public:
+		void ReportRuns(const std::vector<Run>& runs) override {
+			for (const auto& run : runs) {
+				if (run.run_type != Run::RT_Iteration)
+					continue;
+				auto& [sum, count] = mTimings[run.benchmark_name()];
+				sum += run.GetAdjustedCPUTime() / benchmark::GetTimeUnitMultiplier(run.time_unit);
+				++count;
+			}
+			ConsoleReporter::ReportRuns(runs);
+		}
+
+		Timings getTimings() const {
+			Timings result;
+			for (const auto& [name, timing] : mTimings)
+				result[name] = timing.first / static_cast<double>(timing.second);
+			return result;
+		}
+
+	private:
+		std::map<std::string, std::pair<double, size_t>> mTimings;
+	};
+
+	bool loadBaseline(const std::string& filename, Timings& timings, std::string& error) {
+		std::ifstream file(filename);
+		if (!file.good()) {
+			error = "could not open " + filename;
+			return false;
+		}
+		std::stringstream text;
+		text << file.rdbuf();
+		const auto document = Chip8::parseJson(text.str(), error);
+		if (!document)
+			return false;
+		const std::map<std::string, double> unitsPerSecond = { { "ns", 1e9 }, { "us", 1e6 }, { "ms", 1e3 }, { "s", 1.0 } };
+		std::map<std::string, std::pair<double, size_t>> sums;
+		for (const auto& benchmark : (*document)["benchmarks"].asArray()) {
+			if (benchmark["run_type"].asString() == "aggregate")
+				continue;
+			const auto unit = unitsPerSecond.find(benchmark["time_unit"].asString());
+			if (!benchmark["name"].isString() || !benchmark["cpu_time"].isNumber() || unit == unitsPerSecond.end()) {
+				error = "unexpected benchmark entry in " + filename;
+				return false;
+			}
+			auto& [sum, count] = sums[benchmark["name"].asString()];
+			sum += benchmark["cpu_time"].asNumber() / unit->second;
+			++count;
+		}
+		if (sums.empty()) {
+			error = filename + " does not contain any benchmarks";
+			return false;
+		}
+		for (const auto& [name, timing] : sums)
+			timings[name] = timing.first / static_cast<double>(timing.second);
+		return true;
+	}
+
+	// prints the changes and returns the number of regressions
+	size_t compare(const Timings& baseline, const Timings& current, double threshold) {
+		size_t regressions = 0;
+		std::printf("\nComparison against the baseline (CPU time, threshold %.1f%%):\n", threshold * 100.0);
+		std::printf("%-50s %14s %14s %9s\n", "Benchmark", "Baseline (ns)", "Current (ns)", "Change");
+		for (const auto& [name, time] : current) {
+			const auto entry = baseline.find(name);
+			if (entry == baseline.end()) {
+				std::printf("%-50s %14s %14.1f %9s\n", name.c_str(), "-", time * 1e9, "new");
+				continue;
+			}
+			const double change = (entry->second > 0.0 ? time / entry->second - 1.0 : 0.0);
+			const bool regression = (change > threshold);
+			regressions += (regression ? 1 : 0);
+			std::printf("%-50s %14.1f %14.1f %+8.1f%%%s\n", name.c_str(), entry->second * 1e9, time * 1e9, change * 100.0,
+				(regression ? "  REGRESSION" : (change < -threshold ? "  improved" : "")));
+		}
+		return regressions;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	// take out the options of the comparison mode before Google Benchmark sees the arguments
+	std::string baselinePath;
+	double threshold = 0.1;
+	std::vector<char*> arguments;
+	for (int i = 0; i < argc; ++i) {
+		const std::string argument = argv[i];
+		if (argument == "--compare" && i + 1 < argc) {
+			baselinePath = argv[++i];
+		} else if (argument == "--threshold" && i + 1 < argc) {
+			try {
+				threshold = std::stod(argv[++i]) / 100.0;
+			} catch (const std::exception&) {
+				std::cerr << "Invalid threshold " << argv[i] << "\n";
+				return 1;
+			}
+		} else if (argument == "--help") {
+			std::cout << "Chip8Bench [benchmark options] [--compare <baseline.json> [--threshold <percent>]]\n"
+				"  --compare <file>      compare the CPU times against a baseline written with\n"
+				"                        --benchmark_out=<file> --benchmark_out_format=json; the exit code\n"
+				"                        is 1 if a benchmark has become slower than the threshold allows\n"
+				"  --threshold <percent> the allowed slowdown (default: 10)\n\n";
+			arguments.push_back(argv[i]);
+		} else {
+			arguments.push_back(argv[i]);
+		}
+	}
+	int argumentCount = static_cast<int>(arguments.size());
+	benchmark::Initialize(&argumentCount, arguments.data());
+	if (benchmark::ReportUnrecognizedArguments(argumentCount, arguments.data()))
+		return 1;
+
+	if (baselinePath.empty()) {
+		benchmark::RunSpecifiedBenchmarks();
+		benchmark::Shutdown();
+		return 0;
+	}
+
+	Timings baseline;
+	std::string error;
+	if (!loadBaseline(baselinePath, baseline, error)) {
+		std::cerr << "Could not load the baseline: " << error << "\n";
+		return 1;
+	}
+	CollectingReporter reporter;
+	benchmark::RunSpecifiedBenchmarks(&reporter);
+	benchmark::Shutdown();
+	const size_t regressions = compare(baseline, reporter.getTimings(), threshold);
+	if (regressions > 0) {
+		std::printf("%zu benchmark(s) have regressed\n", regressions);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include "FuzzTarget.hpp"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+
+#include <Chip8Core/Chip8.hpp>
+#include <Chip8Core/Opcodes.hpp>
+
+namespace {
+
+    constexpr uint64_t CycleBudget = 1000;
+    constexpr uint64_t CyclesPerFrame = 10;
+    // one counter per opcode, one for unknown opcodes and one per instruction address
+    constexpr size_t UnknownOpcodeCounter = Chip8::Opcodes.size();
+    constexpr size_t FirstAddressCounter = UnknownOpcodeCounter + 1;
+    constexpr size_t CoverageCounterCount = FirstAddressCounter + Chip8::Chip8::MemorySize / 2;
+
+    // libFuzzer picks up counters in this section as additional coverage feedback
+#if defined(__linux__) && !defined(CHIP8_FUZZ_STANDALONE)
+    __attribute__((section("__libfuzzer_extra_counters")))
+#endif
+    uint8_t coverageCounters[CoverageCounterCount];
+
+    // the snapshot every input starts from (reset machine with the font loaded)
+    const Chip8::Chip8& getSnapshot() {
+        static const Chip8::Chip8 snapshot = []() {
+            Chip8::Chip8 chip8;
+            chip8.reset();
+            chip8.setLoggingEnabled(false);
+            return chip8;
+        }();
+        return snapshot;
+    }
+
+    inline void count(size_t counter) noexcept {
+        if (coverageCounters[counter] != 0xFF)
+            ++coverageCounters[counter];
+    }
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1)
+        return 0;
+    const uint8_t options = data[0];
+
+    // the machine is restored in place, which only copies the registers and shares the memory pages;
+    // writing the ROM then copies only the pages it covers (loadROM() would reset the machine again)
+    static Chip8::Chip8 chip8;
+    chip8 = getSnapshot();
+    const size_t romSize = std::min(size - 1, Chip8::Chip8::MemorySize - Chip8::Chip8::ProgramOffset);
+    chip8.getMemory().writeBlock(Chip8::Chip8::ProgramOffset, data + 1, romSize);
+    chip8.setCompatibilityMode((options & 0x1) ? Chip8::CompatibilityMode::OriginalChip8 : Chip8::CompatibilityMode::SuperChip);
+    const uint8_t key = options >> 4;
+
+    try {
+        for (uint64_t cycle = 1; cycle <= CycleBudget; ++cycle) {
+            const uint16_t pc = chip8.getProgramCounter();
+            if (pc + 1u < Chip8::Chip8::MemorySize) {
+                const auto instruction = static_cast<uint16_t>(chip8.getMemory().read(pc) << 8 | chip8.getMemory().read(pc + 1));
+                count(Chip8::getOpcodeIndex(instruction)); // Opcodes.size() for unknown opcodes
+                count(FirstAddressCounter + pc / 2);
+            }
+            if (!chip8.step())
+                break;
+            if (cycle % CyclesPerFrame == 0) {
+                chip8.clockTimers();
+                // release and press the key every frame, so that programs waiting for a key continue
+                chip8.triggerKeyUp(key);
+                chip8.triggerKeyDown(key);
+            }
+        }
+    } catch (const std::exception&) {
+        // memory accesses out of bounds are a property of the ROM, not a bug of the interpreter
+    }
+    return 0;
+}
+
+namespace Chip8Fuzz {
+
+    size_t getCoverageCounterCount() noexcept {
+        return CoverageCounterCount;
+    }
+
+    uint8_t* getCoverageCounters() noexcept {
+        return coverageCounters;
+    }
+
+}
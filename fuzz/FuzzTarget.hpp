@@ -0,0 +1,34 @@
+/** @file
+  * @brief Contains the interface between the fuzz target and the standalone fuzz driver.
+  */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief The libFuzzer entry point: runs a single input.
+ *
+ * The first byte of an input selects the options (bit 0: compatibility mode, bits 4 to 7: the key
+ * that gets pressed whenever the program waits for one), the remaining bytes are the ROM.
+ * @param data The input.
+ * @param size The size of the input in bytes.
+ * @return Always 0.
+*/
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace Chip8Fuzz {
+
+	/**
+	 * @brief The number of coverage counters: one per opcode plus one per (even) program counter.
+	*/
+	size_t getCoverageCounterCount() noexcept;
+
+	/**
+	 * @brief Returns the coverage counters of the last input(s). libFuzzer reads and clears them
+	 *        itself; the standalone driver has to clear them after each input.
+	 * @return The counters.
+	*/
+	uint8_t* getCoverageCounters() noexcept;
+
+}
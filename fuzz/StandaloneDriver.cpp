@@ -0,0 +1,144 @@
+// Runs the fuzz target without libFuzzer: either replays the given inputs once (to reproduce
+// crashes found by libFuzzer) or runs a simple coverage guided mutation loop.
+#include "FuzzTarget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Input = std::vector<uint8_t>;
+
+    constexpr size_t MaximumInputSize = 512;
+
+    void printUsage(const char* program) {
+        std::cerr << "usage: " << program << " [-runs=<count>] [-seed=<seed>] [input files...]\n"
+            << "  Without input files, random inputs are generated and mutated for <count> runs\n"
+            << "  (default: 1000000). With input files, every file is run once.\n";
+    }
+
+    bool readFile(const std::string& filename, Input& input) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file)
+            return false;
+        input.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // runs an input and returns the number of coverage counters it has hit for the first time
+    size_t runInput(const Input& input, std::vector<uint8_t>& totalCoverage) {
+        uint8_t* counters = Chip8Fuzz::getCoverageCounters();
+        const size_t counterCount = Chip8Fuzz::getCoverageCounterCount();
+        std::memset(counters, 0, counterCount);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        size_t newCoverage = 0;
+        for (size_t i = 0; i < counterCount; ++i) {
+            if (counters[i] != 0 && totalCoverage[i] == 0) {
+                totalCoverage[i] = 1;
+                ++newCoverage;
+            }
+        }
+        return newCoverage;
+    }
+
+    void mutate(Input& input, std::mt19937_64& random) {
+        std::uniform_int_distribution<int> byteDistribution(0, 0xFF);
+        const auto getIndex = [&random](size_t size) {
+            return std::uniform_int_distribution<size_t>(0, size - 1)(random);
+        };
+        const int mutationCount = std::uniform_int_distribution<int>(1, 4)(random);
+        for (int i = 0; i < mutationCount; ++i) {
+            switch (std::uniform_int_distribution<int>(0, 3)(random)) {
+                case 0: // overwrite a byte
+                    input[getIndex(input.size())] = static_cast<uint8_t>(byteDistribution(random));
+                    break;
+                case 1: // flip a bit
+                    input[getIndex(input.size())] ^= static_cast<uint8_t>(1u << std::uniform_int_distribution<int>(0, 7)(random));
+                    break;
+                case 2: // insert an instruction
+                    if (input.size() + 2 <= MaximumInputSize) {
+                        const auto position = input.begin() + static_cast<std::ptrdiff_t>(getIndex(input.size()) + 1);
+                        input.insert(position, { static_cast<uint8_t>(byteDistribution(random)), static_cast<uint8_t>(byteDistribution(random)) });
+                    }
+                    break;
+                case 3: // remove an instruction
+                    if (input.size() > 3) {
+                        const auto position = input.begin() + static_cast<std::ptrdiff_t>(getIndex(input.size() - 2) + 1);
+                        input.erase(position, position + 2);
+                    }
+                    break;
+            }
+        }
+    }
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t runs = 1'000'000;
+    uint64_t seed = std::random_device{}();
+    std::vector<std::string> inputFiles;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        try {
+            if (argument.rfind("-runs=", 0) == 0) {
+                runs = std::stoull(argument.substr(6));
+            } else if (argument.rfind("-seed=", 0) == 0) {
+                seed = std::stoull(argument.substr(6));
+            } else if (argument == "-h" || argument == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (!argument.empty() && argument.front() == '-') {
+                // ignore the flags of libFuzzer, so that the same command lines work with both binaries
+            } else {
+                inputFiles.push_back(argument);
+            }
+        } catch (const std::exception&) {
+            std::cerr << "invalid argument " << argument << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> totalCoverage(Chip8Fuzz::getCoverageCounterCount(), 0);
+    if (!inputFiles.empty()) {
+        for (const auto& filename : inputFiles) {
+            Input input;
+            if (!readFile(filename, input)) {
+                std::cerr << "could not read " << filename << "\n";
+                return 1;
+            }
+            std::cout << "Running " << filename << " (" << input.size() << " bytes)\n";
+            runInput(input, totalCoverage);
+        }
+        std::cout << "Executed " << inputFiles.size() << " inputs\n";
+        return 0;
+    }
+
+    std::mt19937_64 random(seed);
+    std::vector<Input> corpus;
+    corpus.push_back(Input(3, 0));
+    size_t coverage = 0;
+    const auto startTime = std::chrono::steady_clock::now();
+    Input input;
+    for (uint64_t run = 1; run <= runs; ++run) {
+        input = corpus[std::uniform_int_distribution<size_t>(0, corpus.size() - 1)(random)];
+        mutate(input, random);
+        const size_t newCoverage = runInput(input, totalCoverage);
+        if (newCoverage > 0) {
+            coverage += newCoverage;
+            corpus.push_back(input);
+        }
+        if ((run & (run - 1)) == 0 || run == runs) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            std::cout << "#" << run << "\tcov: " << coverage << "\tcorp: " << corpus.size()
+                << "\texec/s: " << static_cast<uint64_t>(static_cast<double>(run) / std::max(seconds, 1e-9)) << "\n";
+        }
+    }
+    return 0;
+}
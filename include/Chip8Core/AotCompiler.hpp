@@ -0,0 +1,81 @@
+/** @file
+  * @brief Contains the Chip8::AotCompiler class that translates a ROM to C++ source code.
+  */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Translates a ROM ahead of time to a C++ source file that is run by the AotRuntime.
+	 *
+	 * The blocks are found by the ControlFlowAnalysis, starting at the entry point of the ROM, at the targets of
+	 * the BNNN jumps whose V0 is set by a 60NN in the same block and at the additional entry points (e.g. targets
+	 * of other computed jumps, which the analysis cannot follow). Every basic block becomes a function that keeps
+	 * the registers it uses in local variables and returns the address to continue at to the dispatcher of the
+	 * runtime. Blocks also end after FX33 and FX55 (which can overwrite code) and before the instructions that
+	 * are left to the interpreter (FX0A and unknown opcodes).
+	 *
+	 * The generated file defines the AotRuntime::Program as a global constant with the given name and registers
+	 * it (see AotRuntime::findProgram()). It only depends on the header of the runtime.
+	*/
+	class AotCompiler {
+	public:
+		/**
+		 * @brief A block of the translation.
+		*/
+		struct Block {
+			uint16_t start; /**< The address of the first instruction. */
+			uint16_t end; /**< The address after the last translated instruction. */
+			uint16_t instructionCount; /**< The number of translated instructions. */
+		};
+
+	public:
+		/**
+		 * @brief Analyzes a ROM.
+		 * @param data The ROM (only the part that fits into the memory is translated).
+		 * @param size The size of the ROM in bytes.
+		 * @param entryPoints Addresses besides the start of the program that execution can reach.
+		*/
+		AotCompiler(const uint8_t* data, size_t size, const std::vector<uint16_t>& entryPoints = {});
+
+		/**
+		 * @brief Returns the blocks that will be translated.
+		 * @return The blocks, ordered by their start address.
+		*/
+		const std::vector<Block>& getBlocks() const noexcept;
+
+		/**
+		 * @brief Writes the C++ source file.
+		 * @param output The stream to write to.
+		 * @param symbol The name of the AotRuntime::Program constant (has to be a C++ identifier).
+		 * @param romName The name of the ROM (e.g. its file name) for the program and the comments.
+		*/
+		void writeSource(std::ostream& output, const std::string& symbol, const std::string& romName) const;
+
+		/**
+		 * @brief Derives the name of the program constant from the file name of a ROM ("games/Pong 2.ch8"
+		 *        becomes "Pong_2Program").
+		 * @param filename The file name.
+		 * @return The identifier.
+		*/
+		static std::string getDefaultSymbol(const std::string& filename);
+
+		/**
+		 * @brief Returns whether a name can be used as the name of the program constant.
+		 * @param symbol The name.
+		 * @return True if the name is a C++ identifier.
+		*/
+		static bool isValidSymbol(const std::string& symbol) noexcept;
+
+	private:
+		std::vector<uint8_t> mImage;
+		std::vector<Block> mBlocks;
+	};
+
+}
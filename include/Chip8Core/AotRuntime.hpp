@@ -0,0 +1,200 @@
+/** @file
+  * @brief Contains the Chip8::AotRuntime class that runs ROMs which have been translated to C++ ahead of time.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/Random.hpp"
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Runs a ROM that has been translated to C++ by the AotCompiler (see the Chip8Aot tool) on a Chip8
+	 *        instance.
+	 *
+	 * A translated ROM (an AotRuntime::Program) consists of one function per basic block. The runtime loads the
+	 * registers of the emulator, dispatches on the program counter to the function of the block that starts
+	 * there and writes the registers back when it returns. The display, the memory, the timers, the keys and the
+	 * random number generator are those of the emulator, so a frontend drives a translated ROM just like an
+	 * interpreted one: it sets the keys, calls run() instead of step() and clockTimers() as usual.
+	 *
+	 * Addresses without a block (targets of computed BNNN jumps that the analysis has not found), blocks whose
+	 * code has been overwritten by the program, blocks that do not fit into the remaining cycles and the
+	 * instructions the translation leaves out (FX0A, unknown opcodes, stack errors, memory accesses out of
+	 * bounds) are executed by the interpreter, one instruction at a time. The result is the same as calling
+	 * Chip8::step() for every cycle, including the cycle count, the random numbers and the exceptions. Only the
+	 * messages the interpreter logs for 0NNN are missing. If a profiler, tracer or debugger is attached, run()
+	 * interprets every instruction, so that the hooks see them.
+	*/
+	class AotRuntime {
+	public:
+		/**
+		 * @brief The machine state the functions of the blocks work on. The registers are copies (written back
+		 *        after run()), everything else points into the emulator.
+		*/
+		struct Machine {
+			std::array<uint8_t, 16> v; /**< The registers V0 to VF. */
+			uint16_t i; /**< The address register. */
+			uint16_t pc; /**< The program counter. */
+			std::array<uint16_t, Chip8::StackSize> stack; /**< The return addresses. */
+			uint8_t stackSize; /**< The number of return addresses on the stack. */
+			uint8_t delayTimer; /**< The delay timer. */
+			uint8_t soundTimer; /**< The sound timer. */
+			uint16_t pressedKeys; /**< The pressed keys, one bit per key. */
+			bool superChip; /**< Whether the SUPER-CHIP behavior of 8XY6, 8XYE, FX55 and FX65 is active. */
+			uint64_t cycleCount; /**< The number of executed cycles. */
+			Chip8Memory<uint8_t>* memory; /**< The memory of the emulator. */
+			Chip8::PackedDisplay* display; /**< The display of the emulator. */
+			RandomNumberGenerator* random; /**< The random number generator of the emulator. */
+			AotRuntime* runtime; /**< The runtime (keeps track of overwritten code). */
+		};
+
+		/**
+		 * @brief The function of a block. It executes the instructions of the block on the machine, adds them to
+		 *        the cycle count and sets the program counter to the address to continue at.
+		 * @return False if the instruction at the new program counter has to be interpreted.
+		*/
+		using BlockFunction = bool (*)(Machine& machine);
+
+		/**
+		 * @brief A translated basic block.
+		*/
+		struct Block {
+			uint16_t start; /**< The address of the first instruction. */
+			uint16_t end; /**< The address after the last instruction. */
+			uint16_t instructionCount; /**< The maximum number of instructions the function executes. */
+			BlockFunction function; /**< The translation. */
+		};
+
+		/**
+		 * @brief A translated ROM, as defined by the generated source file.
+		*/
+		struct Program {
+			const char* name; /**< The name of the ROM file. */
+			const uint8_t* image; /**< The ROM the blocks have been translated from. */
+			size_t imageSize; /**< The size of the ROM in bytes. */
+			const Block* blocks; /**< The blocks, ordered by their start address. */
+			size_t blockCount; /**< The number of blocks. */
+		};
+
+		/**
+		 * @brief Counters about how the cycles have been executed.
+		*/
+		struct Statistics {
+			uint64_t compiledCycles = 0; /**< Cycles executed by the functions of the blocks. */
+			uint64_t interpretedCycles = 0; /**< Cycles executed by the interpreter. */
+			uint64_t blockCalls = 0; /**< Number of functions that have been called. */
+		};
+
+	public:
+		/**
+		 * @brief Constructs a runtime for a translated ROM.
+		 * @param program The program (has to outlive the runtime).
+		*/
+		explicit AotRuntime(const Program& program);
+
+		/**
+		 * @brief Loads the ROM of the program into an emulator.
+		 * @param chip8 The emulator.
+		*/
+		void loadROM(Chip8& chip8) const;
+
+		/**
+		 * @brief Runs a number of cycles, with the same result as calling Chip8::step() for each of them. The
+		 *        emulator has to contain the ROM of the program (the memory may have been changed since).
+		 * @param chip8 The emulator.
+		 * @param cycles The number of cycles.
+		 * @return False if a cycle has returned false (the remaining cycles are not executed), true otherwise.
+		*/
+		bool run(Chip8& chip8, uint64_t cycles);
+
+		/**
+		 * @brief Returns how the cycles have been executed since the construction.
+		 * @return The counters.
+		*/
+		const Statistics& getStatistics() const noexcept;
+
+		/**
+		 * @brief Returns the program.
+		 * @return The program.
+		*/
+		const Program& getProgram() const noexcept;
+
+		/**
+		 * @brief Makes a program available to findProgram(). The generated source files register their program
+		 *        during static initialization.
+		 * @param program The program (has to stay alive, usually a global constant).
+		 * @return Always true (to initialize a global with).
+		*/
+		static bool registerProgram(const Program& program);
+
+		/**
+		 * @brief Looks for a registered program whose ROM is the one an emulator has loaded.
+		 * @param chip8 The emulator (compared right after loading the ROM).
+		 * @return The program, or nullptr if the ROM has not been translated.
+		*/
+		static const Program* findProgram(const Chip8& chip8);
+
+		/**
+		 * @brief Returns the registered programs.
+		 * @return The programs in the order of their registration.
+		*/
+		static const std::vector<const Program*>& getPrograms();
+
+		/**
+		 * @brief Draws a sprite (DXYN). Called by the translated code.
+		 * @param machine The machine.
+		 * @param address The address of the sprite (I; address + height must be within the memory).
+		 * @param x The x coordinate (VX).
+		 * @param y The y coordinate (VY).
+		 * @param height The number of rows (N).
+		 * @return The value of VF (1 if a pixel has been cleared, 0 otherwise).
+		*/
+		static uint8_t drawSprite(Machine& machine, uint16_t address, uint8_t x, uint8_t y, uint8_t height);
+
+		/**
+		 * @brief Writes a byte (FX33, FX55) and keeps track of overwritten code. Called by the translated code.
+		 * @param machine The machine.
+		 * @param address The address (within the memory).
+		 * @param value The value.
+		*/
+		static void store(Machine& machine, uint16_t address, uint8_t value);
+
+		/**
+		 * @brief Reads a byte (FX65). Called by the translated code.
+		 * @param machine The machine.
+		 * @param address The address (within the memory).
+		 * @return The value.
+		*/
+		static uint8_t load(const Machine& machine, uint16_t address) {
+			return machine.memory->read(address);
+		}
+
+	private:
+		void loadMachine(Chip8& chip8) noexcept;
+		void storeMachine(Chip8& chip8) const noexcept;
+		bool interpret(Chip8& chip8);
+		void verifyCode();
+		void updateModifiedCode(uint16_t address, size_t count);
+		bool isModified(const Block& block) const noexcept;
+
+	private:
+		const Program& mProgram;
+		std::vector<const Block*> mDispatchTable; ///< the block starting at each address (or nullptr)
+		std::bitset<Chip8::MemorySize> mCode; ///< the bytes the blocks have been translated from
+		std::vector<std::pair<uint16_t, uint16_t>> mCodeRanges; ///< the contiguous ranges of mCode (start, end)
+		std::bitset<Chip8::MemorySize> mModified; ///< the bytes of mCode that differ from the ROM
+		bool mHasModifiedCode; ///< whether any bit of mModified is set
+		Machine mMachine;
+		Statistics mStatistics;
+	};
+
+}
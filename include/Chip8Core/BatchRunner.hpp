@@ -0,0 +1,151 @@
+/** @file
+  * @brief Contains the types and functions to run many headless emulation jobs in parallel.
+  */
+#pragma once
+
+#include "Chip8Core/OpcodeHandler.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	class MemoryProfiler;
+	class Profiler;
+	class RomStore;
+	class ThreadPool;
+
+	/**
+	 * @brief Describes a single headless emulation run.
+	*/
+	struct BatchJob {
+		std::string romPath; /**< The ROM to run. */
+		CompatibilityMode compatibilityMode = CompatibilityMode::SuperChip; /**< The quirk profile. */
+		uint64_t cycleBudget = 100'000; /**< The number of cycles after which the job is stopped. */
+		std::string moviePath; /**< Optional input movie to replay (its initial state replaces the ROM). */
+		double timeLimit = 10.0; /**< Watchdog limit for the wall time of the job in seconds. */
+		uint64_t randomSeed = 0; /**< The seed of the random number generator. */
+		uint64_t cyclesPerFrame = 8; /**< The timers are clocked every this many cycles (unless a movie drives them). */
+		bool profile = false; /**< Whether to collect opcode statistics, the heat map and the memory accesses (see Profiler and MemoryProfiler). */
+		std::string tracePath; /**< Optional file to write an instruction trace to (see InstructionTracer). */
+	};
+
+	/**
+	 * @brief The reason why a job has stopped.
+	*/
+	enum class StopReason {
+		CycleBudgetReached,/**< the job ran for its complete cycle budget */
+		Halted,/**< the program has stopped (end of memory, zero instruction or critical error) */
+		TimeLimitExceeded,/**< the watchdog has stopped the job */
+		LoadFailed,/**< the ROM or the movie could not be loaded */
+		Crashed,/**< the program accessed memory out of bounds */
+	};
+
+	/**
+	 * @brief The outcome of a BatchJob.
+	*/
+	struct BatchResult {
+		StopReason stopReason = StopReason::LoadFailed; /**< Why the job has stopped. */
+		uint64_t cycles = 0; /**< The number of executed cycles. */
+		uint64_t displayHash = 0; /**< FNV-1a hash of the packed display at the end of the job. */
+		double wallTime = 0.0; /**< The wall time the job took in seconds. */
+		std::string message; /**< Details about errors, if any. */
+		std::shared_ptr<const Profiler> profiler; /**< The opcode statistics and the heat map, only set for jobs with BatchJob::profile. */
+		std::shared_ptr<const MemoryProfiler> memoryProfiler; /**< The memory accesses, only set for jobs with BatchJob::profile. */
+	};
+
+	/**
+	 * @brief Runs a single job on the calling thread.
+	 * @param job The job.
+	 * @param romStore The store to load the ROM through (optional). Jobs that share a store read
+	 *        every ROM file only once.
+	 * @return The result.
+	*/
+	BatchResult runBatchJob(const BatchJob& job, RomStore* romStore = nullptr);
+
+	/**
+	 * @brief Runs all jobs on a thread pool. The ROMs are loaded through a common RomStore.
+	 * @param jobs The jobs.
+	 * @param threadPool The pool to run the jobs on.
+	 * @return The results, in the same order as the jobs.
+	*/
+	std::vector<BatchResult> runBatchJobs(const std::vector<BatchJob>& jobs, ThreadPool& threadPool);
+
+	/**
+	 * @brief Parses a job manifest.
+	 *
+	 * Each line describes one job as comma separated fields: `rom[,profile[,cycles[,movie]]]`. The
+	 * profile is either `chip8` or `superchip`. Empty fields take the value from the default job.
+	 * Empty lines and lines starting with `#` are ignored, so a plain list of ROM files is a valid
+	 * manifest as well.
+	 * @param input The manifest.
+	 * @param defaultJob The job that provides the values of omitted fields.
+	 * @param error Receives a description of the first error, if any.
+	 * @return The jobs, or an empty optional on error.
+	*/
+	std::optional<std::vector<BatchJob>> parseBatchManifest(std::istream& input, const BatchJob& defaultJob, std::string& error);
+
+	/**
+	 * @brief Parses the name of a quirk profile (`chip8` or `superchip`).
+	 * @param name The name of the profile.
+	 * @return The compatibility mode, or an empty optional if the name is unknown.
+	*/
+	std::optional<CompatibilityMode> parseCompatibilityMode(const std::string& name);
+
+	/**
+	 * @brief Returns the name of a stop reason as used in the result files.
+	 * @param stopReason The stop reason.
+	 * @return The name.
+	*/
+	const char* getStopReasonName(StopReason stopReason) noexcept;
+
+	/**
+	 * @brief Writes jobs and their results as a JSON array.
+	 * @param output The stream to write to.
+	 * @param jobs The jobs.
+	 * @param results The results (same order and size as the jobs).
+	*/
+	void writeBatchResultsJson(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results);
+
+	/**
+	 * @brief Writes the opcode statistics of the profiled jobs as a JSON array with one object per job
+	 *        (see Profiler::writeJson()).
+	 * @param output The stream to write to.
+	 * @param jobs The jobs.
+	 * @param results The results (same order and size as the jobs).
+	*/
+	void writeBatchProfilesJson(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results);
+
+	/**
+	 * @brief Writes the heat maps of the profiled jobs as CSV with a header line. Each line contains
+	 *        a ROM, an address (in hex) and how often the instruction at the address has been executed;
+	 *        addresses that have never been executed are left out.
+	 * @param output The stream to write to.
+	 * @param jobs The jobs.
+	 * @param results The results (same order and size as the jobs).
+	*/
+	void writeBatchHeatMapsCsv(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results);
+
+	/**
+	 * @brief Writes the memory reports of the profiled jobs as a JSON array with one object per job
+	 *        (see MemoryProfiler::writeReportJson()).
+	 * @param output The stream to write to.
+	 * @param jobs The jobs.
+	 * @param results The results (same order and size as the jobs).
+	*/
+	void writeBatchMemoryReportsJson(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results);
+
+	/**
+	 * @brief Writes jobs and their results as CSV with a header line.
+	 * @param output The stream to write to.
+	 * @param jobs The jobs.
+	 * @param results The results (same order and size as the jobs).
+	*/
+	void writeBatchResultsCsv(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results);
+
+}
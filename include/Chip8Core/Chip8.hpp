@@ -6,6 +6,7 @@
 #include "Chip8Core/Memory.hpp"
 #include "Chip8Core/Instruction.hpp"
 #include "Chip8Core/OpcodeHandler.hpp"
+#include "Chip8Core/Random.hpp"
 
 #include <string>
 #include <array>
@@ -16,6 +17,14 @@
 
 namespace Chip8 {
 
+	class Debugger;
+	class ExecutionHistory;
+	class InputMovie;
+	class InstructionTracer;
+	class MemoryProfiler;
+	class Profiler;
+	class Rom;
+
 	/**
 	 * @brief This class represents the actual CHIP-8 and emulates it.
 	 * 
@@ -29,7 +38,14 @@ namespace Chip8 {
 		constexpr static uint16_t ProgramOffset = 0x0200; /**< This is the point in memory where execution starts.*/
 		constexpr static size_t DisplayWidth = 64u; /**< The width of the display in pixels.*/
 		constexpr static size_t DisplayHeight = 32u; /**< The height of the display in pixels.*/
+		constexpr static size_t MemorySize = 0x1000u; /**< The size of the addressable memory in bytes.*/
+		constexpr static size_t StackSize = 16u; /**< The maximum number of nested subroutine calls.*/
+		constexpr static size_t StateSize = MemorySize + DisplayWidth * DisplayHeight / 8u + 0x10u + 2u + 2u + 1u + 1u
+			+ StackSize * 2u + 1u + 1u + 2u + 1u + 1u + 8u + 8u + 8u; /**< The size of a serialized machine state in bytes.*/
+		constexpr static uint64_t DefaultRandomSeed = 0x43484950u; /**< The seed used by the random number generator unless another one is set.*/
 		using MemoryUnderlyingType = uint8_t; /**< Every addressable piece of memory is stored as this type. */
+		using State = std::array<uint8_t, StateSize>; /**< A serialized snapshot of the whole machine. */
+		using PackedDisplay = std::array<uint8_t, DisplayWidth * DisplayHeight / 8u>; /**< The display with one bit per pixel, row by row, most significant bit first. */
 
 	public:
 		/**
@@ -39,19 +55,53 @@ namespace Chip8 {
 
 		/**
 		 * @brief Resets the emulator to its initial state (registers, program counter,
-		 *        memory pointer, timers).
+		 *        memory pointer, timers, cycle counter). The random number generator is reseeded
+		 *        with the current seed.
 		 * @param alsoResetMemory Whether or not the contents of the memory should be cleared.
 		*/
 		void reset(bool alsoResetMemory = true) noexcept;
 
 		/**
 		 * @brief Loads a CHIP-8 ROM from disk and puts it into memory at the point of execution
-		 *        start. See Chip8::Chip8::ProgramOffset.
+		 *        start. See Chip8::Chip8::ProgramOffset. The file is memory-mapped instead of being
+		 *        read; use a RomStore to avoid accessing the file system for repeated loads.
 		 * @param filename The file to open.
 		 * @return True if the ROM could be loaded correctly. False otherwise.
 		*/
 		bool loadROM(const std::string& filename);
 
+		/**
+		 * @brief Resets the emulator and puts a ROM that is already in memory at the point of
+		 *        execution start. This avoids any file system access, e.g. when fuzzing.
+		 *        Bytes that do not fit into the memory are ignored.
+		 * @param data The contents of the ROM.
+		 * @param size The size of the ROM in bytes.
+		*/
+		void loadROM(const MemoryUnderlyingType* data, size_t size);
+
+		/**
+		 * @brief Resets the emulator and loads a prepared ROM (see Chip8::RomStore). The memory
+		 *        pages of the ROM are shared with the machine instead of being copied.
+		 * @param rom The ROM.
+		*/
+		void loadROM(const Rom& rom);
+
+		/**
+		 * @brief Serializes the complete machine state (memory, display, registers, timers, stack,
+		 *        keys and compatibility mode) into a fixed-size buffer.
+		 * @see loadState()
+		 * @param state The buffer to write the state into.
+		*/
+		void saveState(State& state) const noexcept;
+
+		/**
+		 * @brief Restores a machine state that has previously been written by saveState().
+		 * @see saveState()
+		 * @param state The serialized state.
+		 * @throws std::bad_alloc if a shared memory page has to be copied and the allocation fails.
+		*/
+		void loadState(const State& state);
+
 		/**
 		 * @brief Runs a simulation step for the emulator. This should be called several hundred
 		 *        times per second (depending on the program).
@@ -145,6 +195,7 @@ namespace Chip8 {
 		 * @brief Pushes a return address onto the internal stack. This function usually should
 		 *        not get called from outside.
 		 * @param returnAddress The return address to push onto the stack.
+		 * @throws std::overflow_error if the stack already holds Chip8::Chip8::StackSize entries.
 		*/
 		void stackPush(uint16_t returnAddress);
 
@@ -152,8 +203,9 @@ namespace Chip8 {
 		 * @brief Pops the return address off the top of the stack and returns it. This function usually should
 		 *        not get called from outside.
 		 * @return The popped off return address.
+		 * @throws std::underflow_error if the stack is empty.
 		*/
-		uint16_t stackPop() noexcept;
+		uint16_t stackPop();
 
 		/**
 		 * @brief Returns the instruction that will be executed during the next call to step().
@@ -177,6 +229,110 @@ namespace Chip8 {
 		*/
 		bool getPixel(size_t x, size_t y) const;
 
+		/**
+		 * @brief Returns the number of times step() has been called since the last reset.
+		 * @return The cycle count.
+		*/
+		uint64_t getCycleCount() const noexcept;
+
+		/**
+		 * @brief Sets the seed of the random number generator (used by CXNN) and reseeds it.
+		 * @param seed The seed.
+		*/
+		void seedRandom(uint64_t seed) noexcept;
+
+		/**
+		 * @brief Returns the seed of the random number generator.
+		 * @return The seed.
+		*/
+		uint64_t getRandomSeed() const noexcept;
+
+		/**
+		 * @brief Sets an input movie that records all key events and timer clocks from now on,
+		 *        together with the cycle they occurred at. The movie is not owned by the emulator.
+		 * @see InputMovie::startRecording()
+		 * @param recorder The movie to record into or nullptr to stop recording.
+		*/
+		void setInputRecorder(InputMovie* recorder) noexcept;
+
+		/**
+		 * @brief Returns the input movie that has been set with setInputRecorder().
+		 * @return The movie or nullptr.
+		*/
+		InputMovie* getInputRecorder() const noexcept;
+
+		/**
+		 * @brief Sets an execution history that records all key events and timer clocks from now on,
+		 *        independently of the input recorder. The history is not owned by the emulator.
+		 * @see ExecutionHistory::start()
+		 * @param history The history to record into or nullptr to stop recording.
+		*/
+		void setExecutionHistory(ExecutionHistory* history) noexcept;
+
+		/**
+		 * @brief Sets a profiler that records the execution time of every instruction from now on.
+		 *        The profiler is not owned by the emulator. Without CHIP8_ENABLE_PROFILING this does nothing.
+		 * @see Profiler
+		 * @param profiler The profiler to record into or nullptr to stop profiling.
+		*/
+		void setProfiler(Profiler* profiler) noexcept;
+
+		/**
+		 * @brief Returns the profiler that has been set with setProfiler().
+		 * @return The profiler or nullptr (always without CHIP8_ENABLE_PROFILING).
+		*/
+		Profiler* getProfiler() const noexcept;
+
+		/**
+		 * @brief Sets a tracer that records every executed instruction from now on (see TraceRecord).
+		 *        The tracer is not owned by the emulator. Without CHIP8_ENABLE_PROFILING this does nothing.
+		 * @see InstructionTracer
+		 * @param tracer The tracer to record into or nullptr to stop tracing.
+		*/
+		void setTracer(InstructionTracer* tracer) noexcept;
+
+		/**
+		 * @brief Returns the tracer that has been set with setTracer().
+		 * @return The tracer or nullptr (always without CHIP8_ENABLE_PROFILING).
+		*/
+		InstructionTracer* getTracer() const noexcept;
+
+		/**
+		 * @brief Sets a memory profiler that records the memory accesses of all instructions from now on.
+		 *        The profiler is not owned by the emulator. Without CHIP8_ENABLE_PROFILING this does nothing.
+		 * @see MemoryProfiler
+		 * @param profiler The profiler to record into or nullptr to stop profiling.
+		*/
+		void setMemoryProfiler(MemoryProfiler* profiler) noexcept;
+
+		/**
+		 * @brief Returns the memory profiler that has been set with setMemoryProfiler().
+		 * @return The profiler or nullptr (always without CHIP8_ENABLE_PROFILING).
+		*/
+		MemoryProfiler* getMemoryProfiler() const noexcept;
+
+		/**
+		 * @brief Sets a debugger that checks breakpoints and watchpoints after every instruction from now on.
+		 *        The debugger is not owned by the emulator. Usually the debugger sets itself while it has
+		 *        breakpoints (see Debugger::attach()). Without CHIP8_ENABLE_PROFILING this does nothing.
+		 * @see Debugger
+		 * @param debugger The debugger or nullptr to stop checking.
+		*/
+		void setDebugger(Debugger* debugger) noexcept;
+
+		/**
+		 * @brief Returns the debugger that has been set with setDebugger().
+		 * @return The debugger or nullptr (always without CHIP8_ENABLE_PROFILING).
+		*/
+		Debugger* getDebugger() const noexcept;
+
+		/**
+		 * @brief Returns the contents of the display with eight pixels packed into each byte. This
+		 *        is the format the display is stored in, so no conversion takes place.
+		 * @return The packed display.
+		*/
+		const PackedDisplay& getPackedDisplay() const noexcept;
+
 		/**
 		 * @brief Tells the emulator that a key has been pressed.
 		 * @param key The code of the key (0x0 to 0xF).
@@ -192,28 +348,62 @@ namespace Chip8 {
 		/**
 		 * @brief Returns whether a key is currently being held down.
 		 * @param key The code of the key (0x0 to 0xF).
-		 * @return True if the key is held down, false otherwise.
+		 * @return True if the key is held down, false otherwise (also for invalid key codes).
 		*/
 		bool isKeyPressed(uint8_t key) const noexcept;
 
+		/**
+		 * @brief Enables or disables the messages the emulator prints while running (unknown
+		 *        opcodes, stack errors, end of program). Logging is enabled by default.
+		 * @param enabled Whether to print messages.
+		*/
+		void setLoggingEnabled(bool enabled) noexcept;
+
+		/**
+		 * @brief Returns whether the emulator prints messages while running.
+		 * @return True if logging is enabled, false otherwise.
+		*/
+		bool isLoggingEnabled() const noexcept;
+
 	private:
 		void writeCharacterData();
+		bool executeInstruction(size_t opcodeIndex, Instruction instruction);
+		bool executeInstrumented(size_t opcodeIndex, Instruction instruction);
+		bool stopsAtEntry();
+		void updateInstrumented() noexcept;
 
 	private:
 		std::array<uint8_t, 16> mV; ///< registers V0 to VF
 		uint16_t mI; ///< 16 bit memory address register I
-		std::vector<uint16_t> mStack;
+		std::array<uint16_t, StackSize> mStack;
+		uint8_t mStackSize;
 		uint16_t mPC; ///< program counter
 		uint8_t mDelayTimer;
 		uint8_t mSoundTimer;
 		Chip8Memory<uint8_t> mMemory;
 		CompatibilityMode mCompatibilityMode;
-		std::bitset<DisplayWidth * DisplayHeight> mDisplayMemory;
+		PackedDisplay mDisplayMemory; ///< one bit per pixel, see PackedDisplay
 		std::bitset<0x10> mPressedKeys;
 		bool mAwaitingKeyPress;
 		uint8_t mKeyPressRegisterTarget;
-
+		uint64_t mCycleCount;
+		uint64_t mRandomSeed;
+		RandomNumberGenerator mRandom;
+		InputMovie* mInputRecorder;
+		ExecutionHistory* mExecutionHistory;
+#ifdef CHIP8_ENABLE_PROFILING
+		Profiler* mProfiler;
+		InstructionTracer* mTracer;
+		MemoryProfiler* mMemoryProfiler;
+		Debugger* mDebugger;
+		bool mInstrumented; ///< whether any of the hooks is set, so that step() needs a single branch
+		bool mEntryChecked; ///< whether the breakpoint at the first instruction since the reset has been checked
+#endif
+		bool mLoggingEnabled;
+
+		friend class AotRuntime;
 		friend class OpcodeHandler;
+		friend class VectorMachine;
 
 		static constexpr uint8_t Characters[] = {
 			0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
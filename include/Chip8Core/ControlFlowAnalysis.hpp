@@ -0,0 +1,173 @@
+/** @file
+  * @brief Contains the Chip8::ControlFlowAnalysis class that separates the code of a ROM from its data
+  *        without running it.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/Hash.hpp"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A static analysis of the memory of an emulator (usually right after loading a ROM) that builds
+	 *        the control-flow graph from the entry point and classifies every address.
+	 *
+	 * The analysis follows jumps (1NNN), calls (2NNN, assuming that the subroutine returns), returns (00EE)
+	 * and both successors of the skip instructions. Indirect jumps (BNNN) cannot be followed; they are
+	 * reported, and code that is only reached through them is classified as unknown. Along the paths, the
+	 * analysis tracks the value of I as far as it is set by ANNN, so that DXYN marks the bytes it draws as
+	 * sprite data. Addresses that are neither are unknown (unreachable code, other data or padding).
+	*/
+	class ControlFlowAnalysis {
+	public:
+		/**
+		 * @brief The number of addresses that are classified.
+		*/
+		static constexpr size_t AddressCount = Chip8::MemorySize;
+
+		/**
+		 * @brief What an address has been found to contain. An address that is both executed and drawn is code.
+		*/
+		enum class ByteKind : uint8_t {
+			Unknown,/**< neither reachable code nor drawn as a sprite */
+			Code,/**< part of a reachable instruction */
+			Sprite,/**< drawn by a DXYN whose I has been set by an ANNN */
+		};
+
+		/**
+		 * @brief How a basic block ends.
+		*/
+		enum class Terminator : uint8_t {
+			FallThrough,/**< the next instruction starts another block (it is the target of a branch) */
+			Jump,/**< 1NNN */
+			Call,/**< 2NNN, the successors are the subroutine and the return address */
+			Return,/**< 00EE */
+			Skip,/**< 3XNN, 4XNN, 5XY0, 9XY0, EX9E or EXA1, the successors are the next two instructions */
+			IndirectJump,/**< BNNN, the successors are unknown */
+			Halt,/**< a zero instruction, an unknown opcode or the end of the memory */
+		};
+
+		/**
+		 * @brief A basic block: a sequence of instructions that is only entered at its start and only left at its end.
+		*/
+		struct Block {
+			uint16_t start; /**< The address of the first instruction. */
+			uint16_t end; /**< The address after the last instruction. */
+			Terminator terminator; /**< How the block ends. */
+			std::vector<uint16_t> successors; /**< The addresses of the blocks that can follow. */
+
+			bool operator==(const Block& other) const noexcept; /**< Compares all fields. */
+		};
+
+	public:
+		/**
+		 * @brief Constructs an empty analysis in which every address is unknown.
+		*/
+		ControlFlowAnalysis();
+
+		/**
+		 * @brief Analyzes a memory.
+		 * @param memory The memory, e.g. of an emulator that has just loaded a ROM.
+		 * @param entry The address execution starts at.
+		 * @return The analysis.
+		*/
+		static ControlFlowAnalysis analyze(const Chip8Memory<uint8_t>& memory, uint16_t entry = Chip8::ProgramOffset);
+
+		/**
+		 * @brief Returns the analysis of a ROM from a cache directory, or analyzes the memory and stores the result
+		 *        in the cache. The files are named after the hash of the ROM, so the analysis of a ROM is only
+		 *        computed once, no matter where the ROM file is located. Only the classification and the blocks
+		 *        are cached; the disassembly is always generated from the memory.
+		 * @param directory The cache directory (created if it does not exist).
+		 * @param hash The SHA-1 hash of the ROM (see Rom::getHash()).
+		 * @param memory The memory of an emulator that has just loaded the ROM.
+		 * @return The analysis.
+		*/
+		static ControlFlowAnalysis analyzeCached(const std::string& directory, const Sha1Digest& hash, const Chip8Memory<uint8_t>& memory);
+
+		/**
+		 * @brief Returns what an address contains.
+		 * @param address The address.
+		 * @return The kind of the byte.
+		*/
+		ByteKind getByteKind(uint16_t address) const noexcept;
+
+		/**
+		 * @brief Returns whether a reachable instruction starts at an address. Instructions that are only
+		 *        reached through an odd jump target can overlap others.
+		 * @param address The address.
+		 * @return True if an instruction starts at the address.
+		*/
+		bool isInstructionStart(uint16_t address) const noexcept;
+
+		/**
+		 * @brief Returns the number of addresses of a kind.
+		 * @param kind The kind.
+		 * @return The number of addresses.
+		*/
+		size_t countBytes(ByteKind kind) const noexcept;
+
+		/**
+		 * @brief Returns the basic blocks.
+		 * @return The blocks, ordered by their start address.
+		*/
+		const std::vector<Block>& getBlocks() const noexcept;
+
+		/**
+		 * @brief Returns the block that contains an instruction.
+		 * @param address The address of the instruction.
+		 * @return The block, or nullptr if no reachable instruction starts at the address.
+		*/
+		const Block* findBlock(uint16_t address) const noexcept;
+
+		/**
+		 * @brief Returns the addresses of the reachable indirect jumps (BNNN).
+		 * @return The addresses in ascending order.
+		*/
+		std::vector<uint16_t> getIndirectJumps() const;
+
+		/**
+		 * @brief Writes the control-flow graph in the DOT language of Graphviz, one node per block with
+		 *        its disassembly.
+		 * @param output The stream to write to.
+		*/
+		void writeDot(std::ostream& output) const;
+
+		/**
+		 * @brief Writes the analysis to disk.
+		 * @param filename The file to write.
+		 * @return True on success, false otherwise.
+		*/
+		bool save(const std::string& filename) const;
+
+		/**
+		 * @brief Reads an analysis that has been written by save().
+		 * @param filename The file to read.
+		 * @param memory The memory that has been analyzed; the disassembly of the blocks is generated from it.
+		 * @return True on success, false if the file is missing, malformed or written by another version.
+		*/
+		bool load(const std::string& filename, const Chip8Memory<uint8_t>& memory);
+
+		/**
+		 * @brief Returns the name of a terminator ("fall-through", "jump", "call", ...).
+		 * @param terminator The terminator.
+		 * @return The name.
+		*/
+		static const char* getTerminatorName(Terminator terminator) noexcept;
+
+	private:
+		std::vector<ByteKind> mKinds;
+		std::bitset<AddressCount> mInstructionStarts;
+		std::vector<Block> mBlocks;
+		std::vector<std::string> mBlockText; ///< the disassembly of each block (for writeDot())
+	};
+
+}
@@ -0,0 +1,223 @@
+/** @file
+  * @brief Contains the Chip8::Debugger class that stops the emulation at breakpoints and watchpoints,
+  *        and the compiler for breakpoint conditions.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A compiled breakpoint condition. It returns whether the breakpoint is hit in the state of an emulator.
+	*/
+	using Condition = std::function<bool(const Chip8&)>;
+
+	/**
+	 * @brief Compiles a condition like `V3 == 0x10 && I >= 0x300` into a predicate, so that checking it
+	 *        does not parse anything. A condition consists of comparisons (`==`, `!=`, `<`, `<=`, `>`, `>=`)
+	 *        joined by `&&` and `||` (`&&` binds stronger). The operands are the registers `V0` to `VF`,
+	 *        `I`, `PC`, `DT`, `ST` and decimal or hexadecimal (`0x`) numbers.
+	 * @param text The condition.
+	 * @param error Receives a description of the error, if any.
+	 * @return The predicate, or an empty optional on error.
+	*/
+	std::optional<Condition> compileCondition(const std::string& text, std::string& error);
+
+	/**
+	 * @brief Stops the emulation when the program counter reaches a breakpoint (optionally only if its
+	 *        condition holds) or when an instruction writes a watched address or register.
+	 *
+	 * Checking breakpoints and watchpoints costs time for every instruction, so the emulator only checks
+	 * them on its instrumented path: the debugger attaches itself to its emulator (see attach()) while it
+	 * has at least one breakpoint or watchpoint and detaches itself when the last one is removed. The checks
+	 * are bitmaps over the address space and a mask of the registers. The emulator does not halt at a
+	 * stop; it finishes the instruction and the caller asks takeStop() whether to pause. The only exception is
+	 * a breakpoint at the first instruction after a reset, which no other instruction leads to: the first
+	 * step() only checks it and executes nothing if it is hit (see checkEntry()). The hook is only
+	 * compiled into the emulator if CHIP8_ENABLE_PROFILING is defined (see Profiler::Enabled).
+	*/
+	class Debugger {
+	public:
+		/**
+		 * @brief The number of addresses a breakpoint or a watchpoint can be set at.
+		*/
+		static constexpr size_t AddressCount = Chip8::MemorySize;
+
+		/**
+		 * @brief Why the emulation has been stopped.
+		*/
+		enum class StopReason {
+			Breakpoint,/**< the program counter has reached a breakpoint */
+			MemoryWatch,/**< an instruction has written a watched address */
+			RegisterWatch,/**< an instruction has changed a watched register */
+		};
+
+		/**
+		 * @brief Describes a stop.
+		*/
+		struct Stop {
+			StopReason reason; /**< Why the emulation has been stopped. */
+			uint16_t address; /**< The address of the instruction that has caused the stop. */
+			uint16_t target; /**< The breakpoint address, the written address or the register number. */
+			uint64_t cycle; /**< The cycle of the instruction (see Chip8::getCycleCount()). */
+		};
+
+	public:
+		/**
+		 * @brief Constructs a debugger without breakpoints that is not attached to an emulator.
+		*/
+		Debugger() noexcept;
+
+		Debugger(const Debugger&) = delete;
+		Debugger& operator=(const Debugger&) = delete;
+
+		/**
+		 * @brief Sets the emulator the debugger stops. The debugger is set as the debugger of the emulator
+		 *        whenever it has breakpoints or watchpoints (see Chip8::setDebugger()). Neither owns the other
+		 *        and the destructor does not touch the emulator, which may already be gone: a debugger that
+		 *        is destroyed before an emulator that keeps running has to be detached first.
+		 * @param chip8 The emulator (not owned) or nullptr to detach.
+		*/
+		void attach(Chip8* chip8) noexcept;
+
+		/**
+		 * @brief Returns whether there are neither breakpoints nor watchpoints.
+		 * @return True if the debugger has nothing to check.
+		*/
+		bool isEmpty() const noexcept;
+
+		/**
+		 * @brief Removes all breakpoints and watchpoints and the pending stop.
+		*/
+		void clear() noexcept;
+
+		/**
+		 * @brief Sets an unconditional breakpoint (replacing the condition of an existing one).
+		 * @param address The address.
+		*/
+		void setBreakpoint(uint16_t address);
+
+		/**
+		 * @brief Sets a breakpoint that is only hit if a condition holds (see compileCondition()).
+		 * @param address The address.
+		 * @param condition The condition, or an empty string for an unconditional breakpoint.
+		 * @param error Receives a description of the error, if any.
+		 * @return True if the condition could be compiled and the breakpoint has been set, otherwise false.
+		*/
+		bool setBreakpoint(uint16_t address, const std::string& condition, std::string& error);
+
+		/**
+		 * @brief Removes a breakpoint.
+		 * @param address The address.
+		*/
+		void removeBreakpoint(uint16_t address);
+
+		/**
+		 * @brief Returns whether a breakpoint is set at an address.
+		 * @param address The address.
+		 * @return True if there is a breakpoint.
+		*/
+		bool hasBreakpoint(uint16_t address) const noexcept;
+
+		/**
+		 * @brief Returns the condition of a breakpoint as it has been written.
+		 * @param address The address.
+		 * @return The condition, or an empty string for an unconditional breakpoint.
+		*/
+		std::string getCondition(uint16_t address) const;
+
+		/**
+		 * @brief Returns the addresses of all breakpoints.
+		 * @return The addresses in ascending order.
+		*/
+		std::vector<uint16_t> getBreakpoints() const;
+
+		/**
+		 * @brief Watches or stops watching writes to a range of addresses.
+		 * @param address The first address.
+		 * @param count The number of addresses.
+		 * @param watched Whether to watch the addresses.
+		*/
+		void setMemoryWatch(uint16_t address, size_t count, bool watched);
+
+		/**
+		 * @brief Returns whether writes to an address are watched.
+		 * @param address The address.
+		 * @return True if the address is watched.
+		*/
+		bool isMemoryWatched(uint16_t address) const noexcept;
+
+		/**
+		 * @brief Watches or stops watching changes of a register.
+		 * @param registerNumber The register (0x0 to 0xF).
+		 * @param watched Whether to watch the register.
+		*/
+		void setRegisterWatch(uint8_t registerNumber, bool watched);
+
+		/**
+		 * @brief Returns the watched registers.
+		 * @return A mask with bit n set if Vn is watched.
+		*/
+		uint16_t getRegisterWatchMask() const noexcept;
+
+		/**
+		 * @brief Returns the first stop since the last call and forgets it.
+		 * @return The stop, or an empty optional if the emulation has not been stopped.
+		*/
+		std::optional<Stop> takeStop() noexcept;
+
+		/**
+		 * @brief Checks the watched registers and the breakpoint at the new program counter after an
+		 *        instruction. This is called by the emulator.
+		 * @param chip8 The emulator.
+		 * @param address The address of the instruction.
+		 * @param changedRegisters The registers the instruction has changed (bit n for Vn).
+		*/
+		void checkInstruction(const Chip8& chip8, uint16_t address, uint16_t changedRegisters);
+
+		/**
+		 * @brief Checks the breakpoint at the program counter before the first instruction after a reset. This
+		 *        is called by the emulator.
+		 * @param chip8 The emulator.
+		 * @return True if the breakpoint has been hit, so that the instruction must not be executed yet.
+		*/
+		bool checkEntry(const Chip8& chip8);
+
+		/**
+		 * @brief Checks the watched addresses when an instruction writes to memory. This is called by the emulator.
+		 * @param chip8 The emulator.
+		 * @param address The first written address.
+		 * @param count The number of written bytes.
+		*/
+		void checkMemoryWrite(const Chip8& chip8, uint16_t address, size_t count) noexcept;
+
+	private:
+		struct ConditionalBreakpoint {
+			std::string text;
+			Condition condition;
+		};
+
+		bool isBreakpointHit(const Chip8& chip8, uint16_t programCounter) const;
+		void stop(StopReason reason, uint16_t address, uint16_t target, uint64_t cycle) noexcept;
+		void updateAttachment() noexcept;
+
+	private:
+		Chip8* mChip8;
+		std::bitset<AddressCount> mBreakpoints;
+		std::unordered_map<uint16_t, ConditionalBreakpoint> mConditions; ///< only breakpoints with a condition
+		std::bitset<AddressCount> mWatchedAddresses;
+		uint16_t mWatchedRegisters; ///< bit n for Vn
+		std::optional<Stop> mStop;
+	};
+
+}
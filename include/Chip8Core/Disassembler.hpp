@@ -0,0 +1,83 @@
+/** @file
+  * @brief Contains the functions to turn CHIP-8 instructions into assembly mnemonics.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/Instruction.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Disassembles a single instruction into the common mnemonics (e.g. `DRW V0, V1, 5`). Unknown
+	 *        opcodes are shown as data words (`DW 0x5AB1`).
+	 * @param instruction The instruction.
+	 * @return The mnemonic with its operands.
+	*/
+	std::string disassemble(Instruction instruction);
+
+	/**
+	 * @brief A disassembly of the whole address space with one line per address (every address can be the
+	 *        start of an instruction, since jumps are not restricted to even addresses).
+	 *
+	 * The listing is built by the first call to update(). Later calls only disassemble the addresses whose
+	 * bytes have changed: the listing keeps a reference to every page of the memory it has disassembled, so
+	 * a write of the emulator duplicates the page (see Chip8Memory) and the pages that still have the same
+	 * pointer are known to be unchanged without comparing them.
+	*/
+	class DisassemblyListing {
+	public:
+		/**
+		 * @brief The number of lines (the whole address space).
+		*/
+		static constexpr size_t AddressCount = Chip8::MemorySize;
+
+	public:
+		/**
+		 * @brief Constructs an empty listing. The lines are only valid after update() has been called.
+		*/
+		DisassemblyListing();
+
+		/**
+		 * @brief Brings the listing up to date with a memory.
+		 * @param memory The memory to disassemble.
+		 * @return The number of lines that have been disassembled again.
+		*/
+		size_t update(const Chip8Memory<uint8_t>& memory);
+
+		/**
+		 * @brief Forces the next call to update() to disassemble the whole address space again.
+		*/
+		void invalidate() noexcept;
+
+		/**
+		 * @brief Returns the instruction that starts at an address. The byte after the last address is read as zero.
+		 * @param address The address.
+		 * @return The instruction.
+		*/
+		Instruction getInstruction(uint16_t address) const;
+
+		/**
+		 * @brief Returns the mnemonic of the instruction that starts at an address (see disassemble()).
+		 * @param address The address.
+		 * @return The mnemonic.
+		*/
+		const std::string& getLine(uint16_t address) const;
+
+	private:
+		using Page = Chip8Memory<uint8_t>::Page;
+
+		uint8_t readByte(size_t address) const noexcept;
+		void disassembleLine(size_t address);
+
+	private:
+		std::array<std::shared_ptr<const Page>, Chip8Memory<uint8_t>::PageCount> mPages; ///< the pages the lines have been disassembled from (null if invalid)
+		std::vector<std::string> mLines;
+	};
+
+}
@@ -0,0 +1,117 @@
+/** @file
+  * @brief Contains the Chip8::VectorEnvironment class, a batched step/reset interface for agents.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+
+	class ThreadPool;
+
+	/**
+	 * @brief What happened to a single environment during VectorEnvironment::step().
+	*/
+	struct EnvironmentInfo {
+		bool done = false; /**< The program has halted or crashed. The environment stays done until it is reset. */
+		bool crashed = false; /**< The program has accessed memory out of bounds. */
+		uint8_t soundTimer = 0; /**< The sound timer after the step (non-zero while the buzzer sounds). */
+		uint64_t cycleCount = 0; /**< The cycle count of the machine after the step. */
+		uint64_t frameCount = 0; /**< The number of frames since the last reset. */
+	};
+
+	/**
+	 * @brief Runs K copies of a machine as environments for agents that interact with them in a
+	 *        step(actions) -> (observations, infos) loop.
+	 *
+	 * An action is the set of keys held down during the step (bit n stands for key n). Each step
+	 * runs a number of frames (frame skip), clocking the timers after every frame, and then writes
+	 * the packed display of every environment into a caller-provided buffer of
+	 * getEnvironmentCount() * ObservationSize bytes. Since the display is stored packed, this is a
+	 * single copy of 256 bytes per environment; the buffer may live in SharedMemory so that another
+	 * process reads the observations directly.
+	 *
+	 * All environments start as copies of the initial machine without its hooks (input recorder,
+	 * execution history, profilers and debugger). Resets restore that copy, which only
+	 * shares the copy-on-write memory pages, and reseed the random number generator so that the
+	 * episodes differ.
+	*/
+	class VectorEnvironment {
+	public:
+		constexpr static size_t ObservationSize = sizeof(Chip8::PackedDisplay); /**< The size of a single observation in bytes.*/
+
+	public:
+		/**
+		 * @brief Creates the environments.
+		 * @param environmentCount The number of environments.
+		 * @param initialMachine The machine every environment starts as (usually with a ROM loaded).
+		 * @param cyclesPerFrame The number of cycles run between two timer clocks.
+		 * @param threadPool If given, the environments are stepped in parallel on this pool. It has
+		 *        to outlive the environment.
+		*/
+		VectorEnvironment(size_t environmentCount, const Chip8& initialMachine, size_t cyclesPerFrame = 10,
+			ThreadPool* threadPool = nullptr);
+
+		/**
+		 * @brief Returns the number of environments.
+		 * @return The number of environments.
+		*/
+		size_t getEnvironmentCount() const noexcept;
+
+		/**
+		 * @brief Returns the size the observation buffer must have.
+		 * @return The size in bytes.
+		*/
+		size_t getObservationBufferSize() const noexcept;
+
+		/**
+		 * @brief Resets all environments and writes their initial observations.
+		 * @param observations The observation buffer.
+		*/
+		void reset(uint8_t* observations);
+
+		/**
+		 * @brief Resets the given environments and writes their initial observations. The
+		 *        observations of the other environments are left untouched.
+		 * @param environments The indices of the environments to reset.
+		 * @param observations The observation buffer.
+		*/
+		void reset(const std::vector<size_t>& environments, uint8_t* observations);
+
+		/**
+		 * @brief Runs all environments that are not done.
+		 * @param actions One key mask per environment.
+		 * @param frameSkip The number of frames to run.
+		 * @param observations The observation buffer.
+		 * @param infos Receives one info per environment (may be nullptr).
+		*/
+		void step(const uint16_t* actions, size_t frameSkip, uint8_t* observations, EnvironmentInfo* infos);
+
+		/**
+		 * @brief Gives access to the machine of an environment, for example for debugging.
+		 * @param environment The index of the environment.
+		 * @return The machine.
+		*/
+		const Chip8& getMachine(size_t environment) const noexcept;
+
+	private:
+		void resetEnvironment(size_t environment, uint8_t* observations);
+		void stepEnvironment(size_t environment, uint16_t action, size_t frameSkip, uint8_t* observations, EnvironmentInfo* infos);
+
+	private:
+		Chip8 mInitialMachine;
+		size_t mCyclesPerFrame;
+		ThreadPool* mThreadPool;
+		std::vector<Chip8> mMachines;
+		std::vector<uint16_t> mPressedKeys;
+		std::vector<uint64_t> mEpisodes;
+		std::vector<uint64_t> mFrameCounts;
+		std::vector<uint8_t> mDone;
+		std::vector<uint8_t> mCrashed;
+	};
+
+}
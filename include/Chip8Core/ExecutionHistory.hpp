@@ -0,0 +1,155 @@
+/** @file
+  * @brief Contains the Chip8::ExecutionHistory class that allows to step and run the emulation backwards.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/InputMovie.hpp"
+#include "Chip8Core/RewindBuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace Chip8 {
+
+	class Debugger;
+
+	/**
+	 * @brief Records the execution of an emulator so that it can be restored to any cycle of the recent past
+	 *        (time-travel debugging).
+	 *
+	 * The history takes a checkpoint (a saved state) every few cycles and records the input in between,
+	 * like an InputMovie. The checkpoint states are stored in a RewindBuffer, so each one only costs the
+	 * delta to its predecessor. Since the emulation is deterministic (including the random number generator,
+	 * whose state is part of the checkpoints), restoring the last checkpoint before a cycle and executing
+	 * the instructions up to it reproduces the machine exactly. Reaching any cycle therefore costs at most
+	 * one checkpoint interval of re-execution.
+	 *
+	 * The history is attached to the emulator with start() and records the input from then on; the caller
+	 * has to call update() after every step (or at least once per checkpoint interval). Restoring a cycle
+	 * discards the history after it, like RewindBuffer does. The oldest checkpoints are dropped to keep the
+	 * history below its memory budget, but never the newest keyframe group of the buffer.
+	*/
+	class ExecutionHistory {
+	public:
+		constexpr static size_t DefaultMemoryBudget = 16u * 1024u * 1024u; /**< Default memory budget in bytes. */
+		constexpr static uint64_t DefaultCheckpointInterval = 1024u; /**< Default number of cycles between two checkpoints. */
+
+	public:
+		/**
+		 * @brief Constructs an empty history.
+		 * @param memoryBudget The maximum number of bytes the checkpoints and the recorded input may occupy.
+		 * @param checkpointInterval The number of cycles between two checkpoints.
+		*/
+		explicit ExecutionHistory(size_t memoryBudget = DefaultMemoryBudget,
+			uint64_t checkpointInterval = DefaultCheckpointInterval);
+
+		ExecutionHistory(const ExecutionHistory&) = delete;
+		ExecutionHistory& operator=(const ExecutionHistory&) = delete;
+
+		/**
+		 * @brief Discards the history, takes the first checkpoint and attaches the history to the emulator
+		 *        as its execution history. This has to be called again whenever the state of the emulator is
+		 *        changed by other means than executing it (e.g. loading a ROM or a state).
+		 * @param chip8 The emulator to record.
+		*/
+		void start(Chip8& chip8);
+
+		/**
+		 * @brief Detaches the history from the emulator and discards it.
+		 * @param chip8 The emulator that has been recorded.
+		*/
+		void stop(Chip8& chip8) noexcept;
+
+		/**
+		 * @brief Takes a checkpoint if the emulator has advanced by the checkpoint interval since the last one.
+		 * @param chip8 The recorded emulator.
+		*/
+		void update(const Chip8& chip8);
+
+		/**
+		 * @brief Appends an input event. This is called by the emulator while it is recorded.
+		 * @param event The event.
+		*/
+		void recordEvent(const InputMovie::Event& event);
+
+		/**
+		 * @brief Restores the emulator to the state right after the instruction of a cycle (before the input of
+		 *        that cycle). The history after the cycle is discarded.
+		 * @param chip8 The recorded emulator.
+		 * @param cycle The cycle, between getFirstCycle() and the current cycle of the emulator.
+		 * @return True on success, false if the cycle is out of range.
+		*/
+		bool seek(Chip8& chip8, uint64_t cycle);
+
+		/**
+		 * @brief Restores the state before the last instruction.
+		 * @param chip8 The recorded emulator.
+		 * @return True on success, false if the history does not reach back far enough.
+		*/
+		bool stepBack(Chip8& chip8);
+
+		/**
+		 * @brief Restores the most recent state before the current one in which the debugger has stopped the
+		 *        emulation, e.g. the program counter at a breakpoint (see Debugger::Stop). The history is
+		 *        re-executed with the debugger attached; without CHIP8_ENABLE_PROFILING it never stops.
+		 * @param chip8 The recorded emulator.
+		 * @param debugger The debugger whose breakpoints and watchpoints are checked.
+		 * @return True on success, false if the debugger has not stopped within the history.
+		*/
+		bool reverseContinue(Chip8& chip8, Debugger& debugger);
+
+		/**
+		 * @brief Restores the state before the most recent instruction that has written an address, so that
+		 *        the program counter points to that instruction. Like reverseContinue(), this needs the debugging
+		 *        hooks (CHIP8_ENABLE_PROFILING).
+		 * @param chip8 The recorded emulator.
+		 * @param address The address.
+		 * @return True on success, false if the address has not been written within the history.
+		*/
+		bool runBackToLastWrite(Chip8& chip8, uint16_t address);
+
+		/**
+		 * @brief Returns the oldest cycle that can be restored.
+		 * @return The cycle of the oldest checkpoint (0 if the history is empty).
+		*/
+		uint64_t getFirstCycle() const noexcept;
+
+		/**
+		 * @brief Returns the number of checkpoints.
+		 * @return The number of checkpoints.
+		*/
+		size_t getCheckpointCount() const noexcept;
+
+		/**
+		 * @brief Returns the number of bytes occupied by the checkpoints and the recorded input.
+		 * @return The memory usage in bytes.
+		*/
+		size_t getMemoryUsage() const noexcept;
+
+	private:
+		struct Checkpoint {
+			uint64_t cycle;
+			uint64_t eventIndex; ///< the number of events recorded before the checkpoint
+		};
+
+		size_t findCheckpoint(uint64_t cycle) const noexcept;
+		uint64_t replay(Chip8& chip8, size_t checkpointIndex, uint64_t cycle);
+		void pushCheckpoint(const Chip8& chip8);
+		void applyEvents(Chip8& chip8, uint64_t& eventIndex) const noexcept;
+		bool findLastStop(Chip8& chip8, Debugger& debugger, uint64_t lastCycle, uint64_t& stopCycle);
+		void truncate(uint64_t cycle, uint64_t eventIndex);
+		void enforceMemoryBudget();
+
+	private:
+		std::deque<Checkpoint> mCheckpoints; ///< one per frame of mStates
+		RewindBuffer mStates;
+		std::deque<InputMovie::Event> mEvents;
+		uint64_t mFirstEventIndex; ///< the index of mEvents.front() among all events ever recorded
+		size_t mMemoryBudget;
+		uint64_t mCheckpointInterval;
+		bool mReplaying; ///< input applied during re-execution is already recorded
+	};
+
+}
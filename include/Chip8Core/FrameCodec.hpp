@@ -0,0 +1,178 @@
+/** @file
+  * @brief Contains the wire format of the framebuffer stream: run-length encoding, the
+  *        Chip8::FrameEncoder and Chip8::FrameDecoder classes and the key event messages.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief The type of a stream message (the first byte of every message).
+	 *
+	 * All multi-byte fields are little endian. Frame messages (server to client) are
+	 * `type:u8 sequence:u32 inputEcho:i64 dirtyRows:u32 rle...` where bit n of dirtyRows tells
+	 * whether row n is part of the message and the run-length encoded payload contains the
+	 * packed bytes of the dirty rows in ascending order. Key event messages (client to server)
+	 * are `type:u8 key:u8 pressed:u8 time:i64`.
+	*/
+	enum class StreamMessageType : uint8_t {
+		Keyframe = 1,/**< a frame containing all rows */
+		Delta = 2,/**< a frame containing only the rows that have changed since the previous frame */
+		KeyEvent = 3,/**< a key has been pressed or released on the client */
+	};
+
+	constexpr std::array<uint8_t, 4> StreamHello = { 'C', '8', 'S', 0x01 }; /**< Sent by plain TCP clients after connecting (the last byte is the protocol version). */
+	constexpr size_t StreamFrameHeaderSize = 1u + 4u + 8u + 4u; /**< The size of a frame message without payload. */
+	constexpr size_t StreamKeyEventSize = 1u + 1u + 1u + 8u; /**< The size of a key event message. */
+	constexpr size_t StreamRowSize = Chip8::DisplayWidth / 8u; /**< The number of bytes of a packed display row. */
+	static_assert(Chip8::DisplayHeight <= 32u, "the dirty rows must fit into 32 bits");
+
+	/**
+	 * @brief A key event sent from a client to the server.
+	*/
+	struct StreamKeyEvent {
+		uint8_t key; /**< The code of the key (0x0 to 0xF). */
+		bool pressed; /**< True if the key has been pressed, false if it has been released. */
+		int64_t time; /**< The time of the event on the clock of the client (echoed back in the frames). */
+	};
+
+	/**
+	 * @brief Appends the PackBits encoding of a block of memory: a control byte n < 128 is followed by
+	 *        n + 1 literal bytes, a control byte n > 128 is followed by one byte that is repeated 257 - n times.
+	 * @param data Pointer to the data.
+	 * @param size The size of the data in bytes.
+	 * @param output The buffer to append to.
+	*/
+	void encodeRle(const uint8_t* data, size_t size, std::vector<uint8_t>& output);
+
+	/**
+	 * @brief Decodes data that has been written by encodeRle().
+	 * @param data Pointer to the encoded data.
+	 * @param size The size of the encoded data in bytes.
+	 * @param output Receives the decoded bytes.
+	 * @param outputSize The exact number of bytes the data must decode to.
+	 * @return True on success, false if the data is malformed or does not decode to outputSize bytes.
+	*/
+	bool decodeRle(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize) noexcept;
+
+	/**
+	 * @brief Appends a key event message.
+	 * @param event The event.
+	 * @param output The buffer to append to.
+	*/
+	void encodeKeyEvent(const StreamKeyEvent& event, std::vector<uint8_t>& output);
+
+	/**
+	 * @brief Decodes a key event message.
+	 * @param message Pointer to the message.
+	 * @param size The size of the message in bytes.
+	 * @return The event, or an empty optional if the message is not a valid key event.
+	*/
+	std::optional<StreamKeyEvent> decodeKeyEvent(const uint8_t* message, size_t size) noexcept;
+
+	/**
+	 * @brief Encodes successive displays as frame messages for one client.
+	 *
+	 * The first frame and every keyframeInterval-th frame after it are keyframes, all others only
+	 * contain the rows that differ from the previous frame.
+	*/
+	class FrameEncoder {
+	public:
+		/**
+		 * @brief Creates an encoder whose first frame is a keyframe.
+		 * @param keyframeInterval A keyframe is sent at least every this many frames (0: only the first frame).
+		*/
+		explicit FrameEncoder(uint32_t keyframeInterval = 60) noexcept;
+
+		/**
+		 * @brief Appends the frame message for a display.
+		 * @param display The display.
+		 * @param inputEcho The time of the last key event of this client that the display includes.
+		 * @param output The buffer to append to.
+		 * @return True if the message is a keyframe.
+		*/
+		bool encode(const Chip8::PackedDisplay& display, int64_t inputEcho, std::vector<uint8_t>& output);
+
+		/**
+		 * @brief Makes the next frame a keyframe, for example after frames have been dropped.
+		*/
+		void requestKeyframe() noexcept;
+
+		/**
+		 * @brief Returns the sequence number of the next frame.
+		 * @return The sequence number.
+		*/
+		uint32_t getSequence() const noexcept;
+
+	private:
+		Chip8::PackedDisplay mPrevious;
+		uint32_t mKeyframeInterval;
+		uint32_t mFramesSinceKeyframe;
+		uint32_t mSequence;
+		bool mKeyframeRequested;
+	};
+
+	/**
+	 * @brief Reconstructs the display from the frame messages written by a FrameEncoder.
+	*/
+	class FrameDecoder {
+	public:
+		FrameDecoder() noexcept;
+
+		/**
+		 * @brief Applies a frame message.
+		 * @param message Pointer to the message.
+		 * @param size The size of the message in bytes.
+		 * @return True on success, false if the message is malformed or a delta does not follow the
+		 *         previous frame. The display is unchanged in this case and only a keyframe can be
+		 *         applied next.
+		*/
+		bool decode(const uint8_t* message, size_t size) noexcept;
+
+		/**
+		 * @brief Returns whether a keyframe has been applied and no frame has been missed since.
+		 * @return True if the display is up to date.
+		*/
+		bool isSynchronized() const noexcept;
+
+		/**
+		 * @brief Returns the display.
+		 * @return The display of the last applied frame.
+		*/
+		const Chip8::PackedDisplay& getDisplay() const noexcept;
+
+		/**
+		 * @brief Returns the sequence number of the last applied frame.
+		 * @return The sequence number.
+		*/
+		uint32_t getSequence() const noexcept;
+
+		/**
+		 * @brief Returns the input echo of the last applied frame.
+		 * @return The time of the last key event the display includes (0 if none).
+		*/
+		int64_t getInputEcho() const noexcept;
+
+		/**
+		 * @brief Returns the type of the last applied frame.
+		 * @return StreamMessageType::Keyframe or StreamMessageType::Delta.
+		*/
+		StreamMessageType getLastFrameType() const noexcept;
+
+	private:
+		Chip8::PackedDisplay mDisplay;
+		uint32_t mSequence;
+		int64_t mInputEcho;
+		StreamMessageType mLastFrameType;
+		bool mSynchronized;
+	};
+
+}
@@ -0,0 +1,48 @@
+/** @file
+  * @brief Contains hash functions for machine states and framebuffers.
+  */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Computes the 64 bit FNV-1a hash of a block of memory. This is not a cryptographic hash, but
+	 *        it is fast and good enough to detect differences between framebuffers or machine states.
+	 * @param data Pointer to the data.
+	 * @param size The size of the data in bytes.
+	 * @param hash The hash to continue from (for hashing multiple blocks).
+	 * @return The hash.
+	*/
+	inline uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull) noexcept {
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 0x00000100000001B3ull;
+		}
+		return hash;
+	}
+
+	using Sha1Digest = std::array<uint8_t, 20>; /**< A SHA-1 hash. */
+
+	/**
+	 * @brief Computes the SHA-1 hash of a block of memory. This is used to identify ROMs by their
+	 *        content (the same hash that ROM databases use).
+	 * @param data Pointer to the data.
+	 * @param size The size of the data in bytes.
+	 * @return The hash.
+	*/
+	Sha1Digest sha1(const void* data, size_t size) noexcept;
+
+	/**
+	 * @brief Formats a SHA-1 hash as 40 lower case hexadecimal digits.
+	 * @param digest The hash.
+	 * @return The hexadecimal representation.
+	*/
+	std::string toHexString(const Sha1Digest& digest);
+
+}
@@ -0,0 +1,151 @@
+/** @file
+  * @brief Contains the Chip8::InputMovie and Chip8::MoviePlayer classes to record and replay input.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A recording of all inputs of an emulation session.
+	 *
+	 * A movie consists of the machine state at the start of the recording (which includes the
+	 * ROM and the seed of the random number generator) and a list of key and timer events, each
+	 * tagged with the cycle it occurred at. Since the emulation itself is deterministic, replaying
+	 * the events at the same cycles reproduces the session exactly, on any machine and at any speed.
+	*/
+	class InputMovie {
+	public:
+		/**
+		 * @brief The kind of a recorded event.
+		*/
+		enum class EventType : uint8_t {
+			KeyDown,/**< a key has been pressed */
+			KeyUp,/**< a key has been released */
+			ClockTimers,/**< the delay and sound timers have been clocked */
+		};
+
+		/**
+		 * @brief A single recorded event.
+		*/
+		struct Event {
+			uint64_t cycle; /**< The cycle count of the emulator when the event occurred. */
+			EventType type; /**< The kind of event. */
+			uint8_t key; /**< The key code (0x0 to 0xF), only used for key events. */
+		};
+
+	public:
+		/**
+		 * @brief Discards all events and stores the current state of the emulator as the starting
+		 *        point. The movie is attached to the emulator as its input recorder.
+		 * @param chip8 The emulator to record.
+		*/
+		void startRecording(Chip8& chip8);
+
+		/**
+		 * @brief Detaches the movie from the emulator.
+		 * @param chip8 The emulator that has been recorded.
+		*/
+		void stopRecording(Chip8& chip8) noexcept;
+
+		/**
+		 * @brief Appends an event. This is called by the emulator while recording. If the event lies
+		 *        before already recorded events (because the emulator has been rewound), these are discarded.
+		 * @param event The event.
+		*/
+		void recordEvent(const Event& event);
+
+		/**
+		 * @brief Returns all recorded events in chronological order.
+		 * @return The events.
+		*/
+		const std::vector<Event>& getEvents() const noexcept;
+
+		/**
+		 * @brief Returns the machine state at the start of the recording.
+		 * @return The initial state.
+		*/
+		const Chip8::State& getInitialState() const noexcept;
+
+		/**
+		 * @brief Returns whether the movie contains timer events. If so, the timers have to be clocked
+		 *        by the movie during playback.
+		 * @return True if the movie drives the timers, false otherwise.
+		*/
+		bool drivesTimers() const noexcept;
+
+		/**
+		 * @brief Writes the movie to disk.
+		 * @param filename The file to write.
+		 * @return True on success, false otherwise.
+		*/
+		bool save(const std::string& filename) const;
+
+		/**
+		 * @brief Reads a movie from disk that has been written by save().
+		 * @param filename The file to read.
+		 * @param error Receives a description of the error, if any.
+		 * @return True on success, false otherwise.
+		*/
+		bool load(const std::string& filename, std::string& error);
+
+	private:
+		Chip8::State mInitialState = {};
+		std::vector<Event> mEvents;
+		bool mDrivesTimers = false;
+	};
+
+	/**
+	 * @brief Replays an InputMovie on an emulator.
+	*/
+	class MoviePlayer {
+	public:
+		/**
+		 * @brief Constructs a player. The movie must outlive the player.
+		 * @param movie The movie to play.
+		*/
+		explicit MoviePlayer(const InputMovie& movie) noexcept;
+
+		/**
+		 * @brief Restores the initial state of the movie and rewinds the player.
+		 * @param chip8 The emulator to play the movie on.
+		*/
+		void start(Chip8& chip8);
+
+		/**
+		 * @brief Applies all events that are due before the next call to Chip8::step().
+		 * @param chip8 The emulator to play the movie on.
+		*/
+		void applyEvents(Chip8& chip8) noexcept;
+
+		/**
+		 * @brief Applies all due events and runs a single emulation step.
+		 * @param chip8 The emulator to play the movie on.
+		 * @return The result of Chip8::step().
+		*/
+		bool step(Chip8& chip8);
+
+		/**
+		 * @brief Returns whether all events of the movie have been applied.
+		 * @return True if the movie is finished, false otherwise.
+		*/
+		bool isFinished() const noexcept;
+
+		/**
+		 * @brief Returns the movie that is being played.
+		 * @return The movie.
+		*/
+		const InputMovie& getMovie() const noexcept;
+
+	private:
+		const InputMovie& mMovie;
+		size_t mNextEvent;
+	};
+
+}
@@ -0,0 +1,77 @@
+/** @file
+  * @brief Contains the Chip8::InputQueue class that applies key events at the emulated time they have happened.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Buffers key events with the host time they have happened at and hands them to an emulator right
+	 *        before the first instruction that is scheduled after them.
+	 *
+	 * A frontend runs the emulation in batches, e.g. all instructions that are due since the last frame, and
+	 * receives the key events in between. Triggering the keys as soon as they arrive would apply them at the
+	 * start of the next batch, no matter when they have happened. Instead, the frontend pushes the events with
+	 * their timestamps and calls apply() with the scheduled time of every instruction before executing it, so
+	 * every event ends up at the cycle that corresponds to its time (and is recorded at that cycle by movies
+	 * and the execution history). Timestamps can be on any clock, as long as it is the clock of the schedule.
+	*/
+	class InputQueue {
+	public:
+		/**
+		 * @brief A key event.
+		*/
+		struct Event {
+			double time; /**< The host time of the event. */
+			uint8_t key; /**< The key (0x0 to 0xF). */
+			bool pressed; /**< Whether the key has been pressed or released. */
+		};
+
+	public:
+		/**
+		 * @brief Adds an event. Events are applied in the order of their timestamps.
+		 * @param time The host time of the event.
+		 * @param key The key (0x0 to 0xF).
+		 * @param pressed Whether the key has been pressed or released.
+		*/
+		void push(double time, uint8_t key, bool pressed);
+
+		/**
+		 * @brief Applies the events that have happened until a point in time to an emulator. If a key has been
+		 *        pressed and released within that time, the release is held back until the next call, so that
+		 *        the emulator executes at least one instruction while the key is pressed.
+		 * @param chip8 The emulator.
+		 * @param time The scheduled time of the next instruction.
+		 * @return The number of events that have been applied.
+		*/
+		size_t apply(Chip8& chip8, double time);
+
+		/**
+		 * @brief Applies all events (e.g. while the emulation is paused).
+		 * @param chip8 The emulator.
+		 * @return The number of events that have been applied.
+		*/
+		size_t flush(Chip8& chip8);
+
+		/**
+		 * @brief Discards all events.
+		*/
+		void clear() noexcept;
+
+		/**
+		 * @brief Returns the number of pending events.
+		 * @return The number of events.
+		*/
+		size_t size() const noexcept;
+
+	private:
+		std::deque<Event> mEvents;
+	};
+
+}
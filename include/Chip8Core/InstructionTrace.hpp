@@ -0,0 +1,190 @@
+/** @file
+  * @brief Contains the Chip8::InstructionTracer class, which writes every executed instruction into a
+  *        compressed binary trace file, and the Chip8::TraceReader class to read such files.
+  */
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A single executed instruction.
+	*/
+	struct TraceRecord {
+		constexpr static uint8_t NoRegister = 0xFF; /**< The value of changedRegister if no register has changed. */
+
+		uint64_t cycle; /**< The cycle count after the instruction (see Chip8::getCycleCount()). */
+		uint16_t address; /**< The address of the instruction. */
+		uint16_t instruction; /**< The instruction. */
+		uint16_t addressRegister; /**< The register I after the instruction. */
+		uint8_t changedRegister; /**< The lowest register VX that the instruction has changed, or NoRegister. */
+		uint8_t value; /**< The new value of the changed register (0 if none has changed). */
+	};
+
+	/**
+	 * @brief Compares two records.
+	 * @param lhs The first record.
+	 * @param rhs The second record.
+	 * @return True if all fields are equal.
+	*/
+	bool operator==(const TraceRecord& lhs, const TraceRecord& rhs) noexcept;
+
+	/**
+	 * @brief Compares two records.
+	 * @param lhs The first record.
+	 * @param rhs The second record.
+	 * @return True if any field differs.
+	*/
+	bool operator!=(const TraceRecord& lhs, const TraceRecord& rhs) noexcept;
+
+	/**
+	 * @brief The magic bytes at the start of a trace file, followed by a version byte.
+	*/
+	constexpr std::array<char, 4> TraceMagic = { 'C', '8', 'T', 'R' };
+
+	/**
+	 * @brief Encodes records as a block of a trace file.
+	 *
+	 * A block starts with the number of records and the encoded size (both as 32 bit little endian
+	 * integers). Each record is stored as a flags byte, the instruction and only the fields that cannot
+	 * be predicted from the previous record of the block: the cycle if it is not one more, the address
+	 * if it neither follows the previous instruction nor is the target of its jump or call, I if it has
+	 * changed and the changed register. A typical record takes three to five bytes instead of sixteen.
+	 * Every block can be decoded on its own.
+	 * @param records Pointer to the records.
+	 * @param count The number of records.
+	 * @param output The vector to append the block to.
+	*/
+	void encodeTraceBlock(const TraceRecord* records, size_t count, std::vector<uint8_t>& output);
+
+	/**
+	 * @brief Decodes the records of a block without its header (see encodeTraceBlock()).
+	 * @param data Pointer to the encoded records.
+	 * @param size The encoded size.
+	 * @param count The number of records.
+	 * @param records The vector to append the records to.
+	 * @return True on success, false if the block is malformed.
+	*/
+	bool decodeTraceBlock(const uint8_t* data, size_t size, size_t count, std::vector<TraceRecord>& records);
+
+	/**
+	 * @brief Records the instructions of an emulator into a trace file.
+	 *
+	 * The tracer is attached with Chip8::setTracer(). The emulator thread only copies each record into
+	 * its current block; full blocks are handed to a background thread, which encodes and writes them.
+	 * If the writer falls behind by more than MaximumQueuedBlocks, recording waits for it, so no
+	 * record is ever lost.
+	*/
+	class InstructionTracer {
+	public:
+		constexpr static size_t BlockSize = 0x2000; /**< The number of records per block. */
+		constexpr static size_t MaximumQueuedBlocks = 64; /**< The number of full blocks that may wait for the writer. */
+
+	public:
+		/**
+		 * @brief Creates the trace file and starts the writer thread.
+		 * @param filename The path of the file.
+		 * @throws std::runtime_error if the file could not be created.
+		*/
+		explicit InstructionTracer(const std::string& filename);
+
+		/**
+		 * @brief Writes the remaining records and closes the file.
+		*/
+		~InstructionTracer();
+
+		InstructionTracer(const InstructionTracer&) = delete;
+		InstructionTracer& operator=(const InstructionTracer&) = delete;
+
+		/**
+		 * @brief Appends a record. This is called by the emulator.
+		 * @param record The record.
+		*/
+		void record(const TraceRecord& record) {
+			mBlock.push_back(record);
+			if (mBlock.size() == BlockSize)
+				submitBlock();
+		}
+
+		/**
+		 * @brief Writes all records that have been recorded so far and waits until they are in the file.
+		*/
+		void flush();
+
+		/**
+		 * @brief Returns the number of recorded instructions.
+		 * @return The number of records.
+		*/
+		uint64_t getRecordCount() const;
+
+		/**
+		 * @brief Returns the size of the trace file so far.
+		 * @return The number of written bytes.
+		*/
+		uint64_t getBytesWritten() const;
+
+	private:
+		void submitBlock();
+		void writeBlocks();
+
+	private:
+		std::ofstream mFile;
+		std::vector<TraceRecord> mBlock; ///< the block the emulator records into
+		mutable std::mutex mMutex;
+		std::condition_variable mCondition;
+		std::deque<std::vector<TraceRecord>> mQueue;
+		std::vector<std::vector<TraceRecord>> mSpareBlocks; ///< written blocks, reused to avoid allocations
+		bool mWriting; ///< whether the writer thread is busy with a block that has been taken from the queue
+		bool mStopping;
+		uint64_t mRecordCount;
+		uint64_t mBytesWritten;
+		std::thread mWriter;
+	};
+
+	/**
+	 * @brief Reads the records of a trace file one after another.
+	*/
+	class TraceReader {
+	public:
+		/**
+		 * @brief Opens a trace file.
+		 * @param filename The path of the file.
+		 * @return True on success, false if the file could not be opened or is not a trace file.
+		*/
+		bool open(const std::string& filename);
+
+		/**
+		 * @brief Reads the next record.
+		 * @param record Receives the record.
+		 * @return True on success, false at the end of the file or if the file is malformed (see hasError()).
+		*/
+		bool next(TraceRecord& record);
+
+		/**
+		 * @brief Returns whether reading has stopped because the file is malformed or truncated.
+		 * @return True on error.
+		*/
+		bool hasError() const noexcept;
+
+	private:
+		bool readBlock();
+
+	private:
+		std::ifstream mFile;
+		std::streamoff mFileSize = 0;
+		std::vector<TraceRecord> mRecords;
+		size_t mPosition = 0;
+		bool mError = false;
+	};
+
+}
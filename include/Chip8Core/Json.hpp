@@ -0,0 +1,98 @@
+/** @file
+  * @brief Contains a minimal JSON document model and parser (used to read ROM databases).
+  */
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A JSON value: null, a boolean, a number, a string, an array or an object.
+	*/
+	class JsonValue {
+	public:
+		using Array = std::vector<JsonValue>; /**< The representation of JSON arrays. */
+		using Object = std::map<std::string, JsonValue>; /**< The representation of JSON objects. */
+
+	public:
+		/**
+		 * @brief Constructs a null value.
+		*/
+		JsonValue() noexcept = default;
+
+		/**
+		 * @brief Constructs a value.
+		 * @tparam T bool, double, std::string, Array or Object.
+		 * @param value The value.
+		*/
+		template <typename T, typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, JsonValue>>>
+		JsonValue(T value)
+			: mValue(std::move(value))
+		{}
+
+		bool isNull() const noexcept { return std::holds_alternative<std::monostate>(mValue); } /**< @return Whether the value is null. */
+		bool isBool() const noexcept { return std::holds_alternative<bool>(mValue); } /**< @return Whether the value is a boolean. */
+		bool isNumber() const noexcept { return std::holds_alternative<double>(mValue); } /**< @return Whether the value is a number. */
+		bool isString() const noexcept { return std::holds_alternative<std::string>(mValue); } /**< @return Whether the value is a string. */
+		bool isArray() const noexcept { return std::holds_alternative<Array>(mValue); } /**< @return Whether the value is an array. */
+		bool isObject() const noexcept { return std::holds_alternative<Object>(mValue); } /**< @return Whether the value is an object. */
+
+		/**
+		 * @brief Returns the boolean.
+		 * @param fallback The result if the value is not a boolean.
+		 * @return The boolean.
+		*/
+		bool asBool(bool fallback = false) const noexcept;
+
+		/**
+		 * @brief Returns the number.
+		 * @param fallback The result if the value is not a number.
+		 * @return The number.
+		*/
+		double asNumber(double fallback = 0.0) const noexcept;
+
+		/**
+		 * @brief Returns the string.
+		 * @return The string, or an empty string if the value is not a string.
+		*/
+		const std::string& asString() const noexcept;
+
+		/**
+		 * @brief Returns the elements of an array.
+		 * @return The elements, or an empty array if the value is not an array.
+		*/
+		const Array& asArray() const noexcept;
+
+		/**
+		 * @brief Returns the members of an object.
+		 * @return The members, or an empty object if the value is not an object.
+		*/
+		const Object& asObject() const noexcept;
+
+		/**
+		 * @brief Looks up a member of an object.
+		 * @param key The name of the member.
+		 * @return The member, or a null value if the value is not an object or has no such member.
+		*/
+		const JsonValue& operator[](const std::string& key) const noexcept;
+
+	private:
+		std::variant<std::monostate, bool, double, std::string, Array, Object> mValue;
+	};
+
+	/**
+	 * @brief Parses a JSON document (RFC 8259).
+	 * @param text The document.
+	 * @param error Receives a description of the first error, if any.
+	 * @return The value, or an empty optional on error.
+	*/
+	std::optional<JsonValue> parseJson(const std::string& text, std::string& error);
+
+}
@@ -0,0 +1,159 @@
+/** @file
+  * @brief Contains the Chip8::LatencyProbe class that measures the time from a key press to the changed
+  *        display.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Measures the input latency of a frontend by pressing keys itself and timing their effect.
+	 *
+	 * The emulator runs LatencyProbe::TestRom, which waits for a key and draws something for every key press.
+	 * The frontend asks poll() for due key events in its input path (so the events take the way of real input)
+	 * and calls checkDisplay() after every instruction and present() after every displayed frame. A sample is
+	 * the time from the scheduled press to the first changed display, and to the first frame presented after
+	 * that. The presses are scheduled at random times, so frontends that only read their input once per frame
+	 * are measured with the resulting delay. A headless frontend that does not present frames measures the
+	 * latency of the core alone. All times are on the clock of getProbeTime() (nanoseconds).
+	*/
+	class LatencyProbe {
+	public:
+		/**
+		 * @brief The ROM the probe has to run: it waits for a key (FX0A) and draws the digit of the key in the
+		 *        top left corner (XOR, so every press changes the display), then waits again.
+		*/
+		static constexpr std::array<uint8_t, 8> TestRom = { 0xF0, 0x0A, 0xF0, 0x29, 0xD1, 0x15, 0x12, 0x00 };
+
+		/**
+		 * @brief A key event the frontend has to inject.
+		*/
+		struct KeyEvent {
+			uint8_t key; /**< The key (0x0 to 0xF). */
+			bool pressed; /**< Whether the key has to be pressed or released. */
+		};
+
+		/**
+		 * @brief A measurement.
+		*/
+		struct Sample {
+			int64_t pressTime; /**< The time the key press has been scheduled at. */
+			int64_t displayTime; /**< The time after the instruction that has changed the display (0 until then). */
+			int64_t presentTime; /**< The time after the first frame presented with the change (0 until then). */
+		};
+
+		/**
+		 * @brief The percentiles of a latency in milliseconds.
+		*/
+		struct Distribution {
+			double p50; /**< The median. */
+			double p95; /**< The 95th percentile. */
+			double p99; /**< The 99th percentile. */
+			double maximum; /**< The maximum. */
+		};
+
+	public:
+		/**
+		 * @brief Constructs a probe.
+		 * @param sampleCount The number of measurements.
+		 * @param measuresPresent Whether the frontend presents frames (calls present()); each measurement then
+		 *        waits for the presented frame.
+		 * @param interval The mean time between the end of a measurement and the next key press in nanoseconds.
+		 * @param seed The seed of the random press times.
+		*/
+		explicit LatencyProbe(size_t sampleCount, bool measuresPresent, int64_t interval = 100'000'000, uint32_t seed = 0);
+
+		/**
+		 * @brief Returns the next key event to inject, if any is due. A release follows every measured press.
+		 * @param chip8 The emulator (its display is remembered when a key is pressed).
+		 * @param now The current time.
+		 * @return The event, or an empty optional if nothing is due.
+		*/
+		std::optional<KeyEvent> poll(const Chip8& chip8, int64_t now);
+
+		/**
+		 * @brief Checks whether the display has changed since the pending key press. Call this after every instruction.
+		 * @param chip8 The emulator.
+		 * @param now The current time.
+		*/
+		void checkDisplay(const Chip8& chip8, int64_t now);
+
+		/**
+		 * @brief Completes the pending measurement if its change has been displayed. Call this after every
+		 *        presented frame (e.g. after the buffer swap).
+		 * @param now The current time.
+		*/
+		void present(int64_t now) noexcept;
+
+		/**
+		 * @brief Returns whether all measurements have been taken.
+		 * @return True if the probe is finished.
+		*/
+		bool isFinished() const noexcept;
+
+		/**
+		 * @brief Returns the completed measurements.
+		 * @return The samples in the order they have been taken.
+		*/
+		const std::vector<Sample>& getSamples() const noexcept;
+
+		/**
+		 * @brief Returns the number of key presses that have not changed the display within a second (they are
+		 *        not measured, e.g. because the emulation has been paused or the test ROM is not running).
+		 * @return The number of timeouts.
+		*/
+		size_t getTimeoutCount() const noexcept;
+
+		/**
+		 * @brief Returns the distribution of the time from the key press to the changed display.
+		 * @return The percentiles.
+		*/
+		Distribution getDisplayLatency() const;
+
+		/**
+		 * @brief Returns the distribution of the time from the key press to the presented frame.
+		 * @return The percentiles (all zero if the frontend does not present frames).
+		*/
+		Distribution getPresentLatency() const;
+
+		/**
+		 * @brief Writes the number of samples and the distributions as text.
+		 * @param output The stream to write to.
+		*/
+		void printReport(std::ostream& output) const;
+
+	private:
+		enum class Phase {
+			Idle,/**< waiting for the scheduled press */
+			Pressed,/**< waiting for the display to change */
+			Displayed,/**< waiting for the frame to be presented */
+			Releasing,/**< the release has to be injected */
+		};
+
+		void finishSample();
+
+	private:
+		size_t mSampleCount;
+		bool mMeasuresPresent;
+		int64_t mInterval;
+		std::mt19937 mRandomGenerator;
+		std::vector<Sample> mSamples;
+		size_t mTimeoutCount;
+		Phase mPhase;
+		int64_t mNextPressTime; ///< 0 until the first poll()
+		Sample mPendingSample;
+		uint8_t mKey;
+		Chip8::PackedDisplay mDisplayBeforePress;
+	};
+
+}
@@ -0,0 +1,89 @@
+/** @file
+  * @brief Contains the Chip8::MappedFile class, a read-only memory mapping of a file.
+  */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Maps a file read-only into the address space (mmap on Linux and macOS, a file mapping
+	 *        on Windows), so its content can be used without reading it into a buffer first.
+	*/
+	class MappedFile {
+	public:
+		/**
+		 * @brief Identifies a version of a file by its size and modification time.
+		*/
+		struct Stamp {
+			uint64_t size; /**< The size of the file in bytes. */
+			int64_t modificationTime; /**< The modification time in nanoseconds (since an unspecified, platform-dependent epoch). */
+
+			bool operator==(const Stamp& other) const noexcept {
+				return size == other.size && modificationTime == other.modificationTime;
+			}
+
+			bool operator!=(const Stamp& other) const noexcept {
+				return !(*this == other);
+			}
+		};
+
+	public:
+		/**
+		 * @brief Opens and maps a file.
+		 * @param filename The file to map.
+		 * @throws std::runtime_error if the file could not be opened or mapped.
+		*/
+		explicit MappedFile(const std::string& filename);
+
+		/**
+		 * @brief Unmaps the file.
+		*/
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/**
+		 * @brief Moves the mapping into a new object.
+		 * @param other The object to move from. It is left without a mapping.
+		*/
+		MappedFile(MappedFile&& other) noexcept;
+
+		/**
+		 * @brief Returns the content of the file.
+		 * @return Pointer to the first byte (nullptr if the file is empty).
+		*/
+		const uint8_t* data() const noexcept;
+
+		/**
+		 * @brief Returns the size of the file.
+		 * @return The size in bytes.
+		*/
+		size_t size() const noexcept;
+
+		/**
+		 * @brief Returns the size and modification time of the file at the time it has been mapped.
+		 * @return The stamp.
+		*/
+		const Stamp& getStamp() const noexcept;
+
+		/**
+		 * @brief Queries the size and modification time of a file without opening it.
+		 * @param filename The file.
+		 * @return The stamp, or an empty optional if the file does not exist.
+		*/
+		static std::optional<Stamp> getStamp(const std::string& filename);
+
+	private:
+		const uint8_t* mData;
+		size_t mSize;
+		Stamp mStamp;
+		void* mHandle; ///< the file mapping handle (Windows only)
+	};
+
+}
@@ -6,16 +6,42 @@
 #include <cstddef>
 #include <cstdint>
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
 #include <iostream>
 #include <iomanip>
 
 /**
  * @brief This class template represents the memory for the CHIP-8.
+ *
+ * The memory is divided into pages that are reference counted and shared copy-on-write. Copying
+ * a Chip8Memory instance therefore only copies the page pointers, and a page is only duplicated
+ * once one of the instances sharing it writes to it. Pages that never get written (e.g. the
+ * ROM or the font) stay shared between all copies.
+ *
+ * A page is written in place only if this instance has allocated it and holds the only reference
+ * (shared_ptr::use_count() == 1). Copies sharing a page may live on other threads; releasing them
+ * synchronizes with the writer through the reference count (see getWritablePage()). As for any
+ * standard container, a single instance must not be written while it is read or copied elsewhere.
  * @tparam UnderlyingType The data type each memory location will be represented at (usually uint8_t).
 */
 template <typename UnderlyingType>
 class Chip8Memory {
 public:
+	constexpr static size_t Size = 0x1000u; /**< The number of addressable memory locations. */
+	constexpr static size_t PageSize = 0x100u; /**< The number of memory locations per page. */
+	constexpr static size_t PageCount = Size / PageSize; /**< The number of pages. */
+	using Page = std::array<UnderlyingType, PageSize>; /**< The storage of a single page. */
+
+public:
+	/**
+	 * @brief Constructs a zero-initialized memory. All pages share the same empty page.
+	*/
+	Chip8Memory();
+
 	/**
 	 * @brief Writes a value.
 	 * @param address The address to write to.
@@ -30,17 +56,49 @@ public:
 	*/
 	UnderlyingType read(uint16_t address) const;
 
+	/**
+	 * @brief Writes a contiguous block of values. Pages whose content would not change are not
+	 *        written to and therefore stay shared.
+	 * @param address The address of the first value to write.
+	 * @param source Pointer to the values.
+	 * @param count The number of values to write.
+	*/
+	void writeBlock(uint16_t address, const UnderlyingType* source, size_t count);
+
+	/**
+	 * @brief Reads a contiguous block of values.
+	 * @param address The address of the first value to read.
+	 * @param destination Pointer to the buffer that receives the values.
+	 * @param count The number of values to read.
+	*/
+	void readBlock(uint16_t address, UnderlyingType* destination, size_t count) const;
+
 	/**
 	 * @brief Fills the whole memory with zeros.
 	*/
 	void clear();
 
 	/**
-	 * @brief Returns a pointer to the underlying memory. This should usually not
-	 *        be used from outside.
-	 * @return Pointer to the data.
+	 * @brief Returns a shared, read-only handle to a page.
+	 * @param pageIndex The index of the page (0 to PageCount - 1).
+	 * @return The page.
 	*/
-	UnderlyingType* data() noexcept;
+	std::shared_ptr<const Page> getPage(size_t pageIndex) const;
+
+	/**
+	 * @brief Replaces a page with a shared one. The page will be copied as soon as it gets
+	 *        written to, so the caller may keep and share the page freely.
+	 * @param pageIndex The index of the page (0 to PageCount - 1).
+	 * @param page The page.
+	*/
+	void setPage(size_t pageIndex, std::shared_ptr<const Page> page);
+
+	/**
+	 * @brief Returns the number of pages that are exclusively owned by this instance, i.e. that
+	 *        are not shared with any other memory instance.
+	 * @return The number of private pages.
+	*/
+	size_t getPrivatePageCount() const noexcept;
 
 	/**
 	 * @brief Writes the content of the memory to standard output.
@@ -48,38 +106,121 @@ public:
 	void dump() const;
 
 private:
-	std::array<UnderlyingType, 4096u> mMemory = {};
+	Page& getWritablePage(size_t pageIndex);
+	static const std::shared_ptr<const Page>& getEmptyPage();
+
+private:
+	std::array<std::shared_ptr<const Page>, PageCount> mPages;
+	std::bitset<PageCount> mAllocatedPages; ///< pages that have been allocated by a Chip8Memory (and are therefore not const)
 };
 
+template <typename UnderlyingType>
+inline Chip8Memory<UnderlyingType>::Chip8Memory() {
+	clear();
+}
+
 template <typename UnderlyingType>
 inline void Chip8Memory<UnderlyingType>::write(uint16_t address, UnderlyingType value) {
-	mMemory.at(address) = value;
+	if (address >= Size)
+		throw std::out_of_range("memory address out of range");
+	getWritablePage(address / PageSize)[address % PageSize] = value;
 }
 
 template <typename UnderlyingType>
 [[nodiscard]] inline UnderlyingType Chip8Memory<UnderlyingType>::read(uint16_t address) const {
-	return mMemory.at(address);
+	if (address >= Size)
+		throw std::out_of_range("memory address out of range");
+	return (*mPages[address / PageSize])[address % PageSize];
+}
+
+template <typename UnderlyingType>
+inline void Chip8Memory<UnderlyingType>::writeBlock(uint16_t address, const UnderlyingType* source, size_t count) {
+	if (static_cast<size_t>(address) + count > Size)
+		throw std::out_of_range("memory block out of range");
+	size_t position = address;
+	while (count > 0) {
+		const size_t offset = position % PageSize;
+		const size_t chunk = std::min(count, PageSize - offset);
+		// leave pages untouched (and therefore shared) if their content does not change
+		const auto& page = *mPages[position / PageSize];
+		if (!std::equal(source, source + chunk, page.begin() + offset))
+			std::copy(source, source + chunk, getWritablePage(position / PageSize).begin() + offset);
+		source += chunk;
+		position += chunk;
+		count -= chunk;
+	}
+}
+
+template <typename UnderlyingType>
+inline void Chip8Memory<UnderlyingType>::readBlock(uint16_t address, UnderlyingType* destination, size_t count) const {
+	if (static_cast<size_t>(address) + count > Size)
+		throw std::out_of_range("memory block out of range");
+	size_t position = address;
+	while (count > 0) {
+		const size_t offset = position % PageSize;
+		const size_t chunk = std::min(count, PageSize - offset);
+		const auto& page = *mPages[position / PageSize];
+		destination = std::copy(page.begin() + offset, page.begin() + offset + chunk, destination);
+		position += chunk;
+		count -= chunk;
+	}
 }
 
 template <typename UnderlyingType>
 inline void Chip8Memory<UnderlyingType>::clear() {
-	mMemory.fill(static_cast<UnderlyingType>(0));
+	mPages.fill(getEmptyPage());
+	mAllocatedPages.reset();
+}
+
+template <typename UnderlyingType>
+inline std::shared_ptr<const typename Chip8Memory<UnderlyingType>::Page> Chip8Memory<UnderlyingType>::getPage(size_t pageIndex) const {
+	return mPages.at(pageIndex);
 }
 
 template <typename UnderlyingType>
-inline UnderlyingType* Chip8Memory<UnderlyingType>::data() noexcept {
-	return mMemory.data();
+inline void Chip8Memory<UnderlyingType>::setPage(size_t pageIndex, std::shared_ptr<const Page> page) {
+	if (!page)
+		throw std::invalid_argument("page must not be null");
+	mPages.at(pageIndex) = std::move(page);
+	mAllocatedPages[pageIndex] = false;
+}
+
+template <typename UnderlyingType>
+inline size_t Chip8Memory<UnderlyingType>::getPrivatePageCount() const noexcept {
+	return static_cast<size_t>(std::count_if(mPages.begin(), mPages.end(),
+		[](const auto& page) noexcept { return page.use_count() == 1; }));
 }
 
 template<typename UnderlyingType>
 inline void Chip8Memory<UnderlyingType>::dump() const {
 	constexpr size_t columns = 32;
 	std::cout << "0x" << std::setfill('0') << std::setw(4) << 0u << ": ";
-	for (size_t i = 0; i < mMemory.size(); i++) {
-		std::cout << std::setfill('0') << std::setw(2) << std::uppercase << std::hex << +static_cast<uint8_t>(mMemory.at(i)) << " ";
-		if ((i + 1) % columns == 0 && i < mMemory.size() - 1) {			
+	for (size_t i = 0; i < Size; i++) {
+		std::cout << std::setfill('0') << std::setw(2) << std::uppercase << std::hex << +static_cast<uint8_t>(read(static_cast<uint16_t>(i))) << " ";
+		if ((i + 1) % columns == 0 && i < Size - 1) {
 			std::cout << "\n0x" << std::setfill('0') << std::setw(4) << (i + 1) << ": ";
 		}
 	}
 	std::cout << std::endl;
 }
+
+template <typename UnderlyingType>
+inline typename Chip8Memory<UnderlyingType>::Page& Chip8Memory<UnderlyingType>::getWritablePage(size_t pageIndex) {
+	auto& page = mPages[pageIndex];
+	// a page that is referenced only by this instance cannot be observed by anybody else
+	if (!mAllocatedPages[pageIndex] || page.use_count() != 1) {
+		page = std::make_shared<Page>(*page);
+		mAllocatedPages[pageIndex] = true;
+	} else {
+		// use_count() is a relaxed load: the fence orders the write after the last read of a copy on another
+		// thread, which has released its reference before
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	return const_cast<Page&>(*page);
+}
+
+template <typename UnderlyingType>
+inline const std::shared_ptr<const typename Chip8Memory<UnderlyingType>::Page>& Chip8Memory<UnderlyingType>::getEmptyPage() {
+	static const std::shared_ptr<const Page> emptyPage = std::make_shared<const Page>(Page{});
+	return emptyPage;
+}
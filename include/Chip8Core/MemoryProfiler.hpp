@@ -0,0 +1,149 @@
+/** @file
+  * @brief Contains the Chip8::MemoryProfiler class that counts the memory accesses per address and
+  *        reports self-modifying code.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief The kinds of memory accesses the MemoryProfiler tells apart.
+	*/
+	enum class MemoryAccess : uint8_t {
+		Read,/**< read by FX65 */
+		Write,/**< written by FX33 or FX55 */
+		Execute,/**< fetched as an instruction */
+		SpriteRead,/**< read as sprite data by DXYN */
+	};
+
+	/**
+	 * @brief Counts how often each address is read, written, executed and drawn as a sprite, classifies
+	 *        the addresses into regions and finds instructions that are executed after they have been written.
+	 *
+	 * A memory profiler is attached to an emulator with Chip8::setMemoryProfiler(). It only sees the
+	 * accesses of instructions; loading a ROM or a state is not recorded. The hook is only compiled into
+	 * the emulator if CHIP8_ENABLE_PROFILING is defined (see Profiler::Enabled).
+	*/
+	class MemoryProfiler {
+	public:
+		/**
+		 * @brief The number of addresses (the whole address space).
+		*/
+		static constexpr size_t AddressCount = Chip8::MemorySize;
+
+		/**
+		 * @brief What an address is used for, judged by its accesses.
+		*/
+		enum class Region {
+			Unused,/**< never accessed by an instruction */
+			Code,/**< part of an executed instruction */
+			Data,/**< read or written, but neither executed nor drawn */
+			Sprite,/**< drawn by DXYN (and not executed) */
+		};
+
+		/**
+		 * @brief The number of regions.
+		*/
+		static constexpr size_t RegionCount = 4;
+
+		/**
+		 * @brief The accesses of a single address.
+		*/
+		struct AddressStatistics {
+			uint64_t reads = 0; /**< How often the address has been read by FX65. */
+			uint64_t writes = 0; /**< How often the address has been written. */
+			uint64_t executions = 0; /**< How often an instruction at the address has been executed. */
+			uint64_t spriteReads = 0; /**< How often the address has been drawn by DXYN. */
+			uint64_t executionsAfterWrite = 0; /**< How often the instruction at the address has been executed after one of its bytes had been written. */
+			uint64_t firstWriteCycle = 0; /**< The cycle of the first write (only valid if writes > 0). */
+			uint64_t firstModifiedExecutionCycle = 0; /**< The cycle of the first execution after a write (only valid if executionsAfterWrite > 0). */
+		};
+
+		/**
+		 * @brief An instruction that has been executed after it had been written.
+		*/
+		struct SelfModifyingCode {
+			uint16_t address; /**< The address of the instruction. */
+			uint64_t writes; /**< The writes to both bytes of the instruction. */
+			uint64_t executionsAfterWrite; /**< How often the instruction has been executed after it had been written. */
+			uint64_t firstWriteCycle; /**< The cycle of the first write to one of its bytes. */
+			uint64_t firstModifiedExecutionCycle; /**< The cycle of the first execution after a write. */
+		};
+
+	public:
+		/**
+		 * @brief Constructs a profiler with all counters at zero.
+		*/
+		MemoryProfiler();
+
+		/**
+		 * @brief Discards all counters.
+		*/
+		void reset() noexcept;
+
+		/**
+		 * @brief Records an access. This is called by the emulator.
+		 * @param access The kind of the access.
+		 * @param address The first accessed address.
+		 * @param count The number of accessed bytes (ignored for executions, which always cover the instruction).
+		 * @param cycle The cycle count of the emulator.
+		*/
+		void record(MemoryAccess access, uint16_t address, size_t count, uint64_t cycle) noexcept;
+
+		/**
+		 * @brief Returns the counters of an address.
+		 * @param address The address.
+		 * @return The counters.
+		*/
+		const AddressStatistics& getAddressStatistics(uint16_t address) const;
+
+		/**
+		 * @brief Returns the region of an address. An address is code if an instruction that covers it
+		 *        has been executed; otherwise it is sprite data if it has been drawn, and data if it has been
+		 *        read or written.
+		 * @param address The address.
+		 * @return The region.
+		*/
+		Region getRegion(uint16_t address) const noexcept;
+
+		/**
+		 * @brief Returns the number of addresses per region.
+		 * @return The sizes, indexed by Region.
+		*/
+		std::array<size_t, RegionCount> getRegionSizes() const noexcept;
+
+		/**
+		 * @brief Returns the name of a region ("unused", "code", "data" or "sprite").
+		 * @param region The region.
+		 * @return The name.
+		*/
+		static const char* getRegionName(Region region) noexcept;
+
+		/**
+		 * @brief Returns all instructions that have been executed after one of their bytes had been written,
+		 *        which e.g. a cache of translated code would have to invalidate.
+		 * @return The instructions, ordered by address.
+		*/
+		std::vector<SelfModifyingCode> getSelfModifyingCode() const;
+
+		/**
+		 * @brief Writes the region sizes and the self-modifying code as a JSON object.
+		 * @param output The stream to write to.
+		*/
+		void writeReportJson(std::ostream& output) const;
+
+	private:
+		std::vector<AddressStatistics> mAddresses; ///< one entry per address (on the heap, the profiler is often a member of objects on the stack)
+		std::bitset<AddressCount> mWritten;
+	};
+
+}
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <map>
@@ -15,6 +16,7 @@ namespace Chip8 {
 
 	class Chip8;
 	class Instruction;
+	enum class MemoryAccess : uint8_t;
 
 	/**
 	 * @brief Strongly typed enum that describes the compatibility mode behavior selection. See the
@@ -31,11 +33,6 @@ namespace Chip8 {
 	*/
 	class OpcodeHandler {
 	public:
-		/**
-		 * @brief Constructs an instance and sets up the random number generator.
-		*/
-		OpcodeHandler() noexcept;
-
 		/**
 		 * @brief Executes an instruction.
 		 * @param opcode The CHIP-8 opcode.
@@ -49,7 +46,8 @@ namespace Chip8 {
 
 	private:
 		static void drawSprite(uint8_t x, uint8_t y, uint8_t height, Chip8& chip8);
-		static uint8_t generateRandomNumber() noexcept;
+		static uint8_t generateRandomNumber(Chip8& chip8) noexcept;
+		static void recordMemoryAccess(Chip8& chip8, MemoryAccess access, uint16_t address, size_t count) noexcept;
 	};
 
 }
@@ -8,6 +8,7 @@
 #include <gsl/gsl>
 #include <cstdint>
 #include <functional>
+#include <tuple>
 
 #include "Chip8Core/Chip8.hpp"
 #include "Chip8Core/Instruction.hpp"
@@ -121,4 +122,16 @@ namespace Chip8 {
 		std::make_tuple("FX65", getOpcode(to_array("FX65")), instructionMaskToUint16(inverseInstructionMaskFromCharArray(to_array("FX65"))), instructionMaskToUint16(instructionMaskFromCharArray(to_array("FX65")))),
 	};
 
+	/**
+	 * @brief Looks up the entry of an instruction in Chip8::Opcodes.
+	 * @param instruction The instruction (see Instruction::getValue()).
+	 * @return The index of the first matching entry, or Opcodes.size() if the opcode is unknown.
+	*/
+	constexpr size_t getOpcodeIndex(uint16_t instruction) noexcept {
+		size_t index = 0;
+		while (index < Opcodes.size() && (instruction & std::get<2>(Opcodes[index])) != std::get<1>(Opcodes[index]))
+			++index;
+		return index;
+	}
+
 }
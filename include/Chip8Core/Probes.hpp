@@ -0,0 +1,198 @@
+/** @file
+  * @brief Contains scoped timing probes that record into lock-free per-thread buffers, rolling
+  *        percentiles of the recorded durations and the export as Chrome trace events.
+  */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A single recorded probe.
+	*/
+	struct ProbeEvent {
+		const char* name; /**< The name of the probe (a string literal). */
+		int64_t start; /**< The start time (steady clock, in nanoseconds). */
+		int64_t duration; /**< The duration in nanoseconds. */
+		uint32_t thread; /**< The index of the thread that has recorded the probe. */
+	};
+
+	/**
+	 * @brief A single-producer/single-consumer ring of probe events. Every thread that records
+	 *        probes owns one (see getProbeBuffer()), the events are collected by another thread.
+	 *
+	 * Recording never blocks: if the ring is full because nobody collects, new events are dropped.
+	*/
+	class ProbeBuffer {
+	public:
+		static constexpr size_t Capacity = 0x4000; /**< The number of events the ring can hold. */
+
+	public:
+		/**
+		 * @brief Constructs an empty buffer.
+		 * @param thread The index of the owning thread.
+		*/
+		explicit ProbeBuffer(uint32_t thread) noexcept;
+
+		/**
+		 * @brief Appends an event. Must only be called by the owning thread.
+		 * @param name The name of the probe (a string literal).
+		 * @param start The start time in nanoseconds.
+		 * @param duration The duration in nanoseconds.
+		 * @return True if the event has been recorded, false if it has been dropped.
+		*/
+		bool push(const char* name, int64_t start, int64_t duration) noexcept;
+
+		/**
+		 * @brief Removes all events and appends them to a list. Must only be called by one thread at a time.
+		 * @param events The list to append to.
+		 * @return The number of events.
+		*/
+		size_t drain(std::vector<ProbeEvent>& events);
+
+		/**
+		 * @brief Returns the index of the owning thread.
+		 * @return The index.
+		*/
+		uint32_t getThread() const noexcept;
+
+		/**
+		 * @brief Returns the number of events that have been dropped because the ring was full.
+		 * @return The number of dropped events.
+		*/
+		uint64_t getDroppedCount() const noexcept;
+
+	private:
+		std::array<ProbeEvent, Capacity> mEvents;
+		alignas(64) std::atomic<size_t> mHead; ///< written by the owning thread
+		alignas(64) std::atomic<size_t> mTail; ///< written by the collecting thread
+		std::atomic<uint64_t> mDroppedCount;
+		uint32_t mThread;
+	};
+
+	/**
+	 * @brief Returns the current time of the clock the probes use.
+	 * @return The time (steady clock, in nanoseconds).
+	*/
+	int64_t getProbeTime() noexcept;
+
+	/**
+	 * @brief Returns the probe buffer of the calling thread. It is created and registered on first use.
+	 * @return The buffer.
+	*/
+	ProbeBuffer& getProbeBuffer();
+
+	/**
+	 * @brief Collects the events of all threads that have recorded probes since the last call. Only one
+	 *        thread should collect.
+	 * @return The events, ordered by their start time.
+	*/
+	std::vector<ProbeEvent> collectProbeEvents();
+
+	/**
+	 * @brief Measures the time from its construction until its destruction and records it into the
+	 *        probe buffer of the calling thread.
+	*/
+	class ScopedProbe {
+	public:
+		/**
+		 * @brief Starts the measurement.
+		 * @param name The name of the probe. It has to be a string literal (only the pointer is stored).
+		*/
+		explicit ScopedProbe(const char* name) noexcept
+			: mName(name), mStart(getProbeTime())
+		{}
+
+		/**
+		 * @brief Stops the measurement and records it.
+		*/
+		~ScopedProbe() {
+			getProbeBuffer().push(mName, mStart, getProbeTime() - mStart);
+		}
+
+		ScopedProbe(const ScopedProbe&) = delete;
+		ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+	private:
+		const char* mName;
+		int64_t mStart;
+	};
+
+	/**
+	 * @brief Keeps the durations of the latest events of every probe and the history of their
+	 *        50th, 95th and 99th percentiles, e.g. to draw rolling graphs once per frame.
+	*/
+	class ProbeStatistics {
+	public:
+		/**
+		 * @brief The percentiles of a probe over time.
+		*/
+		struct Series {
+			std::deque<double> window; /**< The durations of the latest events in milliseconds. */
+			std::vector<float> p50; /**< The 50th percentile after every update in milliseconds, oldest first. */
+			std::vector<float> p95; /**< The 95th percentile after every update in milliseconds, oldest first. */
+			std::vector<float> p99; /**< The 99th percentile after every update in milliseconds, oldest first. */
+		};
+
+	public:
+		/**
+		 * @brief Constructs empty statistics.
+		 * @param windowSize The number of latest events per probe the percentiles are computed of.
+		 * @param historySize The number of updates the histories keep.
+		*/
+		explicit ProbeStatistics(size_t windowSize = 240, size_t historySize = 300) noexcept;
+
+		/**
+		 * @brief Adds the durations of events to the windows of their probes.
+		 * @param events The events.
+		*/
+		void add(const std::vector<ProbeEvent>& events);
+
+		/**
+		 * @brief Computes the percentiles of every probe over its window and appends them to the histories.
+		*/
+		void update();
+
+		/**
+		 * @brief Discards all windows and histories.
+		*/
+		void clear() noexcept;
+
+		/**
+		 * @brief Returns the series of all probes that have been seen.
+		 * @return The series by probe name.
+		*/
+		const std::map<std::string, Series>& getSeries() const noexcept;
+
+	private:
+		size_t mWindowSize;
+		size_t mHistorySize;
+		std::map<std::string, Series> mSeries;
+	};
+
+	/**
+	 * @brief Returns a percentile of a list of values (nearest rank).
+	 * @param values The values (reordered by the function).
+	 * @param percentile The percentile (0 to 100).
+	 * @return The percentile, or 0 if the list is empty.
+	*/
+	double getPercentile(std::vector<double>& values, double percentile);
+
+	/**
+	 * @brief Writes events in the Chrome trace event format (complete events, times in microseconds
+	 *        relative to the first event). The file can be opened with Perfetto or chrome://tracing.
+	 * @param output The stream to write to.
+	 * @param events The events.
+	*/
+	void writeChromeTrace(std::ostream& output, const std::vector<ProbeEvent>& events);
+
+}
@@ -0,0 +1,143 @@
+/** @file
+  * @brief Contains the Chip8::Profiler class that collects execution statistics per opcode.
+  */
+#pragma once
+
+#include "Chip8Core/Opcodes.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Counts how often each opcode of Chip8::Opcodes is executed and how long it takes, and how
+	 *        often the instruction at each address is executed (a heat map of the address space).
+	 *
+	 * A profiler is attached to an emulator with Chip8::setProfiler(). While it is attached, every
+	 * executed instruction is timed and recorded; without a profiler the emulator does not look at the
+	 * clock at all. The hook is only compiled into the emulator if CHIP8_ENABLE_PROFILING is defined
+	 * (see Profiler::Enabled), otherwise attaching a profiler has no effect.
+	*/
+	class Profiler {
+	public:
+		/**
+		 * @brief Whether the emulator has been compiled with the profiling hook.
+		*/
+#ifdef CHIP8_ENABLE_PROFILING
+		static constexpr bool Enabled = true;
+#else
+		static constexpr bool Enabled = false;
+#endif
+
+		/**
+		 * @brief The number of buckets of the duration histograms. Bucket i counts the instructions that took
+		 *        2^i to 2^(i + 1) - 1 nanoseconds (bucket 0 includes 0 ns, the last bucket everything above).
+		*/
+		static constexpr size_t DurationBuckets = 16;
+
+		/**
+		 * @brief The number of entries: one per opcode of Chip8::Opcodes plus one for unknown opcodes.
+		*/
+		static constexpr size_t OpcodeCount = Opcodes.size() + 1;
+
+		/**
+		 * @brief The number of addresses of the heat map (the whole address space).
+		*/
+		static constexpr size_t AddressCount = Chip8::MemorySize;
+
+		/**
+		 * @brief The statistics of a single opcode.
+		*/
+		struct OpcodeStatistics {
+			uint64_t executions = 0; /**< How often the opcode has been executed. */
+			uint64_t totalTime = 0; /**< The summed up execution time in nanoseconds. */
+			std::array<uint64_t, DurationBuckets> histogram{}; /**< The execution times, see DurationBuckets. */
+		};
+
+	public:
+		/**
+		 * @brief Discards all statistics.
+		*/
+		void reset() noexcept;
+
+		/**
+		 * @brief Records an executed instruction. This is called by the emulator.
+		 * @param address The address of the instruction.
+		 * @param opcodeIndex The index of the opcode in Chip8::Opcodes (Opcodes.size() for unknown opcodes).
+		 * @param duration The execution time in nanoseconds.
+		*/
+		void recordInstruction(uint16_t address, size_t opcodeIndex, uint64_t duration) noexcept {
+			++mAddressCounts[address % AddressCount];
+			auto& statistics = mOpcodes[opcodeIndex];
+			++statistics.executions;
+			statistics.totalTime += duration;
+			size_t bucket = 0;
+			while (duration > 1 && bucket + 1 < DurationBuckets) {
+				duration >>= 1;
+				++bucket;
+			}
+			++statistics.histogram[bucket];
+		}
+
+		/**
+		 * @brief Returns the statistics of an opcode.
+		 * @param opcodeIndex The index of the opcode in Chip8::Opcodes (Opcodes.size() for unknown opcodes).
+		 * @return The statistics.
+		*/
+		const OpcodeStatistics& getOpcodeStatistics(size_t opcodeIndex) const;
+
+		/**
+		 * @brief Returns the name of an opcode as given in Chip8::Opcodes (e.g. "DXYN").
+		 * @param opcodeIndex The index of the opcode in Chip8::Opcodes (Opcodes.size() for unknown opcodes).
+		 * @return The name, "unknown" for unknown opcodes.
+		*/
+		static const char* getOpcodeName(size_t opcodeIndex);
+
+		/**
+		 * @brief Returns the number of recorded instructions.
+		 * @return The sum of the executions of all opcodes.
+		*/
+		uint64_t getTotalExecutions() const noexcept;
+
+		/**
+		 * @brief Returns the summed up execution time of all recorded instructions.
+		 * @return The time in nanoseconds.
+		*/
+		uint64_t getTotalTime() const noexcept;
+
+		/**
+		 * @brief Returns how often the instruction at each address has been executed.
+		 * @return The counters, indexed by address.
+		*/
+		const std::array<uint64_t, AddressCount>& getAddressCounts() const noexcept;
+
+		/**
+		 * @brief Returns the most frequently executed addresses.
+		 * @param count The maximum number of addresses to return.
+		 * @return The addresses that have been executed at least once, most frequently executed first.
+		*/
+		std::vector<uint16_t> getHotAddresses(size_t count) const;
+
+		/**
+		 * @brief Writes the heat map as CSV lines of the form `address,executions` (addresses in hex),
+		 *        one for every address that has been executed at least once.
+		 * @param output The stream to write to.
+		*/
+		void writeHeatMapCsv(std::ostream& output) const;
+
+		/**
+		 * @brief Writes the statistics as a JSON object with the totals and one entry per opcode.
+		 * @param output The stream to write to.
+		*/
+		void writeJson(std::ostream& output) const;
+
+	private:
+		std::array<OpcodeStatistics, OpcodeCount> mOpcodes;
+		std::array<uint64_t, AddressCount> mAddressCounts{};
+	};
+
+}
@@ -0,0 +1,80 @@
+/** @file
+  * @brief Contains the Chip8::RandomNumberGenerator class, a small and fast seedable random number generator.
+  */
+#pragma once
+
+#include <cstdint>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A xorshift64* random number generator.
+	 *
+	 * Every Chip8 instance owns one of these, so the random numbers of an emulation only depend
+	 * on its seed. The complete state consists of a single 64 bit value which is part of the
+	 * saved machine state.
+	*/
+	class RandomNumberGenerator {
+	public:
+		/**
+		 * @brief Constructs a generator and seeds it.
+		 * @param seed The seed.
+		*/
+		explicit RandomNumberGenerator(uint64_t seed = 0) noexcept {
+			this->seed(seed);
+		}
+
+		/**
+		 * @brief Resets the generator to the sequence determined by the given seed.
+		 * @param seed The seed.
+		*/
+		void seed(uint64_t seed) noexcept {
+			// splitmix64 scrambles the seed, so that similar seeds yield unrelated sequences
+			uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			mState = z ^ (z >> 31);
+			if (mState == 0)
+				mState = 0x9E3779B97F4A7C15ull; // xorshift must never be in the zero state
+		}
+
+		/**
+		 * @brief Generates the next random number.
+		 * @return A uniformly distributed 64 bit value.
+		*/
+		uint64_t next() noexcept {
+			mState ^= mState >> 12;
+			mState ^= mState << 25;
+			mState ^= mState >> 27;
+			return mState * 0x2545F4914F6CDD1Dull;
+		}
+
+		/**
+		 * @brief Generates a random byte.
+		 * @return A uniformly distributed value from 0 to 255.
+		*/
+		uint8_t nextByte() noexcept {
+			return static_cast<uint8_t>(next() >> 56); // the upper bits have the best quality
+		}
+
+		/**
+		 * @brief Returns the internal state of the generator.
+		 * @return The state.
+		*/
+		uint64_t getState() const noexcept {
+			return mState;
+		}
+
+		/**
+		 * @brief Restores an internal state that has been obtained by getState().
+		 * @param state The state (must not be zero).
+		*/
+		void setState(uint64_t state) noexcept {
+			mState = (state == 0 ? 0x9E3779B97F4A7C15ull : state);
+		}
+
+	private:
+		uint64_t mState;
+	};
+
+}
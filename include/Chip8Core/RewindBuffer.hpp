@@ -0,0 +1,126 @@
+/** @file
+  * @brief Contains the Chip8::RewindBuffer class, which keeps a compressed history of machine states.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A ring buffer of machine states that allows to rewind the emulation frame by frame.
+	 *
+	 * Each frame is stored as the XOR delta to its predecessor. The deltas are run-length encoded so
+	 * that unchanged bytes (usually almost the whole memory) cost next to nothing. Every few frames a
+	 * keyframe that holds the complete (also run-length encoded) state is stored in addition. This way
+	 * stepping one frame back or forth costs a single delta application, while jumping to an arbitrary
+	 * frame never has to apply more deltas than the keyframe interval.
+	 *
+	 * The total size of all stored frames is kept below the memory budget by dropping the oldest
+	 * frames (always a whole keyframe group at once).
+	*/
+	class RewindBuffer {
+	public:
+		constexpr static size_t DefaultMemoryBudget = 4u * 1024u * 1024u; /**< Default memory budget in bytes. */
+		constexpr static size_t DefaultKeyframeInterval = 60u; /**< Default number of frames between two keyframes. */
+
+	public:
+		/**
+		 * @brief Constructs an empty rewind buffer.
+		 * @param memoryBudget The maximum number of bytes all stored frames may occupy.
+		 * @param keyframeInterval The number of frames between two keyframes.
+		*/
+		explicit RewindBuffer(size_t memoryBudget = DefaultMemoryBudget,
+			size_t keyframeInterval = DefaultKeyframeInterval);
+
+		/**
+		 * @brief Appends the current state of the emulator as the newest frame. If a previous frame
+		 *        has been restored before, all frames after it are discarded first.
+		 * @param chip8 The emulator to capture.
+		*/
+		void push(const Chip8& chip8);
+
+		/**
+		 * @brief Restores the emulator to the state of a stored frame.
+		 * @param index The index of the frame (0 is the oldest frame).
+		 * @param chip8 The emulator to restore.
+		 * @return True on success, false if the index is out of range.
+		*/
+		bool restore(size_t index, Chip8& chip8);
+
+		/**
+		 * @brief Restores the frame before the current position.
+		 * @param chip8 The emulator to restore.
+		 * @return True on success, false if there is no older frame.
+		*/
+		bool stepBack(Chip8& chip8);
+
+		/**
+		 * @brief Discards all frames after the current position, as push() does before appending.
+		*/
+		void truncateAfterPosition();
+
+		/**
+		 * @brief Discards all stored frames.
+		*/
+		void clear() noexcept;
+
+		/**
+		 * @brief Returns the number of stored frames.
+		 * @return The number of frames.
+		*/
+		size_t size() const noexcept;
+
+		/**
+		 * @brief Returns the index of the frame that has been pushed or restored most recently.
+		 * @return The current frame index.
+		*/
+		size_t getPosition() const noexcept;
+
+		/**
+		 * @brief Returns the number of bytes currently occupied by the stored frames.
+		 * @return The memory usage in bytes.
+		*/
+		size_t getMemoryUsage() const noexcept;
+
+		/**
+		 * @brief Returns the memory budget.
+		 * @return The memory budget in bytes.
+		*/
+		size_t getMemoryBudget() const noexcept;
+
+		/**
+		 * @brief Sets a new memory budget. Frames exceeding it are dropped immediately.
+		 * @param memoryBudget The memory budget in bytes.
+		*/
+		void setMemoryBudget(size_t memoryBudget);
+
+	private:
+		struct Frame {
+			std::vector<uint8_t> delta; ///< run-length encoded XOR delta to the previous frame
+			std::vector<uint8_t> keyframe; ///< run-length encoded full state (empty for non-keyframes)
+		};
+
+		static std::vector<uint8_t> encode(const Chip8::State& state, const Chip8::State& reference);
+		static void applyXor(const std::vector<uint8_t>& encoded, Chip8::State& state);
+		static size_t frameSize(const Frame& frame) noexcept;
+		void enforceMemoryBudget();
+
+	private:
+		std::deque<Frame> mFrames;
+		size_t mMemoryBudget;
+		size_t mKeyframeInterval;
+		size_t mFramesSinceKeyframe;
+		size_t mPosition;
+		size_t mMemoryUsage;
+		Chip8::State mNewestState; ///< decoded state of the newest frame
+		Chip8::State mPositionState; ///< decoded state of the frame at mPosition
+		Chip8::State mScratchState;
+	};
+
+}
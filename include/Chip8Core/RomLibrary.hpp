@@ -0,0 +1,144 @@
+/** @file
+  * @brief Contains the Chip8::RomDatabase and Chip8::RomLibrary classes to manage collections of ROMs.
+  */
+#pragma once
+
+#include "Chip8Core/Hash.hpp"
+#include "Chip8Core/MappedFile.hpp"
+#include "Chip8Core/OpcodeHandler.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+
+	class ThreadPool;
+
+	/**
+	 * @brief Known ROMs with their titles and quirk settings, read from a database in the format of
+	 *        the chip-8-database project (programs.json and the optional platforms.json).
+	*/
+	class RomDatabase {
+	public:
+		/**
+		 * @brief What the database knows about a ROM.
+		*/
+		struct Entry {
+			std::string title; /**< The title of the program. */
+			std::string platform; /**< The platform the ROM has been written for (e.g. "originalChip8" or "superchip"). */
+			CompatibilityMode compatibilityMode = CompatibilityMode::SuperChip; /**< The quirk profile that suits the platform best. */
+			uint32_t tickrate = 0; /**< The recommended number of instructions per frame (0 if unknown). */
+		};
+
+	public:
+		/**
+		 * @brief Loads the database from a directory that contains programs.json and optionally
+		 *        platforms.json (which provides the quirks of each platform).
+		 * @param directory The directory.
+		 * @param error Receives a description of the error, if any.
+		 * @return True if the database could be loaded, false otherwise.
+		*/
+		bool load(const std::string& directory, std::string& error);
+
+		/**
+		 * @brief Loads the database from the contents of its files.
+		 * @param programs The content of programs.json.
+		 * @param platforms The content of platforms.json (may be empty).
+		 * @param error Receives a description of the error, if any.
+		 * @return True if the database could be parsed, false otherwise.
+		*/
+		bool loadFromJson(const std::string& programs, const std::string& platforms, std::string& error);
+
+		/**
+		 * @brief Looks up a ROM.
+		 * @param hash The SHA-1 hash of the ROM.
+		 * @return The entry, or nullptr if the ROM is unknown.
+		*/
+		const Entry* find(const Sha1Digest& hash) const;
+
+		/**
+		 * @brief Returns the number of known ROMs.
+		 * @return The number of ROMs.
+		*/
+		size_t size() const noexcept;
+
+	private:
+		std::unordered_map<std::string, Entry> mEntries; ///< keyed by the hexadecimal hash
+	};
+
+	/**
+	 * @brief An index of the ROMs in a set of directories.
+	 *
+	 * Scanning hashes the ROM files in parallel and looks them up in a RomDatabase. The index can be
+	 * saved and loaded again, so that later scans only hash files that are new or have changed.
+	*/
+	class RomLibrary {
+	public:
+		/**
+		 * @brief A ROM of the library.
+		*/
+		struct Entry {
+			std::string path; /**< The path of the ROM file. */
+			Sha1Digest hash{}; /**< The SHA-1 hash of the file. */
+			MappedFile::Stamp stamp{ 0, 0 }; /**< Size and modification time of the file when it was hashed. */
+			std::string title; /**< The title from the database, or the file name for unknown ROMs. */
+			std::string platform; /**< The platform from the database (empty for unknown ROMs). */
+			CompatibilityMode compatibilityMode = CompatibilityMode::SuperChip; /**< The quirk profile to run the ROM with. */
+			uint32_t tickrate = 0; /**< The recommended number of instructions per frame (0 if unknown). */
+			bool known = false; /**< Whether the ROM is in the database. */
+		};
+
+	public:
+		/**
+		 * @brief Returns whether a file name has one of the extensions of CHIP-8 ROMs (.ch8, .c8, .sc8, .xo8).
+		 * @param filename The file name.
+		 * @return True if it is a ROM file name.
+		*/
+		static bool isRomFile(const std::string& filename);
+
+		/**
+		 * @brief Replaces the entries by the ROMs found in the given directories (recursively). Files
+		 *        that are already indexed with the same size and modification time are not hashed again.
+		 * @param directories The directories to scan.
+		 * @param database The database to look up titles and quirks in.
+		 * @param threadPool The pool the files are hashed on.
+		 * @return The number of files that have been hashed.
+		*/
+		size_t scan(const std::vector<std::string>& directories, const RomDatabase& database, ThreadPool& threadPool);
+
+		/**
+		 * @brief Loads an index that has been written by saveIndex().
+		 * @param filename The index file.
+		 * @return True if the index could be loaded, false otherwise (the entries are left unchanged).
+		*/
+		bool loadIndex(const std::string& filename);
+
+		/**
+		 * @brief Writes the entries to an index file.
+		 * @param filename The index file.
+		 * @return True if the index could be written, false otherwise.
+		*/
+		bool saveIndex(const std::string& filename) const;
+
+		/**
+		 * @brief Finds the entries whose title or path contains a text (ignoring case).
+		 * @param query The text. An empty text matches every entry.
+		 * @return The indices of the matching entries, sorted by title.
+		*/
+		std::vector<size_t> search(const std::string& query) const;
+
+		/**
+		 * @brief Returns all entries, sorted by path.
+		 * @return The entries.
+		*/
+		const std::vector<Entry>& getEntries() const noexcept;
+
+	private:
+		std::vector<Entry> mEntries;
+	};
+
+}
@@ -0,0 +1,128 @@
+/** @file
+  * @brief Contains the Chip8::Rom and Chip8::RomStore classes, a content-addressed cache of ROMs.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/Hash.hpp"
+#include "Chip8Core/MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief An immutable ROM, prepared for loading into a machine.
+	 *
+	 * The content is kept as the memory pages it occupies once loaded (the program starts at
+	 * Chip8::Chip8::ProgramOffset, which is page aligned). Loading the ROM with Chip8::loadROM(const Rom&)
+	 * therefore only shares these pages with the machine instead of copying bytes; they are copied
+	 * once the program writes to them.
+	*/
+	class Rom {
+	public:
+		using Memory = Chip8Memory<Chip8::MemoryUnderlyingType>; /**< The memory the ROM gets loaded into. */
+		using Page = Memory::Page; /**< A page of the machine memory. */
+		constexpr static size_t FirstPage = Chip8::ProgramOffset / Memory::PageSize; /**< The page the program starts in. */
+		constexpr static size_t MaximumSize = Chip8::MemorySize - Chip8::ProgramOffset; /**< Bytes beyond this size are ignored. */
+
+	public:
+		/**
+		 * @brief Prepares a ROM.
+		 * @param data The content of the ROM.
+		 * @param size The size of the ROM in bytes.
+		*/
+		Rom(const uint8_t* data, size_t size);
+
+		/**
+		 * @brief Returns the SHA-1 hash of the (complete) content.
+		 * @return The hash.
+		*/
+		const Sha1Digest& getHash() const noexcept;
+
+		/**
+		 * @brief Returns the size of the ROM as it gets loaded into memory.
+		 * @return The size in bytes (at most MaximumSize).
+		*/
+		size_t getSize() const noexcept;
+
+		/**
+		 * @brief Returns the pages the ROM occupies in memory, starting with page FirstPage.
+		 * @return The pages.
+		*/
+		const std::vector<std::shared_ptr<const Page>>& getPages() const noexcept;
+
+	private:
+		Sha1Digest mHash;
+		size_t mSize;
+		std::vector<std::shared_ptr<const Page>> mPages;
+	};
+
+	/**
+	 * @brief Loads ROM files through memory mappings and caches them by content hash.
+	 *
+	 * Loading the same path again is answered from the cache without touching the file system.
+	 * Files with identical content share a single Rom. All member functions are thread-safe, so one
+	 * store can serve the workers of a batch run.
+	*/
+	class RomStore {
+	public:
+		/**
+		 * @brief Returns the ROM stored in a file.
+		 * @param filename The file.
+		 * @param revalidate Whether to check if a file that has already been loaded has changed on disk
+		 *        since (by its size and modification time) and to reload it if so. This is meant for
+		 *        hot-reloading; otherwise the file system is only accessed on the first load.
+		 * @return The ROM, or nullptr if the file could not be read.
+		*/
+		std::shared_ptr<const Rom> load(const std::string& filename, bool revalidate = false);
+
+		/**
+		 * @brief Adds a ROM that is already in memory (if no ROM with the same content is stored yet).
+		 * @param data The content of the ROM.
+		 * @param size The size of the ROM in bytes.
+		 * @return The stored ROM.
+		*/
+		std::shared_ptr<const Rom> add(const uint8_t* data, size_t size);
+
+		/**
+		 * @brief Looks up a ROM by the hash of its content.
+		 * @param hash The SHA-1 hash.
+		 * @return The ROM, or nullptr if no such ROM has been stored.
+		*/
+		std::shared_ptr<const Rom> find(const Sha1Digest& hash) const;
+
+		/**
+		 * @brief Returns the number of distinct ROMs in the store.
+		 * @return The number of ROMs.
+		*/
+		size_t size() const;
+
+		/**
+		 * @brief Removes all ROMs and forgets all paths. ROMs that are still referenced stay valid.
+		*/
+		void clear();
+
+	private:
+		struct PathEntry {
+			MappedFile::Stamp stamp;
+			std::shared_ptr<const Rom> rom;
+		};
+
+	private:
+		std::shared_ptr<const Rom> insert(const uint8_t* data, size_t size);
+
+	private:
+		mutable std::mutex mMutex;
+		std::map<Sha1Digest, std::shared_ptr<const Rom>> mRoms;
+		std::unordered_map<std::string, PathEntry> mPaths;
+	};
+
+}
@@ -0,0 +1,167 @@
+/** @file
+  * @brief Contains the Chip8::SessionBackend and Chip8::SessionViewer classes, which split the
+  *        emulation (backend) from any number of viewers in other processes via shared memory.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/SharedMemory.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A snapshot of the emulation as published by a SessionBackend.
+	*/
+	struct SessionFrame {
+		constexpr static size_t MaximumViewers = 4u; /**< The number of viewers that can be attached at once. */
+
+		uint64_t frameNumber; /**< Counts the published frames, starting at 1. */
+		int64_t publishTime; /**< The time of publishing (steady clock, in nanoseconds). */
+		std::array<int64_t, MaximumViewers> inputEcho; /**< Per viewer: the send time of the last input event that has been applied before this frame. */
+		Chip8::State state; /**< The complete machine state, see Chip8::saveState(). */
+	};
+
+	/**
+	 * @brief Latency measurements of a SessionViewer.
+	*/
+	struct SessionLatency {
+		uint64_t samples = 0; /**< The number of measurements. */
+		double last = 0.0; /**< The last measurement in seconds. */
+		double mean = 0.0; /**< The mean in seconds. */
+		double maximum = 0.0; /**< The maximum in seconds. */
+
+		/**
+		 * @brief Adds a measurement.
+		 * @param seconds The latency in seconds.
+		*/
+		void add(double seconds) noexcept;
+	};
+
+	/**
+	 * @brief Publishes the state of a machine into a named shared memory segment and receives the
+	 *        input of the attached viewers.
+	 *
+	 * Frames are published with a seqlock over three slots: the backend writes into the slot after
+	 * the latest one and never waits for viewers, viewers copy the latest slot and retry if it has
+	 * been overwritten meanwhile. With three slots that only happens if a viewer is stalled for two
+	 * publishes. Each viewer has its own single-producer/single-consumer ring for key events. A
+	 * viewer channel stores the process id of its viewer, so the channels of crashed viewers are
+	 * reclaimed by the next viewer that attaches.
+	*/
+	class SessionBackend {
+	public:
+		/**
+		 * @brief Creates the shared memory segment.
+		 * @param name The name of the segment (on POSIX systems it should start with a slash).
+		 * @throws std::runtime_error if the segment could not be created.
+		*/
+		explicit SessionBackend(const std::string& name);
+
+		/**
+		 * @brief Publishes the current state of a machine.
+		 * @param chip8 The machine.
+		*/
+		void publish(const Chip8& chip8) noexcept;
+
+		/**
+		 * @brief Applies the key events that the viewers have sent since the last call.
+		 * @param chip8 The machine to apply the events to.
+		 * @return The number of events that have been applied.
+		*/
+		size_t pollInput(Chip8& chip8) noexcept;
+
+		/**
+		 * @brief Returns the number of attached viewers whose processes are still running.
+		 * @return The number of viewers.
+		*/
+		size_t getViewerCount() const noexcept;
+
+		/**
+		 * @brief Returns the number of published frames.
+		 * @return The number of frames.
+		*/
+		uint64_t getFrameCount() const noexcept;
+
+	private:
+		SharedMemory mMemory;
+		uint64_t mFrameCount;
+		std::array<int64_t, SessionFrame::MaximumViewers> mInputEcho;
+	};
+
+	/**
+	 * @brief Attaches to the segment of a SessionBackend (usually in another process), reads the
+	 *        published frames and sends key events.
+	 *
+	 * The viewer measures two latencies: the age of a frame when it is read (publish to read) and
+	 * the end-to-end input latency from sending a key event until the first frame that includes it
+	 * has been read.
+	*/
+	class SessionViewer {
+	public:
+		/**
+		 * @brief Attaches to a session.
+		 * @param name The name of the segment.
+		 * @throws std::runtime_error if the segment does not exist, is not a session or if the
+		 *         maximum number of viewers is already attached.
+		*/
+		explicit SessionViewer(const std::string& name);
+
+		/**
+		 * @brief Detaches from the session.
+		*/
+		~SessionViewer();
+
+		SessionViewer(const SessionViewer&) = delete;
+		SessionViewer& operator=(const SessionViewer&) = delete;
+
+		/**
+		 * @brief Copies the latest published frame.
+		 * @param frame Receives the frame (its content is unspecified if false is returned).
+		 * @return True if a frame has been copied, false if nothing has been published yet or if no
+		 *         consistent frame could be read within a bounded number of attempts (the backend
+		 *         has stalled or crashed while publishing).
+		*/
+		bool read(SessionFrame& frame) noexcept;
+
+		/**
+		 * @brief Sends a key event to the backend.
+		 * @param key The code of the key (0x0 to 0xF).
+		 * @param pressed True if the key has been pressed, false if it has been released.
+		 * @return True if the event has been queued, false if the queue is full.
+		*/
+		bool sendKey(uint8_t key, bool pressed) noexcept;
+
+		/**
+		 * @brief Returns the index of the viewer slot this viewer occupies.
+		 * @return The index (0 to SessionFrame::MaximumViewers - 1).
+		*/
+		size_t getViewerIndex() const noexcept;
+
+		/**
+		 * @brief Returns the age of the frames when they have been read.
+		 * @return The latency statistics.
+		*/
+		const SessionLatency& getFrameLatency() const noexcept;
+
+		/**
+		 * @brief Returns the time from sending a key event until reading the first frame that includes it.
+		 * @return The latency statistics.
+		*/
+		const SessionLatency& getInputLatency() const noexcept;
+
+	private:
+		SharedMemory mMemory;
+		size_t mViewerIndex;
+		int64_t mPendingInputTime; ///< send time of the oldest event whose effect has not been seen yet (0 if none)
+		int64_t mLastInputTime;
+		uint64_t mLastFrameNumber;
+		SessionLatency mFrameLatency;
+		SessionLatency mInputLatency;
+	};
+
+}
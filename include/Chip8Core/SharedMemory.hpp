@@ -0,0 +1,86 @@
+/** @file
+  * @brief Contains the Chip8::SharedMemory class, a named memory block that can be mapped by several processes.
+  */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A named block of memory that other processes can map as well (POSIX shared memory on
+	 *        Linux and macOS, a named file mapping on Windows).
+	 *
+	 * This allows handing the observation buffers of a VectorEnvironment to another process (for
+	 * example a training script) without copying them. The process that creates the block owns
+	 * the name and removes it again when the object is destroyed.
+	*/
+	class SharedMemory {
+	public:
+		/**
+		 * @brief Whether to create a new block or to open an existing one.
+		*/
+		enum class Mode {
+			Create,/**< create a new block (an existing block with the same name is replaced) */
+			Open,/**< open a block created by another SharedMemory object */
+		};
+
+	public:
+		/**
+		 * @brief Creates or opens a named memory block and maps it into the address space.
+		 * @param name The name of the block. On POSIX systems it should start with a slash.
+		 * @param size The size in bytes (ignored when opening; the size of the existing block is used).
+		 * @param mode Whether to create or open the block.
+		 * @throws std::runtime_error if the block could not be created, opened or mapped.
+		*/
+		SharedMemory(const std::string& name, size_t size, Mode mode = Mode::Create);
+
+		/**
+		 * @brief Unmaps the block. If this object has created the block, the name is removed.
+		*/
+		~SharedMemory();
+
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator=(const SharedMemory&) = delete;
+
+		/**
+		 * @brief Moves the mapping into a new object.
+		 * @param other The object to move from. It is left without a mapping.
+		*/
+		SharedMemory(SharedMemory&& other) noexcept;
+
+		/**
+		 * @brief Returns the start of the mapped block.
+		 * @return Pointer to the first byte.
+		*/
+		uint8_t* data() noexcept;
+
+		/**
+		 * @brief Returns the start of the mapped block.
+		 * @return Pointer to the first byte.
+		*/
+		const uint8_t* data() const noexcept;
+
+		/**
+		 * @brief Returns the size of the mapped block.
+		 * @return The size in bytes.
+		*/
+		size_t size() const noexcept;
+
+		/**
+		 * @brief Returns the name of the block.
+		 * @return The name.
+		*/
+		const std::string& getName() const noexcept;
+
+	private:
+		std::string mName;
+		uint8_t* mData;
+		size_t mSize;
+		bool mIsOwner;
+		void* mHandle; ///< the file mapping handle (Windows only)
+	};
+
+}
@@ -0,0 +1,105 @@
+/** @file
+  * @brief Contains the Chip8::StreamClient class, the reference client of the Chip8::StreamServer.
+  */
+#pragma once
+
+#include "Chip8Core/FrameCodec.hpp"
+#include "Chip8Core/Session.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Connects to a StreamServer over plain TCP, decodes the frames and sends key events.
+	 *
+	 * Like SessionViewer, the client measures the end-to-end input latency: from sending a key event
+	 * until receiving the first frame that includes it (the server echoes the time of the event).
+	 *
+	 * Only available on POSIX systems; on Windows the constructor throws.
+	*/
+	class StreamClient {
+	public:
+		/**
+		 * @brief Counters of a client.
+		*/
+		struct Statistics {
+			uint64_t frames = 0; /**< The number of received frames. */
+			uint64_t keyframes = 0; /**< The number of keyframes among them. */
+			uint64_t bytesReceived = 0; /**< The number of received bytes (including framing). */
+			uint64_t sequenceErrors = 0; /**< The number of deltas that did not follow the previous frame. */
+		};
+
+	public:
+		/**
+		 * @brief Connects to a server.
+		 * @param host The host name or IPv4 address.
+		 * @param port The port.
+		 * @throws std::runtime_error if the connection could not be established.
+		*/
+		StreamClient(const std::string& host, uint16_t port);
+
+		/**
+		 * @brief Closes the connection.
+		*/
+		~StreamClient();
+
+		StreamClient(const StreamClient&) = delete;
+		StreamClient& operator=(const StreamClient&) = delete;
+
+		/**
+		 * @brief Waits for the next frame and applies it.
+		 * @param timeout The maximum time to wait in seconds.
+		 * @return True if a frame has been applied, false on timeout or if the connection has been closed.
+		*/
+		bool receiveFrame(double timeout);
+
+		/**
+		 * @brief Sends a key event to the server.
+		 * @param key The code of the key (0x0 to 0xF).
+		 * @param pressed True if the key has been pressed, false if it has been released.
+		 * @return True on success, false if the connection has been closed.
+		*/
+		bool sendKey(uint8_t key, bool pressed);
+
+		/**
+		 * @brief Returns whether the connection is still open.
+		 * @return True if connected.
+		*/
+		bool isConnected() const noexcept;
+
+		/**
+		 * @brief Returns the decoder, which holds the display of the last frame.
+		 * @return The decoder.
+		*/
+		const FrameDecoder& getDecoder() const noexcept;
+
+		/**
+		 * @brief Returns the counters of the client.
+		 * @return The counters.
+		*/
+		const Statistics& getStatistics() const noexcept;
+
+		/**
+		 * @brief Returns the time from sending a key event until receiving the first frame that includes it.
+		 * @return The latency statistics.
+		*/
+		const SessionLatency& getInputLatency() const noexcept;
+
+	private:
+		bool applyBufferedFrame();
+
+	private:
+		int mSocket;
+		FrameDecoder mDecoder;
+		std::vector<uint8_t> mInput;
+		Statistics mStatistics;
+		SessionLatency mInputLatency;
+		int64_t mPendingInputTime; ///< send time of the oldest event whose effect has not been seen yet (0 if none)
+		int64_t mLastInputTime;
+	};
+
+}
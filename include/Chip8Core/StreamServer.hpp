@@ -0,0 +1,159 @@
+/** @file
+  * @brief Contains the Chip8::StreamServer class, which streams the display to TCP and WebSocket
+  *        clients and receives their key events.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/FrameCodec.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Computes the value of the Sec-WebSocket-Accept header for a WebSocket handshake.
+	 * @param key The value of the Sec-WebSocket-Key header of the request.
+	 * @return The base64 encoded SHA-1 hash of the key and the WebSocket GUID.
+	*/
+	std::string getWebSocketAcceptKey(const std::string& key);
+
+	/**
+	 * @brief Streams the display of a machine to any number of clients and applies their key events.
+	 *
+	 * All socket I/O happens with non-blocking sockets on a dedicated thread that waits with epoll,
+	 * so publishing never blocks the emulation. Every client has its own FrameEncoder, so clients
+	 * receive a keyframe when they connect and only dirty rows afterwards (see FrameCodec.hpp for the
+	 * message format). Plain TCP clients start the connection with StreamHello, and every message in
+	 * either direction is preceded by its size as u16 (little endian). Connections that start with an
+	 * HTTP GET request are upgraded to WebSocket, where every binary message contains exactly one
+	 * stream message. Invalid upgrade requests are answered with an HTTP error and closed, and clients
+	 * that have neither sent the hello nor completed the upgrade within the handshake timeout are
+	 * disconnected.
+	 *
+	 * If a client cannot keep up, frames are dropped for it until its send buffer has drained, and it
+	 * receives a keyframe next.
+	 *
+	 * The server is only available on Linux; on other platforms the constructor throws.
+	*/
+	class StreamServer {
+	public:
+		/**
+		 * @brief Counters of a server, summed over all clients.
+		*/
+		struct Statistics {
+			uint64_t framesPublished = 0; /**< The number of calls to publish(). */
+			uint64_t framesSent = 0; /**< The number of frame messages queued for clients. */
+			uint64_t keyframesSent = 0; /**< The number of keyframes among them. */
+			uint64_t framesDropped = 0; /**< The number of frames skipped for slow clients. */
+			uint64_t bytesSent = 0; /**< The number of bytes written to the sockets (including framing). */
+			uint64_t keyEventsReceived = 0; /**< The number of key events received from clients. */
+		};
+
+		constexpr static size_t MaximumPendingBytes = 64u * 1024u; /**< Frames are dropped for clients with more unsent data. */
+
+	public:
+		/**
+		 * @brief Starts listening and the network thread.
+		 * @param port The TCP port (0 to let the system choose one, see getPort()).
+		 * @param address The IPv4 address to listen on ("0.0.0.0" for all interfaces).
+		 * @param keyframeInterval A keyframe is sent to every client at least every this many frames.
+		 * @param handshakeTimeout The time a client has after connecting to send the hello or the upgrade request.
+		 * @throws std::runtime_error if the socket could not be created or bound.
+		*/
+		explicit StreamServer(uint16_t port, const std::string& address = "127.0.0.1", uint32_t keyframeInterval = 60,
+			std::chrono::milliseconds handshakeTimeout = std::chrono::seconds(5));
+
+		/**
+		 * @brief Disconnects all clients and stops the network thread.
+		*/
+		~StreamServer();
+
+		StreamServer(const StreamServer&) = delete;
+		StreamServer& operator=(const StreamServer&) = delete;
+
+		/**
+		 * @brief Returns the port the server listens on.
+		 * @return The port.
+		*/
+		uint16_t getPort() const noexcept;
+
+		/**
+		 * @brief Sends the current display of a machine to all clients. Only the display is copied,
+		 *        the encoding and sending happens on the network thread.
+		 * @param chip8 The machine.
+		*/
+		void publish(const Chip8& chip8);
+
+		/**
+		 * @brief Applies the key events that have been received since the last call.
+		 * @param chip8 The machine to apply the events to.
+		 * @return The number of events that have been applied.
+		*/
+		size_t pollInput(Chip8& chip8);
+
+		/**
+		 * @brief Returns the number of connected clients.
+		 * @return The number of clients.
+		*/
+		size_t getClientCount() const noexcept;
+
+		/**
+		 * @brief Returns the counters of the server.
+		 * @return A copy of the counters.
+		*/
+		Statistics getStatistics() const;
+
+	private:
+		struct Client;
+		struct ReceivedKeyEvent {
+			uint64_t clientId;
+			StreamKeyEvent event;
+		};
+
+	private:
+		void run();
+		void acceptClients();
+		void sendFrame(Client& client, const Chip8::PackedDisplay& display, int64_t inputEcho);
+		bool receive(Client& client);
+		bool processRawMessages(Client& client);
+		bool processWebSocketHandshake(Client& client);
+		bool processWebSocketFrames(Client& client);
+		void queueMessage(Client& client, const std::vector<uint8_t>& message);
+		bool flush(Client& client);
+		void closeClient(int socket);
+		int closeExpiredHandshakes();
+
+	private:
+		int mListenSocket;
+		int mEpoll;
+		int mWakeEvent; ///< an eventfd that wakes the network thread up after publish() and on shutdown
+		uint16_t mPort;
+		uint32_t mKeyframeInterval;
+		std::chrono::milliseconds mHandshakeTimeout;
+		std::atomic<bool> mStopping;
+		std::atomic<size_t> mClientCount;
+		std::unordered_map<int, std::unique_ptr<Client>> mClients; ///< owned by the network thread, keyed by socket
+		uint64_t mNextClientId;
+
+		mutable std::mutex mMutex; ///< guards the members below
+		Chip8::PackedDisplay mDisplay;
+		uint64_t mPublishedFrames;
+		std::vector<ReceivedKeyEvent> mReceivedEvents;
+		std::unordered_map<uint64_t, int64_t> mAppliedInput; ///< per client: time of the last event applied by pollInput()
+		std::unordered_map<uint64_t, int64_t> mPublishedInput; ///< mAppliedInput at the time of the last publish()
+		Statistics mStatistics;
+
+		std::thread mThread;
+	};
+
+}
@@ -0,0 +1,96 @@
+/** @file
+  * @brief Contains the Chip8::ThreadPool class, a work-stealing thread pool for running many emulators in parallel.
+  */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief A thread pool in which every worker has its own task queue.
+	 *
+	 * Tasks submitted from outside the pool are distributed round-robin over the workers. Tasks
+	 * submitted from within a worker go to the queue of that worker. A worker takes tasks from the
+	 * back of its own queue and, once that is empty, steals from the front of the other queues. This
+	 * keeps all cores busy even if the tasks differ a lot in duration.
+	*/
+	class ThreadPool {
+	public:
+		using Task = std::function<void()>; /**< The type of the tasks. */
+
+	public:
+		/**
+		 * @brief Creates the pool and starts the worker threads.
+		 * @param threadCount The number of worker threads. 0 means one thread per hardware thread.
+		*/
+		explicit ThreadPool(size_t threadCount = 0);
+
+		/**
+		 * @brief Waits for all tasks to finish and stops the worker threads.
+		*/
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/**
+		 * @brief Adds a task to the pool.
+		 * @param task The task.
+		*/
+		void submit(Task task);
+
+		/**
+		 * @brief Blocks until all submitted tasks have been executed. If a task threw an exception,
+		 *        the first one is rethrown here. Must not be called from a task of this pool, which
+		 *        would wait for itself.
+		*/
+		void wait();
+
+		/**
+		 * @brief Runs a function for every index in [0, count) on the pool and waits for completion.
+		 *        Called from a task of this pool, the indices are run inline on the calling worker,
+		 *        since waiting there would deadlock.
+		 * @param count The number of indices.
+		 * @param function The function to call with each index.
+		*/
+		void parallelFor(size_t count, const std::function<void(size_t)>& function);
+
+		/**
+		 * @brief Returns the number of worker threads.
+		 * @return The number of threads.
+		*/
+		size_t getThreadCount() const noexcept;
+
+	private:
+		struct Worker {
+			std::deque<Task> tasks;
+			std::mutex mutex;
+		};
+
+		void run(size_t workerIndex);
+		bool tryTakeTask(size_t workerIndex, Task& task);
+
+	private:
+		std::vector<std::unique_ptr<Worker>> mWorkers;
+		std::vector<std::thread> mThreads;
+		std::mutex mMutex;
+		std::condition_variable mTasksAvailable;
+		std::condition_variable mAllTasksDone;
+		size_t mQueuedTasks;
+		size_t mUnfinishedTasks;
+		bool mStopping;
+		std::exception_ptr mException;
+		std::atomic<size_t> mNextWorker;
+	};
+
+}
@@ -0,0 +1,207 @@
+/** @file
+  * @brief Contains the Chip8::VectorMachine class, which runs many CHIP-8 machines in lockstep.
+  */
+#pragma once
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/Random.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+
+	/**
+	 * @brief Runs many CHIP-8 machines side by side, for example copies of the same ROM that only
+	 *        differ in their inputs and random seeds.
+	 *
+	 * The state of all machines (called lanes) is kept in struct-of-arrays layout: the register VX of
+	 * all lanes is stored contiguously, as are the program counters, address pointers and timers.
+	 * Each call to step() runs one cycle on every lane. The lanes are grouped by the instruction they
+	 * are about to execute, which is the same for all lanes whose program counters agree. Groups are
+	 * executed by vector kernels that work on 32 lanes at once (using AVX2 if the build enables it)
+	 * and mask out the lanes that are not part of the group. Small groups, lanes that have diverged
+	 * too far (see MaximumGroups) and instructions without a vector kernel (drawing, memory transfers,
+	 * subroutines, ...) fall back to scalar execution, which copies the lane into a Chip8 and executes
+	 * the instruction with the same OpcodeHandler as Chip8::step().
+	 *
+	 * Every lane behaves exactly like a Chip8 instance. Lanes can be initialized from and copied back
+	 * to Chip8 instances with setLane() and getLane().
+	*/
+	class VectorMachine {
+	public:
+		/**
+		 * @brief The execution status of a lane.
+		*/
+		enum class LaneStatus : uint8_t {
+			Running,/**< the lane executes instructions */
+			Halted,/**< the lane has stopped (Chip8::step() would have returned false) */
+			Crashed,/**< the lane has accessed memory out of bounds (Chip8::step() would have thrown) */
+		};
+
+		/**
+		 * @brief Counters about how the lanes have been executed.
+		*/
+		struct Statistics {
+			uint64_t vectorLaneSteps = 0; /**< Lane cycles executed by the vector kernels. */
+			uint64_t scalarLaneSteps = 0; /**< Lane cycles executed by the scalar fallback. */
+			uint64_t vectorGroups = 0; /**< Number of times a vector kernel has been run. */
+		};
+
+		constexpr static size_t LanesPerVector = 32u; /**< The number of lanes a vector kernel processes at once.*/
+		constexpr static size_t MaximumGroups = 16u; /**< Lanes whose instruction does not fit into the first groups of a cycle are executed scalar.*/
+		constexpr static size_t MinimumVectorGroupSize = 4u; /**< Smaller groups are executed scalar.*/
+
+	public:
+		/**
+		 * @brief Creates the lanes, each one a copy of the given machine.
+		 * @param laneCount The number of lanes.
+		 * @param prototype The machine every lane starts as.
+		*/
+		VectorMachine(size_t laneCount, const Chip8& prototype);
+
+		/**
+		 * @brief Returns the number of lanes.
+		 * @return The number of lanes.
+		*/
+		size_t getLaneCount() const noexcept;
+
+		/**
+		 * @brief Replaces the state of a lane by the state of a machine. The input recorder of the
+		 *        machine is not taken over.
+		 * @param lane The lane.
+		 * @param chip8 The machine to copy.
+		*/
+		void setLane(size_t lane, const Chip8& chip8);
+
+		/**
+		 * @brief Copies the state of a lane into a machine.
+		 * @param lane The lane.
+		 * @param chip8 The machine to overwrite.
+		*/
+		void getLane(size_t lane, Chip8& chip8) const;
+
+		/**
+		 * @brief Runs one cycle on every running lane. This corresponds to calling Chip8::step() on
+		 *        every machine.
+		*/
+		void step();
+
+		/**
+		 * @brief Decreases the delay and sound timers of all lanes.
+		*/
+		void clockTimers() noexcept;
+
+		/**
+		 * @brief Returns the execution status of a lane.
+		 * @param lane The lane.
+		 * @return The status.
+		*/
+		LaneStatus getLaneStatus(size_t lane) const noexcept;
+
+		/**
+		 * @brief Returns the number of running lanes.
+		 * @return The number of lanes whose status is LaneStatus::Running.
+		*/
+		size_t getRunningLaneCount() const noexcept;
+
+		/**
+		 * @brief Reads a register of a lane.
+		 * @param lane The lane.
+		 * @param registerNumber The number of the register (0x0 to 0xF).
+		 * @return The value of the register.
+		*/
+		uint8_t getRegister(size_t lane, uint8_t registerNumber) const noexcept;
+
+		/**
+		 * @brief Returns the program counter of a lane.
+		 * @param lane The lane.
+		 * @return The program counter.
+		*/
+		uint16_t getProgramCounter(size_t lane) const noexcept;
+
+		/**
+		 * @brief Returns the display of a lane.
+		 * @param lane The lane.
+		 * @return The display with eight pixels packed into each byte.
+		*/
+		Chip8::PackedDisplay getPackedDisplay(size_t lane) const noexcept;
+
+		/**
+		 * @brief Sets the seed of the random number generator of a lane and reseeds it.
+		 * @param lane The lane.
+		 * @param seed The seed.
+		*/
+		void seedRandom(size_t lane, uint64_t seed) noexcept;
+
+		/**
+		 * @brief Tells a lane that a key has been pressed.
+		 * @param lane The lane.
+		 * @param key The code of the key (0x0 to 0xF).
+		*/
+		void triggerKeyDown(size_t lane, uint8_t key) noexcept;
+
+		/**
+		 * @brief Tells a lane that a key has been released.
+		 * @param lane The lane.
+		 * @param key The code of the key (0x0 to 0xF).
+		*/
+		void triggerKeyUp(size_t lane, uint8_t key) noexcept;
+
+		/**
+		 * @brief Returns how the lanes have been executed so far.
+		 * @return The statistics.
+		*/
+		const Statistics& getStatistics() const noexcept;
+
+	private:
+		struct Group {
+			uint16_t instruction;
+			uint16_t opcode;
+			CompatibilityMode compatibilityMode;
+			std::vector<uint32_t> lanes;
+		};
+
+	private:
+		uint8_t* getRegisters(uint8_t registerNumber) noexcept;
+		uint8_t& getRegisterReference(size_t lane, uint8_t registerNumber) noexcept;
+		void copyFromMachine(size_t lane, const Chip8& chip8, bool withMemory);
+		void copyToMachine(size_t lane, Chip8& chip8, bool withMemory) const;
+		static bool hasVectorKernel(uint16_t opcode) noexcept;
+		void executeVector(uint16_t opcode, uint16_t instruction, CompatibilityMode compatibilityMode);
+		void executeScalar(size_t lane, uint16_t opcode, uint16_t instruction);
+
+	private:
+		size_t mLaneCount;
+		size_t mPaddedLaneCount; ///< the lane count rounded up to a multiple of LanesPerVector
+
+		// struct-of-arrays state, indexed by lane (registers: registerNumber * mPaddedLaneCount + lane)
+		std::vector<uint8_t> mV;
+		std::vector<uint16_t> mI;
+		std::vector<uint16_t> mPC;
+		std::vector<uint8_t> mDelayTimer;
+		std::vector<uint8_t> mSoundTimer;
+		std::vector<uint8_t> mStackSize;
+		std::vector<uint16_t> mStack; ///< lane * Chip8::StackSize + index
+		std::vector<CompatibilityMode> mCompatibilityMode;
+		std::vector<uint16_t> mPressedKeys;
+		std::vector<uint8_t> mAwaitingKeyPress;
+		std::vector<uint8_t> mKeyPressRegisterTarget;
+		std::vector<uint64_t> mCycleCount;
+		std::vector<uint64_t> mRandomSeed;
+		std::vector<RandomNumberGenerator> mRandom;
+		std::vector<LaneStatus> mStatus;
+		std::vector<uint8_t> mMemory; ///< lane * Chip8::MemorySize + address
+		std::vector<uint8_t> mDisplay; ///< lane * sizeof(Chip8::PackedDisplay) + byte
+
+		// per cycle scratch data
+		std::vector<Group> mGroups;
+		std::vector<uint8_t> mGroupMask; ///< 0xFF for the lanes of the current group, 0x00 otherwise
+		std::vector<uint8_t> mCondition;
+		Chip8 mScalarMachine; ///< the scalar fallback copies a lane into this machine and executes it there
+
+		Statistics mStatistics;
+	};
+
+}
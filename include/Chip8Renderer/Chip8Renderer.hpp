@@ -5,8 +5,27 @@
 #pragma once
 
 #include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/ControlFlowAnalysis.hpp"
+#include "Chip8Core/Debugger.hpp"
+#include "Chip8Core/Disassembler.hpp"
+#include "Chip8Core/ExecutionHistory.hpp"
+#include "Chip8Core/RewindBuffer.hpp"
+#include "Chip8Core/InputMovie.hpp"
+#include "Chip8Core/InputQueue.hpp"
+#include "Chip8Core/LatencyProbe.hpp"
+#include "Chip8Core/MemoryProfiler.hpp"
+#include "Chip8Core/Profiler.hpp"
+#include "Chip8Core/Probes.hpp"
+#include "Chip8Core/RomLibrary.hpp"
+#include "Chip8Core/RomStore.hpp"
+#include "Chip8Core/Session.hpp"
 #include "Chip8Renderer/Clock.hpp"
 
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
 struct GLFWwindow;
 struct GLFWmonitor;
 
@@ -33,14 +52,48 @@ public:
 	*/
 	[[nodiscard]] bool createWindow();
 
+	/**
+	 * @brief Switches to client mode: instead of running the emulation, the renderer shows the
+	 *        frames published by a SessionBackend and sends the input to it.
+	 * @param name The name of the session.
+	 * @returns True on success, false if the session could not be attached.
+	*/
+	[[nodiscard]] bool connectToSession(const std::string& name);
+
+	/**
+	 * @brief Loads Chip8::LatencyProbe::TestRom, runs it and measures the latency from injected key presses
+	 *        to the presented frames. The report is printed when the measurements are complete.
+	 * @param sampleCount The number of measurements.
+	*/
+	void startLatencyProbe(size_t sampleCount);
+
 	/**
 	 * @brief Enters a loop until the user closes the window.
 	*/
 	void startRenderLoop();
 
 private:
+	void renderFrame();
 	void renderDisplay() const;
 	void renderImGui();
+	void renderRewindControls();
+	void renderMovieControls();
+	void renderLibraryWindow();
+	void renderSessionWindow();
+	void renderProfilerWindow();
+	void renderOpcodeTable();
+	void renderHeatMap();
+	void renderMemoryMap();
+	void renderFrameTimeWindow();
+	void renderDisassemblyWindow();
+	void renderControlFlowWindow();
+	void renderWatchControls();
+	void renderTimeTravelControls();
+	bool pauseAtStop();
+	bool stepEmulation();
+	bool isMovieDrivingTimers() const noexcept;
+	void stopMovie();
+	bool loadROM(const std::string& filename, bool revalidate);
 	void centerWindow(GLFWwindow* window, GLFWmonitor* monitor);
 	void drawUnitQuad() const;
 
@@ -60,4 +113,43 @@ private:
 	float mLastTimerClockTime;
 	float mLastUpdateClockTime;
 	int mUpdatesPerSecond;
+	Chip8::RewindBuffer mRewindBuffer;
+	int mRewindBudgetMiB;
+	Chip8::InputMovie mMovie;
+	std::optional<Chip8::MoviePlayer> mMoviePlayer;
+	bool mRecording;
+	Chip8::RomStore mRomStore;
+	std::string mRomPath; ///< the path of the loaded ROM (for reloading)
+	Chip8::RomDatabase mRomDatabase;
+	Chip8::RomLibrary mRomLibrary;
+	bool mLibraryInitialized; ///< the index and the database are loaded when the library window is shown first
+	char mLibraryDirectory[256];
+	char mLibraryFilter[64];
+	std::string mSessionName;
+	std::unique_ptr<Chip8::SessionViewer> mSessionViewer; ///< only set in client mode
+	Chip8::SessionFrame mSessionFrame;
+	Chip8::Profiler mProfiler;
+	bool mProfiling; ///< whether mProfiler is attached to the emulator
+	int mProfilerSortColumn;
+	bool mProfilerSortDescending;
+	int mHotAddressCount; ///< the number of addresses listed below the heat map
+	Chip8::MemoryProfiler mMemoryProfiler;
+	bool mMemoryProfiling; ///< whether mMemoryProfiler is attached to the emulator
+	Chip8::ProbeStatistics mProbeStatistics;
+	std::string mFrameTimeProbe; ///< the probe whose percentiles are plotted
+	std::vector<Chip8::ProbeEvent> mTraceCapture;
+	int64_t mTraceCaptureEnd; ///< the probe time at which the running capture ends (0 if none is running)
+	Chip8::DisassemblyListing mDisassembly;
+	bool mFollowProgramCounter; ///< whether the disassembly scrolls to the program counter when it changes
+	uint16_t mLastListedProgramCounter; ///< the program counter the disassembly has been scrolled to
+	Chip8::Debugger mDebugger; ///< attached to mChip8, running is paused at its stops
+	char mBreakpointCondition[64]; ///< the condition of the breakpoints set by clicking the disassembly
+	char mWatchAddress[8];
+	int mWatchCount;
+	Chip8::ExecutionHistory mHistory; ///< restarted whenever the state is changed by other means than executing it
+	char mLastWriteAddress[8];
+	Chip8::ControlFlowAnalysis mControlFlow; ///< of the loaded ROM (taken from the cache if it has been analyzed before)
+	int mDisassemblyScrollTarget; ///< the address the disassembly scrolls to next (-1 if none)
+	Chip8::InputQueue mInputQueue; ///< key events stamped with mUpdateClock, applied before the instruction scheduled after them
+	std::optional<Chip8::LatencyProbe> mLatencyProbe; ///< only set while the latency is measured
 };
\ No newline at end of file
@@ -6,8 +6,9 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <bitset>
+#include <array>
 #include <functional>
+#include <string>
 
 /**
  * @brief Helper class for handling keyboard input.
@@ -41,11 +42,46 @@ public:
 	*/
 	static void setKeyUpCallback(KeyCallbackFunction function) noexcept;
 
+	/**
+	 * @brief Restores the default mapping of the keyboard to the CHIP-8 keypad (1234/QWER/ASDF/ZXCV).
+	*/
+	static void resetKeyMapping() noexcept;
+
+	/**
+	 * @brief Changes the mapping of the keyboard from a JSON file. The file contains an object that maps
+	 *        CHIP-8 keys to the name of a key or an array of names, e.g. `{ "5": ["W", "UP"], "8": "S" }`.
+	 *        The names are the GLFW key names without the `GLFW_KEY_` prefix. The CHIP-8 keys that are not
+	 *        listed keep their mapping.
+	 * @param filename The file.
+	 * @param error Receives a description of the error, if any.
+	 * @return True on success, false otherwise (the mapping is left unchanged).
+	*/
+	static bool loadKeyMapping(const std::string& filename, std::string& error);
+
+	/**
+	 * @brief Returns the CHIP-8 key a key of the keyboard is mapped to.
+	 * @param glfwKey The GLFW key code.
+	 * @return The key (0x0 to 0xF), or -1 if the key is not mapped.
+	*/
+	static int getMappedKey(int glfwKey) noexcept;
+
+	/**
+	 * @brief Presses or releases a CHIP-8 key like a mapped key of the keyboard does (used by the latency
+	 *        probe to take the same path as the user input). Presses are counted, so a key that is pressed
+	 *        by several sources (e.g. two keyboard keys mapped to it) is released by the last release.
+	 *        Releasing a key that is not pressed does nothing.
+	 * @param key The key (0x0 to 0xF).
+	 * @param pressed Whether the key is pressed or released.
+	*/
+	static void injectKey(uint8_t key, bool pressed);
+
 private:
 	static void glfwKeyCallbackFunction(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 private:
-	static std::bitset<0x10> mPressedKeys;
+	static std::array<uint8_t, 0x10> mPressCounts; ///< the number of presses that hold every CHIP-8 key
+	static std::array<int8_t, GLFW_KEY_LAST + 1> mHeldKeys; ///< the CHIP-8 key every held GLFW key presses (-1 if not held)
+	static std::array<int8_t, GLFW_KEY_LAST + 1> mKeyTable; ///< the CHIP-8 key of every GLFW key code (-1 if not mapped)
 	static KeyCallbackFunction mKeyDownCallback;
 	static KeyCallbackFunction mKeyUpCallback;
 
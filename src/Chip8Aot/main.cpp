@@ -0,0 +1,102 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <Chip8Core/AotCompiler.hpp>
+
+namespace {
+
+	void printUsage() {
+		std::cout << "Usage: Chip8Aot <rom> [options]\n"
+			"Translates a CHIP-8 ROM ahead of time to a C++ source file, which runs with Chip8::AotRuntime\n"
+			"(compile it together with Chip8Core).\n\n"
+			"Options:\n"
+			"  -o, --output <file> write the source to the file (default: standard output)\n"
+			"  --symbol <name>     name of the Chip8::AotRuntime::Program constant (default: the name of the\n"
+			"                      ROM file followed by Program)\n"
+			"  --entry <addr>      additional entry point (hex), e.g. a target of a computed BNNN jump that\n"
+			"                      would otherwise be interpreted; can be repeated\n";
+	}
+
+}
+
+int main(int argc, char** argv) {
+	const std::vector<std::string> arguments(argv + 1, argv + argc);
+	std::string romPath;
+	std::string outputPath;
+	std::string symbol;
+	std::vector<uint16_t> entryPoints;
+
+	try {
+		for (size_t i = 0; i < arguments.size(); ++i) {
+			const auto& argument = arguments[i];
+			const auto nextArgument = [&]() -> const std::string& {
+				if (i + 1 >= arguments.size())
+					throw std::invalid_argument("missing value for " + argument);
+				return arguments[++i];
+			};
+			if (argument == "--help" || argument == "-h") {
+				printUsage();
+				return 0;
+			} else if (argument == "--output" || argument == "-o") {
+				outputPath = nextArgument();
+			} else if (argument == "--symbol") {
+				symbol = nextArgument();
+				if (!Chip8::AotCompiler::isValidSymbol(symbol))
+					throw std::invalid_argument("invalid symbol " + symbol);
+			} else if (argument == "--entry") {
+				const auto address = std::stoul(nextArgument(), nullptr, 16);
+				if (address >= 0x1000)
+					throw std::invalid_argument("entry point out of range");
+				entryPoints.push_back(static_cast<uint16_t>(address));
+			} else if (!argument.empty() && argument.front() == '-') {
+				throw std::invalid_argument("unknown option " + argument);
+			} else if (romPath.empty()) {
+				romPath = argument;
+			} else {
+				throw std::invalid_argument("more than one ROM");
+			}
+		}
+		if (romPath.empty())
+			throw std::invalid_argument("missing ROM");
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what() << "\n\n";
+		printUsage();
+		return 2;
+	}
+
+	std::ifstream romFile(romPath, std::ios::binary);
+	if (!romFile.good()) {
+		std::cerr << "Could not open " << romPath << "\n";
+		return 1;
+	}
+	const std::vector<uint8_t> rom((std::istreambuf_iterator<char>(romFile)), std::istreambuf_iterator<char>());
+	if (rom.empty()) {
+		std::cerr << romPath << " is empty\n";
+		return 1;
+	}
+
+	const Chip8::AotCompiler compiler(rom.data(), rom.size(), entryPoints);
+	if (symbol.empty())
+		symbol = Chip8::AotCompiler::getDefaultSymbol(romPath);
+	const auto separator = romPath.find_last_of("/\\");
+	const std::string romName = (separator == std::string::npos ? romPath : romPath.substr(separator + 1));
+	if (outputPath.empty()) {
+		compiler.writeSource(std::cout, symbol, romName);
+	} else {
+		std::ofstream output(outputPath);
+		compiler.writeSource(output, symbol, romName);
+		if (!output.good()) {
+			std::cerr << "Could not write " << outputPath << "\n";
+			return 1;
+		}
+	}
+	size_t instructionCount = 0;
+	for (const auto& block : compiler.getBlocks())
+		instructionCount += block.instructionCount;
+	std::cerr << romName << ": " << compiler.getBlocks().size() << " blocks, " << instructionCount << " instructions\n";
+	return 0;
+}
@@ -0,0 +1,226 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#ifdef _MSC_VER
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+
+#include <Chip8Core/BatchRunner.hpp>
+#include <Chip8Core/RomLibrary.hpp>
+#include <Chip8Core/ThreadPool.hpp>
+
+namespace {
+
+	void printUsage() {
+		std::cout << "Usage: Chip8Batch [options] [rom...]\n"
+			"Runs CHIP-8 ROMs headless and in parallel and reports the results.\n\n"
+			"Options:\n"
+			"  --manifest <file>      read jobs from a manifest (lines of: rom[,profile[,cycles[,movie]]])\n"
+			"  --library <dir>        add every ROM in a directory (recursively), with the profile from the database\n"
+			"  --database <dir>       chip-8-database directory (programs.json, platforms.json) for --library\n"
+			"  --profile <name>       default quirk profile: chip8 or superchip (default: superchip)\n"
+			"  --cycles <n>           default cycle budget per job (default: 100000)\n"
+			"  --cycles-per-frame <n> cycles between two timer clocks (default: 8)\n"
+			"  --seed <n>             seed of the random number generator (default: 0)\n"
+			"  --time-limit <s>       watchdog limit per job in seconds (default: 10)\n"
+			"  --threads <n>          number of worker threads (default: all cores)\n"
+			"  --json <file>          write the results as JSON (\"-\" for standard output)\n"
+			"  --csv <file>           write the results as CSV (\"-\" for standard output)\n"
+			"  --opcode-stats <file>  profile the jobs and write the executions and times per opcode as JSON\n"
+			"  --heat-map <file>      profile the jobs and write the executions per address as CSV\n"
+			"  --memory-report <file> profile the jobs and write the memory regions and self-modifying code as JSON\n"
+			"  --trace-dir <dir>      write an instruction trace of every job into the directory (see Chip8Trace)\n";
+	}
+
+	bool writeResults(const std::string& filename, bool asJson, const std::vector<Chip8::BatchJob>& jobs,
+		const std::vector<Chip8::BatchResult>& results) {
+		if (filename == "-") {
+			if (asJson)
+				Chip8::writeBatchResultsJson(std::cout, jobs, results);
+			else
+				Chip8::writeBatchResultsCsv(std::cout, jobs, results);
+			return true;
+		}
+		std::ofstream file(filename);
+		if (!file.good()) {
+			std::cerr << "Could not open " << filename << " for writing\n";
+			return false;
+		}
+		if (asJson)
+			Chip8::writeBatchResultsJson(file, jobs, results);
+		else
+			Chip8::writeBatchResultsCsv(file, jobs, results);
+		return file.good();
+	}
+
+	using ProfileWriter = void (*)(std::ostream&, const std::vector<Chip8::BatchJob>&, const std::vector<Chip8::BatchResult>&);
+
+	bool writeProfiles(const std::string& filename, ProfileWriter write, const std::vector<Chip8::BatchJob>& jobs,
+		const std::vector<Chip8::BatchResult>& results) {
+		if (filename == "-") {
+			write(std::cout, jobs, results);
+			return true;
+		}
+		std::ofstream file(filename);
+		if (!file.good()) {
+			std::cerr << "Could not open " << filename << " for writing\n";
+			return false;
+		}
+		write(file, jobs, results);
+		return file.good();
+	}
+
+}
+
+int main(int argc, char** argv) {
+	const std::vector<std::string> arguments(argv + 1, argv + argc);
+	Chip8::BatchJob defaultJob;
+	std::string manifestPath;
+	std::vector<std::string> libraryDirectories;
+	std::string databasePath;
+	std::string jsonPath;
+	std::string csvPath;
+	std::string opcodeStatisticsPath;
+	std::string heatMapPath;
+	std::string memoryReportPath;
+	std::string traceDirectory;
+	size_t threadCount = 0;
+	std::vector<std::string> roms;
+
+	try {
+		for (size_t i = 0; i < arguments.size(); ++i) {
+			const auto& argument = arguments[i];
+			const auto nextArgument = [&]() -> const std::string& {
+				if (i + 1 >= arguments.size())
+					throw std::invalid_argument("missing value for " + argument);
+				return arguments[++i];
+			};
+			if (argument == "--help" || argument == "-h") {
+				printUsage();
+				return 0;
+			} else if (argument == "--manifest") {
+				manifestPath = nextArgument();
+			} else if (argument == "--library") {
+				libraryDirectories.push_back(nextArgument());
+			} else if (argument == "--database") {
+				databasePath = nextArgument();
+			} else if (argument == "--profile") {
+				const auto compatibilityMode = Chip8::parseCompatibilityMode(nextArgument());
+				if (!compatibilityMode)
+					throw std::invalid_argument("unknown profile " + arguments[i]);
+				defaultJob.compatibilityMode = compatibilityMode.value();
+			} else if (argument == "--cycles") {
+				defaultJob.cycleBudget = std::stoull(nextArgument());
+			} else if (argument == "--cycles-per-frame") {
+				defaultJob.cyclesPerFrame = std::stoull(nextArgument());
+			} else if (argument == "--seed") {
+				defaultJob.randomSeed = std::stoull(nextArgument());
+			} else if (argument == "--time-limit") {
+				defaultJob.timeLimit = std::stod(nextArgument());
+			} else if (argument == "--threads") {
+				threadCount = std::stoul(nextArgument());
+			} else if (argument == "--json") {
+				jsonPath = nextArgument();
+			} else if (argument == "--csv") {
+				csvPath = nextArgument();
+			} else if (argument == "--opcode-stats") {
+				opcodeStatisticsPath = nextArgument();
+				defaultJob.profile = true;
+			} else if (argument == "--heat-map") {
+				heatMapPath = nextArgument();
+				defaultJob.profile = true;
+			} else if (argument == "--memory-report") {
+				memoryReportPath = nextArgument();
+				defaultJob.profile = true;
+			} else if (argument == "--trace-dir") {
+				traceDirectory = nextArgument();
+			} else if (!argument.empty() && argument.front() == '-') {
+				throw std::invalid_argument("unknown option " + argument);
+			} else {
+				roms.push_back(argument);
+			}
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what() << "\n\n";
+		printUsage();
+		return 2;
+	}
+
+	std::vector<Chip8::BatchJob> jobs;
+	if (!manifestPath.empty()) {
+		std::ifstream manifest(manifestPath);
+		if (!manifest.good()) {
+			std::cerr << "Could not open manifest " << manifestPath << "\n";
+			return 2;
+		}
+		std::string error;
+		auto manifestJobs = Chip8::parseBatchManifest(manifest, defaultJob, error);
+		if (!manifestJobs) {
+			std::cerr << manifestPath << ": " << error << "\n";
+			return 2;
+		}
+		jobs = std::move(manifestJobs.value());
+	}
+	for (const auto& rom : roms) {
+		jobs.push_back(defaultJob);
+		jobs.back().romPath = rom;
+	}
+
+	Chip8::ThreadPool threadPool(threadCount);
+	if (!libraryDirectories.empty()) {
+		Chip8::RomDatabase database;
+		std::string error;
+		if (!databasePath.empty() && !database.load(databasePath, error)) {
+			std::cerr << "Could not load database: " << error << "\n";
+			return 2;
+		}
+		Chip8::RomLibrary library;
+		library.scan(libraryDirectories, database, threadPool);
+		for (const auto& entry : library.getEntries()) {
+			jobs.push_back(defaultJob);
+			jobs.back().romPath = entry.path;
+			if (entry.known)
+				jobs.back().compatibilityMode = entry.compatibilityMode;
+		}
+	}
+	if (jobs.empty()) {
+		printUsage();
+		return 2;
+	}
+	if (jsonPath.empty() && csvPath.empty())
+		jsonPath = "-";
+	if (!traceDirectory.empty()) {
+		// the index keeps the names of jobs that run the same ROM apart
+		std::error_code error;
+		fs::create_directories(traceDirectory, error);
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			const auto name = fs::path(jobs[i].romPath.empty() ? jobs[i].moviePath : jobs[i].romPath).stem().string();
+			jobs[i].tracePath = (fs::path(traceDirectory) / (std::to_string(i) + "_" + name + ".c8trace")).string();
+		}
+	}
+
+	const auto startTime = std::chrono::steady_clock::now();
+	const auto results = Chip8::runBatchJobs(jobs, threadPool);
+	const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+
+	bool success = true;
+	if (!jsonPath.empty())
+		success = writeResults(jsonPath, true, jobs, results) && success;
+	if (!csvPath.empty())
+		success = writeResults(csvPath, false, jobs, results) && success;
+	if (!opcodeStatisticsPath.empty())
+		success = writeProfiles(opcodeStatisticsPath, Chip8::writeBatchProfilesJson, jobs, results) && success;
+	if (!heatMapPath.empty())
+		success = writeProfiles(heatMapPath, Chip8::writeBatchHeatMapsCsv, jobs, results) && success;
+	if (!memoryReportPath.empty())
+		success = writeProfiles(memoryReportPath, Chip8::writeBatchMemoryReportsJson, jobs, results) && success;
+	std::cerr << jobs.size() << " jobs finished in " << duration.count() << " s on "
+		<< threadPool.getThreadCount() << " threads\n";
+	return (success ? 0 : 1);
+}
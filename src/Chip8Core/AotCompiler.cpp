@@ -0,0 +1,504 @@
+#include "Chip8Core/AotCompiler.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <tuple>
+#include <gsl/gsl>
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/ControlFlowAnalysis.hpp"
+#include "Chip8Core/Disassembler.hpp"
+#include "Chip8Core/Opcodes.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr uint16_t InterpretedOpcode = 0xFFFF; // zero words and unknown opcodes
+
+        // how a translated instruction affects the block
+        enum class Flow {
+            Continue,
+            EndAfter,/**< branches, or writes to the memory (so that the dispatcher checks for overwritten code) */
+            Interpret,/**< left to the interpreter, the block ends before it */
+        };
+
+        uint16_t decodeOpcode(Instruction instruction) noexcept {
+            const size_t index = getOpcodeIndex(instruction.getValue());
+            return (index == Opcodes.size() || instruction.getValue() == 0x0000 ? InterpretedOpcode : std::get<1>(Opcodes[index]));
+        }
+
+        Flow getFlow(uint16_t opcode) noexcept {
+            switch (opcode) {
+                case InterpretedOpcode:
+                case 0xF00A:
+                    return Flow::Interpret;
+                case 0x00EE:
+                case 0x1000:
+                case 0x2000:
+                case 0x3000:
+                case 0x4000:
+                case 0x5000:
+                case 0x9000:
+                case 0xB000:
+                case 0xE09E:
+                case 0xE0A1:
+                case 0xF033:
+                case 0xF055:
+                    return Flow::EndAfter;
+                default:
+                    return Flow::Continue;
+            }
+        }
+
+        // whether the interpreter continues with the next instruction once it has executed the last one of the block
+        bool resumesAfter(uint16_t opcode) noexcept {
+            return opcode == 0xF00A || opcode == 0xF033 || opcode == 0xF055;
+        }
+
+        struct RegisterUse {
+            uint16_t registers = 0; ///< one bit per register the instruction reads or writes
+            uint16_t writtenRegisters = 0;
+            bool addressRegister = false;
+            bool writesAddressRegister = false;
+        };
+
+        RegisterUse getRegisterUse(uint16_t opcode, Instruction instruction) noexcept {
+            const auto x = static_cast<uint16_t>(1u << instruction.getX());
+            const auto y = static_cast<uint16_t>(1u << instruction.getY());
+            const auto upToX = static_cast<uint16_t>((2u << instruction.getX()) - 1u);
+            constexpr uint16_t f = 1u << 0xF;
+            switch (opcode) {
+                case 0x3000:
+                case 0x4000:
+                case 0xE09E:
+                case 0xE0A1:
+                case 0xF015:
+                case 0xF018:
+                    return { x, 0, false, false };
+                case 0x5000:
+                case 0x9000:
+                    return { static_cast<uint16_t>(x | y), 0, false, false };
+                case 0x6000:
+                case 0x7000:
+                case 0xC000:
+                case 0xF007:
+                    return { x, x, false, false };
+                case 0x8000:
+                case 0x8001:
+                case 0x8002:
+                case 0x8003:
+                    return { static_cast<uint16_t>(x | y), x, false, false };
+                case 0x8004:
+                case 0x8005:
+                case 0x8006:
+                case 0x8007:
+                case 0x800E:
+                    return { static_cast<uint16_t>(x | y | f), static_cast<uint16_t>(x | f), false, false };
+                case 0xA000:
+                    return { 0, 0, true, true };
+                case 0xB000:
+                    return { 0x1, 0, false, false };
+                case 0xD000:
+                    return { static_cast<uint16_t>(x | y | f), f, true, false };
+                case 0xF01E:
+                case 0xF029:
+                    return { x, 0, true, true };
+                case 0xF033:
+                    return { x, 0, true, false };
+                case 0xF055:
+                    return { upToX, 0, true, true };
+                case 0xF065:
+                    return { upToX, upToX, true, true };
+                default:
+                    return {};
+            }
+        }
+
+        std::string formatHex(unsigned value, int digits) {
+            std::ostringstream stream;
+            stream << "0x" << std::hex << std::uppercase << std::setw(digits) << std::setfill('0') << value;
+            return stream.str();
+        }
+
+        std::string formatRegister(unsigned index) {
+            std::ostringstream stream;
+            stream << 'v' << std::hex << std::uppercase << index;
+            return stream.str();
+        }
+
+        std::string getFunctionName(uint16_t address) {
+            std::ostringstream stream;
+            stream << "block" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << address;
+            return stream.str();
+        }
+
+        std::string escapeString(const std::string& text) {
+            std::string result;
+            for (const char c : text) {
+                if (c == '"' || c == '\\')
+                    result.push_back('\\');
+                if (c != '\n' && c != '\r')
+                    result.push_back(c);
+            }
+            return result;
+        }
+
+        // writes the statements of a single instruction; index is the number of instructions before it in the block
+        void translateInstruction(std::ostream& output, uint16_t opcode, Instruction instruction, uint16_t address, size_t index) {
+            const std::string x = formatRegister(instruction.getX());
+            const std::string y = formatRegister(instruction.getY());
+            const std::string nn = formatHex(instruction.getNN(), 2);
+            const std::string nnn = formatHex(instruction.getNNN(), 4);
+            const std::string here = formatHex(address, 4);
+            const std::string next = formatHex(address + 2u, 4);
+            const std::string skipped = formatHex(address + 4u, 4);
+            const std::string executed = std::to_string(index + 1);
+            // the interpreter executes the instruction, so that stack errors and memory accesses out of bounds behave the same
+            const std::string bail = "return leave(" + here + ", " + std::to_string(index) + ", false);";
+            const auto skipIf = [&](const std::string& condition) {
+                output << "\t\treturn leave(" << condition << " ? " << skipped << " : " << next << ", " << executed << ", true);\n";
+            };
+            switch (opcode) {
+                case 0x0000:
+                    output << "\t\t// calls of machine code routines are not implemented\n";
+                    break;
+                case 0x00E0:
+                    output << "\t\tmachine.display->fill(0x0);\n";
+                    break;
+                case 0x00EE:
+                    output << "\t\tif (machine.stackSize == 0)\n\t\t\t" << bail << "\n";
+                    output << "\t\treturn leave(machine.stack[--machine.stackSize], " << executed << ", true);\n";
+                    break;
+                case 0x1000:
+                    output << "\t\treturn leave(" << nnn << ", " << executed << ", true);\n";
+                    break;
+                case 0x2000:
+                    output << "\t\tif (machine.stackSize >= Chip8::Chip8::StackSize)\n\t\t\t" << bail << "\n";
+                    output << "\t\tmachine.stack[machine.stackSize++] = " << next << ";\n";
+                    output << "\t\treturn leave(" << nnn << ", " << executed << ", true);\n";
+                    break;
+                case 0x3000:
+                    skipIf("(" + x + " == " + nn + ")");
+                    break;
+                case 0x4000:
+                    skipIf("(" + x + " != " + nn + ")");
+                    break;
+                case 0x5000:
+                    skipIf("(" + x + " == " + y + ")");
+                    break;
+                case 0x6000:
+                    output << "\t\t" << x << " = " << nn << ";\n";
+                    break;
+                case 0x7000:
+                    output << "\t\t" << x << " = static_cast<uint8_t>(" << x << " + " << nn << ");\n";
+                    break;
+                case 0x8000:
+                    output << "\t\t" << x << " = " << y << ";\n";
+                    break;
+                case 0x8001:
+                    output << "\t\t" << x << " = static_cast<uint8_t>(" << x << " | " << y << ");\n";
+                    break;
+                case 0x8002:
+                    output << "\t\t" << x << " = static_cast<uint8_t>(" << x << " & " << y << ");\n";
+                    break;
+                case 0x8003:
+                    output << "\t\t" << x << " = static_cast<uint8_t>(" << x << " ^ " << y << ");\n";
+                    break;
+                // VF is written before VX, like the interpreter does (this matters if X or Y is F)
+                case 0x8004:
+                    output << "\t\tvF = (" << x << " + " << y << " > 0xFF ? 0x1 : 0x0);\n";
+                    output << "\t\t" << x << " = static_cast<uint8_t>(" << x << " + " << y << ");\n";
+                    break;
+                case 0x8005:
+                    output << "\t\tvF = (" << x << " > " << y << " ? 0x1 : 0x0);\n";
+                    output << "\t\t" << x << " = static_cast<uint8_t>(" << x << " - " << y << ");\n";
+                    break;
+                case 0x8006:
+                    output << "\t\tif (machine.superChip) {\n";
+                    output << "\t\t\tvF = static_cast<uint8_t>(" << x << " & 0x1);\n";
+                    output << "\t\t\t" << x << " = static_cast<uint8_t>(" << x << " >> 1);\n";
+                    output << "\t\t} else {\n";
+                    output << "\t\t\tvF = static_cast<uint8_t>(" << y << " & 0x1);\n";
+                    output << "\t\t\t" << x << " = static_cast<uint8_t>(" << y << " >> 1);\n";
+                    output << "\t\t}\n";
+                    break;
+                case 0x8007:
+                    output << "\t\tvF = (" << y << " > " << x << " ? 0x1 : 0x0);\n";
+                    output << "\t\t" << x << " = static_cast<uint8_t>(" << y << " - " << x << ");\n";
+                    break;
+                case 0x800E:
+                    output << "\t\tif (machine.superChip) {\n";
+                    output << "\t\t\tvF = ((" << x << " & 0x80) != 0x0 ? 0x1 : 0x0);\n";
+                    output << "\t\t\t" << x << " = static_cast<uint8_t>(" << x << " << 1);\n";
+                    output << "\t\t} else {\n";
+                    output << "\t\t\tvF = ((" << y << " & 0x80) != 0x0 ? 0x1 : 0x0);\n";
+                    output << "\t\t\t" << x << " = static_cast<uint8_t>(" << y << " << 1);\n";
+                    output << "\t\t}\n";
+                    break;
+                case 0x9000:
+                    skipIf("(" + x + " != " + y + ")");
+                    break;
+                case 0xA000:
+                    output << "\t\ti = " << nnn << ";\n";
+                    break;
+                case 0xB000:
+                    // the dispatcher of the runtime looks up the target (or leaves it to the interpreter)
+                    output << "\t\treturn leave(static_cast<uint16_t>(v0 + " << nnn << "), " << executed << ", true);\n";
+                    break;
+                case 0xC000:
+                    output << "\t\t" << x << " = static_cast<uint8_t>(machine.random->nextByte() & " << nn << ");\n";
+                    break;
+                case 0xD000:
+                    output << "\t\tif (i + " << static_cast<unsigned>(instruction.getN()) << "u > Chip8::Chip8::MemorySize)\n\t\t\t" << bail << "\n";
+                    output << "\t\tvF = Chip8::AotRuntime::drawSprite(machine, i, " << x << ", " << y << ", "
+                        << static_cast<unsigned>(instruction.getN()) << ");\n";
+                    break;
+                case 0xE09E:
+                    skipIf("(" + x + " < 0x10 && ((machine.pressedKeys >> " + x + ") & 0x1) != 0x0)");
+                    break;
+                case 0xE0A1:
+                    skipIf("!(" + x + " < 0x10 && ((machine.pressedKeys >> " + x + ") & 0x1) != 0x0)");
+                    break;
+                case 0xF007:
+                    output << "\t\t" << x << " = machine.delayTimer;\n";
+                    break;
+                case 0xF015:
+                    output << "\t\tmachine.delayTimer = " << x << ";\n";
+                    break;
+                case 0xF018:
+                    output << "\t\tmachine.soundTimer = " << x << ";\n";
+                    break;
+                case 0xF01E:
+                    output << "\t\ti = static_cast<uint16_t>(i + " << x << ");\n";
+                    break;
+                case 0xF029:
+                    output << "\t\ti = static_cast<uint16_t>(5u * " << x << ");\n";
+                    break;
+                case 0xF033:
+                    output << "\t\tif (i + 2u >= Chip8::Chip8::MemorySize)\n\t\t\t" << bail << "\n";
+                    output << "\t\tChip8::AotRuntime::store(machine, i, static_cast<uint8_t>(" << x << " / 100));\n";
+                    output << "\t\tChip8::AotRuntime::store(machine, static_cast<uint16_t>(i + 1u), static_cast<uint8_t>((" << x << " % 100) / 10));\n";
+                    output << "\t\tChip8::AotRuntime::store(machine, static_cast<uint16_t>(i + 2u), static_cast<uint8_t>(" << x << " % 10));\n";
+                    output << "\t\treturn leave(" << next << ", " << executed << ", true);\n";
+                    break;
+                case 0xF055:
+                case 0xF065: {
+                    // the original CHIP-8 leaves I incremented, the SUPER-CHIP does not
+                    const unsigned count = instruction.getX() + 1u;
+                    output << "\t\tif (i + " << (count - 1) << "u >= Chip8::Chip8::MemorySize)\n\t\t\t" << bail << "\n";
+                    for (unsigned offset = 0; offset < count; ++offset) {
+                        const std::string target = (offset == 0 ? std::string("i") : "static_cast<uint16_t>(i + " + std::to_string(offset) + "u)");
+                        if (opcode == 0xF055)
+                            output << "\t\tChip8::AotRuntime::store(machine, " << target << ", " << formatRegister(offset) << ");\n";
+                        else
+                            output << "\t\t" << formatRegister(offset) << " = Chip8::AotRuntime::load(machine, " << target << ");\n";
+                    }
+                    output << "\t\tif (!machine.superChip)\n\t\t\ti = static_cast<uint16_t>(i + " << count << "u);\n";
+                    if (opcode == 0xF055)
+                        output << "\t\treturn leave(" << next << ", " << executed << ", true);\n";
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+    }
+
+    AotCompiler::AotCompiler(const uint8_t* data, size_t size, const std::vector<uint16_t>& entryPoints)
+        : mImage(data, data + std::min(size, Chip8::MemorySize - Chip8::ProgramOffset))
+    {
+        Chip8 chip8;
+        chip8.loadROM(mImage.data(), mImage.size());
+        const auto& memory = chip8.getMemory();
+        const size_t imageEnd = Chip8::ProgramOffset + mImage.size();
+        const auto readInstruction = [&memory](size_t address) {
+            return Instruction(memory.read(gsl::narrow_cast<uint16_t>(address)), memory.read(gsl::narrow_cast<uint16_t>(address + 1)));
+        };
+
+        // the blocks of the analyses are the leaders, plus the instructions the interpreter resumes compiled code at
+        std::bitset<Chip8::MemorySize> leaders;
+        std::vector<uint16_t> entries = { Chip8::ProgramOffset };
+        entries.insert(entries.end(), entryPoints.begin(), entryPoints.end());
+        for (size_t index = 0; index < entries.size(); ++index) {
+            const uint16_t entry = entries[index];
+            if (entry >= Chip8::MemorySize || leaders[entry])
+                continue;
+            leaders.set(entry);
+            const auto analysis = ControlFlowAnalysis::analyze(memory, entry);
+            for (const auto& block : analysis.getBlocks()) {
+                leaders.set(block.start);
+                if (block.terminator != ControlFlowAnalysis::Terminator::IndirectJump)
+                    continue;
+                // a BNNN whose V0 is set by a 60NN earlier in the block jumps to a known target
+                const auto jump = readInstruction(block.end - 2u);
+                for (size_t address = block.end - 2u; address > block.start; address -= 2) {
+                    const auto instruction = readInstruction(address - 2u);
+                    const uint16_t opcode = decodeOpcode(instruction);
+                    if ((getRegisterUse(opcode, instruction).writtenRegisters & 0x1) == 0)
+                        continue;
+                    if (opcode == 0x6000 && instruction.getX() == 0x0)
+                        entries.push_back(gsl::narrow_cast<uint16_t>(jump.getNNN() + instruction.getNN()));
+                    break;
+                }
+            }
+        }
+        std::vector<size_t> worklist;
+        for (size_t address = 0; address < Chip8::MemorySize; ++address) {
+            if (leaders[address])
+                worklist.push_back(address);
+        }
+        while (!worklist.empty()) {
+            size_t address = worklist.back();
+            worklist.pop_back();
+            for (; address + 1 < imageEnd && address >= Chip8::ProgramOffset; address += 2) {
+                const uint16_t opcode = decodeOpcode(readInstruction(address));
+                if (getFlow(opcode) == Flow::Continue)
+                    continue;
+                if (resumesAfter(opcode) && address + 2 < Chip8::MemorySize && !leaders[address + 2]) {
+                    leaders.set(address + 2);
+                    worklist.push_back(address + 2);
+                }
+                break;
+            }
+        }
+
+        for (size_t start = Chip8::ProgramOffset; start < imageEnd; ++start) {
+            if (!leaders[start])
+                continue;
+            Block block{ gsl::narrow_cast<uint16_t>(start), gsl::narrow_cast<uint16_t>(start), 0 };
+            for (size_t address = start; address + 1 < imageEnd; address += 2) {
+                if (address != start && leaders[address])
+                    break;
+                const auto flow = getFlow(decodeOpcode(readInstruction(address)));
+                if (flow == Flow::Interpret)
+                    break;
+                block.end = gsl::narrow_cast<uint16_t>(address + 2);
+                ++block.instructionCount;
+                if (flow == Flow::EndAfter)
+                    break;
+            }
+            if (block.instructionCount > 0)
+                mBlocks.push_back(block);
+        }
+    }
+
+    const std::vector<AotCompiler::Block>& AotCompiler::getBlocks() const noexcept {
+        return mBlocks;
+    }
+
+    void AotCompiler::writeSource(std::ostream& output, const std::string& symbol, const std::string& romName) const {
+        const auto readInstruction = [this](size_t address) {
+            const size_t offset = address - Chip8::ProgramOffset;
+            return Instruction(mImage[offset], mImage[offset + 1]);
+        };
+
+        output << "// Translation of " << romName << " (" << mImage.size() << " bytes, " << mBlocks.size() << " blocks)\n"
+            "// Generated by Chip8Aot, do not edit. Run it with Chip8::AotRuntime.\n"
+            "#include <cstddef>\n"
+            "#include <cstdint>\n\n"
+            "#include <Chip8Core/AotRuntime.hpp>\n\n"
+            "extern const Chip8::AotRuntime::Program " << symbol << ";\n\n"
+            "namespace {\n\n";
+
+        for (const auto& block : mBlocks) {
+            RegisterUse use;
+            for (size_t address = block.start; address < block.end; address += 2) {
+                const auto instruction = readInstruction(address);
+                const auto instructionUse = getRegisterUse(decodeOpcode(instruction), instruction);
+                use.registers |= instructionUse.registers;
+                use.writtenRegisters |= instructionUse.writtenRegisters;
+                use.addressRegister |= instructionUse.addressRegister;
+                use.writesAddressRegister |= instructionUse.writesAddressRegister;
+            }
+
+            output << "\tbool " << getFunctionName(block.start) << "(Chip8::AotRuntime::Machine& machine) {\n";
+            for (unsigned index = 0; index < 0x10; ++index) {
+                if (use.registers & (1u << index))
+                    output << "\t\t" << ((use.writtenRegisters & (1u << index)) ? "" : "const ") << "uint8_t "
+                        << formatRegister(index) << " = machine.v[" << formatHex(index, 1) << "];\n";
+            }
+            if (use.addressRegister)
+                output << "\t\t" << (use.writesAddressRegister ? "" : "const ") << "uint16_t i = machine.i;\n";
+            output << "\t\tconst auto leave = [&](uint16_t pc, uint64_t instructionCount, bool continues) {\n";
+            for (unsigned index = 0; index < 0x10; ++index) {
+                if (use.writtenRegisters & (1u << index))
+                    output << "\t\t\tmachine.v[" << formatHex(index, 1) << "] = " << formatRegister(index) << ";\n";
+            }
+            if (use.writesAddressRegister)
+                output << "\t\t\tmachine.i = i;\n";
+            output << "\t\t\tmachine.pc = pc;\n"
+                "\t\t\tmachine.cycleCount += instructionCount;\n"
+                "\t\t\treturn continues;\n"
+                "\t\t};\n";
+
+            bool ended = false;
+            for (size_t address = block.start; address < block.end; address += 2) {
+                const auto instruction = readInstruction(address);
+                const uint16_t opcode = decodeOpcode(instruction);
+                output << "\t\t// " << formatHex(static_cast<unsigned>(address), 4) << ": " << disassemble(instruction) << "\n";
+                translateInstruction(output, opcode, instruction, gsl::narrow_cast<uint16_t>(address), (address - block.start) / 2);
+                ended = (getFlow(opcode) == Flow::EndAfter);
+            }
+            if (!ended) {
+                // the next instruction starts another block, or is left to the interpreter
+                const auto next = gsl::narrow_cast<uint16_t>(block.end);
+                const bool interpreted = (next + 1u < Chip8::ProgramOffset + mImage.size()
+                    && getFlow(decodeOpcode(readInstruction(next))) == Flow::Interpret);
+                output << "\t\treturn leave(" << formatHex(next, 4) << ", " << block.instructionCount << ", "
+                    << (interpreted ? "false" : "true") << ");\n";
+            }
+            output << "\t}\n\n";
+        }
+
+        output << "\tconst uint8_t Image[] = {";
+        for (size_t i = 0; i < mImage.size(); ++i)
+            output << (i % 16 == 0 ? "\n\t\t" : " ") << formatHex(mImage[i], 2) << ",";
+        output << "\n\t};\n\n";
+
+        if (!mBlocks.empty()) {
+            output << "\tconst Chip8::AotRuntime::Block Blocks[] = {\n";
+            for (const auto& block : mBlocks)
+                output << "\t\t{ " << formatHex(block.start, 4) << ", " << formatHex(block.end, 4) << ", "
+                    << block.instructionCount << ", " << getFunctionName(block.start) << " },\n";
+            output << "\t};\n\n";
+        }
+        output << "}\n\n"
+            "const Chip8::AotRuntime::Program " << symbol << " = {\n"
+            "\t\"" << escapeString(romName) << "\", Image, " << mImage.size() << ", "
+            << (mBlocks.empty() ? "nullptr" : "Blocks") << ", " << mBlocks.size() << "\n"
+            "};\n\n"
+            "namespace {\n\n"
+            "\t[[maybe_unused]] const bool registered = Chip8::AotRuntime::registerProgram(" << symbol << ");\n\n"
+            "}\n";
+    }
+
+    std::string AotCompiler::getDefaultSymbol(const std::string& filename) {
+        const auto separator = filename.find_last_of("/\\");
+        std::string name = (separator == std::string::npos ? filename : filename.substr(separator + 1));
+        const auto extension = name.find_last_of('.');
+        if (extension != std::string::npos && extension > 0)
+            name.erase(extension);
+        for (auto& c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)))
+                c = '_';
+        }
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name.front())))
+            name.insert(0, "rom");
+        return name + "Program";
+    }
+
+    bool AotCompiler::isValidSymbol(const std::string& symbol) noexcept {
+        if (symbol.empty() || std::isdigit(static_cast<unsigned char>(symbol.front())))
+            return false;
+        return std::all_of(symbol.begin(), symbol.end(), [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        });
+    }
+
+}
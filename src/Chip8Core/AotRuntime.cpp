@@ -0,0 +1,236 @@
+#include "Chip8Core/AotRuntime.hpp"
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+
+#include <gsl/gsl>
+
+#include "Chip8Core/Opcodes.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        std::vector<const AotRuntime::Program*>& getRegistry() {
+            static std::vector<const AotRuntime::Program*> registry;
+            return registry;
+        }
+
+        bool matchesImage(const Chip8Memory<uint8_t>& memory, const AotRuntime::Program& program) {
+            if (program.imageSize > Chip8::MemorySize - Chip8::ProgramOffset)
+                return false;
+            std::vector<uint8_t> buffer(program.imageSize);
+            memory.readBlock(Chip8::ProgramOffset, buffer.data(), buffer.size());
+            return std::equal(buffer.begin(), buffer.end(), program.image);
+        }
+
+    }
+
+    AotRuntime::AotRuntime(const Program& program)
+        : mProgram(program), mDispatchTable(Chip8::MemorySize, nullptr), mHasModifiedCode(false), mMachine{}
+    {
+        const size_t imageEnd = Chip8::ProgramOffset + std::min(program.imageSize, Chip8::MemorySize - Chip8::ProgramOffset);
+        for (size_t i = 0; i < program.blockCount; ++i) {
+            const auto& block = program.blocks[i];
+            // the translation has to match the image, so blocks outside of it are never dispatched to
+            if (block.start < Chip8::ProgramOffset || block.end > imageEnd || block.start >= block.end)
+                continue;
+            mDispatchTable[block.start] = &block;
+            for (size_t address = block.start; address < block.end; ++address)
+                mCode.set(address);
+        }
+        for (size_t address = 0; address < Chip8::MemorySize; ++address) {
+            if (!mCode[address])
+                continue;
+            if (!mCodeRanges.empty() && mCodeRanges.back().second == address)
+                mCodeRanges.back().second = gsl::narrow_cast<uint16_t>(address + 1);
+            else
+                mCodeRanges.emplace_back(gsl::narrow_cast<uint16_t>(address), gsl::narrow_cast<uint16_t>(address + 1));
+        }
+    }
+
+    void AotRuntime::loadROM(Chip8& chip8) const {
+        chip8.loadROM(mProgram.image, mProgram.imageSize);
+    }
+
+    bool AotRuntime::run(Chip8& chip8, uint64_t cycles) {
+#ifdef CHIP8_ENABLE_PROFILING
+        if (chip8.mInstrumented) {
+            // the hooks have to see every instruction
+            for (; cycles > 0; --cycles) {
+                ++mStatistics.interpretedCycles;
+                if (!chip8.step())
+                    return false;
+            }
+            return true;
+        }
+#endif
+        loadMachine(chip8);
+        verifyCode();
+
+        while (cycles > 0) {
+            if (chip8.mAwaitingKeyPress) {
+                // the keys do not change during run(), so every remaining step() would only count the cycle
+                mMachine.cycleCount += cycles;
+                mStatistics.interpretedCycles += cycles;
+                break;
+            }
+            const Block* block = (mMachine.pc < Chip8::MemorySize ? mDispatchTable[mMachine.pc] : nullptr);
+            if (block && block->instructionCount <= cycles && !isModified(*block)) {
+                const uint64_t cycleCount = mMachine.cycleCount;
+                const bool continues = block->function(mMachine);
+                const uint64_t executed = mMachine.cycleCount - cycleCount;
+                cycles -= executed;
+                mStatistics.compiledCycles += executed;
+                ++mStatistics.blockCalls;
+                if (continues || cycles == 0)
+                    continue;
+            }
+            storeMachine(chip8);
+            --cycles;
+            ++mStatistics.interpretedCycles;
+            if (!interpret(chip8))
+                return false;
+            loadMachine(chip8);
+        }
+        storeMachine(chip8);
+        return true;
+    }
+
+    const AotRuntime::Statistics& AotRuntime::getStatistics() const noexcept {
+        return mStatistics;
+    }
+
+    const AotRuntime::Program& AotRuntime::getProgram() const noexcept {
+        return mProgram;
+    }
+
+    bool AotRuntime::registerProgram(const Program& program) {
+        getRegistry().push_back(&program);
+        return true;
+    }
+
+    const AotRuntime::Program* AotRuntime::findProgram(const Chip8& chip8) {
+        // if one ROM starts with another one, the longer one is the better match
+        const Program* result = nullptr;
+        for (const auto program : getRegistry()) {
+            if ((!result || program->imageSize > result->imageSize) && matchesImage(chip8.mMemory, *program))
+                result = program;
+        }
+        return result;
+    }
+
+    const std::vector<const AotRuntime::Program*>& AotRuntime::getPrograms() {
+        return getRegistry();
+    }
+
+    uint8_t AotRuntime::drawSprite(Machine& machine, uint16_t address, uint8_t x, uint8_t y, uint8_t height) {
+        // the same as OpcodeHandler::drawSprite(), but a whole row of the sprite at once: it covers one
+        // byte of the display or two neighboring ones, and the pixels beyond the edges are clipped
+        constexpr size_t rowSize = Chip8::DisplayWidth / 8u;
+        bool collision = false;
+        for (uint8_t row = 0x0; row < height; ++row) {
+            const uint8_t sprite = machine.memory->read(gsl::narrow_cast<uint16_t>(address + row));
+            const size_t displayRow = static_cast<size_t>(y) + row;
+            if (displayRow >= Chip8::DisplayHeight || x >= Chip8::DisplayWidth)
+                continue;
+            uint8_t* line = machine.display->data() + displayRow * rowSize;
+            const size_t column = x / 8u;
+            const unsigned shift = x % 8u;
+            const auto left = gsl::narrow_cast<uint8_t>(sprite >> shift);
+            collision |= ((line[column] & left) != 0x0);
+            line[column] ^= left;
+            if (shift != 0 && column + 1 < rowSize) {
+                const auto right = gsl::narrow_cast<uint8_t>(sprite << (8u - shift));
+                collision |= ((line[column + 1] & right) != 0x0);
+                line[column + 1] ^= right;
+            }
+        }
+        return (collision ? 0x1 : 0x0);
+    }
+
+    void AotRuntime::store(Machine& machine, uint16_t address, uint8_t value) {
+        machine.memory->write(address, value);
+        if (machine.runtime->mCode[address])
+            machine.runtime->updateModifiedCode(address, 1);
+    }
+
+    void AotRuntime::loadMachine(Chip8& chip8) noexcept {
+        mMachine.v = chip8.mV;
+        mMachine.i = chip8.mI;
+        mMachine.pc = chip8.mPC;
+        mMachine.stack = chip8.mStack;
+        mMachine.stackSize = chip8.mStackSize;
+        mMachine.delayTimer = chip8.mDelayTimer;
+        mMachine.soundTimer = chip8.mSoundTimer;
+        mMachine.pressedKeys = gsl::narrow_cast<uint16_t>(chip8.mPressedKeys.to_ulong());
+        mMachine.superChip = (chip8.mCompatibilityMode == CompatibilityMode::SuperChip);
+        mMachine.cycleCount = chip8.mCycleCount;
+        mMachine.memory = &chip8.mMemory;
+        mMachine.display = &chip8.mDisplayMemory;
+        mMachine.random = &chip8.mRandom;
+        mMachine.runtime = this;
+    }
+
+    void AotRuntime::storeMachine(Chip8& chip8) const noexcept {
+        chip8.mV = mMachine.v;
+        chip8.mI = mMachine.i;
+        chip8.mPC = mMachine.pc;
+        chip8.mStack = mMachine.stack;
+        chip8.mStackSize = mMachine.stackSize;
+        chip8.mDelayTimer = mMachine.delayTimer;
+        chip8.mSoundTimer = mMachine.soundTimer;
+        chip8.mCycleCount = mMachine.cycleCount;
+    }
+
+    bool AotRuntime::interpret(Chip8& chip8) {
+        const uint16_t address = chip8.mI;
+        const Instruction instruction = (chip8.mPC + 1u < Chip8::MemorySize ? chip8.getNextInstruction() : Instruction(0x0000));
+        const bool result = chip8.step();
+        // the interpreter writes to the memory directly, so the overwritten code has to be looked up afterwards
+        const size_t index = getOpcodeIndex(instruction.getValue());
+        const uint16_t opcode = (index < Opcodes.size() ? std::get<1>(Opcodes[index]) : 0x0000);
+        if (opcode == 0xF033)
+            updateModifiedCode(address, 3);
+        else if (opcode == 0xF055)
+            updateModifiedCode(address, instruction.getX() + 1u);
+        return result;
+    }
+
+    void AotRuntime::verifyCode() {
+        // the memory may have been changed since the last call (by the interpreter, by loading a state, ...),
+        // but usually the code is still the one of the ROM
+        std::array<uint8_t, Chip8::MemorySize> buffer;
+        for (const auto& [start, end] : mCodeRanges) {
+            mMachine.memory->readBlock(start, buffer.data(), static_cast<size_t>(end - start));
+            if (!std::equal(buffer.begin(), buffer.begin() + (end - start), mProgram.image + (start - Chip8::ProgramOffset))) {
+                for (const auto& [rangeStart, rangeEnd] : mCodeRanges)
+                    updateModifiedCode(rangeStart, static_cast<size_t>(rangeEnd - rangeStart));
+                return;
+            }
+        }
+        mModified.reset();
+        mHasModifiedCode = false;
+    }
+
+    void AotRuntime::updateModifiedCode(uint16_t address, size_t count) {
+        count = std::min(count, Chip8::MemorySize - std::min<size_t>(address, Chip8::MemorySize));
+        for (size_t i = address; i < address + count; ++i) {
+            if (mCode[i])
+                mModified[i] = (mMachine.memory->read(gsl::narrow_cast<uint16_t>(i)) != mProgram.image[i - Chip8::ProgramOffset]);
+        }
+        mHasModifiedCode = mModified.any();
+    }
+
+    bool AotRuntime::isModified(const Block& block) const noexcept {
+        if (!mHasModifiedCode)
+            return false;
+        for (size_t address = block.start; address < block.end; ++address) {
+            if (mModified[address])
+                return true;
+        }
+        return false;
+    }
+
+}
@@ -0,0 +1,344 @@
+#include "Chip8Core/BatchRunner.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <gsl/gsl>
+
+#include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/Hash.hpp"
+#include "Chip8Core/InputMovie.hpp"
+#include "Chip8Core/InstructionTrace.hpp"
+#include "Chip8Core/MemoryProfiler.hpp"
+#include "Chip8Core/Profiler.hpp"
+#include "Chip8Core/RomStore.hpp"
+#include "Chip8Core/ThreadPool.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        // the watchdog only looks at the clock every this many cycles
+        constexpr uint64_t WatchdogInterval = 0x1000;
+
+        std::string trim(const std::string& text) {
+            const auto begin = std::find_if_not(text.begin(), text.end(), [](unsigned char c) { return std::isspace(c); });
+            const auto end = std::find_if_not(text.rbegin(), text.rend(), [](unsigned char c) { return std::isspace(c); }).base();
+            return (begin < end ? std::string(begin, end) : std::string());
+        }
+
+        std::string escapeJson(const std::string& text) {
+            std::ostringstream result;
+            for (const char c : text) {
+                switch (c) {
+                    case '"': result << "\\\""; break;
+                    case '\\': result << "\\\\"; break;
+                    case '\n': result << "\\n"; break;
+                    case '\r': result << "\\r"; break;
+                    case '\t': result << "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                            result << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                        else
+                            result << c;
+                }
+            }
+            return result.str();
+        }
+
+        std::string escapeCsv(const std::string& text) {
+            if (text.find_first_of(",\"\n") == std::string::npos)
+                return text;
+            std::string result = "\"";
+            for (const char c : text) {
+                if (c == '"')
+                    result += '"';
+                result += c;
+            }
+            return result + "\"";
+        }
+
+        std::string formatHash(uint64_t hash) {
+            std::ostringstream result;
+            result << std::hex << std::setw(16) << std::setfill('0') << hash;
+            return result.str();
+        }
+
+        std::string formatAddress(size_t address) {
+            std::ostringstream result;
+            result << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << address;
+            return result.str();
+        }
+
+        const char* getCompatibilityModeName(CompatibilityMode compatibilityMode) noexcept {
+            return (compatibilityMode == CompatibilityMode::OriginalChip8 ? "chip8" : "superchip");
+        }
+
+    }
+
+    BatchResult runBatchJob(const BatchJob& job, RomStore* romStore) {
+        using Clock = std::chrono::steady_clock;
+        const auto startTime = Clock::now();
+        const auto getElapsedTime = [&startTime]() {
+            return std::chrono::duration<double>(Clock::now() - startTime).count();
+        };
+
+        BatchResult result;
+        Chip8 chip8;
+        chip8.setLoggingEnabled(false); // the results tell why a job has stopped
+        InputMovie movie;
+        std::optional<MoviePlayer> player;
+        if (!job.moviePath.empty()) {
+            std::string error;
+            if (!movie.load(job.moviePath, error)) {
+                result.message = "could not load movie " + job.moviePath + ": " + error;
+                result.wallTime = getElapsedTime();
+                return result;
+            }
+            player.emplace(movie);
+            player->start(chip8);
+        } else {
+            const auto rom = (romStore ? romStore->load(job.romPath) : nullptr);
+            if (rom) {
+                chip8.loadROM(*rom);
+            } else if (romStore || !chip8.loadROM(job.romPath)) {
+                result.message = "could not load ROM " + job.romPath;
+                result.wallTime = getElapsedTime();
+                return result;
+            }
+            chip8.setCompatibilityMode(job.compatibilityMode);
+            chip8.seedRandom(job.randomSeed);
+        }
+        const bool clockTimers = !(player && movie.drivesTimers());
+        std::shared_ptr<Profiler> profiler;
+        std::shared_ptr<MemoryProfiler> memoryProfiler;
+        if (job.profile) {
+            profiler = std::make_shared<Profiler>();
+            chip8.setProfiler(profiler.get());
+            memoryProfiler = std::make_shared<MemoryProfiler>();
+            chip8.setMemoryProfiler(memoryProfiler.get());
+        }
+        std::unique_ptr<InstructionTracer> tracer;
+        if (!job.tracePath.empty()) {
+            try {
+                tracer = std::make_unique<InstructionTracer>(job.tracePath);
+            } catch (const std::exception& e) {
+                result.stopReason = StopReason::LoadFailed;
+                result.message = e.what();
+                result.wallTime = getElapsedTime();
+                return result;
+            }
+            chip8.setTracer(tracer.get());
+        }
+        const uint64_t cyclesPerFrame = std::max<uint64_t>(job.cyclesPerFrame, 1);
+
+        result.stopReason = StopReason::CycleBudgetReached;
+        try {
+            while (result.cycles < job.cycleBudget) {
+                if (player)
+                    player->applyEvents(chip8);
+                const bool success = chip8.step();
+                ++result.cycles;
+                if (!success) {
+                    result.stopReason = StopReason::Halted;
+                    break;
+                }
+                if (clockTimers && result.cycles % cyclesPerFrame == 0)
+                    chip8.clockTimers();
+                if (result.cycles % WatchdogInterval == 0 && getElapsedTime() > job.timeLimit) {
+                    result.stopReason = StopReason::TimeLimitExceeded;
+                    break;
+                }
+            }
+        } catch (const std::exception& e) {
+            result.stopReason = StopReason::Crashed;
+            result.message = e.what();
+        }
+
+        const auto& display = chip8.getPackedDisplay();
+        result.displayHash = fnv1a64(display.data(), display.size());
+        result.profiler = std::move(profiler);
+        result.memoryProfiler = std::move(memoryProfiler);
+        result.wallTime = getElapsedTime();
+        return result;
+    }
+
+    std::vector<BatchResult> runBatchJobs(const std::vector<BatchJob>& jobs, ThreadPool& threadPool) {
+        std::vector<BatchResult> results(jobs.size());
+        RomStore romStore;
+        threadPool.parallelFor(jobs.size(), [&jobs, &results, &romStore](size_t index) {
+            results[index] = runBatchJob(jobs[index], &romStore);
+        });
+        return results;
+    }
+
+    std::optional<std::vector<BatchJob>> parseBatchManifest(std::istream& input, const BatchJob& defaultJob, std::string& error) {
+        std::vector<BatchJob> jobs;
+        std::string line;
+        for (size_t lineNumber = 1; std::getline(input, line); ++lineNumber) {
+            line = trim(line);
+            if (line.empty() || line.front() == '#')
+                continue;
+
+            std::vector<std::string> fields;
+            std::istringstream lineStream(line);
+            for (std::string field; std::getline(lineStream, field, ',');)
+                fields.push_back(trim(field));
+            if (fields.size() > 4) {
+                error = "line " + std::to_string(lineNumber) + ": too many fields";
+                return {};
+            }
+            fields.resize(4);
+
+            BatchJob job = defaultJob;
+            job.romPath = fields[0];
+            if (!fields[1].empty()) {
+                const auto compatibilityMode = parseCompatibilityMode(fields[1]);
+                if (!compatibilityMode) {
+                    error = "line " + std::to_string(lineNumber) + ": unknown profile '" + fields[1] + "'";
+                    return {};
+                }
+                job.compatibilityMode = compatibilityMode.value();
+            }
+            if (!fields[2].empty()) {
+                try {
+                    job.cycleBudget = std::stoull(fields[2]);
+                } catch (const std::exception&) {
+                    error = "line " + std::to_string(lineNumber) + ": invalid cycle budget '" + fields[2] + "'";
+                    return {};
+                }
+            }
+            if (!fields[3].empty())
+                job.moviePath = fields[3];
+            if (job.romPath.empty() && job.moviePath.empty()) {
+                error = "line " + std::to_string(lineNumber) + ": neither ROM nor movie given";
+                return {};
+            }
+            jobs.push_back(std::move(job));
+        }
+        return jobs;
+    }
+
+    std::optional<CompatibilityMode> parseCompatibilityMode(const std::string& name) {
+        std::string lowerCaseName = name;
+        std::transform(lowerCaseName.begin(), lowerCaseName.end(), lowerCaseName.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (lowerCaseName == "chip8" || lowerCaseName == "chip-8")
+            return CompatibilityMode::OriginalChip8;
+        if (lowerCaseName == "superchip" || lowerCaseName == "schip")
+            return CompatibilityMode::SuperChip;
+        return {};
+    }
+
+    const char* getStopReasonName(StopReason stopReason) noexcept {
+        switch (stopReason) {
+            case StopReason::CycleBudgetReached:
+                return "cycle_budget";
+            case StopReason::Halted:
+                return "halted";
+            case StopReason::TimeLimitExceeded:
+                return "time_limit";
+            case StopReason::LoadFailed:
+                return "load_failed";
+            case StopReason::Crashed:
+                return "crashed";
+        }
+        return "unknown";
+    }
+
+    void writeBatchResultsJson(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results) {
+        Expects(jobs.size() == results.size());
+        output << "[\n";
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            const auto& job = jobs[i];
+            const auto& result = results[i];
+            output << "  {"
+                << "\"rom\": \"" << escapeJson(job.romPath) << "\", "
+                << "\"profile\": \"" << getCompatibilityModeName(job.compatibilityMode) << "\", "
+                << "\"movie\": \"" << escapeJson(job.moviePath) << "\", "
+                << "\"cycle_budget\": " << job.cycleBudget << ", "
+                << "\"stop_reason\": \"" << getStopReasonName(result.stopReason) << "\", "
+                << "\"cycles\": " << result.cycles << ", "
+                << "\"display_hash\": \"" << formatHash(result.displayHash) << "\", "
+                << "\"wall_time\": " << result.wallTime << ", "
+                << "\"message\": \"" << escapeJson(result.message) << "\""
+                << (i + 1 < jobs.size() ? "},\n" : "}\n");
+        }
+        output << "]\n";
+    }
+
+    void writeBatchProfilesJson(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results) {
+        Expects(jobs.size() == results.size());
+        output << "[";
+        bool first = true;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (!results[i].profiler)
+                continue;
+            output << (first ? "\n" : ",\n")
+                << "  {\"rom\": \"" << escapeJson(jobs[i].romPath) << "\", "
+                << "\"movie\": \"" << escapeJson(jobs[i].moviePath) << "\", "
+                << "\"opcode_statistics\": ";
+            results[i].profiler->writeJson(output);
+            output << "}";
+            first = false;
+        }
+        output << "\n]\n";
+    }
+
+    void writeBatchHeatMapsCsv(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results) {
+        Expects(jobs.size() == results.size());
+        output << "rom,address,executions\n";
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (!results[i].profiler)
+                continue;
+            const auto rom = escapeCsv(jobs[i].romPath);
+            const auto& counts = results[i].profiler->getAddressCounts();
+            for (size_t address = 0; address < counts.size(); ++address) {
+                if (counts[address] > 0)
+                    output << rom << ',' << formatAddress(address) << ',' << counts[address] << '\n';
+            }
+        }
+    }
+
+    void writeBatchMemoryReportsJson(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results) {
+        Expects(jobs.size() == results.size());
+        output << "[";
+        bool first = true;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (!results[i].memoryProfiler)
+                continue;
+            output << (first ? "\n" : ",\n")
+                << "  {\"rom\": \"" << escapeJson(jobs[i].romPath) << "\", "
+                << "\"movie\": \"" << escapeJson(jobs[i].moviePath) << "\", "
+                << "\"memory\": ";
+            results[i].memoryProfiler->writeReportJson(output);
+            output << "}";
+            first = false;
+        }
+        output << "\n]\n";
+    }
+
+    void writeBatchResultsCsv(std::ostream& output, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results) {
+        Expects(jobs.size() == results.size());
+        output << "rom,profile,movie,cycle_budget,stop_reason,cycles,display_hash,wall_time,message\n";
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            const auto& job = jobs[i];
+            const auto& result = results[i];
+            output << escapeCsv(job.romPath) << ','
+                << getCompatibilityModeName(job.compatibilityMode) << ','
+                << escapeCsv(job.moviePath) << ','
+                << job.cycleBudget << ','
+                << getStopReasonName(result.stopReason) << ','
+                << result.cycles << ','
+                << formatHash(result.displayHash) << ','
+                << result.wallTime << ','
+                << escapeCsv(result.message) << '\n';
+        }
+    }
+
+}
@@ -1,27 +1,36 @@
 #include "Chip8Core/Chip8.hpp"
 
-#ifdef _MSC_VER
-#include <filesystem>
-namespace fs = std::filesystem;
-#else
-#include <experimental/filesystem>
-namespace fs = std::experimental::filesystem;
-#endif
 #include <iostream>
-#include <fstream>
 #include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 
 #include <gsl/gsl>
 
+#include "Chip8Core/Debugger.hpp"
+#include "Chip8Core/ExecutionHistory.hpp"
 #include "Chip8Core/Instruction.hpp"
 #include "Chip8Core/Opcodes.hpp"
+#include "Chip8Core/InputMovie.hpp"
+#include "Chip8Core/InstructionTrace.hpp"
+#include "Chip8Core/MappedFile.hpp"
+#include "Chip8Core/MemoryProfiler.hpp"
+#include "Chip8Core/Profiler.hpp"
+#include "Chip8Core/RomStore.hpp"
 
 namespace Chip8 {
 
     Chip8::Chip8() noexcept
-        : mV({}), mI(0), mPC(ProgramOffset), mDelayTimer(0x0), mSoundTimer(0x0)
-        , mCompatibilityMode(CompatibilityMode::SuperChip), mAwaitingKeyPress(false)
-        , mKeyPressRegisterTarget(0x0)
+        : mV({}), mI(0), mStack({}), mStackSize(0), mPC(ProgramOffset), mDelayTimer(0x0), mSoundTimer(0x0)
+        , mCompatibilityMode(CompatibilityMode::SuperChip), mDisplayMemory({}), mAwaitingKeyPress(false)
+        , mKeyPressRegisterTarget(0x0), mCycleCount(0), mRandomSeed(DefaultRandomSeed), mRandom(DefaultRandomSeed)
+        , mInputRecorder(nullptr), mExecutionHistory(nullptr)
+#ifdef CHIP8_ENABLE_PROFILING
+        , mProfiler(nullptr), mTracer(nullptr), mMemoryProfiler(nullptr), mDebugger(nullptr), mInstrumented(false)
+        , mEntryChecked(false)
+#endif
+        , mLoggingEnabled(true)
     {}
 
     void Chip8::reset(bool alsoResetMemory) noexcept {
@@ -29,46 +38,120 @@ namespace Chip8 {
             mMemory.clear();
             writeCharacterData();
         }
-        mDisplayMemory.reset(); // clear display
+        mDisplayMemory.fill(0x0); // clear display
         for (uint8_t i = 0; i <= 0xF; ++i)
             setRegister(i, 0x0);
         mPC = ProgramOffset;
         mI = 0x0;
+        mStackSize = 0;
         mDelayTimer = 0x0;
         mSoundTimer = 0x0;
         mCompatibilityMode = CompatibilityMode::SuperChip;
+        mAwaitingKeyPress = false;
+        mCycleCount = 0;
+#ifdef CHIP8_ENABLE_PROFILING
+        mEntryChecked = false;
+#endif
+        mRandom.seed(mRandomSeed);
+    }
+
+    void Chip8::saveState(State& state) const noexcept {
+        // layout: memory | display (bit-packed, row-major) | V0-VF | I | PC | DT | ST | stack | stack size
+        //         | compatibility mode | pressed keys | awaiting key press | key press register target
+        //         | cycle count | random seed | random number generator state
+        auto out = state.begin();
+        mMemory.readBlock(0x0, &*out, MemorySize);
+        out += MemorySize;
+        out = std::copy(mDisplayMemory.begin(), mDisplayMemory.end(), out);
+        out = std::copy(mV.begin(), mV.end(), out);
+        const auto writeWord = [&out](uint16_t value) noexcept {
+            *out++ = gsl::narrow_cast<uint8_t>(value >> 8);
+            *out++ = gsl::narrow_cast<uint8_t>(value & 0xFF);
+        };
+        writeWord(mI);
+        writeWord(mPC);
+        *out++ = mDelayTimer;
+        *out++ = mSoundTimer;
+        for (const auto address : mStack)
+            writeWord(address);
+        *out++ = mStackSize;
+        *out++ = (mCompatibilityMode == CompatibilityMode::OriginalChip8 ? 0x0 : 0x1);
+        writeWord(gsl::narrow_cast<uint16_t>(mPressedKeys.to_ulong()));
+        *out++ = (mAwaitingKeyPress ? 0x1 : 0x0);
+        *out++ = mKeyPressRegisterTarget;
+        const auto writeQuadWord = [&writeWord](uint64_t value) noexcept {
+            for (int shift = 48; shift >= 0; shift -= 16)
+                writeWord(gsl::narrow_cast<uint16_t>(value >> shift));
+        };
+        writeQuadWord(mCycleCount);
+        writeQuadWord(mRandomSeed);
+        writeQuadWord(mRandom.getState());
+        Ensures(out == state.end());
+    }
+
+    void Chip8::loadState(const State& state) {
+        auto in = state.begin();
+        mMemory.writeBlock(0x0, &*in, MemorySize);
+        in += MemorySize;
+        std::copy(in, in + mDisplayMemory.size(), mDisplayMemory.begin());
+        in += mDisplayMemory.size();
+        std::copy(in, in + mV.size(), mV.begin());
+        in += mV.size();
+        const auto readWord = [&in]() noexcept -> uint16_t {
+            const uint16_t upper = *in++;
+            return gsl::narrow_cast<uint16_t>(upper << 8 | *in++);
+        };
+        mI = readWord();
+        mPC = readWord();
+        mDelayTimer = *in++;
+        mSoundTimer = *in++;
+        for (auto& address : mStack)
+            address = readWord();
+        mStackSize = std::min(*in++, gsl::narrow_cast<uint8_t>(StackSize));
+        mCompatibilityMode = (*in++ == 0x0 ? CompatibilityMode::OriginalChip8 : CompatibilityMode::SuperChip);
+        mPressedKeys = std::bitset<0x10>(readWord());
+        mAwaitingKeyPress = (*in++ != 0x0);
+        mKeyPressRegisterTarget = *in++ & 0xF;
+        const auto readQuadWord = [&readWord]() noexcept -> uint64_t {
+            uint64_t result = 0;
+            for (int i = 0; i < 4; ++i)
+                result = (result << 16) | readWord();
+            return result;
+        };
+        mCycleCount = readQuadWord();
+        mRandomSeed = readQuadWord();
+        mRandom.setState(readQuadWord());
+        Ensures(in == state.end());
     }
 
     bool Chip8::loadROM(const std::string& filename) {
-        if (!fs::exists(filename)) {
-            return false;
-        } else {
-            std::ifstream file;
-            file.exceptions(std::ifstream::failbit | std::ifstream::badbit | std::ifstream::eofbit);
-            file.open(filename, std::ios::in | std::ios::binary);
-            if (file.good()) {
-                reset();
-#ifdef _MSC_VER
-#pragma warning(disable: 26481)
-#endif
-                uintmax_t bytesToRead = std::min(static_cast<uintmax_t>(0x1000 - 0x0200), fs::file_size(filename));
-                try {
-                    file.read((char*)mMemory.data() + 0x0200, bytesToRead);
-                } catch (const std::ifstream::failure& e) {
-                    std::cout << "Error reading file: " << e.what() << std::endl;
-                    return false;
-                }
-#ifdef _MSC_VER
-#pragma warning(default: 26481)
-#endif
-            } else {
-                return false;
-            }
+        try {
+            const MappedFile file(filename);
+            loadROM(file.data(), file.size());
             return true;
+        } catch (const std::runtime_error&) {
+            return false;
         }
     }
 
+    void Chip8::loadROM(const MemoryUnderlyingType* data, size_t size) {
+        reset();
+        mMemory.writeBlock(ProgramOffset, data, std::min(size, MemorySize - ProgramOffset));
+    }
+
+    void Chip8::loadROM(const Rom& rom) {
+        reset();
+        const auto& pages = rom.getPages();
+        for (size_t i = 0; i < pages.size(); ++i)
+            mMemory.setPage(Rom::FirstPage + i, pages[i]);
+    }
+
     bool Chip8::step() {
+#ifdef CHIP8_ENABLE_PROFILING
+        if (mInstrumented && mCycleCount == 0 && !mEntryChecked && stopsAtEntry())
+            return true;
+#endif
+        ++mCycleCount;
         if (mAwaitingKeyPress) {
             // waiting for keypress (blocking)
             return true;
@@ -82,34 +165,81 @@ namespace Chip8 {
             mPC += 2;
 
             // evaluate instruction
-            bool instructionFound = false;
-#ifndef _MSC_VER
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-#endif
-            for (auto& [name, opcode, opcodeMask, parameterMask] : Opcodes) {
-#ifndef _MSC_VER
-#pragma GCC diagnostic pop
+            const size_t opcodeIndex = getOpcodeIndex(instruction.getValue());
+#ifdef CHIP8_ENABLE_PROFILING
+            if (mInstrumented)
+                return executeInstrumented(opcodeIndex, instruction);
 #endif
-                if ((instruction.getValue() & opcodeMask) == opcode) {
-                    instructionFound = true;
-                    if (!OpcodeHandler::execute(opcode, instruction, *this, mCompatibilityMode))
-                        return false;                    
-                    break;
-                }
-            }
-            if (!instructionFound)
+            return executeInstruction(opcodeIndex, instruction);
+        } else {
+            if (mLoggingEnabled)
+                std::cout << "end of program reached\n";
+            return false;
+        }
+    }
+
+    bool Chip8::executeInstruction(size_t opcodeIndex, Instruction instruction) {
+        if (opcodeIndex == Opcodes.size()) {
+            if (mLoggingEnabled)
                 std::cout << "Warning: Instruction 0x"
                     << std::setw(4) << std::setfill('0') << std::hex << std::uppercase
                     << instruction.getValue() << " could not be evaluated (unknown opcode).\n";
             return true;
-        } else {
-            std::cout << "end of program reached\n";
-            return false;
         }
+        return OpcodeHandler::execute(std::get<1>(Opcodes[opcodeIndex]), instruction, *this, mCompatibilityMode);
+    }
+
+    bool Chip8::executeInstrumented([[maybe_unused]] size_t opcodeIndex, [[maybe_unused]] Instruction instruction) {
+#ifdef CHIP8_ENABLE_PROFILING
+        using Clock = std::chrono::steady_clock;
+        const auto address = gsl::narrow_cast<uint16_t>(mPC - 2); // the instruction may change the program counter
+        const auto registers = mV;
+        if (mMemoryProfiler)
+            mMemoryProfiler->record(MemoryAccess::Execute, address, 2, mCycleCount);
+        const auto startTime = (mProfiler ? Clock::now() : Clock::time_point{}); // the other hooks do not need the time
+        const bool success = executeInstruction(opcodeIndex, instruction);
+        if (mProfiler)
+            mProfiler->recordInstruction(address, opcodeIndex, gsl::narrow_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count()));
+        if (mTracer) {
+            TraceRecord record{ mCycleCount, address, instruction.getValue(), mI, TraceRecord::NoRegister, 0 };
+            const auto changed = std::mismatch(registers.begin(), registers.end(), mV.begin()).first;
+            if (changed != registers.end()) {
+                record.changedRegister = gsl::narrow_cast<uint8_t>(changed - registers.begin());
+                record.value = mV[record.changedRegister];
+            }
+            mTracer->record(record);
+        }
+        if (mDebugger) {
+            uint16_t changedRegisters = 0;
+            for (size_t i = 0; i < mV.size(); ++i) {
+                if (mV[i] != registers[i])
+                    changedRegisters |= gsl::narrow_cast<uint16_t>(1u << i);
+            }
+            mDebugger->checkInstruction(*this, address, changedRegisters);
+        }
+        return success;
+#else
+        return true;
+#endif
+    }
+
+    bool Chip8::stopsAtEntry() {
+#ifdef CHIP8_ENABLE_PROFILING
+        // no instruction leads to the first one, so its breakpoint is checked before the first step counts
+        // or executes it (once per reset); if it is hit, the step does nothing
+        mEntryChecked = true;
+        return (mDebugger && !mAwaitingKeyPress && mDebugger->checkEntry(*this));
+#else
+        return false;
+#endif
     }
 
     void Chip8::clockTimers() noexcept {
+        if (mInputRecorder)
+            mInputRecorder->recordEvent({ mCycleCount, InputMovie::EventType::ClockTimers, 0x0 });
+        if (mExecutionHistory)
+            mExecutionHistory->recordEvent({ mCycleCount, InputMovie::EventType::ClockTimers, 0x0 });
         if (mDelayTimer > 0x0)
             mDelayTimer--;
         if (mSoundTimer > 0x0)
@@ -157,14 +287,15 @@ namespace Chip8 {
     }
 
     void Chip8::stackPush(uint16_t returnAddress) {
-        mStack.push_back(returnAddress);
+        if (mStackSize >= StackSize)
+            throw std::overflow_error("stack overflow");
+        mStack[mStackSize++] = returnAddress;
     }
 
-    uint16_t Chip8::stackPop() noexcept {
-        Ensures(mStack.size() > 0);
-        const uint16_t result = mStack.back();
-        mStack.pop_back();
-        return result;
+    uint16_t Chip8::stackPop() {
+        if (mStackSize == 0)
+            throw std::underflow_error("stack underflow");
+        return mStack[--mStackSize];
     }
 
     Instruction Chip8::getNextInstruction() const {
@@ -182,7 +313,12 @@ namespace Chip8 {
             // invalid pixel coordinate
             return;
         }
-        mDisplayMemory[x + DisplayWidth * y] = isSet;
+        const size_t pixel = x + DisplayWidth * y;
+        const auto bit = gsl::narrow_cast<uint8_t>(0x80 >> (pixel % 8));
+        if (isSet)
+            mDisplayMemory[pixel / 8] |= bit;
+        else
+            mDisplayMemory[pixel / 8] &= gsl::narrow_cast<uint8_t>(~bit);
     }
 
     bool Chip8::getPixel(size_t x, size_t y) const {
@@ -190,10 +326,110 @@ namespace Chip8 {
             // invalid pixel coordinate
             return false;
         }
-        return mDisplayMemory[x + DisplayWidth * y];
+        const size_t pixel = x + DisplayWidth * y;
+        return (mDisplayMemory[pixel / 8] & (0x80 >> (pixel % 8))) != 0x0;
+    }
+
+    uint64_t Chip8::getCycleCount() const noexcept {
+        return mCycleCount;
+    }
+
+    void Chip8::seedRandom(uint64_t seed) noexcept {
+        mRandomSeed = seed;
+        mRandom.seed(seed);
+    }
+
+    uint64_t Chip8::getRandomSeed() const noexcept {
+        return mRandomSeed;
+    }
+
+    void Chip8::setInputRecorder(InputMovie* recorder) noexcept {
+        mInputRecorder = recorder;
+    }
+
+    InputMovie* Chip8::getInputRecorder() const noexcept {
+        return mInputRecorder;
+    }
+
+    void Chip8::setExecutionHistory(ExecutionHistory* history) noexcept {
+        mExecutionHistory = history;
+    }
+
+    void Chip8::setProfiler([[maybe_unused]] Profiler* profiler) noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        mProfiler = profiler;
+        updateInstrumented();
+#endif
+    }
+
+    Profiler* Chip8::getProfiler() const noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        return mProfiler;
+#else
+        return nullptr;
+#endif
+    }
+
+    void Chip8::setTracer([[maybe_unused]] InstructionTracer* tracer) noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        mTracer = tracer;
+        updateInstrumented();
+#endif
+    }
+
+    InstructionTracer* Chip8::getTracer() const noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        return mTracer;
+#else
+        return nullptr;
+#endif
+    }
+
+    void Chip8::setMemoryProfiler([[maybe_unused]] MemoryProfiler* profiler) noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        mMemoryProfiler = profiler;
+        updateInstrumented();
+#endif
+    }
+
+    MemoryProfiler* Chip8::getMemoryProfiler() const noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        return mMemoryProfiler;
+#else
+        return nullptr;
+#endif
+    }
+
+    void Chip8::setDebugger([[maybe_unused]] Debugger* debugger) noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        mDebugger = debugger;
+        updateInstrumented();
+#endif
+    }
+
+    Debugger* Chip8::getDebugger() const noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        return mDebugger;
+#else
+        return nullptr;
+#endif
+    }
+
+    void Chip8::updateInstrumented() noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+        mInstrumented = (mProfiler || mTracer || mMemoryProfiler || mDebugger);
+#endif
+    }
+
+    const Chip8::PackedDisplay& Chip8::getPackedDisplay() const noexcept {
+        return mDisplayMemory;
     }
 
     void Chip8::triggerKeyDown(uint8_t key) noexcept {
+        if (mInputRecorder)
+            mInputRecorder->recordEvent({ mCycleCount, InputMovie::EventType::KeyDown, key });
+        if (mExecutionHistory)
+            mExecutionHistory->recordEvent({ mCycleCount, InputMovie::EventType::KeyDown, key });
         mPressedKeys[key] = true;
         if (mAwaitingKeyPress) {
             setRegister(mKeyPressRegisterTarget, key);
@@ -202,17 +438,34 @@ namespace Chip8 {
     }
 
     void Chip8::triggerKeyUp(uint8_t key) noexcept {
+        if (mInputRecorder)
+            mInputRecorder->recordEvent({ mCycleCount, InputMovie::EventType::KeyUp, key });
+        if (mExecutionHistory)
+            mExecutionHistory->recordEvent({ mCycleCount, InputMovie::EventType::KeyUp, key });
         mPressedKeys[key] = false;
     }
 
     bool Chip8::isKeyPressed(uint8_t key) const noexcept {
-        return mPressedKeys[key];
+        return (key < mPressedKeys.size() && mPressedKeys[key]);
+    }
+
+    void Chip8::setLoggingEnabled(bool enabled) noexcept {
+        mLoggingEnabled = enabled;
+    }
+
+    bool Chip8::isLoggingEnabled() const noexcept {
+        return mLoggingEnabled;
     }
 
     void Chip8::writeCharacterData() {
-        for (uint16_t address = 0; address < sizeof(Characters) / sizeof(Characters[0]); ++address) {
-            mMemory.write(address, Characters[static_cast<size_t>(address)]);
-        }
+        // all instances share the same (copy-on-write) page holding the font
+        static const auto characterPage = []() {
+            auto page = std::make_shared<Chip8Memory<MemoryUnderlyingType>::Page>();
+            page->fill(0x0);
+            std::copy(std::begin(Characters), std::end(Characters), page->begin());
+            return std::shared_ptr<const Chip8Memory<MemoryUnderlyingType>::Page>(std::move(page));
+        }();
+        mMemory.setPage(0, characterPage);
     }
 }
 
@@ -0,0 +1,412 @@
+#include "Chip8Core/ControlFlowAnalysis.hpp"
+
+#ifdef _MSC_VER
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <system_error>
+#include <utility>
+#include <gsl/gsl>
+
+#include "Chip8Core/Disassembler.hpp"
+#include "Chip8Core/Opcodes.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        // file layout: magic | version | byte kinds | instruction starts (one bit per address) | block count | blocks
+        // every block is stored as: start | end | terminator | successor count | successors
+        // The disassembly is not stored but generated again on loading, so it never depends on the version of
+        // the disassembler that wrote the file. The version has to change with the format or the analysis.
+        constexpr char Magic[4] = { 'C', '8', 'C', 'F' };
+        constexpr uint8_t Version = 2;
+        constexpr const char* CacheExtension = ".c8cfa";
+
+        // the value of I on a path: either set by an ANNN that the analysis has seen, or unknown
+        struct AddressPointer {
+            bool known;
+            uint16_t value;
+
+            bool operator==(const AddressPointer& other) const noexcept {
+                return known == other.known && (!known || value == other.value);
+            }
+        };
+
+        constexpr AddressPointer UnknownAddressPointer{ false, 0 };
+
+        // how control leaves a single instruction
+        struct InstructionFlow {
+            ControlFlowAnalysis::Terminator terminator;
+            bool endsBlock; ///< false for instructions that simply continue with the next one
+            std::vector<uint16_t> successors;
+        };
+
+        void writeUint16(std::vector<char>& buffer, uint16_t value) {
+            buffer.push_back(static_cast<char>(value & 0xFF));
+            buffer.push_back(static_cast<char>(value >> 8));
+        }
+
+        bool readUint16(const std::vector<char>& buffer, size_t& position, uint16_t& value) noexcept {
+            if (position + 2 > buffer.size())
+                return false;
+            value = static_cast<uint16_t>(static_cast<uint8_t>(buffer[position]) | (static_cast<uint8_t>(buffer[position + 1]) << 8));
+            position += 2;
+            return true;
+        }
+
+        // one line per instruction of a block, e.g. "202: DRW V0, V1, 5"
+        std::string disassembleBlock(const Chip8Memory<uint8_t>& memory, const ControlFlowAnalysis::Block& block) {
+            std::string text;
+            for (size_t address = block.start; address < block.end && address + 1u < ControlFlowAnalysis::AddressCount; address += 2) {
+                char label[8];
+                std::snprintf(label, sizeof(label), "%03X: ", static_cast<unsigned>(address));
+                text += label + disassemble(Instruction(memory.read(static_cast<uint16_t>(address)),
+                    memory.read(static_cast<uint16_t>(address + 1u)))) + '\n';
+            }
+            return text;
+        }
+
+        std::string escapeDotLabel(const std::string& text) {
+            std::string result;
+            for (const char c : text) {
+                if (c == '"' || c == '\\')
+                    result.push_back('\\');
+                result.push_back(c);
+            }
+            return result;
+        }
+
+    }
+
+    bool ControlFlowAnalysis::Block::operator==(const Block& other) const noexcept {
+        return start == other.start && end == other.end && terminator == other.terminator && successors == other.successors;
+    }
+
+    ControlFlowAnalysis::ControlFlowAnalysis()
+        : mKinds(AddressCount, ByteKind::Unknown)
+    {}
+
+    ControlFlowAnalysis ControlFlowAnalysis::analyze(const Chip8Memory<uint8_t>& memory, uint16_t entry) {
+        ControlFlowAnalysis result;
+        std::vector<std::optional<AddressPointer>> states(AddressCount);
+        std::vector<std::optional<InstructionFlow>> flows(AddressCount);
+        std::bitset<AddressCount> code;
+        std::bitset<AddressCount> sprites;
+        std::bitset<AddressCount> leaders;
+
+        // every address is visited with a known I at most once and with an unknown I at most once more,
+        // since the states at an address only ever change from known to unknown
+        std::vector<std::pair<uint16_t, AddressPointer>> worklist;
+        const auto enqueue = [&](uint16_t address, AddressPointer pointer) {
+            if (address >= AddressCount)
+                return;
+            auto& state = states[address];
+            if (state && (*state == pointer || !state->known))
+                return;
+            state = (state ? UnknownAddressPointer : pointer);
+            worklist.emplace_back(address, *state);
+        };
+        leaders.set(entry % AddressCount);
+        enqueue(entry, UnknownAddressPointer);
+
+        while (!worklist.empty()) {
+            const auto [address, pointer] = worklist.back();
+            worklist.pop_back();
+            auto& flow = flows[address];
+            if (address + 1u >= AddressCount) {
+                flow = InstructionFlow{ Terminator::Halt, true, {} };
+                continue;
+            }
+            const Instruction instruction(memory.read(address), memory.read(static_cast<uint16_t>(address + 1u)));
+            code.set(address);
+            code.set(address + 1u);
+            result.mInstructionStarts.set(address);
+
+            const auto next = static_cast<uint16_t>(address + 2u);
+            const uint16_t target = instruction.getNNN();
+            const size_t opcodeIndex = getOpcodeIndex(instruction.getValue());
+            // zero words are padding rather than calls of machine code routines
+            const uint16_t opcode = (opcodeIndex == Opcodes.size() || instruction.getValue() == 0x0000
+                ? 0xFFFF : std::get<1>(Opcodes[opcodeIndex]));
+            AddressPointer nextPointer = pointer;
+            switch (opcode) {
+                case 0xFFFF:
+                    flow = InstructionFlow{ Terminator::Halt, true, {} };
+                    continue;
+                case 0x00EE:
+                    flow = InstructionFlow{ Terminator::Return, true, {} };
+                    continue;
+                case 0x1000:
+                    flow = InstructionFlow{ Terminator::Jump, true, { target } };
+                    leaders.set(target);
+                    enqueue(target, pointer);
+                    continue;
+                case 0x2000:
+                    // the subroutine is assumed to return, but it may have changed I
+                    flow = InstructionFlow{ Terminator::Call, true, { target, next } };
+                    leaders.set(target);
+                    leaders.set(next % AddressCount);
+                    enqueue(target, pointer);
+                    enqueue(next, UnknownAddressPointer);
+                    continue;
+                case 0x3000:
+                case 0x4000:
+                case 0x5000:
+                case 0x9000:
+                case 0xE09E:
+                case 0xE0A1: {
+                    const auto skipped = static_cast<uint16_t>(address + 4u);
+                    flow = InstructionFlow{ Terminator::Skip, true, { next, skipped } };
+                    leaders.set(next % AddressCount);
+                    leaders.set(skipped % AddressCount);
+                    enqueue(next, pointer);
+                    enqueue(skipped, pointer);
+                    continue;
+                }
+                case 0xB000:
+                    flow = InstructionFlow{ Terminator::IndirectJump, true, {} };
+                    continue;
+                case 0xA000:
+                    nextPointer = AddressPointer{ true, target };
+                    break;
+                case 0xD000:
+                    if (pointer.known) {
+                        for (unsigned row = 0; row < instruction.getN(); ++row)
+                            sprites.set((pointer.value + row) % AddressCount);
+                    }
+                    break;
+                case 0xF01E:
+                case 0xF029:
+                case 0xF055: // increments I in some compatibility modes
+                case 0xF065:
+                    nextPointer = UnknownAddressPointer;
+                    break;
+                default:
+                    break;
+            }
+            flow = InstructionFlow{ Terminator::FallThrough, false, { next } };
+            enqueue(next, nextPointer);
+        }
+
+        for (size_t address = 0; address < AddressCount; ++address) {
+            if (code[address])
+                result.mKinds[address] = ByteKind::Code;
+            else if (sprites[address])
+                result.mKinds[address] = ByteKind::Sprite;
+        }
+
+        // a block runs from a leader to the first instruction that branches or whose successor is a leader
+        for (size_t leader = 0; leader < AddressCount; ++leader) {
+            if (!leaders[leader] || !flows[leader])
+                continue;
+            Block block{ static_cast<uint16_t>(leader), static_cast<uint16_t>(leader), Terminator::FallThrough, {} };
+            size_t address = leader;
+            while (true) {
+                const auto& flow = *flows[address];
+                block.end = static_cast<uint16_t>(std::min(address + 2u, AddressCount));
+                if (flow.endsBlock || leaders[flow.successors.front() % AddressCount] || !flows[flow.successors.front() % AddressCount]) {
+                    block.terminator = flow.terminator;
+                    block.successors = flow.successors;
+                    break;
+                }
+                address = flow.successors.front();
+            }
+            result.mBlockText.push_back(disassembleBlock(memory, block));
+            result.mBlocks.push_back(std::move(block));
+        }
+        return result;
+    }
+
+    ControlFlowAnalysis ControlFlowAnalysis::analyzeCached(const std::string& directory, const Sha1Digest& hash, const Chip8Memory<uint8_t>& memory) {
+        const auto filename = (fs::path(directory) / (toHexString(hash) + CacheExtension)).string();
+        ControlFlowAnalysis result;
+        if (result.load(filename, memory))
+            return result;
+        result = analyze(memory);
+        std::error_code errorCode;
+        fs::create_directories(directory, errorCode);
+        result.save(filename); // a failure only means that the analysis is computed again next time
+        return result;
+    }
+
+    ControlFlowAnalysis::ByteKind ControlFlowAnalysis::getByteKind(uint16_t address) const noexcept {
+        return (address < AddressCount ? mKinds[address] : ByteKind::Unknown);
+    }
+
+    bool ControlFlowAnalysis::isInstructionStart(uint16_t address) const noexcept {
+        return address < AddressCount && mInstructionStarts[address];
+    }
+
+    size_t ControlFlowAnalysis::countBytes(ByteKind kind) const noexcept {
+        return static_cast<size_t>(std::count(mKinds.begin(), mKinds.end(), kind));
+    }
+
+    const std::vector<ControlFlowAnalysis::Block>& ControlFlowAnalysis::getBlocks() const noexcept {
+        return mBlocks;
+    }
+
+    const ControlFlowAnalysis::Block* ControlFlowAnalysis::findBlock(uint16_t address) const noexcept {
+        if (!isInstructionStart(address))
+            return nullptr;
+        // blocks can overlap if the program jumps to odd addresses, so the instructions have to line up, too
+        auto iterator = std::upper_bound(mBlocks.begin(), mBlocks.end(), address,
+            [](uint16_t value, const Block& block) { return value < block.start; });
+        while (iterator != mBlocks.begin()) {
+            --iterator;
+            if (address < iterator->end && (address - iterator->start) % 2 == 0)
+                return &*iterator;
+        }
+        return nullptr;
+    }
+
+    std::vector<uint16_t> ControlFlowAnalysis::getIndirectJumps() const {
+        std::vector<uint16_t> result;
+        for (const auto& block : mBlocks) {
+            if (block.terminator == Terminator::IndirectJump)
+                result.push_back(static_cast<uint16_t>(block.end - 2u));
+        }
+        return result;
+    }
+
+    void ControlFlowAnalysis::writeDot(std::ostream& output) const {
+        output << "digraph ControlFlow {\n";
+        output << "    node [shape=box, fontname=\"monospace\"];\n";
+        char name[8];
+        const auto nodeName = [&name](uint16_t address) {
+            std::snprintf(name, sizeof(name), "b%03X", static_cast<unsigned>(address));
+            return std::string(name);
+        };
+        for (size_t i = 0; i < mBlocks.size(); ++i) {
+            const auto& block = mBlocks[i];
+            // "\l" ends a left-aligned line
+            std::string label = escapeDotLabel(mBlockText[i]);
+            for (size_t position = label.find('\n'); position != std::string::npos; position = label.find('\n', position))
+                label.replace(position, 1, "\\l");
+            output << "    " << nodeName(block.start) << " [label=\"" << label << "\"";
+            if (block.terminator == Terminator::IndirectJump || block.terminator == Terminator::Halt)
+                output << ", color=red";
+            output << "];\n";
+        }
+        for (const auto& block : mBlocks) {
+            for (size_t i = 0; i < block.successors.size(); ++i) {
+                output << "    " << nodeName(block.start) << " -> " << nodeName(block.successors[i]);
+                // the return address of a call is reached through the subroutine
+                if (block.terminator == Terminator::Call && i == 1)
+                    output << " [style=dashed]";
+                output << ";\n";
+            }
+        }
+        output << "}\n";
+    }
+
+    bool ControlFlowAnalysis::save(const std::string& filename) const {
+        std::vector<char> buffer(std::begin(Magic), std::end(Magic));
+        buffer.push_back(static_cast<char>(Version));
+        for (const auto kind : mKinds)
+            buffer.push_back(static_cast<char>(kind));
+        for (size_t address = 0; address < AddressCount; address += 8) {
+            uint8_t bits = 0;
+            for (size_t bit = 0; bit < 8; ++bit)
+                bits = static_cast<uint8_t>(bits | (mInstructionStarts[address + bit] << bit));
+            buffer.push_back(static_cast<char>(bits));
+        }
+        writeUint16(buffer, gsl::narrow<uint16_t>(mBlocks.size()));
+        for (const auto& block : mBlocks) {
+            writeUint16(buffer, block.start);
+            writeUint16(buffer, block.end);
+            buffer.push_back(static_cast<char>(block.terminator));
+            buffer.push_back(static_cast<char>(block.successors.size()));
+            for (const auto successor : block.successors)
+                writeUint16(buffer, successor);
+        }
+
+        std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.good())
+            return false;
+        file.write(buffer.data(), gsl::narrow<std::streamsize>(buffer.size()));
+        return file.good();
+    }
+
+    bool ControlFlowAnalysis::load(const std::string& filename, const Chip8Memory<uint8_t>& memory) {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        if (!file.good())
+            return false;
+        const std::vector<char> buffer{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+        constexpr size_t headerSize = sizeof(Magic) + 1u + AddressCount + AddressCount / 8u;
+        if (buffer.size() < headerSize || !std::equal(std::begin(Magic), std::end(Magic), buffer.begin())
+            || static_cast<uint8_t>(buffer[sizeof(Magic)]) != Version)
+            return false;
+        std::vector<ByteKind> kinds(AddressCount);
+        size_t position = sizeof(Magic) + 1u;
+        for (auto& kind : kinds) {
+            const auto value = static_cast<uint8_t>(buffer[position++]);
+            if (value > static_cast<uint8_t>(ByteKind::Sprite))
+                return false;
+            kind = static_cast<ByteKind>(value);
+        }
+        std::bitset<AddressCount> instructionStarts;
+        for (size_t address = 0; address < AddressCount; address += 8) {
+            const auto bits = static_cast<uint8_t>(buffer[position++]);
+            for (size_t bit = 0; bit < 8; ++bit)
+                instructionStarts[address + bit] = ((bits >> bit) & 1u) != 0;
+        }
+
+        uint16_t blockCount = 0;
+        if (!readUint16(buffer, position, blockCount))
+            return false;
+        std::vector<Block> blocks;
+        std::vector<std::string> blockText;
+        for (uint16_t i = 0; i < blockCount; ++i) {
+            Block block{};
+            if (!readUint16(buffer, position, block.start) || !readUint16(buffer, position, block.end) || position + 2 > buffer.size())
+                return false;
+            const auto terminator = static_cast<uint8_t>(buffer[position++]);
+            const auto successorCount = static_cast<uint8_t>(buffer[position++]);
+            if (terminator > static_cast<uint8_t>(Terminator::Halt) || successorCount > 2)
+                return false;
+            block.terminator = static_cast<Terminator>(terminator);
+            block.successors.resize(successorCount);
+            for (auto& successor : block.successors) {
+                if (!readUint16(buffer, position, successor))
+                    return false;
+            }
+            if (block.start >= block.end || block.end > AddressCount)
+                return false;
+            blockText.push_back(disassembleBlock(memory, block));
+            blocks.push_back(std::move(block));
+        }
+        if (position != buffer.size())
+            return false;
+
+        mKinds = std::move(kinds);
+        mInstructionStarts = instructionStarts;
+        mBlocks = std::move(blocks);
+        mBlockText = std::move(blockText);
+        return true;
+    }
+
+    const char* ControlFlowAnalysis::getTerminatorName(Terminator terminator) noexcept {
+        switch (terminator) {
+            case Terminator::FallThrough: return "fall-through";
+            case Terminator::Jump: return "jump";
+            case Terminator::Call: return "call";
+            case Terminator::Return: return "return";
+            case Terminator::Skip: return "skip";
+            case Terminator::IndirectJump: return "indirect jump";
+            case Terminator::Halt: return "halt";
+        }
+        return "";
+    }
+
+}
@@ -0,0 +1,313 @@
+#include "Chip8Core/Debugger.hpp"
+
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+
+namespace Chip8 {
+
+    namespace {
+
+        using Operand = std::function<unsigned(const Chip8&)>;
+
+        // recursive descent over the condition that builds the predicate while parsing
+        class ConditionCompiler {
+        public:
+            ConditionCompiler(const std::string& text, std::string& error)
+                : mText(text), mPosition(0), mError(error)
+            {}
+
+            std::optional<Condition> compile() {
+                auto result = parseDisjunction();
+                if (result && !atEnd())
+                    return fail("unexpected '" + mText.substr(mPosition) + "'");
+                return result;
+            }
+
+        private:
+            std::optional<Condition> parseDisjunction() {
+                auto result = parseConjunction();
+                while (result && accept("||")) {
+                    auto right = parseConjunction();
+                    if (!right)
+                        return std::nullopt;
+                    result = [left = std::move(*result), right = std::move(*right)](const Chip8& chip8) {
+                        return left(chip8) || right(chip8);
+                    };
+                }
+                return result;
+            }
+
+            std::optional<Condition> parseConjunction() {
+                auto result = parseComparison();
+                while (result && accept("&&")) {
+                    auto right = parseComparison();
+                    if (!right)
+                        return std::nullopt;
+                    result = [left = std::move(*result), right = std::move(*right)](const Chip8& chip8) {
+                        return left(chip8) && right(chip8);
+                    };
+                }
+                return result;
+            }
+
+            std::optional<Condition> parseComparison() {
+                auto left = parseOperand();
+                if (!left)
+                    return std::nullopt;
+                // the two-character operators first, "<" would match the start of "<="
+                const char* const operators[] = { "==", "!=", "<=", ">=", "<", ">" };
+                for (const char* const comparison : operators) {
+                    if (!accept(comparison))
+                        continue;
+                    auto right = parseOperand();
+                    if (!right)
+                        return std::nullopt;
+                    const std::string name = comparison;
+                    if (name == "==")
+                        return Condition([l = std::move(*left), r = std::move(*right)](const Chip8& chip8) { return l(chip8) == r(chip8); });
+                    if (name == "!=")
+                        return Condition([l = std::move(*left), r = std::move(*right)](const Chip8& chip8) { return l(chip8) != r(chip8); });
+                    if (name == "<=")
+                        return Condition([l = std::move(*left), r = std::move(*right)](const Chip8& chip8) { return l(chip8) <= r(chip8); });
+                    if (name == ">=")
+                        return Condition([l = std::move(*left), r = std::move(*right)](const Chip8& chip8) { return l(chip8) >= r(chip8); });
+                    if (name == "<")
+                        return Condition([l = std::move(*left), r = std::move(*right)](const Chip8& chip8) { return l(chip8) < r(chip8); });
+                    return Condition([l = std::move(*left), r = std::move(*right)](const Chip8& chip8) { return l(chip8) > r(chip8); });
+                }
+                return fail(atEnd() ? "missing comparison at the end" : "expected a comparison at '" + mText.substr(mPosition) + "'");
+            }
+
+            std::optional<Operand> parseOperand() {
+                skipSpaces();
+                const size_t start = mPosition;
+                while (mPosition < mText.size() && std::isalnum(static_cast<unsigned char>(mText[mPosition])))
+                    ++mPosition;
+                std::string word = mText.substr(start, mPosition - start);
+                if (word.empty())
+                    return failOperand(atEnd() ? "missing operand at the end" : "expected an operand at '" + mText.substr(mPosition) + "'");
+                for (auto& c : word)
+                    c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+
+                if (word.size() == 2 && word[0] == 'V' && std::isxdigit(static_cast<unsigned char>(word[1]))) {
+                    const auto registerNumber = static_cast<uint8_t>(std::stoul(word.substr(1), nullptr, 16));
+                    return Operand([registerNumber](const Chip8& chip8) -> unsigned { return chip8.getRegister(registerNumber); });
+                }
+                if (word == "I")
+                    return Operand([](const Chip8& chip8) -> unsigned { return chip8.getAddressPointer(); });
+                if (word == "PC")
+                    return Operand([](const Chip8& chip8) -> unsigned { return chip8.getProgramCounter(); });
+                if (word == "DT")
+                    return Operand([](const Chip8& chip8) -> unsigned { return chip8.getDelayTimer(); });
+                if (word == "ST")
+                    return Operand([](const Chip8& chip8) -> unsigned { return chip8.getSoundTimer(); });
+
+                const bool hexadecimal = (word.size() > 2 && word[0] == '0' && word[1] == 'X');
+                const std::string digits = (hexadecimal ? word.substr(2) : word);
+                for (const char c : digits) {
+                    if (!(hexadecimal ? std::isxdigit(static_cast<unsigned char>(c)) : std::isdigit(static_cast<unsigned char>(c))))
+                        return failOperand("unknown operand '" + mText.substr(start, mPosition - start) + "'");
+                }
+                if (digits.size() > 5)
+                    return failOperand("number out of range '" + mText.substr(start, mPosition - start) + "'");
+                const auto value = static_cast<unsigned>(std::stoul(digits, nullptr, hexadecimal ? 16 : 10));
+                if (value > 0xFFFF)
+                    return failOperand("number out of range '" + mText.substr(start, mPosition - start) + "'");
+                return Operand([value](const Chip8&) { return value; });
+            }
+
+            bool accept(const char* token) {
+                skipSpaces();
+                const std::string expected = token;
+                if (mText.compare(mPosition, expected.size(), expected) != 0)
+                    return false;
+                mPosition += expected.size();
+                return true;
+            }
+
+            void skipSpaces() noexcept {
+                while (mPosition < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPosition])))
+                    ++mPosition;
+            }
+
+            bool atEnd() noexcept {
+                skipSpaces();
+                return mPosition == mText.size();
+            }
+
+            std::optional<Condition> fail(const std::string& message) {
+                mError = message;
+                return std::nullopt;
+            }
+
+            std::optional<Operand> failOperand(const std::string& message) {
+                mError = message;
+                return std::nullopt;
+            }
+
+        private:
+            const std::string& mText;
+            size_t mPosition;
+            std::string& mError;
+        };
+
+    }
+
+    std::optional<Condition> compileCondition(const std::string& text, std::string& error) {
+        return ConditionCompiler(text, error).compile();
+    }
+
+    Debugger::Debugger() noexcept
+        : mChip8(nullptr), mWatchedRegisters(0)
+    {}
+
+    void Debugger::attach(Chip8* chip8) noexcept {
+        if (mChip8)
+            mChip8->setDebugger(nullptr);
+        mChip8 = chip8;
+        updateAttachment();
+    }
+
+    bool Debugger::isEmpty() const noexcept {
+        return mBreakpoints.none() && mWatchedAddresses.none() && mWatchedRegisters == 0;
+    }
+
+    void Debugger::clear() noexcept {
+        mBreakpoints.reset();
+        mConditions.clear();
+        mWatchedAddresses.reset();
+        mWatchedRegisters = 0;
+        mStop.reset();
+        updateAttachment();
+    }
+
+    void Debugger::setBreakpoint(uint16_t address) {
+        mBreakpoints.set(address);
+        mConditions.erase(address);
+        updateAttachment();
+    }
+
+    bool Debugger::setBreakpoint(uint16_t address, const std::string& condition, std::string& error) {
+        if (address >= AddressCount) {
+            error = "address out of range";
+            return false;
+        }
+        if (condition.find_first_not_of(" \t") == std::string::npos) {
+            setBreakpoint(address);
+            return true;
+        }
+        auto compiled = compileCondition(condition, error);
+        if (!compiled)
+            return false;
+        mBreakpoints.set(address);
+        mConditions[address] = { condition, std::move(*compiled) };
+        updateAttachment();
+        return true;
+    }
+
+    void Debugger::removeBreakpoint(uint16_t address) {
+        mBreakpoints.reset(address);
+        mConditions.erase(address);
+        updateAttachment();
+    }
+
+    bool Debugger::hasBreakpoint(uint16_t address) const noexcept {
+        return address < AddressCount && mBreakpoints[address];
+    }
+
+    std::string Debugger::getCondition(uint16_t address) const {
+        const auto iterator = mConditions.find(address);
+        return (iterator != mConditions.end() ? iterator->second.text : std::string{});
+    }
+
+    std::vector<uint16_t> Debugger::getBreakpoints() const {
+        std::vector<uint16_t> result;
+        for (size_t address = 0; address < AddressCount; ++address) {
+            if (mBreakpoints[address])
+                result.push_back(static_cast<uint16_t>(address));
+        }
+        return result;
+    }
+
+    void Debugger::setMemoryWatch(uint16_t address, size_t count, bool watched) {
+        if (static_cast<size_t>(address) + count > AddressCount)
+            throw std::out_of_range("memory watch out of range");
+        for (size_t i = 0; i < count; ++i)
+            mWatchedAddresses[address + i] = watched;
+        updateAttachment();
+    }
+
+    bool Debugger::isMemoryWatched(uint16_t address) const noexcept {
+        return address < AddressCount && mWatchedAddresses[address];
+    }
+
+    void Debugger::setRegisterWatch(uint8_t registerNumber, bool watched) {
+        if (registerNumber > 0xF)
+            throw std::out_of_range("register out of range");
+        const auto bit = static_cast<uint16_t>(1u << registerNumber);
+        mWatchedRegisters = static_cast<uint16_t>(watched ? (mWatchedRegisters | bit) : (mWatchedRegisters & ~bit));
+        updateAttachment();
+    }
+
+    uint16_t Debugger::getRegisterWatchMask() const noexcept {
+        return mWatchedRegisters;
+    }
+
+    std::optional<Debugger::Stop> Debugger::takeStop() noexcept {
+        auto result = mStop;
+        mStop.reset();
+        return result;
+    }
+
+    void Debugger::checkInstruction(const Chip8& chip8, uint16_t address, uint16_t changedRegisters) {
+        const uint16_t watchedChanges = changedRegisters & mWatchedRegisters;
+        if (watchedChanges != 0) {
+            uint16_t registerNumber = 0;
+            while ((watchedChanges & (1u << registerNumber)) == 0)
+                ++registerNumber;
+            stop(StopReason::RegisterWatch, address, registerNumber, chip8.getCycleCount());
+        }
+        const uint16_t programCounter = chip8.getProgramCounter();
+        if (isBreakpointHit(chip8, programCounter))
+            stop(StopReason::Breakpoint, address, programCounter, chip8.getCycleCount());
+    }
+
+    bool Debugger::checkEntry(const Chip8& chip8) {
+        const uint16_t programCounter = chip8.getProgramCounter();
+        if (!isBreakpointHit(chip8, programCounter))
+            return false;
+        stop(StopReason::Breakpoint, programCounter, programCounter, chip8.getCycleCount());
+        return true;
+    }
+
+    void Debugger::checkMemoryWrite(const Chip8& chip8, uint16_t address, size_t count) noexcept {
+        for (size_t i = 0; i < count; ++i) {
+            const size_t target = (address + i) % AddressCount;
+            if (mWatchedAddresses[target]) {
+                // the program counter already points to the next instruction
+                stop(StopReason::MemoryWatch, static_cast<uint16_t>(chip8.getProgramCounter() - 2u),
+                    static_cast<uint16_t>(target), chip8.getCycleCount());
+                return;
+            }
+        }
+    }
+
+    bool Debugger::isBreakpointHit(const Chip8& chip8, uint16_t programCounter) const {
+        if (programCounter >= AddressCount || !mBreakpoints[programCounter])
+            return false;
+        const auto iterator = mConditions.find(programCounter);
+        return iterator == mConditions.end() || iterator->second.condition(chip8);
+    }
+
+    void Debugger::stop(StopReason reason, uint16_t address, uint16_t target, uint64_t cycle) noexcept {
+        if (!mStop)
+            mStop = Stop{ reason, address, target, cycle };
+    }
+
+    void Debugger::updateAttachment() noexcept {
+        if (mChip8)
+            mChip8->setDebugger(isEmpty() ? nullptr : this);
+    }
+
+}
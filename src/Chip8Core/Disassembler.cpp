@@ -0,0 +1,116 @@
+#include "Chip8Core/Disassembler.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "Chip8Core/Opcodes.hpp"
+
+namespace Chip8 {
+
+    std::string disassemble(Instruction instruction) {
+        const size_t opcodeIndex = getOpcodeIndex(instruction.getValue());
+        const unsigned x = instruction.getX();
+        const unsigned y = instruction.getY();
+        const unsigned nn = instruction.getNN();
+        const unsigned nnn = instruction.getNNN();
+        char text[32];
+        const auto format = [&text](const char* pattern, auto... arguments) {
+            std::snprintf(text, sizeof(text), pattern, arguments...);
+            return std::string(text);
+        };
+        if (opcodeIndex == Opcodes.size())
+            return format("DW 0x%04X", static_cast<unsigned>(instruction.getValue()));
+        switch (std::get<1>(Opcodes[opcodeIndex])) {
+            case 0x00E0: return "CLS";
+            case 0x00EE: return "RET";
+            case 0x0000: return format("SYS 0x%03X", nnn);
+            case 0x1000: return format("JP 0x%03X", nnn);
+            case 0x2000: return format("CALL 0x%03X", nnn);
+            case 0x3000: return format("SE V%X, 0x%02X", x, nn);
+            case 0x4000: return format("SNE V%X, 0x%02X", x, nn);
+            case 0x5000: return format("SE V%X, V%X", x, y);
+            case 0x6000: return format("LD V%X, 0x%02X", x, nn);
+            case 0x7000: return format("ADD V%X, 0x%02X", x, nn);
+            case 0x8000: return format("LD V%X, V%X", x, y);
+            case 0x8001: return format("OR V%X, V%X", x, y);
+            case 0x8002: return format("AND V%X, V%X", x, y);
+            case 0x8003: return format("XOR V%X, V%X", x, y);
+            case 0x8004: return format("ADD V%X, V%X", x, y);
+            case 0x8005: return format("SUB V%X, V%X", x, y);
+            case 0x8006: return format("SHR V%X, V%X", x, y);
+            case 0x8007: return format("SUBN V%X, V%X", x, y);
+            case 0x800E: return format("SHL V%X, V%X", x, y);
+            case 0x9000: return format("SNE V%X, V%X", x, y);
+            case 0xA000: return format("LD I, 0x%03X", nnn);
+            case 0xB000: return format("JP V0, 0x%03X", nnn);
+            case 0xC000: return format("RND V%X, 0x%02X", x, nn);
+            case 0xD000: return format("DRW V%X, V%X, %u", x, y, static_cast<unsigned>(instruction.getN()));
+            case 0xE09E: return format("SKP V%X", x);
+            case 0xE0A1: return format("SKNP V%X", x);
+            case 0xF007: return format("LD V%X, DT", x);
+            case 0xF00A: return format("LD V%X, K", x);
+            case 0xF015: return format("LD DT, V%X", x);
+            case 0xF018: return format("LD ST, V%X", x);
+            case 0xF01E: return format("ADD I, V%X", x);
+            case 0xF029: return format("LD F, V%X", x);
+            case 0xF033: return format("LD B, V%X", x);
+            case 0xF055: return format("LD [I], V%X", x);
+            case 0xF065: return format("LD V%X, [I]", x);
+        }
+        return format("DW 0x%04X", static_cast<unsigned>(instruction.getValue()));
+    }
+
+    DisassemblyListing::DisassemblyListing()
+        : mLines(AddressCount)
+    {}
+
+    size_t DisassemblyListing::update(const Chip8Memory<uint8_t>& memory) {
+        constexpr size_t pageSize = Chip8Memory<uint8_t>::PageSize;
+        std::vector<bool> changed(AddressCount, false);
+        for (size_t pageIndex = 0; pageIndex < mPages.size(); ++pageIndex) {
+            auto page = memory.getPage(pageIndex);
+            if (page == mPages[pageIndex])
+                continue;
+            for (size_t offset = 0; offset < pageSize; ++offset) {
+                if (!mPages[pageIndex] || (*mPages[pageIndex])[offset] != (*page)[offset])
+                    changed[pageIndex * pageSize + offset] = true;
+            }
+            mPages[pageIndex] = std::move(page);
+        }
+        size_t result = 0;
+        for (size_t address = 0; address < AddressCount; ++address) {
+            // a changed byte is the first byte of its own line and the second byte of the previous one
+            if (changed[address] || (address + 1 < AddressCount && changed[address + 1])) {
+                disassembleLine(address);
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    void DisassemblyListing::invalidate() noexcept {
+        mPages.fill(nullptr);
+    }
+
+    Instruction DisassemblyListing::getInstruction(uint16_t address) const {
+        if (address >= AddressCount)
+            throw std::out_of_range("address out of range");
+        return Instruction(readByte(address), readByte(address + 1u));
+    }
+
+    const std::string& DisassemblyListing::getLine(uint16_t address) const {
+        return mLines.at(address);
+    }
+
+    uint8_t DisassemblyListing::readByte(size_t address) const noexcept {
+        constexpr size_t pageSize = Chip8Memory<uint8_t>::PageSize;
+        if (address >= AddressCount || !mPages[address / pageSize])
+            return 0;
+        return (*mPages[address / pageSize])[address % pageSize];
+    }
+
+    void DisassemblyListing::disassembleLine(size_t address) {
+        mLines[address] = disassemble(getInstruction(static_cast<uint16_t>(address)));
+    }
+
+}
@@ -0,0 +1,129 @@
+#include "Chip8Core/Environment.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <gsl/gsl>
+
+#include "Chip8Core/ThreadPool.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        // the environments are stepped on other threads and reset over and over again, so they must not
+        // report to the recorder, history, profilers or debugger of the machine they have been copied from
+        void detachHooks(Chip8& machine) noexcept {
+            machine.setInputRecorder(nullptr);
+            machine.setExecutionHistory(nullptr);
+            machine.setProfiler(nullptr);
+            machine.setTracer(nullptr);
+            machine.setMemoryProfiler(nullptr);
+            machine.setDebugger(nullptr);
+        }
+
+    }
+
+    VectorEnvironment::VectorEnvironment(size_t environmentCount, const Chip8& initialMachine, size_t cyclesPerFrame,
+        ThreadPool* threadPool)
+        : mInitialMachine(initialMachine), mCyclesPerFrame(std::max<size_t>(cyclesPerFrame, 1)), mThreadPool(threadPool)
+        , mMachines(), mPressedKeys(environmentCount, 0x0), mEpisodes(environmentCount, 0)
+        , mFrameCounts(environmentCount, 0), mDone(environmentCount, 0x0), mCrashed(environmentCount, 0x0)
+    {
+        detachHooks(mInitialMachine);
+        mMachines.assign(environmentCount, mInitialMachine);
+    }
+
+    size_t VectorEnvironment::getEnvironmentCount() const noexcept {
+        return mMachines.size();
+    }
+
+    size_t VectorEnvironment::getObservationBufferSize() const noexcept {
+        return mMachines.size() * ObservationSize;
+    }
+
+    void VectorEnvironment::reset(uint8_t* observations) {
+        for (size_t i = 0; i < mMachines.size(); ++i)
+            resetEnvironment(i, observations);
+    }
+
+    void VectorEnvironment::reset(const std::vector<size_t>& environments, uint8_t* observations) {
+        for (const auto environment : environments)
+            resetEnvironment(environment, observations);
+    }
+
+    void VectorEnvironment::step(const uint16_t* actions, size_t frameSkip, uint8_t* observations, EnvironmentInfo* infos) {
+        if (mThreadPool) {
+            mThreadPool->parallelFor(mMachines.size(), [&](size_t environment) {
+                stepEnvironment(environment, actions[environment], frameSkip, observations, infos);
+            });
+        } else {
+            for (size_t environment = 0; environment < mMachines.size(); ++environment)
+                stepEnvironment(environment, actions[environment], frameSkip, observations, infos);
+        }
+    }
+
+    const Chip8& VectorEnvironment::getMachine(size_t environment) const noexcept {
+        return mMachines[environment];
+    }
+
+    void VectorEnvironment::resetEnvironment(size_t environment, uint8_t* observations) {
+        Expects(environment < mMachines.size());
+        auto& machine = mMachines[environment];
+        machine = mInitialMachine; // only shares the memory pages
+        // every environment and every episode gets its own, reproducible random numbers
+        machine.seedRandom(mInitialMachine.getRandomSeed() + (mEpisodes[environment]++ << 32) + environment);
+        mPressedKeys[environment] = gsl::narrow_cast<uint16_t>(0x0);
+        mFrameCounts[environment] = 0;
+        mDone[environment] = 0x0;
+        mCrashed[environment] = 0x0;
+        const auto& display = machine.getPackedDisplay();
+        std::copy(display.begin(), display.end(), observations + environment * ObservationSize);
+    }
+
+    void VectorEnvironment::stepEnvironment(size_t environment, uint16_t action, size_t frameSkip, uint8_t* observations,
+        EnvironmentInfo* infos) {
+        auto& machine = mMachines[environment];
+        if (!mDone[environment]) {
+            // only the keys whose state changed generate events, as they would on a real keyboard
+            const uint16_t changedKeys = action ^ mPressedKeys[environment];
+            for (uint8_t key = 0x0; key <= 0xF; ++key) {
+                if (!(changedKeys & (0x1 << key)))
+                    continue;
+                if (action & (0x1 << key))
+                    machine.triggerKeyDown(key);
+                else
+                    machine.triggerKeyUp(key);
+            }
+            mPressedKeys[environment] = action;
+
+            try {
+                for (size_t frame = 0; frame < frameSkip && !mDone[environment]; ++frame) {
+                    for (size_t cycle = 0; cycle < mCyclesPerFrame; ++cycle) {
+                        if (!machine.step()) {
+                            mDone[environment] = 0x1;
+                            break;
+                        }
+                    }
+                    machine.clockTimers();
+                    ++mFrameCounts[environment];
+                }
+            } catch (const std::exception&) {
+                mDone[environment] = 0x1;
+                mCrashed[environment] = 0x1;
+            }
+            const auto& display = machine.getPackedDisplay();
+            std::copy(display.begin(), display.end(), observations + environment * ObservationSize);
+        }
+
+        if (infos) {
+            auto& info = infos[environment];
+            info.done = (mDone[environment] != 0x0);
+            info.crashed = (mCrashed[environment] != 0x0);
+            info.soundTimer = machine.getSoundTimer();
+            info.cycleCount = machine.getCycleCount();
+            info.frameCount = mFrameCounts[environment];
+        }
+    }
+
+}
@@ -0,0 +1,241 @@
+#include "Chip8Core/ExecutionHistory.hpp"
+
+#include <algorithm>
+
+#include <gsl/gsl>
+
+#include "Chip8Core/Debugger.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        // detaches the hooks of the emulator while instructions are re-executed: they have already seen these
+        // instructions and events, so the input movie, the profilers and the tracer would record them twice
+        class ReplayScope {
+        public:
+            ReplayScope(Chip8& chip8, Debugger* debugger, bool& replaying) noexcept
+                : mChip8(chip8), mInputRecorder(chip8.getInputRecorder()), mProfiler(chip8.getProfiler())
+                , mTracer(chip8.getTracer()), mMemoryProfiler(chip8.getMemoryProfiler()), mDebugger(chip8.getDebugger())
+                , mReplaying(replaying)
+            {
+                mChip8.setInputRecorder(nullptr);
+                mChip8.setProfiler(nullptr);
+                mChip8.setTracer(nullptr);
+                mChip8.setMemoryProfiler(nullptr);
+                mChip8.setDebugger(debugger);
+                mReplaying = true;
+            }
+
+            ~ReplayScope() {
+                mReplaying = false;
+                mChip8.setInputRecorder(mInputRecorder);
+                mChip8.setProfiler(mProfiler);
+                mChip8.setTracer(mTracer);
+                mChip8.setMemoryProfiler(mMemoryProfiler);
+                mChip8.setDebugger(mDebugger);
+            }
+
+            ReplayScope(const ReplayScope&) = delete;
+            ReplayScope& operator=(const ReplayScope&) = delete;
+
+        private:
+            Chip8& mChip8;
+            InputMovie* mInputRecorder;
+            Profiler* mProfiler;
+            InstructionTracer* mTracer;
+            MemoryProfiler* mMemoryProfiler;
+            Debugger* mDebugger;
+            bool& mReplaying;
+        };
+
+    }
+
+    ExecutionHistory::ExecutionHistory(size_t memoryBudget, uint64_t checkpointInterval)
+        : mStates(memoryBudget), mFirstEventIndex(0), mMemoryBudget(memoryBudget), mCheckpointInterval(std::max<uint64_t>(checkpointInterval, 1u))
+        , mReplaying(false)
+    {}
+
+    void ExecutionHistory::start(Chip8& chip8) {
+        mCheckpoints.clear();
+        mStates.clear();
+        mEvents.clear();
+        mFirstEventIndex = 0;
+        pushCheckpoint(chip8);
+        chip8.setExecutionHistory(this);
+    }
+
+    void ExecutionHistory::stop(Chip8& chip8) noexcept {
+        chip8.setExecutionHistory(nullptr);
+        mCheckpoints.clear();
+        mStates.clear();
+        mEvents.clear();
+        mFirstEventIndex = 0;
+    }
+
+    void ExecutionHistory::update(const Chip8& chip8) {
+        if (mCheckpoints.empty() || chip8.getCycleCount() < mCheckpoints.back().cycle + mCheckpointInterval)
+            return;
+        pushCheckpoint(chip8);
+        enforceMemoryBudget();
+    }
+
+    void ExecutionHistory::recordEvent(const InputMovie::Event& event) {
+        if (mReplaying || mCheckpoints.empty())
+            return;
+        mEvents.push_back(event);
+        if (getMemoryUsage() > mMemoryBudget)
+            enforceMemoryBudget();
+    }
+
+    bool ExecutionHistory::seek(Chip8& chip8, uint64_t cycle) {
+        if (mCheckpoints.empty() || cycle < mCheckpoints.front().cycle || cycle > chip8.getCycleCount())
+            return false;
+        const uint64_t eventIndex = replay(chip8, findCheckpoint(cycle), cycle);
+        truncate(cycle, eventIndex);
+        return true;
+    }
+
+    bool ExecutionHistory::stepBack(Chip8& chip8) {
+        return chip8.getCycleCount() > 0 && seek(chip8, chip8.getCycleCount() - 1);
+    }
+
+    bool ExecutionHistory::reverseContinue(Chip8& chip8, Debugger& debugger) {
+        if (chip8.getCycleCount() == 0)
+            return false;
+        // the stop that led to the current state does not count
+        uint64_t stopCycle;
+        if (!findLastStop(chip8, debugger, chip8.getCycleCount() - 1, stopCycle))
+            return false;
+        return seek(chip8, stopCycle);
+    }
+
+    bool ExecutionHistory::runBackToLastWrite(Chip8& chip8, uint16_t address) {
+        Debugger debugger;
+        debugger.setMemoryWatch(address, 1, true);
+        uint64_t stopCycle;
+        if (!findLastStop(chip8, debugger, chip8.getCycleCount(), stopCycle))
+            return false;
+        return seek(chip8, stopCycle - 1);
+    }
+
+    uint64_t ExecutionHistory::getFirstCycle() const noexcept {
+        return (mCheckpoints.empty() ? 0 : mCheckpoints.front().cycle);
+    }
+
+    size_t ExecutionHistory::getCheckpointCount() const noexcept {
+        return mCheckpoints.size();
+    }
+
+    size_t ExecutionHistory::getMemoryUsage() const noexcept {
+        return mStates.getMemoryUsage() + mCheckpoints.size() * sizeof(Checkpoint) + mEvents.size() * sizeof(InputMovie::Event);
+    }
+
+    size_t ExecutionHistory::findCheckpoint(uint64_t cycle) const noexcept {
+        const auto next = std::upper_bound(mCheckpoints.begin(), mCheckpoints.end(), cycle,
+            [](uint64_t value, const Checkpoint& checkpoint) { return value < checkpoint.cycle; });
+        return static_cast<size_t>(next - mCheckpoints.begin()) - 1;
+    }
+
+    uint64_t ExecutionHistory::replay(Chip8& chip8, size_t checkpointIndex, uint64_t cycle) {
+        mStates.restore(checkpointIndex, chip8);
+        uint64_t eventIndex = mCheckpoints[checkpointIndex].eventIndex;
+        // without any hook the fast path is taken
+        const ReplayScope scope(chip8, nullptr, mReplaying);
+        while (chip8.getCycleCount() < cycle) {
+            applyEvents(chip8, eventIndex);
+            chip8.step();
+        }
+        return eventIndex;
+    }
+
+    void ExecutionHistory::pushCheckpoint(const Chip8& chip8) {
+        mCheckpoints.push_back({ chip8.getCycleCount(), mFirstEventIndex + mEvents.size() });
+        mStates.push(chip8);
+        // the buffer drops its oldest frames by itself when they exceed its budget
+        while (mCheckpoints.size() > mStates.size())
+            mCheckpoints.pop_front();
+    }
+
+    void ExecutionHistory::applyEvents(Chip8& chip8, uint64_t& eventIndex) const noexcept {
+        while (eventIndex < mFirstEventIndex + mEvents.size()) {
+            const auto& event = mEvents[static_cast<size_t>(eventIndex - mFirstEventIndex)];
+            if (event.cycle > chip8.getCycleCount())
+                break;
+            switch (event.type) {
+                case InputMovie::EventType::KeyDown:
+                    chip8.triggerKeyDown(event.key);
+                    break;
+                case InputMovie::EventType::KeyUp:
+                    chip8.triggerKeyUp(event.key);
+                    break;
+                case InputMovie::EventType::ClockTimers:
+                    chip8.clockTimers();
+                    break;
+            }
+            ++eventIndex;
+        }
+    }
+
+    bool ExecutionHistory::findLastStop(Chip8& chip8, Debugger& debugger, uint64_t lastCycle, uint64_t& stopCycle) {
+        if (mCheckpoints.empty())
+            return false;
+        Chip8::State currentState;
+        chip8.saveState(currentState);
+        const uint64_t currentCycle = chip8.getCycleCount();
+        const ReplayScope scope(chip8, &debugger, mReplaying);
+        debugger.takeStop();
+
+        // re-executes the intervals between the checkpoints from the newest to the oldest, the last stop
+        // of the first interval that has one is the result
+        bool found = false;
+        for (size_t index = mCheckpoints.size(); index-- > 0 && !found;) {
+            if (mCheckpoints[index].cycle >= lastCycle)
+                continue;
+            const uint64_t end = std::min(lastCycle, (index + 1 < mCheckpoints.size() ? mCheckpoints[index + 1].cycle : currentCycle));
+            mStates.restore(index, chip8);
+            uint64_t eventIndex = mCheckpoints[index].eventIndex;
+            while (chip8.getCycleCount() < end) {
+                applyEvents(chip8, eventIndex);
+                chip8.step();
+                if (const auto stop = debugger.takeStop()) {
+                    stopCycle = stop->cycle;
+                    found = true;
+                }
+            }
+        }
+
+        if (!found) {
+            // the next checkpoint would discard the frames after the restored ones
+            mStates.restore(mStates.size() - 1, chip8);
+            chip8.loadState(currentState);
+        }
+        return found;
+    }
+
+    void ExecutionHistory::truncate(uint64_t cycle, uint64_t eventIndex) {
+        // replay() has restored the newest checkpoint that is kept
+        while (mCheckpoints.size() > 1 && (mCheckpoints.back().cycle > cycle
+            || (mCheckpoints.back().cycle == cycle && mCheckpoints.back().eventIndex > eventIndex)))
+            mCheckpoints.pop_back();
+        mStates.truncateAfterPosition();
+        Ensures(mCheckpoints.size() == mStates.size());
+        while (!mEvents.empty() && mFirstEventIndex + mEvents.size() > eventIndex)
+            mEvents.pop_back();
+    }
+
+    void ExecutionHistory::enforceMemoryBudget() {
+        // the states get what the input and the checkpoint list leave of the budget; the buffer drops whole
+        // keyframe groups, but always keeps the newest one
+        const size_t otherUsage = mCheckpoints.size() * sizeof(Checkpoint) + mEvents.size() * sizeof(InputMovie::Event);
+        mStates.setMemoryBudget(mMemoryBudget > otherUsage ? mMemoryBudget - otherUsage : 0);
+        while (mCheckpoints.size() > mStates.size())
+            mCheckpoints.pop_front();
+        // the events before the oldest checkpoint cannot be replayed anymore
+        while (!mEvents.empty() && mFirstEventIndex < mCheckpoints.front().eventIndex) {
+            mEvents.pop_front();
+            ++mFirstEventIndex;
+        }
+    }
+
+}
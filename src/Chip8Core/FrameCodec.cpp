@@ -0,0 +1,199 @@
+#include "Chip8Core/FrameCodec.hpp"
+
+#include <algorithm>
+#include <gsl/gsl>
+
+namespace Chip8 {
+
+    namespace {
+
+        // runs shorter than this are stored as literals, since a run costs two bytes
+        constexpr size_t MinimumRunLength = 3;
+        constexpr size_t MaximumRunLength = 128;
+
+        size_t getRunLength(const uint8_t* data, size_t size, size_t index) noexcept {
+            size_t length = 1;
+            while (index + length < size && length < MaximumRunLength && data[index + length] == data[index])
+                ++length;
+            return length;
+        }
+
+        template<typename T>
+        void writeLittleEndian(T value, std::vector<uint8_t>& output) {
+            for (size_t i = 0; i < sizeof(T); ++i)
+                output.push_back(gsl::narrow_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+
+        template<typename T>
+        T readLittleEndian(const uint8_t* data) noexcept {
+            uint64_t value = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+                value |= static_cast<uint64_t>(data[i]) << (8 * i);
+            return static_cast<T>(value);
+        }
+
+    }
+
+    void encodeRle(const uint8_t* data, size_t size, std::vector<uint8_t>& output) {
+        size_t index = 0;
+        while (index < size) {
+            const size_t runLength = getRunLength(data, size, index);
+            if (runLength >= MinimumRunLength) {
+                output.push_back(gsl::narrow_cast<uint8_t>(257 - runLength));
+                output.push_back(data[index]);
+                index += runLength;
+                continue;
+            }
+            // collect literals until the next run that is worth encoding
+            size_t end = index + runLength;
+            while (end < size && end - index < MaximumRunLength && getRunLength(data, size, end) < MinimumRunLength)
+                ++end;
+            end = std::min(end, index + MaximumRunLength);
+            output.push_back(gsl::narrow_cast<uint8_t>(end - index - 1));
+            output.insert(output.end(), data + index, data + end);
+            index = end;
+        }
+    }
+
+    bool decodeRle(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize) noexcept {
+        size_t in = 0;
+        size_t out = 0;
+        while (in < size) {
+            const uint8_t control = data[in++];
+            if (control < 128) {
+                const size_t count = control + 1u;
+                if (in + count > size || out + count > outputSize)
+                    return false;
+                std::copy(data + in, data + in + count, output + out);
+                in += count;
+                out += count;
+            } else if (control > 128) {
+                const size_t count = 257u - control;
+                if (in >= size || out + count > outputSize)
+                    return false;
+                std::fill(output + out, output + out + count, data[in++]);
+                out += count;
+            }
+        }
+        return out == outputSize;
+    }
+
+    void encodeKeyEvent(const StreamKeyEvent& event, std::vector<uint8_t>& output) {
+        output.push_back(static_cast<uint8_t>(StreamMessageType::KeyEvent));
+        output.push_back(event.key);
+        output.push_back(event.pressed ? 1 : 0);
+        writeLittleEndian(event.time, output);
+    }
+
+    std::optional<StreamKeyEvent> decodeKeyEvent(const uint8_t* message, size_t size) noexcept {
+        if (size != StreamKeyEventSize || message[0] != static_cast<uint8_t>(StreamMessageType::KeyEvent)
+            || message[1] > 0xF || message[2] > 1)
+            return {};
+        return StreamKeyEvent{ message[1], message[2] != 0, readLittleEndian<int64_t>(message + 3) };
+    }
+
+    FrameEncoder::FrameEncoder(uint32_t keyframeInterval) noexcept
+        : mPrevious{}, mKeyframeInterval(keyframeInterval), mFramesSinceKeyframe(0), mSequence(0), mKeyframeRequested(true)
+    { }
+
+    bool FrameEncoder::encode(const Chip8::PackedDisplay& display, int64_t inputEcho, std::vector<uint8_t>& output) {
+        const bool keyframe = mKeyframeRequested || (mKeyframeInterval > 0 && mFramesSinceKeyframe >= mKeyframeInterval);
+        uint32_t dirtyRows = 0;
+        for (size_t row = 0; row < Chip8::DisplayHeight; ++row) {
+            const size_t offset = row * StreamRowSize;
+            if (keyframe || !std::equal(display.begin() + offset, display.begin() + offset + StreamRowSize, mPrevious.begin() + offset))
+                dirtyRows |= (1u << row);
+        }
+
+        output.push_back(static_cast<uint8_t>(keyframe ? StreamMessageType::Keyframe : StreamMessageType::Delta));
+        writeLittleEndian(mSequence, output);
+        writeLittleEndian(inputEcho, output);
+        writeLittleEndian(dirtyRows, output);
+        // the dirty rows are encoded as one block, so runs can span row boundaries
+        std::array<uint8_t, sizeof(Chip8::PackedDisplay)> rows;
+        size_t rowsSize = 0;
+        for (size_t row = 0; row < Chip8::DisplayHeight; ++row) {
+            if (dirtyRows & (1u << row)) {
+                std::copy_n(display.begin() + row * StreamRowSize, StreamRowSize, rows.begin() + rowsSize);
+                rowsSize += StreamRowSize;
+            }
+        }
+        encodeRle(rows.data(), rowsSize, output);
+
+        mPrevious = display;
+        mFramesSinceKeyframe = (keyframe ? 1 : mFramesSinceKeyframe + 1);
+        mKeyframeRequested = false;
+        ++mSequence;
+        return keyframe;
+    }
+
+    void FrameEncoder::requestKeyframe() noexcept {
+        mKeyframeRequested = true;
+    }
+
+    uint32_t FrameEncoder::getSequence() const noexcept {
+        return mSequence;
+    }
+
+    FrameDecoder::FrameDecoder() noexcept
+        : mDisplay{}, mSequence(0), mInputEcho(0), mLastFrameType(StreamMessageType::Keyframe), mSynchronized(false)
+    { }
+
+    bool FrameDecoder::decode(const uint8_t* message, size_t size) noexcept {
+        if (size < StreamFrameHeaderSize)
+            return false;
+        const auto type = static_cast<StreamMessageType>(message[0]);
+        if (type != StreamMessageType::Keyframe && type != StreamMessageType::Delta)
+            return false;
+        const auto sequence = readLittleEndian<uint32_t>(message + 1);
+        const auto inputEcho = readLittleEndian<int64_t>(message + 5);
+        const auto dirtyRows = readLittleEndian<uint32_t>(message + 13);
+        if (type == StreamMessageType::Delta && (!mSynchronized || sequence != mSequence + 1)) {
+            mSynchronized = false;
+            return false;
+        }
+
+        size_t rowCount = 0;
+        for (size_t row = 0; row < Chip8::DisplayHeight; ++row)
+            rowCount += ((dirtyRows >> row) & 1u);
+        if ((dirtyRows >> (Chip8::DisplayHeight - 1) >> 1) != 0 || (type == StreamMessageType::Keyframe && rowCount != Chip8::DisplayHeight))
+            return false;
+        std::array<uint8_t, sizeof(Chip8::PackedDisplay)> rows;
+        if (!decodeRle(message + StreamFrameHeaderSize, size - StreamFrameHeaderSize, rows.data(), rowCount * StreamRowSize))
+            return false;
+
+        size_t offset = 0;
+        for (size_t row = 0; row < Chip8::DisplayHeight; ++row) {
+            if (dirtyRows & (1u << row)) {
+                std::copy_n(rows.begin() + offset, StreamRowSize, mDisplay.begin() + row * StreamRowSize);
+                offset += StreamRowSize;
+            }
+        }
+        mSequence = sequence;
+        mInputEcho = inputEcho;
+        mLastFrameType = type;
+        mSynchronized = true;
+        return true;
+    }
+
+    bool FrameDecoder::isSynchronized() const noexcept {
+        return mSynchronized;
+    }
+
+    const Chip8::PackedDisplay& FrameDecoder::getDisplay() const noexcept {
+        return mDisplay;
+    }
+
+    uint32_t FrameDecoder::getSequence() const noexcept {
+        return mSequence;
+    }
+
+    int64_t FrameDecoder::getInputEcho() const noexcept {
+        return mInputEcho;
+    }
+
+    StreamMessageType FrameDecoder::getLastFrameType() const noexcept {
+        return mLastFrameType;
+    }
+
+}
@@ -0,0 +1,90 @@
+#include "Chip8Core/Hash.hpp"
+
+#include <cstring>
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr uint32_t rotateLeft(uint32_t value, int bits) noexcept {
+            return (value << bits) | (value >> (32 - bits));
+        }
+
+        void processBlock(const uint8_t* block, std::array<uint32_t, 5>& state) noexcept {
+            std::array<uint32_t, 80> words;
+            for (size_t i = 0; i < 16; ++i)
+                words[i] = (uint32_t{ block[4 * i] } << 24) | (uint32_t{ block[4 * i + 1] } << 16)
+                    | (uint32_t{ block[4 * i + 2] } << 8) | uint32_t{ block[4 * i + 3] };
+            for (size_t i = 16; i < 80; ++i)
+                words[i] = rotateLeft(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+            for (size_t i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                } else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                } else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                const uint32_t temp = rotateLeft(a, 5) + f + e + k + words[i];
+                e = d;
+                d = c;
+                c = rotateLeft(b, 30);
+                b = a;
+                a = temp;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        }
+
+    }
+
+    Sha1Digest sha1(const void* data, size_t size) noexcept {
+        std::array<uint32_t, 5> state = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        const size_t fullBlocks = size / 64;
+        for (size_t i = 0; i < fullBlocks; ++i)
+            processBlock(bytes + 64 * i, state);
+
+        // padding: a single one bit, zeros and the length in bits (big endian) in the last 8 bytes
+        std::array<uint8_t, 128> tail{};
+        const size_t remainder = size % 64;
+        if (remainder > 0)
+            std::memcpy(tail.data(), bytes + 64 * fullBlocks, remainder);
+        tail[remainder] = 0x80;
+        const size_t tailSize = (remainder < 56 ? 64 : 128);
+        const uint64_t bitCount = static_cast<uint64_t>(size) * 8;
+        for (size_t i = 0; i < 8; ++i)
+            tail[tailSize - 1 - i] = static_cast<uint8_t>(bitCount >> (8 * i));
+        for (size_t offset = 0; offset < tailSize; offset += 64)
+            processBlock(tail.data() + offset, state);
+
+        Sha1Digest digest;
+        for (size_t i = 0; i < 20; ++i)
+            digest[i] = static_cast<uint8_t>(state[i / 4] >> (24 - 8 * (i % 4)));
+        return digest;
+    }
+
+    std::string toHexString(const Sha1Digest& digest) {
+        constexpr char digits[] = "0123456789abcdef";
+        std::string result;
+        result.reserve(2 * digest.size());
+        for (const uint8_t byte : digest) {
+            result += digits[byte >> 4];
+            result += digits[byte & 0xF];
+        }
+        return result;
+    }
+
+}
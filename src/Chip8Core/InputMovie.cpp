@@ -0,0 +1,183 @@
+#include "Chip8Core/InputMovie.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <gsl/gsl>
+
+namespace Chip8 {
+
+    namespace {
+
+        // file layout: magic | version | initial state | event count | events
+        // every event is stored as: cycle delta to the previous event (varint) | type | key
+        constexpr char Magic[4] = { 'C', '8', 'M', 'V' };
+        constexpr uint8_t Version = 1;
+
+        void writeVarint(std::vector<char>& buffer, uint64_t value) {
+            while (value >= 0x80) {
+                buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<char>(value));
+        }
+
+        bool readVarint(const std::vector<char>& buffer, size_t& position, uint64_t& value) noexcept {
+            value = 0;
+            for (unsigned shift = 0; position < buffer.size() && shift < 64; shift += 7) {
+                const auto byte = static_cast<uint8_t>(buffer[position++]);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0x0)
+                    return true;
+            }
+            return false;
+        }
+
+    }
+
+    void InputMovie::startRecording(Chip8& chip8) {
+        mEvents.clear();
+        mDrivesTimers = false;
+        chip8.saveState(mInitialState);
+        chip8.setInputRecorder(this);
+    }
+
+    void InputMovie::stopRecording(Chip8& chip8) noexcept {
+        chip8.setInputRecorder(nullptr);
+    }
+
+    void InputMovie::recordEvent(const Event& event) {
+        // an event from the past means that the emulator has been rewound, so the recorded future is obsolete
+        while (!mEvents.empty() && mEvents.back().cycle > event.cycle)
+            mEvents.pop_back();
+        if (event.type == EventType::ClockTimers)
+            mDrivesTimers = true;
+        mEvents.push_back(event);
+    }
+
+    const std::vector<InputMovie::Event>& InputMovie::getEvents() const noexcept {
+        return mEvents;
+    }
+
+    const Chip8::State& InputMovie::getInitialState() const noexcept {
+        return mInitialState;
+    }
+
+    bool InputMovie::drivesTimers() const noexcept {
+        return mDrivesTimers;
+    }
+
+    bool InputMovie::save(const std::string& filename) const {
+        std::vector<char> buffer(std::begin(Magic), std::end(Magic));
+        buffer.push_back(static_cast<char>(Version));
+        buffer.insert(buffer.end(), mInitialState.begin(), mInitialState.end());
+        writeVarint(buffer, mEvents.size());
+        uint64_t previousCycle = 0;
+        for (const auto& event : mEvents) {
+            writeVarint(buffer, event.cycle - previousCycle);
+            buffer.push_back(static_cast<char>(event.type));
+            buffer.push_back(static_cast<char>(event.key));
+            previousCycle = event.cycle;
+        }
+
+        std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.good())
+            return false;
+        file.write(buffer.data(), gsl::narrow<std::streamsize>(buffer.size()));
+        return file.good();
+    }
+
+    bool InputMovie::load(const std::string& filename, std::string& error) {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        if (!file.good()) {
+            error = "could not read " + filename;
+            return false;
+        }
+        const std::vector<char> buffer{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+        constexpr size_t headerSize = sizeof(Magic) + 1u + Chip8::StateSize;
+        if (buffer.size() < headerSize || !std::equal(std::begin(Magic), std::end(Magic), buffer.begin())) {
+            error = "not a movie file";
+            return false;
+        }
+        if (static_cast<uint8_t>(buffer[sizeof(Magic)]) != Version) {
+            error = "unsupported version";
+            return false;
+        }
+        Chip8::State initialState;
+        std::transform(buffer.begin() + sizeof(Magic) + 1, buffer.begin() + headerSize, initialState.begin(),
+            [](char c) noexcept { return static_cast<uint8_t>(c); });
+
+        size_t position = headerSize;
+        uint64_t eventCount = 0;
+        if (!readVarint(buffer, position, eventCount)) {
+            error = "unexpected end of file";
+            return false;
+        }
+        std::vector<Event> events;
+        bool drivesTimers = false;
+        uint64_t cycle = 0;
+        for (uint64_t i = 0; i < eventCount; ++i) {
+            uint64_t cycleDelta = 0;
+            if (!readVarint(buffer, position, cycleDelta) || position + 2 > buffer.size()) {
+                error = "unexpected end of file";
+                return false;
+            }
+            const auto type = static_cast<uint8_t>(buffer[position++]);
+            const auto key = static_cast<uint8_t>(buffer[position++]);
+            if (type > static_cast<uint8_t>(EventType::ClockTimers) || key > 0xF) {
+                error = "invalid event";
+                return false;
+            }
+            cycle += cycleDelta;
+            events.push_back({ cycle, static_cast<EventType>(type), key });
+            drivesTimers = drivesTimers || (events.back().type == EventType::ClockTimers);
+        }
+
+        mInitialState = initialState;
+        mEvents = std::move(events);
+        mDrivesTimers = drivesTimers;
+        return true;
+    }
+
+    MoviePlayer::MoviePlayer(const InputMovie& movie) noexcept
+        : mMovie(movie), mNextEvent(0)
+    {}
+
+    void MoviePlayer::start(Chip8& chip8) {
+        chip8.loadState(mMovie.getInitialState());
+        mNextEvent = 0;
+    }
+
+    void MoviePlayer::applyEvents(Chip8& chip8) noexcept {
+        const auto& events = mMovie.getEvents();
+        while (mNextEvent < events.size() && events[mNextEvent].cycle <= chip8.getCycleCount()) {
+            const auto& event = events[mNextEvent++];
+            switch (event.type) {
+                case InputMovie::EventType::KeyDown:
+                    chip8.triggerKeyDown(event.key);
+                    break;
+                case InputMovie::EventType::KeyUp:
+                    chip8.triggerKeyUp(event.key);
+                    break;
+                case InputMovie::EventType::ClockTimers:
+                    chip8.clockTimers();
+                    break;
+            }
+        }
+    }
+
+    bool MoviePlayer::step(Chip8& chip8) {
+        applyEvents(chip8);
+        return chip8.step();
+    }
+
+    bool MoviePlayer::isFinished() const noexcept {
+        return mNextEvent >= mMovie.getEvents().size();
+    }
+
+    const InputMovie& MoviePlayer::getMovie() const noexcept {
+        return mMovie;
+    }
+
+}
@@ -0,0 +1,55 @@
+#include "Chip8Core/InputQueue.hpp"
+
+#include <algorithm>
+#include <bitset>
+
+namespace Chip8 {
+
+    void InputQueue::push(double time, uint8_t key, bool pressed) {
+        // the events usually arrive in order, so this is an append
+        const auto position = std::upper_bound(mEvents.begin(), mEvents.end(), time,
+            [](double value, const Event& event) { return value < event.time; });
+        mEvents.insert(position, Event{ time, static_cast<uint8_t>(key & 0xF), pressed });
+    }
+
+    size_t InputQueue::apply(Chip8& chip8, double time) {
+        std::bitset<0x10> pressedKeys;
+        size_t result = 0;
+        while (!mEvents.empty() && mEvents.front().time <= time) {
+            const auto event = mEvents.front();
+            if (event.pressed) {
+                chip8.triggerKeyDown(event.key);
+                pressedKeys.set(event.key);
+            } else {
+                if (pressedKeys[event.key])
+                    break;
+                chip8.triggerKeyUp(event.key);
+            }
+            mEvents.pop_front();
+            ++result;
+        }
+        return result;
+    }
+
+    size_t InputQueue::flush(Chip8& chip8) {
+        size_t result = 0;
+        for (const auto& event : mEvents) {
+            if (event.pressed)
+                chip8.triggerKeyDown(event.key);
+            else
+                chip8.triggerKeyUp(event.key);
+            ++result;
+        }
+        mEvents.clear();
+        return result;
+    }
+
+    void InputQueue::clear() noexcept {
+        mEvents.clear();
+    }
+
+    size_t InputQueue::size() const noexcept {
+        return mEvents.size();
+    }
+
+}
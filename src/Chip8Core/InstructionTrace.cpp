@@ -0,0 +1,280 @@
+#include "Chip8Core/InstructionTrace.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <gsl/gsl>
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr uint8_t TraceVersion = 1;
+        constexpr size_t BlockHeaderSize = 8;
+        constexpr size_t MinimumEncodedRecordSize = 3; // flags and instruction
+        constexpr size_t MaximumEncodedRecordSize = 19; // with a cycle delta of ten bytes, address, I, register and value
+
+        // flags of an encoded record
+        constexpr uint8_t CycleFlag = 0x01; // the cycle delta follows (otherwise it is 1)
+        constexpr uint8_t AddressFlag = 0x02; // the address follows (otherwise it is the predicted one)
+        constexpr uint8_t AddressRegisterFlag = 0x04; // I follows (otherwise it is unchanged)
+        constexpr uint8_t RegisterFlag = 0x08; // the changed register and its value follow
+
+        void writeWord(std::vector<uint8_t>& output, uint16_t value) {
+            output.push_back(gsl::narrow_cast<uint8_t>(value));
+            output.push_back(gsl::narrow_cast<uint8_t>(value >> 8));
+        }
+
+        void writeLong(std::vector<uint8_t>& output, uint32_t value) {
+            for (int shift = 0; shift < 32; shift += 8)
+                output.push_back(gsl::narrow_cast<uint8_t>(value >> shift));
+        }
+
+        void writeVarint(std::vector<uint8_t>& output, uint64_t value) {
+            while (value >= 0x80) {
+                output.push_back(gsl::narrow_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            output.push_back(gsl::narrow_cast<uint8_t>(value));
+        }
+
+        // the address of the instruction after the given one, unless it skips or returns
+        uint16_t predictAddress(const TraceRecord& previous) noexcept {
+            const uint16_t group = previous.instruction & 0xF000;
+            if (group == 0x1000 || group == 0x2000)
+                return previous.instruction & 0x0FFF;
+            return gsl::narrow_cast<uint16_t>(previous.address + 2);
+        }
+
+        uint32_t readLong(const uint8_t* data) noexcept {
+            return data[0] | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+        }
+
+    }
+
+    bool operator==(const TraceRecord& lhs, const TraceRecord& rhs) noexcept {
+        return lhs.cycle == rhs.cycle && lhs.address == rhs.address && lhs.instruction == rhs.instruction
+            && lhs.addressRegister == rhs.addressRegister && lhs.changedRegister == rhs.changedRegister && lhs.value == rhs.value;
+    }
+
+    bool operator!=(const TraceRecord& lhs, const TraceRecord& rhs) noexcept {
+        return !(lhs == rhs);
+    }
+
+    void encodeTraceBlock(const TraceRecord* records, size_t count, std::vector<uint8_t>& output) {
+        const size_t headerPosition = output.size();
+        output.resize(output.size() + BlockHeaderSize);
+        TraceRecord previous{ 0, 0, 0, 0, TraceRecord::NoRegister, 0 };
+        bool first = true;
+        for (size_t i = 0; i < count; ++i) {
+            const auto& record = records[i];
+            uint8_t flags = 0;
+            if (first || record.cycle != previous.cycle + 1)
+                flags |= CycleFlag;
+            if (first || record.address != predictAddress(previous))
+                flags |= AddressFlag;
+            if (first || record.addressRegister != previous.addressRegister)
+                flags |= AddressRegisterFlag;
+            if (record.changedRegister != TraceRecord::NoRegister)
+                flags |= RegisterFlag;
+            output.push_back(flags);
+            writeWord(output, record.instruction);
+            if (flags & CycleFlag)
+                writeVarint(output, record.cycle - (first ? 0 : previous.cycle));
+            if (flags & AddressFlag)
+                writeWord(output, record.address);
+            if (flags & AddressRegisterFlag)
+                writeWord(output, record.addressRegister);
+            if (flags & RegisterFlag) {
+                output.push_back(record.changedRegister);
+                output.push_back(record.value);
+            }
+            previous = record;
+            first = false;
+        }
+        std::vector<uint8_t> header;
+        writeLong(header, gsl::narrow<uint32_t>(count));
+        writeLong(header, gsl::narrow<uint32_t>(output.size() - headerPosition - BlockHeaderSize));
+        std::copy(header.begin(), header.end(), output.begin() + static_cast<std::ptrdiff_t>(headerPosition));
+    }
+
+    bool decodeTraceBlock(const uint8_t* data, size_t size, size_t count, std::vector<TraceRecord>& records) {
+        const uint8_t* const end = data + size;
+        const auto readWord = [&data]() noexcept {
+            const uint16_t value = gsl::narrow_cast<uint16_t>(data[0] | (data[1] << 8));
+            data += 2;
+            return value;
+        };
+        TraceRecord previous{ 0, 0, 0, 0, TraceRecord::NoRegister, 0 };
+        for (size_t i = 0; i < count; ++i) {
+            if (end - data < 3)
+                return false;
+            const uint8_t flags = *data++;
+            TraceRecord record = previous;
+            record.instruction = readWord();
+            record.cycle = previous.cycle + 1;
+            if (flags & CycleFlag) {
+                uint64_t delta = 0;
+                for (int shift = 0;; shift += 7) {
+                    if (data == end || shift > 63)
+                        return false;
+                    const uint8_t byte = *data++;
+                    delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        break;
+                }
+                record.cycle = previous.cycle + delta;
+            }
+            const size_t fieldSize = ((flags & AddressFlag) ? 2 : 0) + ((flags & AddressRegisterFlag) ? 2 : 0) + ((flags & RegisterFlag) ? 2 : 0);
+            if (end - data < static_cast<std::ptrdiff_t>(fieldSize))
+                return false;
+            record.address = ((flags & AddressFlag) ? readWord() : predictAddress(previous));
+            if (flags & AddressRegisterFlag)
+                record.addressRegister = readWord();
+            record.changedRegister = TraceRecord::NoRegister;
+            record.value = 0;
+            if (flags & RegisterFlag) {
+                record.changedRegister = *data++;
+                record.value = *data++;
+            }
+            records.push_back(record);
+            previous = record;
+        }
+        return data == end;
+    }
+
+    InstructionTracer::InstructionTracer(const std::string& filename)
+        : mFile(filename, std::ios::binary | std::ios::trunc), mWriting(false), mStopping(false), mRecordCount(0), mBytesWritten(0)
+    {
+        if (!mFile.good())
+            throw std::runtime_error("Could not create " + filename);
+        mFile.write(TraceMagic.data(), TraceMagic.size());
+        mFile.put(static_cast<char>(TraceVersion));
+        mBytesWritten = TraceMagic.size() + 1;
+        mBlock.reserve(BlockSize);
+        mWriter = std::thread(&InstructionTracer::writeBlocks, this);
+    }
+
+    InstructionTracer::~InstructionTracer() {
+        flush();
+        {
+            const std::lock_guard lock(mMutex);
+            mStopping = true;
+        }
+        mCondition.notify_all();
+        mWriter.join();
+    }
+
+    void InstructionTracer::flush() {
+        if (!mBlock.empty())
+            submitBlock();
+        std::unique_lock lock(mMutex);
+        mCondition.wait(lock, [this]() { return mQueue.empty() && !mWriting; });
+        mFile.flush();
+    }
+
+    uint64_t InstructionTracer::getRecordCount() const {
+        const std::lock_guard lock(mMutex);
+        return mRecordCount + mBlock.size();
+    }
+
+    uint64_t InstructionTracer::getBytesWritten() const {
+        const std::lock_guard lock(mMutex);
+        return mBytesWritten;
+    }
+
+    void InstructionTracer::submitBlock() {
+        std::unique_lock lock(mMutex);
+        mCondition.wait(lock, [this]() { return mQueue.size() < MaximumQueuedBlocks; });
+        mRecordCount += mBlock.size();
+        mQueue.push_back(std::move(mBlock));
+        if (mSpareBlocks.empty()) {
+            mBlock = std::vector<TraceRecord>();
+            mBlock.reserve(BlockSize);
+        } else {
+            mBlock = std::move(mSpareBlocks.back());
+            mSpareBlocks.pop_back();
+        }
+        lock.unlock();
+        mCondition.notify_all();
+    }
+
+    void InstructionTracer::writeBlocks() {
+        std::vector<uint8_t> encoded;
+        std::unique_lock lock(mMutex);
+        while (true) {
+            mCondition.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+            if (mQueue.empty())
+                return;
+            auto block = std::move(mQueue.front());
+            mQueue.pop_front();
+            mWriting = true;
+            lock.unlock();
+
+            encoded.clear();
+            encodeTraceBlock(block.data(), block.size(), encoded);
+            mFile.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+            block.clear();
+
+            lock.lock();
+            mBytesWritten += encoded.size();
+            mSpareBlocks.push_back(std::move(block));
+            mWriting = false;
+            mCondition.notify_all();
+        }
+    }
+
+    bool TraceReader::open(const std::string& filename) {
+        mFile = std::ifstream(filename, std::ios::binary);
+        mRecords.clear();
+        mPosition = 0;
+        mError = false;
+        mFileSize = 0;
+        if (mFile.seekg(0, std::ios::end))
+            mFileSize = mFile.tellg();
+        mFile.seekg(0);
+        std::array<char, TraceMagic.size() + 1> header{};
+        if (!mFile.read(header.data(), header.size()))
+            return false;
+        return std::equal(TraceMagic.begin(), TraceMagic.end(), header.begin()) && header.back() == static_cast<char>(TraceVersion);
+    }
+
+    bool TraceReader::next(TraceRecord& record) {
+        while (mPosition == mRecords.size()) {
+            if (mError || !readBlock())
+                return false;
+        }
+        record = mRecords[mPosition++];
+        return true;
+    }
+
+    bool TraceReader::hasError() const noexcept {
+        return mError;
+    }
+
+    bool TraceReader::readBlock() {
+        std::array<uint8_t, BlockHeaderSize> header;
+        if (!mFile.read(reinterpret_cast<char*>(header.data()), header.size())) {
+            mError = (mFile.gcount() != 0); // a partial header means the file has been truncated
+            return false;
+        }
+        const size_t count = readLong(header.data());
+        const size_t size = readLong(header.data() + 4);
+        mRecords.clear();
+        mPosition = 0;
+        // a corrupt header must not allocate more than the file can hold
+        const auto remainingSize = static_cast<uint64_t>(mFileSize - mFile.tellg());
+        if (size > remainingSize || size < count * MinimumEncodedRecordSize || size > count * MaximumEncodedRecordSize) {
+            mError = true;
+            return false;
+        }
+        std::vector<uint8_t> data(size);
+        if (!mFile.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size))
+            || !decodeTraceBlock(data.data(), data.size(), count, mRecords)) {
+            mRecords.clear();
+            mError = true;
+            return false;
+        }
+        return true;
+    }
+
+}
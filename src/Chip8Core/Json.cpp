@@ -0,0 +1,279 @@
+#include "Chip8Core/Json.hpp"
+
+#include <cstdint>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace Chip8 {
+
+    namespace {
+
+        // the recursion depth is limited, so that hostile files cannot overflow the stack
+        constexpr size_t MaximumDepth = 256;
+
+        class Parser {
+        public:
+            explicit Parser(const std::string& text) noexcept
+                : mText(text), mPosition(0)
+            {}
+
+            JsonValue parseDocument() {
+                JsonValue value = parseValue(0);
+                skipWhitespace();
+                if (mPosition != mText.size())
+                    fail("unexpected trailing characters");
+                return value;
+            }
+
+        private:
+            [[noreturn]] void fail(const std::string& message) const {
+                throw std::runtime_error("offset " + std::to_string(mPosition) + ": " + message);
+            }
+
+            void skipWhitespace() noexcept {
+                while (mPosition < mText.size() && (mText[mPosition] == ' ' || mText[mPosition] == '\t'
+                    || mText[mPosition] == '\n' || mText[mPosition] == '\r'))
+                    ++mPosition;
+            }
+
+            char peek() const noexcept {
+                return (mPosition < mText.size() ? mText[mPosition] : '\0');
+            }
+
+            void expect(char c) {
+                if (peek() != c)
+                    fail(std::string("expected '") + c + "'");
+                ++mPosition;
+            }
+
+            bool consumeLiteral(const char* literal) noexcept {
+                const std::string_view expected(literal);
+                if (mText.compare(mPosition, expected.size(), expected) != 0)
+                    return false;
+                mPosition += expected.size();
+                return true;
+            }
+
+            JsonValue parseValue(size_t depth) {
+                if (depth > MaximumDepth)
+                    fail("nesting too deep");
+                skipWhitespace();
+                switch (peek()) {
+                    case '{': return parseObject(depth);
+                    case '[': return parseArray(depth);
+                    case '"': return parseString();
+                    case 't': if (consumeLiteral("true")) return true; break;
+                    case 'f': if (consumeLiteral("false")) return false; break;
+                    case 'n': if (consumeLiteral("null")) return JsonValue(); break;
+                    default:
+                        if (peek() == '-' || (peek() >= '0' && peek() <= '9'))
+                            return parseNumber();
+                }
+                fail("unexpected character");
+            }
+
+            JsonValue parseObject(size_t depth) {
+                expect('{');
+                JsonValue::Object object;
+                skipWhitespace();
+                if (peek() == '}') {
+                    ++mPosition;
+                    return object;
+                }
+                while (true) {
+                    skipWhitespace();
+                    std::string key = parseString().asString();
+                    skipWhitespace();
+                    expect(':');
+                    object[std::move(key)] = parseValue(depth + 1);
+                    skipWhitespace();
+                    if (peek() == '}') {
+                        ++mPosition;
+                        return object;
+                    }
+                    expect(',');
+                }
+            }
+
+            JsonValue parseArray(size_t depth) {
+                expect('[');
+                JsonValue::Array array;
+                skipWhitespace();
+                if (peek() == ']') {
+                    ++mPosition;
+                    return array;
+                }
+                while (true) {
+                    array.push_back(parseValue(depth + 1));
+                    skipWhitespace();
+                    if (peek() == ']') {
+                        ++mPosition;
+                        return array;
+                    }
+                    expect(',');
+                }
+            }
+
+            uint32_t parseHexQuad() {
+                if (mPosition + 4 > mText.size())
+                    fail("incomplete escape sequence");
+                uint32_t value = 0;
+                for (int i = 0; i < 4; ++i) {
+                    const char c = mText[mPosition++];
+                    value <<= 4;
+                    if (c >= '0' && c <= '9')
+                        value |= static_cast<uint32_t>(c - '0');
+                    else if (c >= 'a' && c <= 'f')
+                        value |= static_cast<uint32_t>(c - 'a' + 10);
+                    else if (c >= 'A' && c <= 'F')
+                        value |= static_cast<uint32_t>(c - 'A' + 10);
+                    else
+                        fail("invalid escape sequence");
+                }
+                return value;
+            }
+
+            static void appendUtf8(std::string& result, uint32_t codePoint) {
+                if (codePoint < 0x80) {
+                    result += static_cast<char>(codePoint);
+                } else if (codePoint < 0x800) {
+                    result += static_cast<char>(0xC0 | (codePoint >> 6));
+                    result += static_cast<char>(0x80 | (codePoint & 0x3F));
+                } else if (codePoint < 0x10000) {
+                    result += static_cast<char>(0xE0 | (codePoint >> 12));
+                    result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    result += static_cast<char>(0x80 | (codePoint & 0x3F));
+                } else {
+                    result += static_cast<char>(0xF0 | (codePoint >> 18));
+                    result += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                    result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    result += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+            }
+
+            JsonValue parseString() {
+                expect('"');
+                std::string result;
+                while (true) {
+                    if (mPosition >= mText.size())
+                        fail("unterminated string");
+                    const char c = mText[mPosition++];
+                    if (c == '"')
+                        return result;
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        fail("control character in string");
+                    if (c != '\\') {
+                        result += c;
+                        continue;
+                    }
+                    const char escaped = peek();
+                    ++mPosition;
+                    switch (escaped) {
+                        case '"': result += '"'; break;
+                        case '\\': result += '\\'; break;
+                        case '/': result += '/'; break;
+                        case 'b': result += '\b'; break;
+                        case 'f': result += '\f'; break;
+                        case 'n': result += '\n'; break;
+                        case 'r': result += '\r'; break;
+                        case 't': result += '\t'; break;
+                        case 'u': {
+                            uint32_t codePoint = parseHexQuad();
+                            if (codePoint >= 0xD800 && codePoint < 0xDC00 && consumeLiteral("\\u")) {
+                                const uint32_t low = parseHexQuad();
+                                if (low < 0xDC00 || low >= 0xE000)
+                                    fail("invalid surrogate pair");
+                                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                            }
+                            appendUtf8(result, codePoint);
+                            break;
+                        }
+                        default:
+                            fail("invalid escape sequence");
+                    }
+                }
+            }
+
+            JsonValue parseNumber() {
+                const size_t start = mPosition;
+                if (peek() == '-')
+                    ++mPosition;
+                const auto skipDigits = [this]() {
+                    const size_t first = mPosition;
+                    while (peek() >= '0' && peek() <= '9')
+                        ++mPosition;
+                    if (mPosition == first)
+                        fail("expected a digit");
+                };
+                skipDigits();
+                if (peek() == '.') {
+                    ++mPosition;
+                    skipDigits();
+                }
+                if (peek() == 'e' || peek() == 'E') {
+                    ++mPosition;
+                    if (peek() == '+' || peek() == '-')
+                        ++mPosition;
+                    skipDigits();
+                }
+                // strtod() and a default stream would expect the decimal separator of the current locale
+                std::istringstream stream(mText.substr(start, mPosition - start));
+                stream.imbue(std::locale::classic());
+                double value = 0.0;
+                stream >> value; // out of range values become the largest finite value (the text is valid)
+                return value;
+            }
+
+        private:
+            const std::string& mText;
+            size_t mPosition;
+        };
+
+        const JsonValue& getNull() noexcept {
+            static const JsonValue null;
+            return null;
+        }
+
+    }
+
+    bool JsonValue::asBool(bool fallback) const noexcept {
+        return (isBool() ? std::get<bool>(mValue) : fallback);
+    }
+
+    double JsonValue::asNumber(double fallback) const noexcept {
+        return (isNumber() ? std::get<double>(mValue) : fallback);
+    }
+
+    const std::string& JsonValue::asString() const noexcept {
+        static const std::string empty;
+        return (isString() ? std::get<std::string>(mValue) : empty);
+    }
+
+    const JsonValue::Array& JsonValue::asArray() const noexcept {
+        static const Array empty;
+        return (isArray() ? std::get<Array>(mValue) : empty);
+    }
+
+    const JsonValue::Object& JsonValue::asObject() const noexcept {
+        static const Object empty;
+        return (isObject() ? std::get<Object>(mValue) : empty);
+    }
+
+    const JsonValue& JsonValue::operator[](const std::string& key) const noexcept {
+        const auto& object = asObject();
+        const auto member = object.find(key);
+        return (member == object.end() ? getNull() : member->second);
+    }
+
+    std::optional<JsonValue> parseJson(const std::string& text, std::string& error) {
+        try {
+            return Parser(text).parseDocument();
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+            return {};
+        }
+    }
+
+}
@@ -0,0 +1,130 @@
+#include "Chip8Core/LatencyProbe.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+
+#include "Chip8Core/Probes.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr int64_t Timeout = 1'000'000'000; // nanoseconds
+
+        LatencyProbe::Distribution computeDistribution(std::vector<double> values) {
+            if (values.empty())
+                return {};
+            const double maximum = *std::max_element(values.begin(), values.end());
+            return { getPercentile(values, 50.0), getPercentile(values, 95.0), getPercentile(values, 99.0), maximum };
+        }
+
+        void printDistribution(std::ostream& output, const char* name, const LatencyProbe::Distribution& distribution) {
+            output << "  " << name << ": p50 " << distribution.p50 << " ms, p95 " << distribution.p95 << " ms, p99 "
+                << distribution.p99 << " ms, max " << distribution.maximum << " ms\n";
+        }
+
+    }
+
+    LatencyProbe::LatencyProbe(size_t sampleCount, bool measuresPresent, int64_t interval, uint32_t seed)
+        : mSampleCount(sampleCount), mMeasuresPresent(measuresPresent), mInterval(std::max<int64_t>(interval, 2))
+        , mRandomGenerator(seed), mTimeoutCount(0), mPhase(Phase::Idle), mNextPressTime(0), mPendingSample{}, mKey(0)
+        , mDisplayBeforePress{}
+    {
+        mSamples.reserve(sampleCount);
+    }
+
+    std::optional<LatencyProbe::KeyEvent> LatencyProbe::poll(const Chip8& chip8, int64_t now) {
+        // the presses are spread over half to one and a half intervals, so they hit every phase of a frame
+        std::uniform_int_distribution<int64_t> delay(mInterval / 2, mInterval + mInterval / 2);
+        if (mNextPressTime == 0)
+            mNextPressTime = now + delay(mRandomGenerator);
+
+        switch (mPhase) {
+            case Phase::Idle:
+                if (mSamples.size() >= mSampleCount || now < mNextPressTime)
+                    return std::nullopt;
+                mPendingSample = Sample{ mNextPressTime, 0, 0 };
+                mDisplayBeforePress = chip8.getPackedDisplay();
+                mPhase = Phase::Pressed;
+                return KeyEvent{ mKey, true };
+            case Phase::Pressed:
+            case Phase::Displayed:
+                if (now - mPendingSample.pressTime < Timeout)
+                    return std::nullopt;
+                ++mTimeoutCount;
+                break;
+            case Phase::Releasing:
+                break;
+        }
+        mPhase = Phase::Idle;
+        mNextPressTime = now + delay(mRandomGenerator);
+        const uint8_t key = mKey;
+        mKey = static_cast<uint8_t>((mKey + 1u) % 0x10u);
+        return KeyEvent{ key, false };
+    }
+
+    void LatencyProbe::checkDisplay(const Chip8& chip8, int64_t now) {
+        if (mPhase != Phase::Pressed || chip8.getPackedDisplay() == mDisplayBeforePress)
+            return;
+        mPendingSample.displayTime = now;
+        if (mMeasuresPresent)
+            mPhase = Phase::Displayed;
+        else
+            finishSample();
+    }
+
+    void LatencyProbe::present(int64_t now) noexcept {
+        if (mPhase != Phase::Displayed)
+            return;
+        mPendingSample.presentTime = now;
+        finishSample();
+    }
+
+    bool LatencyProbe::isFinished() const noexcept {
+        return mSamples.size() >= mSampleCount && mPhase == Phase::Idle;
+    }
+
+    const std::vector<LatencyProbe::Sample>& LatencyProbe::getSamples() const noexcept {
+        return mSamples;
+    }
+
+    size_t LatencyProbe::getTimeoutCount() const noexcept {
+        return mTimeoutCount;
+    }
+
+    LatencyProbe::Distribution LatencyProbe::getDisplayLatency() const {
+        std::vector<double> values;
+        for (const auto& sample : mSamples)
+            values.push_back(static_cast<double>(sample.displayTime - sample.pressTime) * 1e-6);
+        return computeDistribution(std::move(values));
+    }
+
+    LatencyProbe::Distribution LatencyProbe::getPresentLatency() const {
+        if (!mMeasuresPresent)
+            return {};
+        std::vector<double> values;
+        for (const auto& sample : mSamples)
+            values.push_back(static_cast<double>(sample.presentTime - sample.pressTime) * 1e-6);
+        return computeDistribution(std::move(values));
+    }
+
+    void LatencyProbe::printReport(std::ostream& output) const {
+        const auto flags = output.flags();
+        const auto precision = output.precision();
+        output << std::fixed << std::setprecision(3);
+        output << "Latency probe: " << mSamples.size() << " samples, " << mTimeoutCount << " timeouts\n";
+        printDistribution(output, "key press to display change", getDisplayLatency());
+        if (mMeasuresPresent)
+            printDistribution(output, "key press to presented frame", getPresentLatency());
+        output.flags(flags);
+        output.precision(precision);
+    }
+
+    void LatencyProbe::finishSample() {
+        mSamples.push_back(mPendingSample);
+        mPhase = Phase::Releasing;
+    }
+
+}
@@ -0,0 +1,135 @@
+#include "Chip8Core/MappedFile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8 {
+
+#ifdef _WIN32
+    namespace {
+        int64_t toNanoseconds(const FILETIME& time) noexcept {
+            return static_cast<int64_t>((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 100;
+        }
+    }
+
+    MappedFile::MappedFile(const std::string& filename)
+        : mData(nullptr), mSize(0), mStamp{ 0, 0 }, mHandle(nullptr)
+    {
+        const HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Could not open " + filename);
+        BY_HANDLE_FILE_INFORMATION information;
+        if (!GetFileInformationByHandle(file, &information)) {
+            CloseHandle(file);
+            throw std::runtime_error("Could not query " + filename);
+        }
+        mStamp.size = (static_cast<uint64_t>(information.nFileSizeHigh) << 32) | information.nFileSizeLow;
+        mStamp.modificationTime = toNanoseconds(information.ftLastWriteTime);
+        mSize = static_cast<size_t>(mStamp.size);
+        if (mSize > 0) {
+            // empty files cannot be mapped
+            mHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mHandle)
+                mData = static_cast<const uint8_t*>(MapViewOfFile(mHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+        CloseHandle(file); // the mapping keeps the file open
+        if (mSize > 0 && !mData) {
+            if (mHandle)
+                CloseHandle(mHandle);
+            throw std::runtime_error("Could not map " + filename);
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if (mData)
+            UnmapViewOfFile(mData);
+        if (mHandle)
+            CloseHandle(mHandle);
+    }
+
+    std::optional<MappedFile::Stamp> MappedFile::getStamp(const std::string& filename) {
+        WIN32_FILE_ATTRIBUTE_DATA information;
+        if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &information))
+            return {};
+        return Stamp{ (static_cast<uint64_t>(information.nFileSizeHigh) << 32) | information.nFileSizeLow,
+            toNanoseconds(information.ftLastWriteTime) };
+    }
+#else
+    namespace {
+        MappedFile::Stamp toStamp(const struct stat& status) noexcept {
+#ifdef __APPLE__
+            const auto& time = status.st_mtimespec;
+#else
+            const auto& time = status.st_mtim;
+#endif
+            return { static_cast<uint64_t>(status.st_size),
+                static_cast<int64_t>(time.tv_sec) * 1'000'000'000 + static_cast<int64_t>(time.tv_nsec) };
+        }
+    }
+
+    MappedFile::MappedFile(const std::string& filename)
+        : mData(nullptr), mSize(0), mStamp{ 0, 0 }, mHandle(nullptr)
+    {
+        const int descriptor = open(filename.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            throw std::runtime_error("Could not open " + filename);
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode)) {
+            close(descriptor);
+            throw std::runtime_error("Could not query " + filename);
+        }
+        mStamp = toStamp(status);
+        mSize = static_cast<size_t>(status.st_size);
+        void* address = nullptr;
+        if (mSize > 0) // empty files cannot be mapped
+            address = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        close(descriptor); // the mapping stays valid
+        if (address == MAP_FAILED)
+            throw std::runtime_error("Could not map " + filename);
+        mData = static_cast<const uint8_t*>(address);
+    }
+
+    MappedFile::~MappedFile() {
+        if (mData)
+            munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+
+    std::optional<MappedFile::Stamp> MappedFile::getStamp(const std::string& filename) {
+        struct stat status;
+        if (stat(filename.c_str(), &status) != 0)
+            return {};
+        return toStamp(status);
+    }
+#endif
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : mData(std::exchange(other.mData, nullptr)), mSize(std::exchange(other.mSize, 0))
+        , mStamp(other.mStamp), mHandle(std::exchange(other.mHandle, nullptr))
+    {}
+
+    const uint8_t* MappedFile::data() const noexcept {
+        return mData;
+    }
+
+    size_t MappedFile::size() const noexcept {
+        return mSize;
+    }
+
+    const MappedFile::Stamp& MappedFile::getStamp() const noexcept {
+        return mStamp;
+    }
+
+}
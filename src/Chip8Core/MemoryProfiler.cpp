@@ -0,0 +1,123 @@
+#include "Chip8Core/MemoryProfiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+namespace Chip8 {
+
+    MemoryProfiler::MemoryProfiler()
+        : mAddresses(AddressCount)
+    {}
+
+    void MemoryProfiler::reset() noexcept {
+        std::fill(mAddresses.begin(), mAddresses.end(), AddressStatistics{});
+        mWritten.reset();
+    }
+
+    void MemoryProfiler::record(MemoryAccess access, uint16_t address, size_t count, uint64_t cycle) noexcept {
+        if (access == MemoryAccess::Execute) {
+            auto& statistics = mAddresses[address % AddressCount];
+            ++statistics.executions;
+            if (mWritten[address % AddressCount] || mWritten[(address + 1u) % AddressCount]) {
+                if (statistics.executionsAfterWrite++ == 0)
+                    statistics.firstModifiedExecutionCycle = cycle;
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const size_t index = (address + i) % AddressCount;
+            auto& statistics = mAddresses[index];
+            switch (access) {
+                case MemoryAccess::Read:
+                    ++statistics.reads;
+                    break;
+                case MemoryAccess::Write:
+                    if (statistics.writes++ == 0)
+                        statistics.firstWriteCycle = cycle;
+                    mWritten[index] = true;
+                    break;
+                default:
+                    ++statistics.spriteReads;
+                    break;
+            }
+        }
+    }
+
+    const MemoryProfiler::AddressStatistics& MemoryProfiler::getAddressStatistics(uint16_t address) const {
+        return mAddresses.at(address);
+    }
+
+    MemoryProfiler::Region MemoryProfiler::getRegion(uint16_t address) const noexcept {
+        address %= AddressCount;
+        const auto& statistics = mAddresses[address];
+        // the second byte of an instruction belongs to the code as well
+        if (statistics.executions > 0 || (address > 0 && mAddresses[address - 1u].executions > 0))
+            return Region::Code;
+        if (statistics.spriteReads > 0)
+            return Region::Sprite;
+        if (statistics.reads > 0 || statistics.writes > 0)
+            return Region::Data;
+        return Region::Unused;
+    }
+
+    std::array<size_t, MemoryProfiler::RegionCount> MemoryProfiler::getRegionSizes() const noexcept {
+        std::array<size_t, RegionCount> result{};
+        for (size_t address = 0; address < AddressCount; ++address)
+            ++result[static_cast<size_t>(getRegion(static_cast<uint16_t>(address)))];
+        return result;
+    }
+
+    const char* MemoryProfiler::getRegionName(Region region) noexcept {
+        switch (region) {
+            case Region::Code:
+                return "code";
+            case Region::Data:
+                return "data";
+            case Region::Sprite:
+                return "sprite";
+            default:
+                return "unused";
+        }
+    }
+
+    std::vector<MemoryProfiler::SelfModifyingCode> MemoryProfiler::getSelfModifyingCode() const {
+        std::vector<SelfModifyingCode> result;
+        for (size_t address = 0; address < AddressCount; ++address) {
+            const auto& statistics = mAddresses[address];
+            if (statistics.executionsAfterWrite == 0)
+                continue;
+            const auto& secondByte = mAddresses[(address + 1) % AddressCount];
+            uint64_t firstWriteCycle = (statistics.writes > 0 ? statistics.firstWriteCycle : secondByte.firstWriteCycle);
+            if (statistics.writes > 0 && secondByte.writes > 0)
+                firstWriteCycle = std::min(statistics.firstWriteCycle, secondByte.firstWriteCycle);
+            result.push_back({ static_cast<uint16_t>(address), statistics.writes + secondByte.writes, statistics.executionsAfterWrite,
+                firstWriteCycle, statistics.firstModifiedExecutionCycle });
+        }
+        return result;
+    }
+
+    void MemoryProfiler::writeReportJson(std::ostream& output) const {
+        const auto regionSizes = getRegionSizes();
+        output << "{\"regions\": {";
+        for (size_t region = 0; region < RegionCount; ++region)
+            output << (region > 0 ? ", " : "") << "\"" << getRegionName(static_cast<Region>(region)) << "\": " << regionSizes[region];
+        output << "}, \"self_modifying_code\": [";
+        const auto flags = output.flags();
+        const auto fill = output.fill();
+        bool first = true;
+        for (const auto& code : getSelfModifyingCode()) {
+            output << (first ? "" : ", ")
+                << "{\"address\": \"" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << code.address << std::dec << "\", "
+                << "\"writes\": " << code.writes << ", "
+                << "\"executions_after_write\": " << code.executionsAfterWrite << ", "
+                << "\"first_write_cycle\": " << code.firstWriteCycle << ", "
+                << "\"first_modified_execution_cycle\": " << code.firstModifiedExecutionCycle << "}";
+            first = false;
+        }
+        output.flags(flags);
+        output.fill(fill);
+        output << "]}";
+    }
+
+}
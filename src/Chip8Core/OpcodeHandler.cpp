@@ -2,34 +2,39 @@
 
 #include <iostream>
 #include <iomanip>
-#include <cstdlib>
-#include <ctime>
+#include <stdexcept>
 #include <gsl/gsl>
 
 #include "Chip8Core/Chip8.hpp"
+#include "Chip8Core/Debugger.hpp"
 #include "Chip8Core/Instruction.hpp"
+#include "Chip8Core/MemoryProfiler.hpp"
 
 namespace Chip8 {
-	OpcodeHandler::OpcodeHandler() noexcept {
-		std::srand(gsl::narrow<unsigned int>(std::time(nullptr)));
-	}
 
 	bool OpcodeHandler::execute(uint16_t opcode, const Instruction& instruction, Chip8& chip8, CompatibilityMode compatibilityMode) {
 		// important note: the program counter will already be incremented upon entering this function!
 
-		// std::cout << "executing " << std::setw(4) << std::setfill('0') << std::hex << std::uppercase << instruction.getValue() << "\n\t";
+		// to follow the executed instructions, attach an InstructionTracer (see Chip8::setTracer())
 		switch (opcode) {
 			case 0x0000: // 0NNN
 				// Calls machine code routine (RCA 1802 for COSMAC VIP) at address NNN. Not necessary for most ROMs.
-				std::cout << "Info: Opcode 0NNN is purposely not implemented.\n";
+				if (chip8.mLoggingEnabled)
+					std::cout << "Info: Opcode 0NNN is purposely not implemented.\n";
 				break;
 			case 0x00E0: // 00E0
 				// Clears the screen.
-				chip8.mDisplayMemory.reset();
+				chip8.mDisplayMemory.fill(0x0);
 				break;
 			case 0x00EE: // 00EE
 				// Returns from a subroutine.
-				chip8.mPC = chip8.stackPop();
+				try {
+					chip8.mPC = chip8.stackPop();
+				} catch (const std::underflow_error&) {
+					if (chip8.mLoggingEnabled)
+						std::cout << "Critical Error: Stack underflow.\n";
+					return false;
+				}
 				break;
 			case 0x1000: // 1NNN
 				// Jumps to address NNN.
@@ -37,7 +42,13 @@ namespace Chip8 {
 				break;
 			case 0x2000: // 2NNN
 				// Calls subroutine at NNN.
-				chip8.stackPush(chip8.getProgramCounter());
+				try {
+					chip8.stackPush(chip8.getProgramCounter());
+				} catch (const std::overflow_error&) {
+					if (chip8.mLoggingEnabled)
+						std::cout << "Critical Error: Stack overflow.\n";
+					return false;
+				}
 				chip8.mPC = instruction.getNNN();
 				break;
 			case 0x3000: // 3XNN
@@ -109,7 +120,8 @@ namespace Chip8 {
 					chip8.setRegister(0xF, chip8.getRegister(instruction.getX()) & 0x1);
 					chip8.setRegister(instruction.getX(), chip8.getRegister(instruction.getX()) >> 1);
 				} else {
-					std::cout << "Critical Error: Unknown compatibility mode.\n";
+					if (chip8.mLoggingEnabled)
+						std::cout << "Critical Error: Unknown compatibility mode.\n";
 					return false;
 				}
 				break;
@@ -138,7 +150,8 @@ namespace Chip8 {
 						chip8.setRegister(0xF, 0x0);
 					chip8.setRegister(instruction.getX(), chip8.getRegister(instruction.getX()) << 1);
 				} else {
-					std::cout << "Critical Error: Unknown compatibility mode.\n";
+					if (chip8.mLoggingEnabled)
+						std::cout << "Critical Error: Unknown compatibility mode.\n";
 					return false;
 				}
 				break;
@@ -157,7 +170,7 @@ namespace Chip8 {
 				break;
 			case 0xC000: // CXNN
 				// Sets VX to the result of a bitwise and operation on a random number (Typically: 0 to 255) and NN.
-				chip8.setRegister(instruction.getX(), generateRandomNumber() & instruction.getNN());
+				chip8.setRegister(instruction.getX(), generateRandomNumber(chip8) & instruction.getNN());
 				break;
 			case 0xD000: // DXYN
 				// Draws a sprite at coordinate (VX, VY) that has a width of 8 pixels and a height of N pixels.
@@ -219,6 +232,7 @@ namespace Chip8 {
 				// at I plus 2. (In other words, take the decimal representation of VX, place the hundreds
 				// digit in memory at location in I, the tens digit at location I+1, and the ones digit at
 				// location I+2.)
+				recordMemoryAccess(chip8, MemoryAccess::Write, chip8.getAddressPointer(), 3);
 				chip8.getMemory().write(chip8.getAddressPointer() + 0x0, chip8.getRegister(instruction.getX()) / 100);
 				chip8.getMemory().write(chip8.getAddressPointer() + 0x1, (chip8.getRegister(instruction.getX()) % 100) / 10);
 				chip8.getMemory().write(chip8.getAddressPointer() + 0x2, chip8.getRegister(instruction.getX()) % 10);
@@ -230,6 +244,7 @@ namespace Chip8 {
 				// Additional information:
 				// In the original CHIP-8 implementation, and also in CHIP-48, I is left incremented after
 				// this instruction had been executed. In SCHIP, I is left unmodified.
+				recordMemoryAccess(chip8, MemoryAccess::Write, chip8.mI, instruction.getX() + 1u);
 				if (compatibilityMode == CompatibilityMode::OriginalChip8) {
 					for (uint8_t i = 0; i <= instruction.getX(); i++) {
 						chip8.getMemory().write(chip8.mI++, chip8.getRegister(i));
@@ -239,7 +254,8 @@ namespace Chip8 {
 						chip8.getMemory().write(chip8.mI + i, chip8.getRegister(i));
 					}
 				} else {
-					std::cout << "Critical Error: Unknown compatibility mode.\n";
+					if (chip8.mLoggingEnabled)
+						std::cout << "Critical Error: Unknown compatibility mode.\n";
 					return false;
 				}
 				break;
@@ -248,6 +264,7 @@ namespace Chip8 {
 				// offset from I is increased by 1 for each value written, but I itself is left unmodified.
 				//
 				// For additional information see: FX55
+				recordMemoryAccess(chip8, MemoryAccess::Read, chip8.mI, instruction.getX() + 1u);
 				if (compatibilityMode == CompatibilityMode::OriginalChip8) {
 					for (uint8_t i = 0; i <= instruction.getX(); i++) {
 						chip8.setRegister(i, chip8.getMemory().read(chip8.mI++));
@@ -257,12 +274,14 @@ namespace Chip8 {
 						chip8.setRegister(i, chip8.getMemory().read(chip8.mI + i));
 					}
 				} else {
-					std::cout << "Critical Error: Unknown compatibility mode.\n";
+					if (chip8.mLoggingEnabled)
+						std::cout << "Critical Error: Unknown compatibility mode.\n";
 					return false;
 				}
 				break;
 			default:
-				std::cout << "Critical Error: Opcode " << opcode << " (not implemented)\n";
+				if (chip8.mLoggingEnabled)
+					std::cout << "Critical Error: Opcode " << opcode << " (not implemented)\n";
 				return false;				
 		}
 		return true;
@@ -274,13 +293,14 @@ namespace Chip8 {
 		// change after the execution of this instruction. As described above, VF is set to 1 if any
 		// screen pixels are flipped from set to unset when the sprite is drawn, and to 0 if that doesnt happen
 		Ensures(height <= 0xF);
+		recordMemoryAccess(chip8, MemoryAccess::SpriteRead, chip8.getAddressPointer(), height);
 		bool collision = false;
 		for (uint8_t row = 0x0; row < height; ++row) {
+			const uint8_t sprite = chip8.getMemory().read(chip8.getAddressPointer() + row);
 			for (uint8_t col = 0x0; col < 0x8; ++col) {
 				bool oldPixel = chip8.getPixel(static_cast<size_t>(x) + col, static_cast<size_t>(y) + row);
-				uint16_t memoryPosition = chip8.getAddressPointer() + row;
 				uint8_t mask = (0x1 << (0x7 - col));
-				bool newPixel = ((chip8.getMemory().read(memoryPosition) & mask) != 0x0);
+				bool newPixel = ((sprite & mask) != 0x0);
 				if (newPixel) {
 					if (oldPixel)
 						collision = true;
@@ -291,8 +311,18 @@ namespace Chip8 {
 		chip8.setRegister(0xF, collision ? 0x1 : 0x0);
 	}
 
-	uint8_t OpcodeHandler::generateRandomNumber() noexcept {
-		return gsl::narrow<uint8_t>(std::rand() % 255);
+	uint8_t OpcodeHandler::generateRandomNumber(Chip8& chip8) noexcept {
+		return chip8.mRandom.nextByte();
+	}
+
+	void OpcodeHandler::recordMemoryAccess([[maybe_unused]] Chip8& chip8, [[maybe_unused]] MemoryAccess access,
+		[[maybe_unused]] uint16_t address, [[maybe_unused]] size_t count) noexcept {
+#ifdef CHIP8_ENABLE_PROFILING
+		if (chip8.mMemoryProfiler)
+			chip8.mMemoryProfiler->record(access, address, count, chip8.mCycleCount);
+		if (chip8.mDebugger && access == MemoryAccess::Write)
+			chip8.mDebugger->checkMemoryWrite(chip8, address, count);
+#endif
 	}
 
 }
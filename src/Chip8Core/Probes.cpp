@@ -0,0 +1,159 @@
+#include "Chip8Core/Probes.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+
+namespace Chip8 {
+
+    namespace {
+
+        // the buffers of all threads that record probes; a buffer is removed once its thread has ended and its events have been collected
+        std::mutex registryMutex;
+        std::vector<std::shared_ptr<ProbeBuffer>> registeredBuffers;
+        uint32_t nextThread = 0;
+
+        std::shared_ptr<ProbeBuffer> registerBuffer() {
+            const std::lock_guard lock(registryMutex);
+            registeredBuffers.push_back(std::make_shared<ProbeBuffer>(nextThread++));
+            return registeredBuffers.back();
+        }
+
+    }
+
+    ProbeBuffer::ProbeBuffer(uint32_t thread) noexcept
+        : mEvents{}, mHead(0), mTail(0), mDroppedCount(0), mThread(thread)
+    {}
+
+    bool ProbeBuffer::push(const char* name, int64_t start, int64_t duration) noexcept {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) >= Capacity) {
+            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        mEvents[head % Capacity] = { name, start, duration, mThread };
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t ProbeBuffer::drain(std::vector<ProbeEvent>& events) {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        const size_t head = mHead.load(std::memory_order_acquire);
+        for (size_t i = tail; i != head; ++i)
+            events.push_back(mEvents[i % Capacity]);
+        mTail.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    uint32_t ProbeBuffer::getThread() const noexcept {
+        return mThread;
+    }
+
+    uint64_t ProbeBuffer::getDroppedCount() const noexcept {
+        return mDroppedCount.load(std::memory_order_relaxed);
+    }
+
+    int64_t getProbeTime() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    ProbeBuffer& getProbeBuffer() {
+        thread_local const std::shared_ptr<ProbeBuffer> buffer = registerBuffer();
+        return *buffer;
+    }
+
+    std::vector<ProbeEvent> collectProbeEvents() {
+        std::vector<std::shared_ptr<ProbeBuffer>> buffers;
+        std::vector<std::shared_ptr<ProbeBuffer>> endedBuffers;
+        {
+            // a buffer that is only referenced by the registry belongs to a thread that has ended
+            const std::lock_guard lock(registryMutex);
+            for (const auto& buffer : registeredBuffers)
+                (buffer.use_count() == 1 ? endedBuffers : buffers).push_back(buffer);
+            registeredBuffers = buffers;
+        }
+        std::vector<ProbeEvent> events;
+        for (const auto& buffer : buffers)
+            buffer->drain(events);
+        for (const auto& buffer : endedBuffers)
+            buffer->drain(events);
+        std::stable_sort(events.begin(), events.end(), [](const ProbeEvent& lhs, const ProbeEvent& rhs) { return lhs.start < rhs.start; });
+        return events;
+    }
+
+    ProbeStatistics::ProbeStatistics(size_t windowSize, size_t historySize) noexcept
+        : mWindowSize(std::max<size_t>(windowSize, 1)), mHistorySize(std::max<size_t>(historySize, 1))
+    {}
+
+    void ProbeStatistics::add(const std::vector<ProbeEvent>& events) {
+        for (const auto& event : events) {
+            auto& window = mSeries[event.name].window;
+            window.push_back(static_cast<double>(event.duration) * 1e-6);
+            if (window.size() > mWindowSize)
+                window.pop_front();
+        }
+    }
+
+    void ProbeStatistics::update() {
+        std::vector<double> values;
+        for (auto& [name, series] : mSeries) {
+            values.assign(series.window.begin(), series.window.end());
+            for (auto [history, percentile] : { std::make_pair(&series.p50, 50.0), std::make_pair(&series.p95, 95.0), std::make_pair(&series.p99, 99.0) }) {
+                history->push_back(static_cast<float>(getPercentile(values, percentile)));
+                if (history->size() > mHistorySize)
+                    history->erase(history->begin());
+            }
+        }
+    }
+
+    void ProbeStatistics::clear() noexcept {
+        mSeries.clear();
+    }
+
+    const std::map<std::string, ProbeStatistics::Series>& ProbeStatistics::getSeries() const noexcept {
+        return mSeries;
+    }
+
+    double getPercentile(std::vector<double>& values, double percentile) {
+        if (values.empty())
+            return 0.0;
+        const double rank = std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(values.size()));
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(std::max(rank, 1.0)) - 1);
+        std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+        return values[index];
+    }
+
+    void writeChromeTrace(std::ostream& output, const std::vector<ProbeEvent>& events) {
+        const int64_t origin = (events.empty() ? 0 : std::min_element(events.begin(), events.end(),
+            [](const ProbeEvent& lhs, const ProbeEvent& rhs) { return lhs.start < rhs.start; })->start);
+        std::set<uint32_t> threads;
+        const auto flags = output.flags();
+        const auto precision = output.precision();
+        output << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        bool first = true;
+        for (const auto& event : events) {
+            output << (first ? "\n" : ",\n")
+                << "{\"name\": \"" << event.name << "\", \"cat\": \"chip8\", \"ph\": \"X\", "
+                << "\"ts\": " << static_cast<double>(event.start - origin) * 1e-3 << ", "
+                << "\"dur\": " << static_cast<double>(event.duration) * 1e-3 << ", "
+                << "\"pid\": 1, \"tid\": " << event.thread << "}";
+            threads.insert(event.thread);
+            first = false;
+        }
+        for (const auto thread : threads) {
+            output << (first ? "\n" : ",\n")
+                << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread
+                << ", \"args\": {\"name\": \"thread " << thread << "\"}}";
+            first = false;
+        }
+        output << "\n]}\n";
+        output.flags(flags);
+        output.precision(precision);
+    }
+
+}
@@ -0,0 +1,85 @@
+#include "Chip8Core/Profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <ostream>
+#include <string>
+
+namespace Chip8 {
+
+    void Profiler::reset() noexcept {
+        mOpcodes.fill(OpcodeStatistics{});
+        mAddressCounts.fill(0);
+    }
+
+    const Profiler::OpcodeStatistics& Profiler::getOpcodeStatistics(size_t opcodeIndex) const {
+        return mOpcodes.at(opcodeIndex);
+    }
+
+    const char* Profiler::getOpcodeName(size_t opcodeIndex) {
+        return (opcodeIndex < Opcodes.size() ? std::get<0>(Opcodes.at(opcodeIndex)) : "unknown");
+    }
+
+    uint64_t Profiler::getTotalExecutions() const noexcept {
+        uint64_t result = 0;
+        for (const auto& statistics : mOpcodes)
+            result += statistics.executions;
+        return result;
+    }
+
+    uint64_t Profiler::getTotalTime() const noexcept {
+        uint64_t result = 0;
+        for (const auto& statistics : mOpcodes)
+            result += statistics.totalTime;
+        return result;
+    }
+
+    const std::array<uint64_t, Profiler::AddressCount>& Profiler::getAddressCounts() const noexcept {
+        return mAddressCounts;
+    }
+
+    std::vector<uint16_t> Profiler::getHotAddresses(size_t count) const {
+        std::vector<uint16_t> addresses(AddressCount);
+        std::iota(addresses.begin(), addresses.end(), uint16_t{ 0 });
+        const auto isHotter = [this](uint16_t lhs, uint16_t rhs) {
+            return (mAddressCounts[lhs] != mAddressCounts[rhs] ? mAddressCounts[lhs] > mAddressCounts[rhs] : lhs < rhs);
+        };
+        count = std::min(count, addresses.size());
+        std::partial_sort(addresses.begin(), addresses.begin() + static_cast<std::ptrdiff_t>(count), addresses.end(), isHotter);
+        addresses.resize(count);
+        addresses.erase(std::find_if(addresses.begin(), addresses.end(), [this](uint16_t address) { return mAddressCounts[address] == 0; }),
+            addresses.end());
+        return addresses;
+    }
+
+    void Profiler::writeHeatMapCsv(std::ostream& output) const {
+        // formatted without manipulators, so the state of the caller's stream neither changes nor matters
+        for (size_t address = 0; address < AddressCount; ++address) {
+            if (mAddressCounts[address] == 0)
+                continue;
+            char label[8];
+            std::snprintf(label, sizeof(label), "%03X,", static_cast<unsigned>(address));
+            output << label << std::to_string(mAddressCounts[address]) << '\n';
+        }
+    }
+
+    void Profiler::writeJson(std::ostream& output) const {
+        output << "{\"total_executions\": " << getTotalExecutions()
+            << ", \"total_time_ns\": " << getTotalTime()
+            << ", \"opcodes\": [";
+        for (size_t i = 0; i < mOpcodes.size(); ++i) {
+            const auto& statistics = mOpcodes[i];
+            output << (i > 0 ? ", " : "")
+                << "{\"opcode\": \"" << getOpcodeName(i) << "\", "
+                << "\"executions\": " << statistics.executions << ", "
+                << "\"time_ns\": " << statistics.totalTime << ", "
+                << "\"histogram\": [";
+            for (size_t bucket = 0; bucket < statistics.histogram.size(); ++bucket)
+                output << (bucket > 0 ? ", " : "") << statistics.histogram[bucket];
+            output << "]}";
+        }
+        output << "]}";
+    }
+
+}
@@ -0,0 +1,213 @@
+#include "Chip8Core/RewindBuffer.hpp"
+
+#include <algorithm>
+#include <gsl/gsl>
+
+namespace Chip8 {
+
+    namespace {
+
+        // xor runs of zero bytes shorter than this are stored inline as literals
+        constexpr size_t MinimumZeroRun = 4u;
+
+        void writeVarint(std::vector<uint8_t>& buffer, size_t value) {
+            while (value >= 0x80) {
+                buffer.push_back(gsl::narrow_cast<uint8_t>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(gsl::narrow_cast<uint8_t>(value));
+        }
+
+        size_t readVarint(const std::vector<uint8_t>& buffer, size_t& position) noexcept {
+            size_t result = 0;
+            size_t shift = 0;
+            while (position < buffer.size()) {
+                const uint8_t byte = buffer[position++];
+                result |= static_cast<size_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0x0)
+                    break;
+                shift += 7;
+            }
+            return result;
+        }
+
+    }
+
+    RewindBuffer::RewindBuffer(size_t memoryBudget, size_t keyframeInterval)
+        : mMemoryBudget(memoryBudget), mKeyframeInterval(std::max<size_t>(keyframeInterval, 1u))
+        , mFramesSinceKeyframe(0), mPosition(0), mMemoryUsage(0), mNewestState({}), mPositionState({})
+        , mScratchState({})
+    {}
+
+    void RewindBuffer::push(const Chip8& chip8) {
+        truncateAfterPosition();
+        chip8.saveState(mScratchState);
+
+        Frame frame;
+        const bool isKeyframe = (mFrames.empty() || mFramesSinceKeyframe + 1 >= mKeyframeInterval);
+        if (!mFrames.empty())
+            frame.delta = encode(mScratchState, mNewestState);
+        if (isKeyframe) {
+            static const Chip8::State emptyState{};
+            frame.keyframe = encode(mScratchState, emptyState);
+            mFramesSinceKeyframe = 0;
+        } else {
+            ++mFramesSinceKeyframe;
+        }
+        mMemoryUsage += frameSize(frame);
+        mFrames.push_back(std::move(frame));
+
+        mNewestState = mScratchState;
+        mPositionState = mScratchState;
+        mPosition = mFrames.size() - 1;
+        enforceMemoryBudget();
+    }
+
+    bool RewindBuffer::restore(size_t index, Chip8& chip8) {
+        if (index >= mFrames.size())
+            return false;
+
+        // find the nearest keyframe at or before the requested frame
+        size_t keyframeIndex = index;
+        while (mFrames[keyframeIndex].keyframe.empty())
+            --keyframeIndex; // the oldest frame is always a keyframe
+        const size_t distanceFromPosition = (index > mPosition ? index - mPosition : mPosition - index);
+
+        if (index - keyframeIndex < distanceFromPosition) {
+            mPositionState.fill(0x0);
+            applyXor(mFrames[keyframeIndex].keyframe, mPositionState);
+            mPosition = keyframeIndex;
+        }
+        // since the deltas are XORs they can be applied in both directions
+        while (mPosition < index)
+            applyXor(mFrames[++mPosition].delta, mPositionState);
+        while (mPosition > index)
+            applyXor(mFrames[mPosition--].delta, mPositionState);
+
+        chip8.loadState(mPositionState);
+        return true;
+    }
+
+    bool RewindBuffer::stepBack(Chip8& chip8) {
+        if (mFrames.empty() || mPosition == 0)
+            return false;
+        return restore(mPosition - 1, chip8);
+    }
+
+    void RewindBuffer::clear() noexcept {
+        mFrames.clear();
+        mFramesSinceKeyframe = 0;
+        mPosition = 0;
+        mMemoryUsage = 0;
+    }
+
+    size_t RewindBuffer::size() const noexcept {
+        return mFrames.size();
+    }
+
+    size_t RewindBuffer::getPosition() const noexcept {
+        return mPosition;
+    }
+
+    size_t RewindBuffer::getMemoryUsage() const noexcept {
+        return mMemoryUsage;
+    }
+
+    size_t RewindBuffer::getMemoryBudget() const noexcept {
+        return mMemoryBudget;
+    }
+
+    void RewindBuffer::setMemoryBudget(size_t memoryBudget) {
+        mMemoryBudget = memoryBudget;
+        enforceMemoryBudget();
+    }
+
+    std::vector<uint8_t> RewindBuffer::encode(const Chip8::State& state, const Chip8::State& reference) {
+        // format: a sequence of (number of unchanged bytes, number of literal bytes, literal bytes)
+        //         with both numbers being varints and the literal bytes being XORed with the reference
+        std::vector<uint8_t> result;
+        size_t i = 0;
+        while (i < state.size()) {
+            const size_t zeroRunStart = i;
+            while (i < state.size() && state[i] == reference[i])
+                ++i;
+            if (i == state.size())
+                break;
+            const size_t literalStart = i;
+            while (i < state.size()) {
+                if (state[i] != reference[i]) {
+                    ++i;
+                    continue;
+                }
+                size_t runEnd = i;
+                while (runEnd < state.size() && runEnd - i < MinimumZeroRun && state[runEnd] == reference[runEnd])
+                    ++runEnd;
+                if (runEnd - i >= MinimumZeroRun || runEnd == state.size())
+                    break;
+                i = runEnd;
+            }
+            writeVarint(result, literalStart - zeroRunStart);
+            writeVarint(result, i - literalStart);
+            for (size_t j = literalStart; j < i; ++j)
+                result.push_back(state[j] ^ reference[j]);
+        }
+        result.shrink_to_fit();
+        return result;
+    }
+
+    void RewindBuffer::applyXor(const std::vector<uint8_t>& encoded, Chip8::State& state) {
+        size_t readPosition = 0;
+        size_t statePosition = 0;
+        while (readPosition < encoded.size()) {
+            statePosition += readVarint(encoded, readPosition);
+            const size_t literalLength = readVarint(encoded, readPosition);
+            Expects(statePosition + literalLength <= state.size());
+            Expects(readPosition + literalLength <= encoded.size());
+            for (size_t i = 0; i < literalLength; ++i)
+                state[statePosition++] ^= encoded[readPosition++];
+        }
+    }
+
+    size_t RewindBuffer::frameSize(const Frame& frame) noexcept {
+        return sizeof(Frame) + frame.delta.capacity() + frame.keyframe.capacity();
+    }
+
+    void RewindBuffer::truncateAfterPosition() {
+        if (mFrames.empty() || mPosition + 1 >= mFrames.size())
+            return;
+        while (mFrames.size() > mPosition + 1) {
+            mMemoryUsage -= frameSize(mFrames.back());
+            mFrames.pop_back();
+        }
+        mNewestState = mPositionState;
+        mFramesSinceKeyframe = 0;
+        for (size_t i = mFrames.size() - 1; mFrames[i].keyframe.empty(); --i)
+            ++mFramesSinceKeyframe;
+    }
+
+    void RewindBuffer::enforceMemoryBudget() {
+        while (mMemoryUsage > mMemoryBudget) {
+            // drop the oldest keyframe group, but always keep the newest one
+            size_t nextKeyframe = 1;
+            while (nextKeyframe < mFrames.size() && mFrames[nextKeyframe].keyframe.empty())
+                ++nextKeyframe;
+            if (nextKeyframe >= mFrames.size())
+                break;
+            for (size_t i = 0; i < nextKeyframe; ++i) {
+                mMemoryUsage -= frameSize(mFrames.front());
+                mFrames.pop_front();
+            }
+            // the delta of the new oldest frame refers to a dropped frame
+            mMemoryUsage -= mFrames.front().delta.capacity();
+            mFrames.front().delta = {};
+            if (mPosition >= nextKeyframe) {
+                mPosition -= nextKeyframe;
+            } else {
+                mPosition = 0;
+                mPositionState.fill(0x0);
+                applyXor(mFrames.front().keyframe, mPositionState);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,323 @@
+#include "Chip8Core/RomLibrary.hpp"
+
+#ifdef _MSC_VER
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <system_error>
+
+#include "Chip8Core/Json.hpp"
+#include "Chip8Core/ThreadPool.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr const char* IndexHeader = "# Chip8 ROM library index v2";
+
+        std::string toLowerCase(std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return text;
+        }
+
+        bool readFile(const std::string& filename, std::string& content) {
+            std::ifstream file(filename, std::ios::binary);
+            if (!file.good())
+                return false;
+            std::ostringstream stream;
+            stream << file.rdbuf();
+            content = stream.str();
+            return true;
+        }
+
+        std::optional<Sha1Digest> parseSha1(const std::string& text) {
+            if (text.size() != 40)
+                return {};
+            Sha1Digest digest;
+            for (size_t i = 0; i < digest.size(); ++i) {
+                unsigned value = 0;
+                for (size_t j = 0; j < 2; ++j) {
+                    const char c = static_cast<char>(std::tolower(static_cast<unsigned char>(text[2 * i + j])));
+                    value <<= 4;
+                    if (c >= '0' && c <= '9')
+                        value |= static_cast<unsigned>(c - '0');
+                    else if (c >= 'a' && c <= 'f')
+                        value |= static_cast<unsigned>(c - 'a' + 10);
+                    else
+                        return {};
+                }
+                digest[i] = static_cast<uint8_t>(value);
+            }
+            return digest;
+        }
+
+        // used when the database comes without platforms.json
+        CompatibilityMode guessCompatibilityMode(const std::string& platform) {
+            const auto name = toLowerCase(platform);
+            const bool isSuperChipLike = (name.find("superchip") != std::string::npos || name.find("schip") != std::string::npos
+                || name.find("chip48") != std::string::npos || name.find("xochip") != std::string::npos);
+            return (isSuperChipLike ? CompatibilityMode::SuperChip : CompatibilityMode::OriginalChip8);
+        }
+
+        // tabs and line breaks would break the index format, so they are written as \t, \n and \r (and \ as \\)
+        std::string escape(const std::string& text) {
+            std::string result;
+            result.reserve(text.size());
+            for (const char c : text) {
+                switch (c) {
+                    case '\\': result += "\\\\"; break;
+                    case '\t': result += "\\t"; break;
+                    case '\n': result += "\\n"; break;
+                    case '\r': result += "\\r"; break;
+                    default: result += c; break;
+                }
+            }
+            return result;
+        }
+
+        std::optional<std::string> unescape(const std::string& text) {
+            std::string result;
+            result.reserve(text.size());
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] != '\\') {
+                    result += text[i];
+                    continue;
+                }
+                if (++i == text.size())
+                    return std::nullopt;
+                switch (text[i]) {
+                    case '\\': result += '\\'; break;
+                    case 't': result += '\t'; break;
+                    case 'n': result += '\n'; break;
+                    case 'r': result += '\r'; break;
+                    default: return std::nullopt;
+                }
+            }
+            return result;
+        }
+
+        void applyDatabase(RomLibrary::Entry& entry, const RomDatabase& database) {
+            const auto* known = database.find(entry.hash);
+            entry.known = (known != nullptr);
+            if (known) {
+                entry.title = known->title;
+                entry.platform = known->platform;
+                entry.compatibilityMode = known->compatibilityMode;
+                entry.tickrate = known->tickrate;
+            } else {
+                entry.title = fs::path(entry.path).stem().string();
+                entry.platform.clear();
+                entry.compatibilityMode = CompatibilityMode::SuperChip;
+                entry.tickrate = 0;
+            }
+        }
+
+    }
+
+    bool RomDatabase::load(const std::string& directory, std::string& error) {
+        std::string programs, platforms;
+        const auto programsPath = (fs::path(directory) / "programs.json").string();
+        if (!readFile(programsPath, programs)) {
+            error = "could not read " + programsPath;
+            return false;
+        }
+        readFile((fs::path(directory) / "platforms.json").string(), platforms); // optional
+        return loadFromJson(programs, platforms, error);
+    }
+
+    bool RomDatabase::loadFromJson(const std::string& programs, const std::string& platforms, std::string& error) {
+        const auto programsDocument = parseJson(programs, error);
+        if (!programsDocument) {
+            error = "programs.json: " + error;
+            return false;
+        }
+        if (!programsDocument->isArray()) {
+            error = "programs.json: expected an array of programs";
+            return false;
+        }
+
+        // a platform is run with the SuperChip profile if it shifts VX in place or leaves I unchanged
+        std::unordered_map<std::string, CompatibilityMode> platformModes;
+        if (!platforms.empty()) {
+            const auto platformsDocument = parseJson(platforms, error);
+            if (!platformsDocument) {
+                error = "platforms.json: " + error;
+                return false;
+            }
+            for (const auto& platform : platformsDocument->asArray()) {
+                const auto& quirks = platform["quirks"];
+                platformModes[platform["id"].asString()] = (quirks["shift"].asBool() || quirks["memoryLeaveIUnchanged"].asBool()
+                    ? CompatibilityMode::SuperChip : CompatibilityMode::OriginalChip8);
+            }
+        }
+
+        std::unordered_map<std::string, Entry> entries;
+        for (const auto& program : programsDocument->asArray()) {
+            for (const auto& [hash, rom] : program["roms"].asObject()) {
+                if (!parseSha1(hash))
+                    continue;
+                Entry entry;
+                entry.title = program["title"].asString();
+                const auto& romPlatforms = rom["platforms"].asArray();
+                if (!romPlatforms.empty())
+                    entry.platform = romPlatforms.front().asString();
+                const auto platformMode = platformModes.find(entry.platform);
+                entry.compatibilityMode = (platformMode != platformModes.end() ? platformMode->second : guessCompatibilityMode(entry.platform));
+                entry.tickrate = static_cast<uint32_t>(std::clamp(rom["tickrate"].asNumber(), 0.0, 100000.0));
+                entries[toLowerCase(hash)] = std::move(entry);
+            }
+        }
+        mEntries = std::move(entries);
+        return true;
+    }
+
+    const RomDatabase::Entry* RomDatabase::find(const Sha1Digest& hash) const {
+        const auto entry = mEntries.find(toHexString(hash));
+        return (entry == mEntries.end() ? nullptr : &entry->second);
+    }
+
+    size_t RomDatabase::size() const noexcept {
+        return mEntries.size();
+    }
+
+    bool RomLibrary::isRomFile(const std::string& filename) {
+        const auto extension = toLowerCase(fs::path(filename).extension().string());
+        return extension == ".ch8" || extension == ".c8" || extension == ".sc8" || extension == ".xo8";
+    }
+
+    size_t RomLibrary::scan(const std::vector<std::string>& directories, const RomDatabase& database, ThreadPool& threadPool) {
+        // listing the directories is sequential, hashing is done in parallel
+        std::vector<Entry> entries;
+        for (const auto& directory : directories) {
+            std::error_code errorCode;
+            for (fs::recursive_directory_iterator iterator(directory, errorCode), end; !errorCode && iterator != end; iterator.increment(errorCode)) {
+                if (fs::is_regular_file(iterator->status()) && isRomFile(iterator->path().string())) {
+                    Entry entry;
+                    entry.path = iterator->path().string();
+                    entries.push_back(std::move(entry));
+                }
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+        entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path == b.path; }), entries.end());
+
+        std::unordered_map<std::string, const Entry*> indexed;
+        for (const auto& entry : mEntries)
+            indexed[entry.path] = &entry;
+        std::vector<uint8_t> hashed(entries.size(), 0);
+        std::vector<uint8_t> readable(entries.size(), 1);
+        threadPool.parallelFor(entries.size(), [&](size_t index) {
+            auto& entry = entries[index];
+            const auto previous = indexed.find(entry.path);
+            const auto stamp = MappedFile::getStamp(entry.path);
+            if (previous != indexed.end() && stamp && stamp.value() == previous->second->stamp) {
+                entry.hash = previous->second->hash;
+                entry.stamp = previous->second->stamp;
+            } else {
+                try {
+                    const MappedFile file(entry.path);
+                    entry.hash = sha1(file.data(), file.size());
+                    entry.stamp = file.getStamp();
+                    hashed[index] = 1;
+                } catch (const std::exception&) {
+                    readable[index] = 0;
+                }
+            }
+            applyDatabase(entry, database); // the database may have changed since the last scan
+        });
+
+        mEntries.clear();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (readable[i])
+                mEntries.push_back(std::move(entries[i]));
+        }
+        return static_cast<size_t>(std::count(hashed.begin(), hashed.end(), 1));
+    }
+
+    bool RomLibrary::loadIndex(const std::string& filename) {
+        std::ifstream file(filename);
+        std::string line;
+        if (!std::getline(file, line) || line != IndexHeader)
+            return false;
+        std::vector<Entry> entries;
+        while (std::getline(file, line)) {
+            if (line.empty())
+                continue;
+            std::vector<std::string> fields;
+            std::istringstream lineStream(line);
+            for (std::string field; std::getline(lineStream, field, '\t');)
+                fields.push_back(field);
+            if (fields.size() != 9)
+                return false;
+            Entry entry;
+            const auto hash = parseSha1(fields[0]);
+            if (!hash)
+                return false;
+            entry.hash = hash.value();
+            try {
+                entry.stamp.size = std::stoull(fields[1]);
+                entry.stamp.modificationTime = std::stoll(fields[2]);
+                entry.tickrate = static_cast<uint32_t>(std::stoul(fields[4]));
+            } catch (const std::exception&) {
+                return false;
+            }
+            entry.compatibilityMode = (fields[3] == "chip8" ? CompatibilityMode::OriginalChip8 : CompatibilityMode::SuperChip);
+            entry.known = (fields[5] == "1");
+            auto platform = unescape(fields[6]);
+            auto title = unescape(fields[7]);
+            auto path = unescape(fields[8]);
+            if (!platform || !title || !path)
+                return false;
+            entry.platform = std::move(platform.value());
+            entry.title = std::move(title.value());
+            entry.path = std::move(path.value());
+            entries.push_back(std::move(entry));
+        }
+        mEntries = std::move(entries);
+        return true;
+    }
+
+    bool RomLibrary::saveIndex(const std::string& filename) const {
+        std::ofstream file(filename);
+        file << IndexHeader << '\n';
+        for (const auto& entry : mEntries) {
+            file << toHexString(entry.hash) << '\t'
+                << entry.stamp.size << '\t'
+                << entry.stamp.modificationTime << '\t'
+                << (entry.compatibilityMode == CompatibilityMode::OriginalChip8 ? "chip8" : "superchip") << '\t'
+                << entry.tickrate << '\t'
+                << (entry.known ? '1' : '0') << '\t'
+                << escape(entry.platform) << '\t'
+                << escape(entry.title) << '\t'
+                << escape(entry.path) << '\n';
+        }
+        return file.good();
+    }
+
+    std::vector<size_t> RomLibrary::search(const std::string& query) const {
+        const auto lowerCaseQuery = toLowerCase(query);
+        std::vector<std::string> titles(mEntries.size());
+        std::vector<size_t> result;
+        for (size_t i = 0; i < mEntries.size(); ++i) {
+            titles[i] = toLowerCase(mEntries[i].title);
+            if (titles[i].find(lowerCaseQuery) != std::string::npos || toLowerCase(mEntries[i].path).find(lowerCaseQuery) != std::string::npos)
+                result.push_back(i);
+        }
+        std::stable_sort(result.begin(), result.end(), [&titles](size_t a, size_t b) { return titles[a] < titles[b]; });
+        return result;
+    }
+
+    const std::vector<RomLibrary::Entry>& RomLibrary::getEntries() const noexcept {
+        return mEntries;
+    }
+
+}
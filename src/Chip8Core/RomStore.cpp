@@ -0,0 +1,82 @@
+#include "Chip8Core/RomStore.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace Chip8 {
+
+    Rom::Rom(const uint8_t* data, size_t size)
+        : mHash(sha1(data, size)), mSize(std::min(size, MaximumSize))
+    {
+        static_assert(Chip8::ProgramOffset % Memory::PageSize == 0, "the program has to start at a page boundary");
+        for (size_t offset = 0; offset < mSize; offset += Memory::PageSize) {
+            auto page = std::make_shared<Page>();
+            page->fill(0x0);
+            std::copy(data + offset, data + std::min(mSize, offset + Memory::PageSize), page->begin());
+            mPages.push_back(std::move(page));
+        }
+    }
+
+    const Sha1Digest& Rom::getHash() const noexcept {
+        return mHash;
+    }
+
+    size_t Rom::getSize() const noexcept {
+        return mSize;
+    }
+
+    const std::vector<std::shared_ptr<const Rom::Page>>& Rom::getPages() const noexcept {
+        return mPages;
+    }
+
+    std::shared_ptr<const Rom> RomStore::load(const std::string& filename, bool revalidate) {
+        std::lock_guard lock(mMutex);
+        const auto entry = mPaths.find(filename);
+        if (entry != mPaths.end()) {
+            if (!revalidate)
+                return entry->second.rom;
+            const auto stamp = MappedFile::getStamp(filename);
+            if (stamp && stamp.value() == entry->second.stamp)
+                return entry->second.rom;
+        }
+
+        try {
+            const MappedFile file(filename);
+            auto rom = insert(file.data(), file.size());
+            mPaths[filename] = { file.getStamp(), rom };
+            return rom;
+        } catch (const std::exception&) {
+            mPaths.erase(filename);
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<const Rom> RomStore::add(const uint8_t* data, size_t size) {
+        std::lock_guard lock(mMutex);
+        return insert(data, size);
+    }
+
+    std::shared_ptr<const Rom> RomStore::find(const Sha1Digest& hash) const {
+        std::lock_guard lock(mMutex);
+        const auto entry = mRoms.find(hash);
+        return (entry == mRoms.end() ? nullptr : entry->second);
+    }
+
+    size_t RomStore::size() const {
+        std::lock_guard lock(mMutex);
+        return mRoms.size();
+    }
+
+    void RomStore::clear() {
+        std::lock_guard lock(mMutex);
+        mRoms.clear();
+        mPaths.clear();
+    }
+
+    std::shared_ptr<const Rom> RomStore::insert(const uint8_t* data, size_t size) {
+        auto rom = std::make_shared<const Rom>(data, size);
+        // an existing ROM with the same content wins, so its pages stay shared
+        return mRoms.emplace(rom->getHash(), rom).first->second;
+    }
+
+}
@@ -0,0 +1,253 @@
+#include "Chip8Core/Session.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr uint32_t Magic = 0x43385353; // "C8SS"
+        constexpr uint32_t Version = 2;
+        constexpr size_t SlotCount = 3;
+        constexpr uint32_t RingSize = 64;
+        constexpr int MaximumReadAttempts = 1000; // a backend that stays inside publish() this long has crashed or stalled
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+            "the shared memory protocol requires lock-free atomics");
+
+        struct InputEvent {
+            int64_t time;
+            uint8_t key;
+            uint8_t pressed;
+        };
+
+        struct Slot {
+            std::atomic<uint64_t> sequence; ///< odd while the slot is being written
+            SessionFrame frame;
+        };
+
+        struct ViewerChannel {
+            std::atomic<uint32_t> attached; ///< process id of the viewer (0 if the channel is free)
+            std::atomic<uint32_t> head; ///< written by the viewer (producer)
+            std::atomic<uint32_t> tail; ///< written by the backend (consumer)
+            std::array<InputEvent, RingSize> events;
+        };
+
+        // the layout of the shared memory segment
+        struct SessionLayout {
+            uint32_t magic;
+            uint32_t version;
+            std::atomic<uint32_t> latestSlot;
+            std::atomic<uint64_t> frameCount;
+            std::array<Slot, SlotCount> slots;
+            std::array<ViewerChannel, SessionFrame::MaximumViewers> viewers;
+        };
+
+        int64_t now() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        SessionLayout& getLayout(SharedMemory& memory) noexcept {
+            return *reinterpret_cast<SessionLayout*>(memory.data());
+        }
+
+        uint32_t getProcessId() noexcept {
+#ifdef _WIN32
+            return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+            return static_cast<uint32_t>(getpid());
+#endif
+        }
+
+        // a viewer that has crashed never frees its channel, so channels of processes that are gone are reclaimed
+        bool isProcessAlive(uint32_t processId) noexcept {
+#ifdef _WIN32
+            HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(processId));
+            if (process == nullptr)
+                return GetLastError() != ERROR_INVALID_PARAMETER;
+            const bool alive = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+            CloseHandle(process);
+            return alive;
+#else
+            return kill(static_cast<pid_t>(processId), 0) == 0 || errno == EPERM;
+#endif
+        }
+
+    }
+
+    void SessionLatency::add(double seconds) noexcept {
+        ++samples;
+        last = seconds;
+        mean += (seconds - mean) / static_cast<double>(samples);
+        maximum = std::max(maximum, seconds);
+    }
+
+    SessionBackend::SessionBackend(const std::string& name)
+        : mMemory(name, sizeof(SessionLayout), SharedMemory::Mode::Create), mFrameCount(0), mInputEcho({})
+    {
+        // the segment is zero-initialized, which is a valid state for all atomics
+        auto* layout = new (mMemory.data()) SessionLayout;
+        layout->latestSlot.store(0, std::memory_order_relaxed);
+        layout->frameCount.store(0, std::memory_order_relaxed);
+        for (auto& slot : layout->slots)
+            slot.sequence.store(0, std::memory_order_relaxed);
+        for (auto& viewer : layout->viewers) {
+            viewer.attached.store(0, std::memory_order_relaxed);
+            viewer.head.store(0, std::memory_order_relaxed);
+            viewer.tail.store(0, std::memory_order_relaxed);
+        }
+        layout->version = Version;
+        std::atomic_thread_fence(std::memory_order_release);
+        layout->magic = Magic;
+    }
+
+    void SessionBackend::publish(const Chip8& chip8) noexcept {
+        auto& layout = getLayout(mMemory);
+        const uint32_t slotIndex = (layout.latestSlot.load(std::memory_order_relaxed) + 1) % SlotCount;
+        auto& slot = layout.slots[slotIndex];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.frame.frameNumber = ++mFrameCount;
+        slot.frame.inputEcho = mInputEcho;
+        chip8.saveState(slot.frame.state);
+        slot.frame.publishTime = now();
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        layout.latestSlot.store(slotIndex, std::memory_order_release);
+        layout.frameCount.store(mFrameCount, std::memory_order_release);
+    }
+
+    size_t SessionBackend::pollInput(Chip8& chip8) noexcept {
+        auto& layout = getLayout(mMemory);
+        size_t count = 0;
+        for (size_t i = 0; i < layout.viewers.size(); ++i) {
+            auto& viewer = layout.viewers[i];
+            uint32_t tail = viewer.tail.load(std::memory_order_relaxed);
+            const uint32_t head = viewer.head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail, ++count) {
+                const auto& event = viewer.events[tail % RingSize];
+                if (event.pressed)
+                    chip8.triggerKeyDown(event.key);
+                else
+                    chip8.triggerKeyUp(event.key);
+                mInputEcho[i] = event.time;
+            }
+            viewer.tail.store(tail, std::memory_order_release);
+        }
+        return count;
+    }
+
+    size_t SessionBackend::getViewerCount() const noexcept {
+        const auto& layout = *reinterpret_cast<const SessionLayout*>(mMemory.data());
+        return static_cast<size_t>(std::count_if(layout.viewers.begin(), layout.viewers.end(),
+            [](const ViewerChannel& viewer) {
+                const uint32_t processId = viewer.attached.load(std::memory_order_relaxed);
+                return processId != 0 && isProcessAlive(processId);
+            }));
+    }
+
+    uint64_t SessionBackend::getFrameCount() const noexcept {
+        return mFrameCount;
+    }
+
+    SessionViewer::SessionViewer(const std::string& name)
+        : mMemory(name, 0, SharedMemory::Mode::Open), mViewerIndex(0), mPendingInputTime(0), mLastInputTime(0), mLastFrameNumber(0)
+    {
+        if (mMemory.size() < sizeof(SessionLayout))
+            throw std::runtime_error(name + " is not a session");
+        auto& layout = getLayout(mMemory);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (layout.magic != Magic || layout.version != Version)
+            throw std::runtime_error(name + " is not a session");
+        const uint32_t processId = getProcessId();
+        for (mViewerIndex = 0; mViewerIndex < layout.viewers.size(); ++mViewerIndex) {
+            auto& attached = layout.viewers[mViewerIndex].attached;
+            uint32_t expected = 0;
+            if (attached.compare_exchange_strong(expected, processId, std::memory_order_acq_rel))
+                break;
+            if (!isProcessAlive(expected) && attached.compare_exchange_strong(expected, processId, std::memory_order_acq_rel))
+                break;
+        }
+        if (mViewerIndex == layout.viewers.size())
+            throw std::runtime_error("too many viewers attached to " + name);
+    }
+
+    SessionViewer::~SessionViewer() {
+        getLayout(mMemory).viewers[mViewerIndex].attached.store(0, std::memory_order_release);
+    }
+
+    bool SessionViewer::read(SessionFrame& frame) noexcept {
+        auto& layout = getLayout(mMemory);
+        if (layout.frameCount.load(std::memory_order_acquire) == 0)
+            return false;
+        bool consistent = false;
+        for (int attempt = 0; attempt < MaximumReadAttempts && !consistent; ++attempt) {
+            const auto& slot = layout.slots[layout.latestSlot.load(std::memory_order_acquire)];
+            const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence % 2 != 0)
+                continue; // the backend is writing into this slot right now
+            std::memcpy(&frame, &slot.frame, sizeof(SessionFrame));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            consistent = (slot.sequence.load(std::memory_order_relaxed) == sequence);
+        }
+        if (!consistent)
+            return false;
+
+        const int64_t time = now();
+        if (frame.frameNumber != mLastFrameNumber) {
+            mFrameLatency.add(static_cast<double>(time - frame.publishTime) * 1e-9);
+            mLastFrameNumber = frame.frameNumber;
+        }
+        if (mPendingInputTime != 0 && frame.inputEcho[mViewerIndex] >= mPendingInputTime) {
+            mInputLatency.add(static_cast<double>(time - mPendingInputTime) * 1e-9);
+            // events sent after the one that has been measured start the next measurement
+            mPendingInputTime = (frame.inputEcho[mViewerIndex] >= mLastInputTime ? 0 : mLastInputTime);
+        }
+        return true;
+    }
+
+    bool SessionViewer::sendKey(uint8_t key, bool pressed) noexcept {
+        auto& viewer = getLayout(mMemory).viewers[mViewerIndex];
+        const uint32_t head = viewer.head.load(std::memory_order_relaxed);
+        if (head - viewer.tail.load(std::memory_order_acquire) >= RingSize)
+            return false;
+        const int64_t time = now();
+        viewer.events[head % RingSize] = { time, key, static_cast<uint8_t>(pressed ? 1 : 0) };
+        viewer.head.store(head + 1, std::memory_order_release);
+        if (mPendingInputTime == 0)
+            mPendingInputTime = time;
+        mLastInputTime = time;
+        return true;
+    }
+
+    size_t SessionViewer::getViewerIndex() const noexcept {
+        return mViewerIndex;
+    }
+
+    const SessionLatency& SessionViewer::getFrameLatency() const noexcept {
+        return mFrameLatency;
+    }
+
+    const SessionLatency& SessionViewer::getInputLatency() const noexcept {
+        return mInputLatency;
+    }
+
+}
@@ -0,0 +1,109 @@
+#include "Chip8Core/SharedMemory.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8 {
+
+#ifdef _WIN32
+    SharedMemory::SharedMemory(const std::string& name, size_t size, Mode mode)
+        : mName(name), mData(nullptr), mSize(size), mIsOwner(mode == Mode::Create), mHandle(nullptr)
+    {
+        if (mode == Mode::Create) {
+            const auto size64 = static_cast<unsigned long long>(size);
+            mHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xFFFFFFFF), name.c_str());
+        } else {
+            mHandle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+        }
+        if (!mHandle)
+            throw std::runtime_error("Could not " + std::string(mode == Mode::Create ? "create" : "open") + " shared memory " + name);
+        mData = static_cast<uint8_t*>(MapViewOfFile(mHandle, FILE_MAP_ALL_ACCESS, 0, 0, (mode == Mode::Create ? size : 0)));
+        if (!mData) {
+            CloseHandle(mHandle);
+            throw std::runtime_error("Could not map shared memory " + name);
+        }
+        if (mode == Mode::Open) {
+            MEMORY_BASIC_INFORMATION information;
+            VirtualQuery(mData, &information, sizeof(information));
+            mSize = information.RegionSize;
+        }
+    }
+
+    SharedMemory::~SharedMemory() {
+        if (mData)
+            UnmapViewOfFile(mData);
+        if (mHandle)
+            CloseHandle(mHandle); // the mapping disappears together with its last handle
+    }
+#else
+    SharedMemory::SharedMemory(const std::string& name, size_t size, Mode mode)
+        : mName(name), mData(nullptr), mSize(size), mIsOwner(mode == Mode::Create), mHandle(nullptr)
+    {
+        const int descriptor = (mode == Mode::Create
+            ? shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR)
+            : shm_open(name.c_str(), O_RDWR, 0));
+        if (descriptor < 0)
+            throw std::runtime_error("Could not " + std::string(mode == Mode::Create ? "create" : "open") + " shared memory " + name);
+        bool success;
+        if (mode == Mode::Create) {
+            success = (ftruncate(descriptor, static_cast<off_t>(size)) == 0);
+        } else {
+            struct stat status;
+            success = (fstat(descriptor, &status) == 0);
+            mSize = static_cast<size_t>(status.st_size);
+        }
+        void* address = MAP_FAILED;
+        if (success)
+            address = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        close(descriptor); // the mapping stays valid
+        if (address == MAP_FAILED) {
+            if (mIsOwner)
+                shm_unlink(name.c_str());
+            throw std::runtime_error("Could not map shared memory " + name);
+        }
+        mData = static_cast<uint8_t*>(address);
+    }
+
+    SharedMemory::~SharedMemory() {
+        if (mData)
+            munmap(mData, mSize);
+        if (mData && mIsOwner)
+            shm_unlink(mName.c_str());
+    }
+#endif
+
+    SharedMemory::SharedMemory(SharedMemory&& other) noexcept
+        : mName(std::move(other.mName)), mData(std::exchange(other.mData, nullptr)), mSize(std::exchange(other.mSize, 0))
+        , mIsOwner(std::exchange(other.mIsOwner, false)), mHandle(std::exchange(other.mHandle, nullptr))
+    {}
+
+    uint8_t* SharedMemory::data() noexcept {
+        return mData;
+    }
+
+    const uint8_t* SharedMemory::data() const noexcept {
+        return mData;
+    }
+
+    size_t SharedMemory::size() const noexcept {
+        return mSize;
+    }
+
+    const std::string& SharedMemory::getName() const noexcept {
+        return mName;
+    }
+
+}
@@ -0,0 +1,163 @@
+#include "Chip8Core/StreamClient.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <gsl/gsl>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8 {
+
+    namespace {
+
+        int64_t now() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    }
+
+#ifndef _WIN32
+    StreamClient::StreamClient(const std::string& host, uint16_t port)
+        : mSocket(-1), mPendingInputTime(0), mLastInputTime(0)
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0 || !addresses)
+            throw std::runtime_error("Could not resolve " + host);
+        for (const addrinfo* address = addresses; address && mSocket < 0; address = address->ai_next) {
+            mSocket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (mSocket >= 0 && connect(mSocket, address->ai_addr, address->ai_addrlen) != 0) {
+                close(mSocket);
+                mSocket = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (mSocket < 0)
+            throw std::runtime_error("Could not connect to " + host + ":" + std::to_string(port));
+        const int enable = 1;
+        setsockopt(mSocket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        if (send(mSocket, StreamHello.data(), StreamHello.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(StreamHello.size())) {
+            close(mSocket);
+            throw std::runtime_error("Could not send to " + host + ":" + std::to_string(port));
+        }
+    }
+
+    StreamClient::~StreamClient() {
+        if (mSocket >= 0)
+            close(mSocket);
+    }
+
+    bool StreamClient::receiveFrame(double timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+        while (mSocket >= 0) {
+            if (applyBufferedFrame())
+                return true;
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (remaining < 0)
+                return false;
+            pollfd descriptor{ mSocket, POLLIN, 0 };
+            const int ready = poll(&descriptor, 1, static_cast<int>(remaining));
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready <= 0)
+                return false;
+            std::array<uint8_t, 4096> buffer;
+            const ssize_t received = recv(mSocket, buffer.data(), buffer.size(), 0);
+            if (received <= 0) {
+                close(mSocket);
+                mSocket = -1;
+                return false;
+            }
+            mInput.insert(mInput.end(), buffer.begin(), buffer.begin() + received);
+            mStatistics.bytesReceived += static_cast<uint64_t>(received);
+        }
+        return false;
+    }
+
+    bool StreamClient::sendKey(uint8_t key, bool pressed) {
+        if (mSocket < 0)
+            return false;
+        const int64_t time = now();
+        std::vector<uint8_t> message{ gsl::narrow_cast<uint8_t>(StreamKeyEventSize), 0 };
+        encodeKeyEvent({ key, pressed, time }, message);
+        if (send(mSocket, message.data(), message.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(message.size())) {
+            close(mSocket);
+            mSocket = -1;
+            return false;
+        }
+        if (mPendingInputTime == 0)
+            mPendingInputTime = time;
+        mLastInputTime = time;
+        return true;
+    }
+#else
+    StreamClient::StreamClient(const std::string&, uint16_t)
+        : mSocket(-1), mPendingInputTime(0), mLastInputTime(0)
+    {
+        throw std::runtime_error("The stream client is not supported on Windows");
+    }
+
+    StreamClient::~StreamClient() = default;
+
+    bool StreamClient::receiveFrame(double) {
+        return false;
+    }
+
+    bool StreamClient::sendKey(uint8_t, bool) {
+        return false;
+    }
+#endif
+
+    bool StreamClient::applyBufferedFrame() {
+        while (mInput.size() >= 2) {
+            const size_t size = mInput[0] | (static_cast<size_t>(mInput[1]) << 8);
+            if (mInput.size() - 2 < size)
+                return false;
+            const bool applied = mDecoder.decode(mInput.data() + 2, size);
+            mInput.erase(mInput.begin(), mInput.begin() + static_cast<std::ptrdiff_t>(size + 2));
+            if (!applied) {
+                ++mStatistics.sequenceErrors; // the next keyframe synchronizes again
+                continue;
+            }
+            ++mStatistics.frames;
+            if (mDecoder.getLastFrameType() == StreamMessageType::Keyframe)
+                ++mStatistics.keyframes;
+            const int64_t echo = mDecoder.getInputEcho();
+            if (mPendingInputTime != 0 && echo >= mPendingInputTime) {
+                mInputLatency.add(static_cast<double>(now() - mPendingInputTime) * 1e-9);
+                mPendingInputTime = (echo >= mLastInputTime ? 0 : mLastInputTime);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool StreamClient::isConnected() const noexcept {
+        return mSocket >= 0;
+    }
+
+    const FrameDecoder& StreamClient::getDecoder() const noexcept {
+        return mDecoder;
+    }
+
+    const StreamClient::Statistics& StreamClient::getStatistics() const noexcept {
+        return mStatistics;
+    }
+
+    const SessionLatency& StreamClient::getInputLatency() const noexcept {
+        return mInputLatency;
+    }
+
+}
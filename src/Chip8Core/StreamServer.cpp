@@ -0,0 +1,575 @@
+#include "Chip8Core/StreamServer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <gsl/gsl>
+
+#include "Chip8Core/Hash.hpp"
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr char const * WebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        constexpr size_t MaximumHandshakeSize = 8192;
+        constexpr size_t MaximumMessageSize = 1024; // clients only send key events
+        constexpr size_t MaximumControlPayloadSize = 125; // RFC 6455, section 5.5
+        constexpr uint16_t ProtocolErrorStatus = 1002;
+        constexpr char const * WebSocketVersion = "13";
+        constexpr char const * BadRequestResponse = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        constexpr char const * UpgradeRequiredResponse = "HTTP/1.1 426 Upgrade Required\r\n"
+            "Sec-WebSocket-Version: 13\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+        std::string encodeBase64(const uint8_t* data, size_t size) {
+            constexpr char const * alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            std::string result;
+            for (size_t i = 0; i < size; i += 3) {
+                const uint32_t block = (static_cast<uint32_t>(data[i]) << 16)
+                    | (i + 1 < size ? static_cast<uint32_t>(data[i + 1]) << 8 : 0u)
+                    | (i + 2 < size ? static_cast<uint32_t>(data[i + 2]) : 0u);
+                result += alphabet[(block >> 18) & 0x3F];
+                result += alphabet[(block >> 12) & 0x3F];
+                result += (i + 1 < size ? alphabet[(block >> 6) & 0x3F] : '=');
+                result += (i + 2 < size ? alphabet[block & 0x3F] : '=');
+            }
+            return result;
+        }
+
+        std::string toLowerCase(std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return text;
+        }
+
+        std::string trim(const std::string& text) {
+            const auto begin = text.find_first_not_of(" \t");
+            if (begin == std::string::npos)
+                return std::string();
+            return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+        }
+
+        // checks a comma separated list of tokens like the value of the Connection header (case insensitive)
+        bool containsToken(const std::string& list, const std::string& token) {
+            std::istringstream stream(toLowerCase(list));
+            for (std::string entry; std::getline(stream, entry, ',');) {
+                if (trim(entry) == token)
+                    return true;
+            }
+            return false;
+        }
+
+        // splits the head of a request (up to the empty line) into the request line and the header fields,
+        // which are keyed by their name in lower case; repeated fields are joined with commas
+        bool parseHttpRequest(const std::string& head, std::string& requestLine, std::unordered_map<std::string, std::string>& headers) {
+            const auto requestLineEnd = std::min(head.find("\r\n"), head.size());
+            requestLine = head.substr(0, requestLineEnd);
+            for (size_t lineBegin = requestLineEnd + 2; lineBegin < head.size() + 2;) {
+                const auto lineEnd = std::min(head.find("\r\n", lineBegin), head.size());
+                const auto line = head.substr(lineBegin, lineEnd - lineBegin);
+                lineBegin = lineEnd + 2;
+                const auto colon = line.find(':');
+                if (colon == std::string::npos || colon == 0)
+                    return false;
+                auto& value = headers[toLowerCase(line.substr(0, colon))];
+                value += (value.empty() ? "" : ", ") + trim(line.substr(colon + 1));
+            }
+            return true;
+        }
+
+    }
+
+    std::string getWebSocketAcceptKey(const std::string& key) {
+        const std::string text = key + WebSocketGuid;
+        const auto digest = sha1(text.data(), text.size());
+        return encodeBase64(digest.data(), digest.size());
+    }
+
+    struct StreamServer::Client {
+        enum class Protocol {
+            Unknown,
+            Raw,
+            WebSocket,
+        };
+
+        Client(uint64_t id, int socket, uint32_t keyframeInterval, std::chrono::steady_clock::time_point handshakeDeadline) noexcept
+            : id(id), socket(socket), protocol(Protocol::Unknown), handshakeDeadline(handshakeDeadline), encoder(keyframeInterval)
+            , outputOffset(0), waitingForWritable(false)
+        { }
+
+        uint64_t id;
+        int socket;
+        Protocol protocol;
+        std::chrono::steady_clock::time_point handshakeDeadline; ///< the client is closed if the protocol is still unknown then
+        FrameEncoder encoder;
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> output;
+        size_t outputOffset; ///< the bytes before this offset have already been sent
+        bool waitingForWritable; ///< EPOLLOUT is registered
+    };
+
+#ifdef __linux__
+    StreamServer::StreamServer(uint16_t port, const std::string& address, uint32_t keyframeInterval, std::chrono::milliseconds handshakeTimeout)
+        : mListenSocket(-1), mEpoll(-1), mWakeEvent(-1), mPort(port), mKeyframeInterval(keyframeInterval), mHandshakeTimeout(handshakeTimeout), mStopping(false)
+        , mClientCount(0), mNextClientId(1), mDisplay{}, mPublishedFrames(0)
+    {
+        const auto fail = [this](const std::string& message) {
+            const int error = errno;
+            for (const int descriptor : { mListenSocket, mEpoll, mWakeEvent }) {
+                if (descriptor >= 0)
+                    close(descriptor);
+            }
+            throw std::runtime_error(message + ": " + std::strerror(error));
+        };
+
+        sockaddr_in socketAddress{};
+        socketAddress.sin_family = AF_INET;
+        socketAddress.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1)
+            throw std::runtime_error("Invalid address " + address);
+        mListenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (mListenSocket < 0)
+            fail("Could not create socket");
+        const int enable = 1;
+        setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (bind(mListenSocket, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0)
+            fail("Could not bind to " + address + ":" + std::to_string(port));
+        if (listen(mListenSocket, SOMAXCONN) != 0)
+            fail("Could not listen on " + address + ":" + std::to_string(port));
+        socklen_t addressSize = sizeof(socketAddress);
+        getsockname(mListenSocket, reinterpret_cast<sockaddr*>(&socketAddress), &addressSize);
+        mPort = ntohs(socketAddress.sin_port);
+
+        mEpoll = epoll_create1(EPOLL_CLOEXEC);
+        mWakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mEpoll < 0 || mWakeEvent < 0)
+            fail("Could not create epoll instance");
+        for (const int descriptor : { mListenSocket, mWakeEvent }) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = descriptor;
+            if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, descriptor, &event) != 0)
+                fail("Could not register socket");
+        }
+        mThread = std::thread(&StreamServer::run, this);
+    }
+
+    StreamServer::~StreamServer() {
+        mStopping = true;
+        const uint64_t one = 1;
+        if (write(mWakeEvent, &one, sizeof(one)) < 0) {
+            // the counter can only overflow if the thread does not run anymore
+        }
+        mThread.join();
+        for (const auto& client : mClients)
+            close(client.first);
+        close(mListenSocket);
+        close(mWakeEvent);
+        close(mEpoll);
+    }
+
+    void StreamServer::publish(const Chip8& chip8) {
+        {
+            std::lock_guard lock(mMutex);
+            mDisplay = chip8.getPackedDisplay();
+            ++mPublishedFrames;
+            ++mStatistics.framesPublished;
+            mPublishedInput = mAppliedInput;
+        }
+        const uint64_t one = 1;
+        if (write(mWakeEvent, &one, sizeof(one)) < 0) {
+            // the network thread is already woken up
+        }
+    }
+
+    void StreamServer::run() {
+        constexpr int MaximumEvents = 64;
+        std::array<epoll_event, MaximumEvents> events;
+        uint64_t sentFrames = 0;
+        while (!mStopping) {
+            const int timeout = closeExpiredHandshakes();
+            const int count = epoll_wait(mEpoll, events.data(), MaximumEvents, timeout);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            bool woken = false;
+            for (int i = 0; i < count; ++i) {
+                const int descriptor = events[i].data.fd;
+                if (descriptor == mListenSocket) {
+                    acceptClients();
+                    continue;
+                }
+                if (descriptor == mWakeEvent) {
+                    uint64_t value;
+                    while (read(mWakeEvent, &value, sizeof(value)) > 0) { }
+                    woken = true;
+                    continue;
+                }
+                const auto iterator = mClients.find(descriptor);
+                if (iterator == mClients.end())
+                    continue; // closed while handling an earlier event
+                auto& client = *iterator->second;
+                const bool failed = (events[i].events & (EPOLLERR | EPOLLHUP))
+                    || ((events[i].events & EPOLLIN) && !receive(client))
+                    || ((events[i].events & EPOLLOUT) && !flush(client));
+                if (failed)
+                    closeClient(descriptor);
+            }
+            if (!woken || mStopping)
+                continue;
+
+            Chip8::PackedDisplay display;
+            std::unordered_map<uint64_t, int64_t> inputEcho;
+            {
+                std::lock_guard lock(mMutex);
+                if (mPublishedFrames == sentFrames)
+                    continue;
+                sentFrames = mPublishedFrames;
+                display = mDisplay;
+                inputEcho = mPublishedInput;
+            }
+            std::vector<int> failedClients;
+            for (auto& [descriptor, client] : mClients) {
+                if (client->protocol == Client::Protocol::Unknown)
+                    continue;
+                const auto echo = inputEcho.find(client->id);
+                sendFrame(*client, display, (echo == inputEcho.end() ? 0 : echo->second));
+                if (!flush(*client))
+                    failedClients.push_back(descriptor);
+            }
+            for (const int descriptor : failedClients)
+                closeClient(descriptor);
+        }
+    }
+
+    void StreamServer::acceptClients() {
+        while (true) {
+            const int descriptor = accept4(mListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (descriptor < 0)
+                return; // EAGAIN: no more pending connections
+            const int enable = 1;
+            setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)); // frames are small and latency matters
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.fd = descriptor;
+            if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, descriptor, &event) != 0) {
+                close(descriptor);
+                continue;
+            }
+            mClients[descriptor] = std::make_unique<Client>(mNextClientId++, descriptor, mKeyframeInterval,
+                std::chrono::steady_clock::now() + mHandshakeTimeout);
+            mClientCount = mClients.size();
+        }
+    }
+
+    void StreamServer::closeClient(int socket) {
+        const auto iterator = mClients.find(socket);
+        if (iterator == mClients.end())
+            return;
+        {
+            std::lock_guard lock(mMutex);
+            mAppliedInput.erase(iterator->second->id);
+            mPublishedInput.erase(iterator->second->id);
+        }
+        close(socket); // also removes the socket from the epoll instance
+        mClients.erase(iterator);
+        mClientCount = mClients.size();
+    }
+
+    int StreamServer::closeExpiredHandshakes() {
+        // returns the timeout for epoll_wait(): the milliseconds until the next deadline, or -1 if there is none
+        const auto now = std::chrono::steady_clock::now();
+        auto nextDeadline = std::chrono::steady_clock::time_point::max();
+        std::vector<int> expiredClients;
+        for (const auto& [descriptor, client] : mClients) {
+            if (client->protocol != Client::Protocol::Unknown)
+                continue;
+            if (client->handshakeDeadline <= now)
+                expiredClients.push_back(descriptor);
+            else
+                nextDeadline = std::min(nextDeadline, client->handshakeDeadline);
+        }
+        for (const int descriptor : expiredClients)
+            closeClient(descriptor);
+        if (nextDeadline == std::chrono::steady_clock::time_point::max())
+            return -1;
+        return gsl::narrow_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(nextDeadline - now).count());
+    }
+
+    void StreamServer::sendFrame(Client& client, const Chip8::PackedDisplay& display, int64_t inputEcho) {
+        if (client.output.size() - client.outputOffset > MaximumPendingBytes) {
+            client.encoder.requestKeyframe();
+            std::lock_guard lock(mMutex);
+            ++mStatistics.framesDropped;
+            return;
+        }
+        std::vector<uint8_t> message;
+        const bool keyframe = client.encoder.encode(display, inputEcho, message);
+        queueMessage(client, message);
+        std::lock_guard lock(mMutex);
+        ++mStatistics.framesSent;
+        if (keyframe)
+            ++mStatistics.keyframesSent;
+    }
+
+    bool StreamServer::receive(Client& client) {
+        std::array<uint8_t, 4096> buffer;
+        while (true) {
+            const ssize_t received = recv(client.socket, buffer.data(), buffer.size(), 0);
+            if (received == 0)
+                return false; // the client has closed the connection
+            if (received < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    return false;
+                break;
+            }
+            client.input.insert(client.input.end(), buffer.begin(), buffer.begin() + received);
+        }
+
+        if (client.protocol == Client::Protocol::Unknown) {
+            if (client.input.size() < StreamHello.size())
+                return true;
+            if (std::equal(StreamHello.begin(), StreamHello.end(), client.input.begin())) {
+                client.protocol = Client::Protocol::Raw;
+                client.input.erase(client.input.begin(), client.input.begin() + StreamHello.size());
+            } else if (std::memcmp(client.input.data(), "GET ", 4) == 0) {
+                if (!processWebSocketHandshake(client))
+                    return false;
+                if (client.protocol == Client::Protocol::Unknown)
+                    return true; // the request is not complete yet
+            } else {
+                return false;
+            }
+        }
+        return (client.protocol == Client::Protocol::Raw ? processRawMessages(client) : processWebSocketFrames(client)) && flush(client);
+    }
+
+    bool StreamServer::processRawMessages(Client& client) {
+        size_t offset = 0;
+        while (client.input.size() - offset >= 2) {
+            const size_t size = client.input[offset] | (static_cast<size_t>(client.input[offset + 1]) << 8);
+            if (client.input.size() - offset - 2 < size)
+                break;
+            const auto event = decodeKeyEvent(client.input.data() + offset + 2, size);
+            if (!event)
+                return false;
+            std::lock_guard lock(mMutex);
+            mReceivedEvents.push_back({ client.id, event.value() });
+            ++mStatistics.keyEventsReceived;
+            offset += 2 + size;
+        }
+        client.input.erase(client.input.begin(), client.input.begin() + static_cast<std::ptrdiff_t>(offset));
+        return true;
+    }
+
+    bool StreamServer::processWebSocketHandshake(Client& client) {
+        const std::string request(client.input.begin(), client.input.end());
+        const auto end = request.find("\r\n\r\n");
+        if (end == std::string::npos)
+            return request.size() <= MaximumHandshakeSize;
+
+        // see RFC 6455, section 4.2.1; invalid requests are answered before the connection is closed
+        const auto reject = [this, &client](const std::string& response) {
+            client.output.insert(client.output.end(), response.begin(), response.end());
+            flush(client);
+            return false;
+        };
+        std::string requestLine;
+        std::unordered_map<std::string, std::string> headers;
+        if (!parseHttpRequest(request.substr(0, end), requestLine, headers))
+            return reject(BadRequestResponse);
+        std::istringstream requestLineStream(requestLine);
+        std::string method, target, version, rest;
+        requestLineStream >> method >> target >> version;
+        const auto& key = headers["sec-websocket-key"];
+        if (method != "GET" || target.empty() || version != "HTTP/1.1" || requestLineStream >> rest
+            || !containsToken(headers["upgrade"], "websocket") || !containsToken(headers["connection"], "upgrade")
+            || key.size() != 24) // the base64 encoding of a 16 byte nonce
+            return reject(BadRequestResponse);
+        if (headers["sec-websocket-version"] != WebSocketVersion)
+            return reject(UpgradeRequiredResponse);
+
+        const std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + getWebSocketAcceptKey(key) + "\r\n\r\n";
+        client.output.insert(client.output.end(), response.begin(), response.end());
+        client.input.erase(client.input.begin(), client.input.begin() + static_cast<std::ptrdiff_t>(end + 4));
+        client.protocol = Client::Protocol::WebSocket;
+        return true;
+    }
+
+    bool StreamServer::processWebSocketFrames(Client& client) {
+        // see RFC 6455, section 5.2 (frames from clients are always masked)
+        size_t offset = 0;
+        while (client.input.size() - offset >= 2) {
+            const uint8_t* frame = client.input.data() + offset;
+            const size_t available = client.input.size() - offset;
+            const bool final = (frame[0] & 0x80) != 0;
+            const uint8_t opcode = frame[0] & 0x0F;
+            if (!(frame[1] & 0x80))
+                return false;
+            size_t size = frame[1] & 0x7F;
+            size_t headerSize = 2;
+            if (size == 126) {
+                if (available < 4)
+                    break;
+                size = (static_cast<size_t>(frame[2]) << 8) | frame[3];
+                headerSize = 4;
+            } else if (size == 127) {
+                return false; // far larger than any valid message
+            }
+            if ((opcode & 0x8) && (size > MaximumControlPayloadSize || !final)) {
+                // control frames (close, ping, pong) must neither be longer nor fragmented
+                client.output.push_back(0x88);
+                client.output.push_back(0x02);
+                client.output.push_back(gsl::narrow_cast<uint8_t>(ProtocolErrorStatus >> 8));
+                client.output.push_back(gsl::narrow_cast<uint8_t>(ProtocolErrorStatus & 0xFF));
+                flush(client);
+                return false;
+            }
+            if (size > MaximumMessageSize)
+                return false;
+            if (available < headerSize + 4 + size)
+                break;
+            const uint8_t* mask = frame + headerSize;
+            std::vector<uint8_t> payload(frame + headerSize + 4, frame + headerSize + 4 + size);
+            for (size_t i = 0; i < payload.size(); ++i)
+                payload[i] ^= mask[i % 4];
+            offset += headerSize + 4 + size;
+
+            if (!final)
+                return false; // fragmented messages are not used by this protocol
+            if (opcode == 0x2) {
+                const auto event = decodeKeyEvent(payload.data(), payload.size());
+                if (!event)
+                    return false;
+                std::lock_guard lock(mMutex);
+                mReceivedEvents.push_back({ client.id, event.value() });
+                ++mStatistics.keyEventsReceived;
+            } else if (opcode == 0x8) {
+                return false; // close
+            } else if (opcode == 0x9) {
+                // answer pings with a pong carrying the same payload
+                client.output.push_back(0x8A);
+                client.output.push_back(gsl::narrow_cast<uint8_t>(payload.size()));
+                client.output.insert(client.output.end(), payload.begin(), payload.end());
+            } else if (opcode != 0xA) {
+                return false;
+            }
+        }
+        client.input.erase(client.input.begin(), client.input.begin() + static_cast<std::ptrdiff_t>(offset));
+        return true;
+    }
+
+    void StreamServer::queueMessage(Client& client, const std::vector<uint8_t>& message) {
+        Expects(message.size() <= 0xFFFF);
+        if (client.protocol == Client::Protocol::WebSocket) {
+            client.output.push_back(0x82); // final binary frame
+            if (message.size() < 126) {
+                client.output.push_back(gsl::narrow_cast<uint8_t>(message.size()));
+            } else {
+                client.output.push_back(126);
+                client.output.push_back(gsl::narrow_cast<uint8_t>(message.size() >> 8));
+                client.output.push_back(gsl::narrow_cast<uint8_t>(message.size() & 0xFF));
+            }
+        } else {
+            client.output.push_back(gsl::narrow_cast<uint8_t>(message.size() & 0xFF));
+            client.output.push_back(gsl::narrow_cast<uint8_t>(message.size() >> 8));
+        }
+        client.output.insert(client.output.end(), message.begin(), message.end());
+    }
+
+    bool StreamServer::flush(Client& client) {
+        size_t sentBytes = 0;
+        while (client.outputOffset < client.output.size()) {
+            const ssize_t sent = send(client.socket, client.output.data() + client.outputOffset,
+                client.output.size() - client.outputOffset, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    return false;
+                break;
+            }
+            client.outputOffset += static_cast<size_t>(sent);
+            sentBytes += static_cast<size_t>(sent);
+        }
+        if (sentBytes > 0) {
+            std::lock_guard lock(mMutex);
+            mStatistics.bytesSent += sentBytes;
+        }
+
+        const bool pending = (client.outputOffset < client.output.size());
+        if (!pending) {
+            client.output.clear();
+            client.outputOffset = 0;
+        }
+        if (pending != client.waitingForWritable) {
+            // only wait for the socket to become writable while there is something to send
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP | (pending ? EPOLLOUT : 0u);
+            event.data.fd = client.socket;
+            if (epoll_ctl(mEpoll, EPOLL_CTL_MOD, client.socket, &event) != 0)
+                return false;
+            client.waitingForWritable = pending;
+        }
+        return true;
+    }
+#else
+    StreamServer::StreamServer(uint16_t port, const std::string&, uint32_t keyframeInterval, std::chrono::milliseconds handshakeTimeout)
+        : mListenSocket(-1), mEpoll(-1), mWakeEvent(-1), mPort(port), mKeyframeInterval(keyframeInterval), mHandshakeTimeout(handshakeTimeout), mStopping(false)
+        , mClientCount(0), mNextClientId(1), mDisplay{}, mPublishedFrames(0)
+    {
+        throw std::runtime_error("Streaming is only supported on Linux");
+    }
+
+    StreamServer::~StreamServer() = default;
+
+    void StreamServer::publish(const Chip8&) { }
+#endif
+
+    uint16_t StreamServer::getPort() const noexcept {
+        return mPort;
+    }
+
+    size_t StreamServer::pollInput(Chip8& chip8) {
+        std::lock_guard lock(mMutex);
+        for (const auto& received : mReceivedEvents) {
+            if (received.event.pressed)
+                chip8.triggerKeyDown(received.event.key);
+            else
+                chip8.triggerKeyUp(received.event.key);
+            mAppliedInput[received.clientId] = received.event.time;
+        }
+        const size_t count = mReceivedEvents.size();
+        mReceivedEvents.clear();
+        return count;
+    }
+
+    size_t StreamServer::getClientCount() const noexcept {
+        return mClientCount;
+    }
+
+    StreamServer::Statistics StreamServer::getStatistics() const {
+        std::lock_guard lock(mMutex);
+        return mStatistics;
+    }
+
+}
@@ -0,0 +1,131 @@
+#include "Chip8Core/ThreadPool.hpp"
+
+#include <algorithm>
+
+#include <gsl/gsl>
+
+namespace Chip8 {
+
+    namespace {
+        // identifies the pool and the worker the current thread belongs to (if any)
+        thread_local const ThreadPool* currentPool = nullptr;
+        thread_local size_t currentWorker = 0;
+    }
+
+    ThreadPool::ThreadPool(size_t threadCount)
+        : mQueuedTasks(0), mUnfinishedTasks(0), mStopping(false), mNextWorker(0)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < threadCount; ++i)
+            mWorkers.push_back(std::make_unique<Worker>());
+        for (size_t i = 0; i < threadCount; ++i)
+            mThreads.emplace_back([this, i]() { run(i); });
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::unique_lock lock(mMutex);
+            mAllTasksDone.wait(lock, [this]() { return mUnfinishedTasks == 0; });
+            mStopping = true;
+        }
+        mTasksAvailable.notify_all();
+        for (auto& thread : mThreads)
+            thread.join();
+    }
+
+    void ThreadPool::submit(Task task) {
+        const size_t workerIndex = (currentPool == this ? currentWorker : mNextWorker++ % mWorkers.size());
+        {
+            auto& worker = *mWorkers[workerIndex];
+            std::lock_guard lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard lock(mMutex);
+            ++mQueuedTasks;
+            ++mUnfinishedTasks;
+        }
+        mTasksAvailable.notify_one();
+    }
+
+    void ThreadPool::wait() {
+        Expects(currentPool != this); // the calling task would never finish
+        std::unique_lock lock(mMutex);
+        mAllTasksDone.wait(lock, [this]() { return mUnfinishedTasks == 0; });
+        if (mException) {
+            auto exception = mException;
+            mException = nullptr;
+            std::rethrow_exception(exception);
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& function) {
+        if (currentPool == this) {
+            // nested: the other workers are busy with the outer loop anyway
+            for (size_t i = 0; i < count; ++i)
+                function(i);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+            submit([&function, i]() { function(i); });
+        wait();
+    }
+
+    size_t ThreadPool::getThreadCount() const noexcept {
+        return mThreads.size();
+    }
+
+    void ThreadPool::run(size_t workerIndex) {
+        currentPool = this;
+        currentWorker = workerIndex;
+        while (true) {
+            {
+                std::unique_lock lock(mMutex);
+                mTasksAvailable.wait(lock, [this]() { return mQueuedTasks > 0 || mStopping; });
+                if (mQueuedTasks == 0 && mStopping)
+                    return;
+            }
+            Task task;
+            if (!tryTakeTask(workerIndex, task))
+                continue; // another worker has been faster
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard lock(mMutex);
+                if (!mException)
+                    mException = std::current_exception();
+            }
+            std::lock_guard lock(mMutex);
+            if (--mUnfinishedTasks == 0)
+                mAllTasksDone.notify_all();
+        }
+    }
+
+    bool ThreadPool::tryTakeTask(size_t workerIndex, Task& task) {
+        const auto takeFrom = [&task](Worker& worker, bool fromBack) {
+            std::lock_guard lock(worker.mutex);
+            if (worker.tasks.empty())
+                return false;
+            if (fromBack) {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+            } else {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+            }
+            return true;
+        };
+
+        // own queue first (newest task, its data is most likely still in the cache), then steal the oldest ones
+        bool found = takeFrom(*mWorkers[workerIndex], true);
+        for (size_t i = 1; !found && i < mWorkers.size(); ++i)
+            found = takeFrom(*mWorkers[(workerIndex + i) % mWorkers.size()], false);
+        if (found) {
+            std::lock_guard lock(mMutex);
+            --mQueuedTasks;
+        }
+        return found;
+    }
+
+}
@@ -0,0 +1,554 @@
+#include "Chip8Core/VectorMachine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <tuple>
+
+#include <gsl/gsl>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "Chip8Core/Instruction.hpp"
+#include "Chip8Core/OpcodeHandler.hpp"
+#include "Chip8Core/Opcodes.hpp"
+
+namespace Chip8 {
+
+    namespace {
+
+        constexpr size_t DisplaySize = sizeof(Chip8::PackedDisplay);
+        constexpr uint16_t UnknownOpcode = 0xFFFF;
+
+        uint16_t decodeOpcode(uint16_t instruction) noexcept {
+            const size_t index = getOpcodeIndex(instruction);
+            return (index < Opcodes.size() ? std::get<1>(Opcodes[index]) : UnknownOpcode);
+        }
+
+        // A block of 32 bytes (one byte per lane) and the operations the kernels need. With AVX2 every
+        // operation is a single instruction, otherwise the loops are left to the auto-vectorizer.
+#ifdef __AVX2__
+        struct Bytes {
+            __m256i value;
+        };
+
+        inline Bytes load(const uint8_t* source) noexcept {
+            return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)) };
+        }
+
+        inline void store(uint8_t* destination, Bytes bytes) noexcept {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), bytes.value);
+        }
+
+        inline Bytes broadcast(uint8_t value) noexcept {
+            return { _mm256_set1_epi8(static_cast<char>(value)) };
+        }
+
+        inline Bytes select(Bytes mask, Bytes ifSet, Bytes ifUnset) noexcept {
+            return { _mm256_blendv_epi8(ifUnset.value, ifSet.value, mask.value) };
+        }
+
+        inline bool isZero(Bytes bytes) noexcept {
+            return _mm256_testz_si256(bytes.value, bytes.value) != 0;
+        }
+
+        inline Bytes operator+(Bytes lhs, Bytes rhs) noexcept { return { _mm256_add_epi8(lhs.value, rhs.value) }; }
+        inline Bytes operator-(Bytes lhs, Bytes rhs) noexcept { return { _mm256_sub_epi8(lhs.value, rhs.value) }; }
+        inline Bytes operator&(Bytes lhs, Bytes rhs) noexcept { return { _mm256_and_si256(lhs.value, rhs.value) }; }
+        inline Bytes operator|(Bytes lhs, Bytes rhs) noexcept { return { _mm256_or_si256(lhs.value, rhs.value) }; }
+        inline Bytes operator^(Bytes lhs, Bytes rhs) noexcept { return { _mm256_xor_si256(lhs.value, rhs.value) }; }
+
+        // 0xFF where lhs == rhs, 0x00 otherwise
+        inline Bytes equal(Bytes lhs, Bytes rhs) noexcept {
+            return { _mm256_cmpeq_epi8(lhs.value, rhs.value) };
+        }
+
+        // 0xFF where lhs > rhs (unsigned), 0x00 otherwise
+        inline Bytes greater(Bytes lhs, Bytes rhs) noexcept {
+            return equal(Bytes{ _mm256_max_epu8(lhs.value, rhs.value) }, rhs) ^ broadcast(0xFF);
+        }
+
+        inline Bytes shiftRight(Bytes bytes, int count) noexcept {
+            // there is no 8 bit shift, so shift 16 bit words and clear the bits that crossed over
+            return Bytes{ _mm256_srli_epi16(bytes.value, count) } & broadcast(static_cast<uint8_t>(0xFF >> count));
+        }
+#else
+        struct Bytes {
+            std::array<uint8_t, VectorMachine::LanesPerVector> value;
+        };
+
+        template<typename Operation>
+        inline Bytes transform(Bytes lhs, Bytes rhs, Operation operation) noexcept {
+            Bytes result;
+            for (size_t i = 0; i < result.value.size(); ++i)
+                result.value[i] = static_cast<uint8_t>(operation(lhs.value[i], rhs.value[i]));
+            return result;
+        }
+
+        inline Bytes load(const uint8_t* source) noexcept {
+            Bytes result;
+            std::copy(source, source + result.value.size(), result.value.begin());
+            return result;
+        }
+
+        inline void store(uint8_t* destination, Bytes bytes) noexcept {
+            std::copy(bytes.value.begin(), bytes.value.end(), destination);
+        }
+
+        inline Bytes broadcast(uint8_t value) noexcept {
+            Bytes result;
+            result.value.fill(value);
+            return result;
+        }
+
+        inline Bytes select(Bytes mask, Bytes ifSet, Bytes ifUnset) noexcept {
+            Bytes result;
+            for (size_t i = 0; i < result.value.size(); ++i)
+                result.value[i] = (mask.value[i] & 0x80 ? ifSet.value[i] : ifUnset.value[i]);
+            return result;
+        }
+
+        inline bool isZero(Bytes bytes) noexcept {
+            return std::all_of(bytes.value.begin(), bytes.value.end(), [](uint8_t value) { return value == 0x0; });
+        }
+
+        inline Bytes operator+(Bytes lhs, Bytes rhs) noexcept { return transform(lhs, rhs, [](uint8_t a, uint8_t b) { return a + b; }); }
+        inline Bytes operator-(Bytes lhs, Bytes rhs) noexcept { return transform(lhs, rhs, [](uint8_t a, uint8_t b) { return a - b; }); }
+        inline Bytes operator&(Bytes lhs, Bytes rhs) noexcept { return transform(lhs, rhs, [](uint8_t a, uint8_t b) { return a & b; }); }
+        inline Bytes operator|(Bytes lhs, Bytes rhs) noexcept { return transform(lhs, rhs, [](uint8_t a, uint8_t b) { return a | b; }); }
+        inline Bytes operator^(Bytes lhs, Bytes rhs) noexcept { return transform(lhs, rhs, [](uint8_t a, uint8_t b) { return a ^ b; }); }
+
+        inline Bytes equal(Bytes lhs, Bytes rhs) noexcept {
+            return transform(lhs, rhs, [](uint8_t a, uint8_t b) { return (a == b ? 0xFF : 0x00); });
+        }
+
+        inline Bytes greater(Bytes lhs, Bytes rhs) noexcept {
+            return transform(lhs, rhs, [](uint8_t a, uint8_t b) { return (a > b ? 0xFF : 0x00); });
+        }
+
+        inline Bytes shiftRight(Bytes bytes, int count) noexcept {
+            for (auto& value : bytes.value)
+                value = static_cast<uint8_t>(value >> count);
+            return bytes;
+        }
+#endif
+
+        inline void storeMasked(uint8_t* destination, Bytes bytes, Bytes mask) noexcept {
+            store(destination, select(mask, bytes, load(destination)));
+        }
+
+        // converts a comparison result (0xFF/0x00) into a flag value (0x1/0x0)
+        inline Bytes toFlag(Bytes comparison) noexcept {
+            return comparison & broadcast(0x1);
+        }
+
+    }
+
+    VectorMachine::VectorMachine(size_t laneCount, const Chip8& prototype)
+        : mLaneCount(laneCount)
+        , mPaddedLaneCount((laneCount + LanesPerVector - 1) / LanesPerVector * LanesPerVector)
+        , mV(0x10 * mPaddedLaneCount, 0x0), mI(mPaddedLaneCount, 0x0), mPC(mPaddedLaneCount, 0x0)
+        , mDelayTimer(mPaddedLaneCount, 0x0), mSoundTimer(mPaddedLaneCount, 0x0), mStackSize(laneCount, 0)
+        , mStack(laneCount * Chip8::StackSize, 0x0), mCompatibilityMode(laneCount, CompatibilityMode::SuperChip)
+        , mPressedKeys(laneCount, 0x0), mAwaitingKeyPress(laneCount, 0x0), mKeyPressRegisterTarget(laneCount, 0x0)
+        , mCycleCount(laneCount, 0), mRandomSeed(laneCount, 0), mRandom(laneCount), mStatus(laneCount, LaneStatus::Running)
+        , mMemory(laneCount * Chip8::MemorySize, 0x0), mDisplay(laneCount * DisplaySize, 0x0)
+        , mGroups(MaximumGroups), mGroupMask(mPaddedLaneCount, 0x0)
+        , mCondition(mPaddedLaneCount, 0x0)
+    {
+        mScalarMachine.setLoggingEnabled(false); // a lane that stops reports it through its status
+        for (size_t lane = 0; lane < laneCount; ++lane)
+            setLane(lane, prototype);
+    }
+
+    size_t VectorMachine::getLaneCount() const noexcept {
+        return mLaneCount;
+    }
+
+    void VectorMachine::setLane(size_t lane, const Chip8& chip8) {
+        Expects(lane < mLaneCount);
+        copyFromMachine(lane, chip8, true);
+        mStatus[lane] = LaneStatus::Running;
+    }
+
+    void VectorMachine::getLane(size_t lane, Chip8& chip8) const {
+        Expects(lane < mLaneCount);
+        copyToMachine(lane, chip8, true);
+    }
+
+    void VectorMachine::step() {
+        // fetch, and group the lanes by their instruction
+        for (auto& group : mGroups)
+            group.lanes.clear();
+        size_t groupCount = 0;
+        size_t lastGroup = 0;
+        for (size_t lane = 0; lane < mLaneCount; ++lane) {
+            if (mStatus[lane] != LaneStatus::Running)
+                continue;
+            ++mCycleCount[lane];
+            if (mAwaitingKeyPress[lane])
+                continue;
+            const size_t pc = mPC[lane];
+            if (pc >= Chip8::MemorySize) {
+                mStatus[lane] = LaneStatus::Halted; // end of program reached
+                continue;
+            }
+            if (pc + 1 >= Chip8::MemorySize) {
+                mStatus[lane] = LaneStatus::Crashed; // the second byte of the instruction is out of bounds
+                continue;
+            }
+            const uint8_t* memory = &mMemory[lane * Chip8::MemorySize];
+            const auto instruction = gsl::narrow_cast<uint16_t>(memory[pc] << 8 | memory[pc + 1]);
+            if (instruction == 0x0000) {
+                mStatus[lane] = LaneStatus::Halted;
+                continue;
+            }
+            mPC[lane] = gsl::narrow_cast<uint16_t>(pc + 2);
+
+            // neighbouring lanes are likely to be in the same group, so the last match is tried first
+            const auto isMember = [&](const Group& group) {
+                return group.instruction == instruction && group.compatibilityMode == mCompatibilityMode[lane];
+            };
+            if (groupCount == 0 || !isMember(mGroups[lastGroup])) {
+                lastGroup = 0;
+                while (lastGroup < groupCount && !isMember(mGroups[lastGroup]))
+                    ++lastGroup;
+                if (lastGroup == MaximumGroups) {
+                    // too much divergence
+                    executeScalar(lane, decodeOpcode(instruction), instruction);
+                    ++mStatistics.scalarLaneSteps;
+                    lastGroup = 0;
+                    continue;
+                }
+                if (lastGroup == groupCount) {
+                    auto& group = mGroups[groupCount++];
+                    group.instruction = instruction;
+                    group.opcode = decodeOpcode(instruction);
+                    group.compatibilityMode = mCompatibilityMode[lane];
+                }
+            }
+            mGroups[lastGroup].lanes.push_back(gsl::narrow_cast<uint32_t>(lane));
+        }
+
+        // execute
+        for (size_t i = 0; i < groupCount; ++i) {
+            const auto& group = mGroups[i];
+            if (group.lanes.size() < MinimumVectorGroupSize || !hasVectorKernel(group.opcode)) {
+                for (const auto lane : group.lanes)
+                    executeScalar(lane, group.opcode, group.instruction);
+                mStatistics.scalarLaneSteps += group.lanes.size();
+                continue;
+            }
+            for (const auto lane : group.lanes)
+                mGroupMask[lane] = 0xFF;
+            executeVector(group.opcode, group.instruction, group.compatibilityMode);
+            for (const auto lane : group.lanes)
+                mGroupMask[lane] = 0x00;
+            ++mStatistics.vectorGroups;
+            mStatistics.vectorLaneSteps += group.lanes.size();
+        }
+    }
+
+    void VectorMachine::clockTimers() noexcept {
+        for (size_t block = 0; block < mPaddedLaneCount; block += LanesPerVector) {
+            for (auto timers : { mDelayTimer.data(), mSoundTimer.data() }) {
+                // decrement all timers that are greater than zero
+                const auto value = load(timers + block);
+                store(timers + block, value - toFlag(greater(value, broadcast(0x0))));
+            }
+        }
+    }
+
+    VectorMachine::LaneStatus VectorMachine::getLaneStatus(size_t lane) const noexcept {
+        return mStatus[lane];
+    }
+
+    size_t VectorMachine::getRunningLaneCount() const noexcept {
+        return gsl::narrow_cast<size_t>(std::count(mStatus.begin(), mStatus.end(), LaneStatus::Running));
+    }
+
+    uint8_t VectorMachine::getRegister(size_t lane, uint8_t registerNumber) const noexcept {
+        return mV[registerNumber * mPaddedLaneCount + lane];
+    }
+
+    uint16_t VectorMachine::getProgramCounter(size_t lane) const noexcept {
+        return mPC[lane];
+    }
+
+    Chip8::PackedDisplay VectorMachine::getPackedDisplay(size_t lane) const noexcept {
+        Chip8::PackedDisplay result;
+        std::copy_n(mDisplay.begin() + lane * DisplaySize, DisplaySize, result.begin());
+        return result;
+    }
+
+    void VectorMachine::seedRandom(size_t lane, uint64_t seed) noexcept {
+        mRandomSeed[lane] = seed;
+        mRandom[lane].seed(seed);
+    }
+
+    void VectorMachine::triggerKeyDown(size_t lane, uint8_t key) noexcept {
+        mPressedKeys[lane] |= gsl::narrow_cast<uint16_t>(0x1 << key);
+        if (mAwaitingKeyPress[lane]) {
+            getRegisterReference(lane, mKeyPressRegisterTarget[lane]) = key;
+            mAwaitingKeyPress[lane] = 0x0;
+        }
+    }
+
+    void VectorMachine::triggerKeyUp(size_t lane, uint8_t key) noexcept {
+        mPressedKeys[lane] &= gsl::narrow_cast<uint16_t>(~(0x1 << key));
+    }
+
+    const VectorMachine::Statistics& VectorMachine::getStatistics() const noexcept {
+        return mStatistics;
+    }
+
+    uint8_t* VectorMachine::getRegisters(uint8_t registerNumber) noexcept {
+        return &mV[registerNumber * mPaddedLaneCount];
+    }
+
+    uint8_t& VectorMachine::getRegisterReference(size_t lane, uint8_t registerNumber) noexcept {
+        return mV[registerNumber * mPaddedLaneCount + lane];
+    }
+
+    void VectorMachine::copyFromMachine(size_t lane, const Chip8& chip8, bool withMemory) {
+        for (uint8_t i = 0; i <= 0xF; ++i)
+            getRegisterReference(lane, i) = chip8.mV[i];
+        mI[lane] = chip8.mI;
+        mPC[lane] = chip8.mPC;
+        mDelayTimer[lane] = chip8.mDelayTimer;
+        mSoundTimer[lane] = chip8.mSoundTimer;
+        mStackSize[lane] = chip8.mStackSize;
+        std::copy(chip8.mStack.begin(), chip8.mStack.end(), mStack.begin() + lane * Chip8::StackSize);
+        mCompatibilityMode[lane] = chip8.mCompatibilityMode;
+        mPressedKeys[lane] = gsl::narrow_cast<uint16_t>(chip8.mPressedKeys.to_ulong());
+        mAwaitingKeyPress[lane] = (chip8.mAwaitingKeyPress ? 0x1 : 0x0);
+        mKeyPressRegisterTarget[lane] = chip8.mKeyPressRegisterTarget;
+        mCycleCount[lane] = chip8.mCycleCount;
+        mRandomSeed[lane] = chip8.mRandomSeed;
+        mRandom[lane] = chip8.mRandom;
+        if (withMemory) {
+            chip8.mMemory.readBlock(0x0, &mMemory[lane * Chip8::MemorySize], Chip8::MemorySize);
+            const auto& display = chip8.getPackedDisplay();
+            std::copy(display.begin(), display.end(), mDisplay.begin() + lane * DisplaySize);
+        }
+    }
+
+    void VectorMachine::copyToMachine(size_t lane, Chip8& chip8, bool withMemory) const {
+        for (uint8_t i = 0; i <= 0xF; ++i)
+            chip8.mV[i] = getRegister(lane, i);
+        chip8.mI = mI[lane];
+        chip8.mPC = mPC[lane];
+        chip8.mDelayTimer = mDelayTimer[lane];
+        chip8.mSoundTimer = mSoundTimer[lane];
+        chip8.mStackSize = mStackSize[lane];
+        std::copy_n(mStack.begin() + lane * Chip8::StackSize, Chip8::StackSize, chip8.mStack.begin());
+        chip8.mCompatibilityMode = mCompatibilityMode[lane];
+        chip8.mPressedKeys = std::bitset<0x10>(mPressedKeys[lane]);
+        chip8.mAwaitingKeyPress = (mAwaitingKeyPress[lane] != 0x0);
+        chip8.mKeyPressRegisterTarget = mKeyPressRegisterTarget[lane];
+        chip8.mCycleCount = mCycleCount[lane];
+        chip8.mRandomSeed = mRandomSeed[lane];
+        chip8.mRandom = mRandom[lane];
+        if (withMemory) {
+            chip8.mMemory.writeBlock(0x0, &mMemory[lane * Chip8::MemorySize], Chip8::MemorySize);
+            std::copy_n(mDisplay.begin() + lane * DisplaySize, DisplaySize, chip8.mDisplayMemory.begin());
+        }
+    }
+
+    bool VectorMachine::hasVectorKernel(uint16_t opcode) noexcept {
+        switch (opcode) {
+            case 0x1000: case 0x3000: case 0x4000: case 0x5000: case 0x6000: case 0x7000:
+            case 0x8000: case 0x8001: case 0x8002: case 0x8003: case 0x8004: case 0x8005:
+            case 0x8006: case 0x8007: case 0x800E: case 0x9000: case 0xA000:
+            case 0xF007: case 0xF015: case 0xF018: case 0xF01E: case 0xF029:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void VectorMachine::executeVector(uint16_t opcode, uint16_t instruction, CompatibilityMode compatibilityMode) {
+        // the same semantics as OpcodeHandler::execute(), applied to the lanes selected by mGroupMask
+        const Instruction decoded(instruction);
+        const uint8_t x = decoded.getX();
+        const uint8_t y = decoded.getY();
+        const uint8_t nn = decoded.getNN();
+        const uint16_t nnn = decoded.getNNN();
+        uint8_t* vx = getRegisters(x);
+        uint8_t* vy = getRegisters(y);
+        uint8_t* vf = getRegisters(0xF);
+
+        // runs a kernel for every block of lanes that contains at least one lane of the group
+        const auto forEachBlock = [this](auto kernel) {
+            for (size_t block = 0; block < mPaddedLaneCount; block += LanesPerVector) {
+                const auto mask = load(&mGroupMask[block]);
+                if (!isZero(mask))
+                    kernel(block, mask);
+            }
+        };
+        // the flag is written first; the result is computed from the registers again afterwards,
+        // since X or Y may refer to VF
+        const auto flagOperation = [&](auto flag, auto result) {
+            forEachBlock([&](size_t block, Bytes mask) {
+                storeMasked(vf + block, toFlag(flag(load(vx + block), load(vy + block))), mask);
+                storeMasked(vx + block, result(load(vx + block), load(vy + block)), mask);
+            });
+        };
+        const auto skipIf = [&](auto condition) {
+            forEachBlock([&](size_t block, Bytes mask) {
+                store(&mCondition[block], condition(block) & mask);
+            });
+            for (size_t lane = 0; lane < mLaneCount; ++lane)
+                mPC[lane] = gsl::narrow_cast<uint16_t>(mPC[lane] + (mCondition[lane] & 0x2));
+            std::fill(mCondition.begin(), mCondition.end(), 0x0);
+        };
+        const auto setWord = [this](std::vector<uint16_t>& target, auto value) {
+            for (size_t lane = 0; lane < mLaneCount; ++lane) {
+                if (mGroupMask[lane])
+                    target[lane] = gsl::narrow_cast<uint16_t>(value(lane));
+            }
+        };
+
+        switch (opcode) {
+            case 0x1000: // 1NNN
+                setWord(mPC, [nnn](size_t) { return nnn; });
+                break;
+            case 0x3000: // 3XNN
+                skipIf([&](size_t block) { return equal(load(vx + block), broadcast(nn)); });
+                break;
+            case 0x4000: // 4XNN
+                skipIf([&](size_t block) { return equal(load(vx + block), broadcast(nn)) ^ broadcast(0xFF); });
+                break;
+            case 0x5000: // 5XY0
+                skipIf([&](size_t block) { return equal(load(vx + block), load(vy + block)); });
+                break;
+            case 0x9000: // 9XY0
+                skipIf([&](size_t block) { return equal(load(vx + block), load(vy + block)) ^ broadcast(0xFF); });
+                break;
+            case 0x6000: // 6XNN
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(vx + block, broadcast(nn), mask); });
+                break;
+            case 0x7000: // 7XNN
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(vx + block, load(vx + block) + broadcast(nn), mask); });
+                break;
+            case 0x8000: // 8XY0
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(vx + block, load(vy + block), mask); });
+                break;
+            case 0x8001: // 8XY1
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(vx + block, load(vx + block) | load(vy + block), mask); });
+                break;
+            case 0x8002: // 8XY2
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(vx + block, load(vx + block) & load(vy + block), mask); });
+                break;
+            case 0x8003: // 8XY3
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(vx + block, load(vx + block) ^ load(vy + block), mask); });
+                break;
+            case 0x8004: // 8XY4
+                flagOperation([](Bytes a, Bytes b) { return greater(a, a + b); }, // the sum wrapped around
+                    [](Bytes a, Bytes b) { return a + b; });
+                break;
+            case 0x8005: // 8XY5
+                flagOperation([](Bytes a, Bytes b) { return greater(a, b); },
+                    [](Bytes a, Bytes b) { return a - b; });
+                break;
+            case 0x8007: // 8XY7
+                flagOperation([](Bytes a, Bytes b) { return greater(b, a); },
+                    [](Bytes a, Bytes b) { return b - a; });
+                break;
+            case 0x8006: // 8XY6
+                if (compatibilityMode == CompatibilityMode::OriginalChip8) {
+                    flagOperation([](Bytes, Bytes b) { return b & broadcast(0x1); },
+                        [](Bytes, Bytes b) { return shiftRight(b, 1); });
+                } else {
+                    flagOperation([](Bytes a, Bytes) { return a & broadcast(0x1); },
+                        [](Bytes a, Bytes) { return shiftRight(a, 1); });
+                }
+                break;
+            case 0x800E: // 8XYE
+                if (compatibilityMode == CompatibilityMode::OriginalChip8) {
+                    flagOperation([](Bytes, Bytes b) { return shiftRight(b, 7); },
+                        [](Bytes, Bytes b) { return b + b; });
+                } else {
+                    flagOperation([](Bytes a, Bytes) { return shiftRight(a, 7); },
+                        [](Bytes a, Bytes) { return a + a; });
+                }
+                break;
+            case 0xA000: // ANNN
+                setWord(mI, [nnn](size_t) { return nnn; });
+                break;
+            case 0xF007: // FX07
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(vx + block, load(&mDelayTimer[block]), mask); });
+                break;
+            case 0xF015: // FX15
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(&mDelayTimer[block], load(vx + block), mask); });
+                break;
+            case 0xF018: // FX18
+                forEachBlock([&](size_t block, Bytes mask) { storeMasked(&mSoundTimer[block], load(vx + block), mask); });
+                break;
+            case 0xF01E: // FX1E
+                setWord(mI, [this, vx](size_t lane) { return mI[lane] + vx[lane]; });
+                break;
+            case 0xF029: // FX29
+                setWord(mI, [vx](size_t lane) { return 5u * vx[lane]; });
+                break;
+            default:
+                Expects(false); // hasVectorKernel() and this switch disagree
+        }
+    }
+
+    void VectorMachine::executeScalar(size_t lane, uint16_t opcode, uint16_t instruction) {
+        // the lane is executed by the same OpcodeHandler as Chip8::step(), so both cannot drift apart; the
+        // instructions only access the memory at I, so only that range (and the display) is copied
+        const Instruction decoded(instruction);
+        size_t memoryCount = 0;
+        bool writesMemory = false;
+        bool usesDisplay = false;
+        switch (opcode) {
+            case 0x00E0:
+                usesDisplay = true;
+                break;
+            case 0xD000:
+                usesDisplay = true;
+                memoryCount = decoded.getN();
+                break;
+            case 0xF033:
+                memoryCount = 3;
+                writesMemory = true;
+                break;
+            case 0xF055:
+                memoryCount = decoded.getX() + 1u;
+                writesMemory = true;
+                break;
+            case 0xF065:
+                memoryCount = decoded.getX() + 1u;
+                break;
+            default:
+                break;
+        }
+        const uint16_t address = mI[lane];
+        memoryCount = (address < Chip8::MemorySize ? std::min(memoryCount, Chip8::MemorySize - address) : 0);
+        uint8_t* memory = &mMemory[lane * Chip8::MemorySize];
+        uint8_t* display = &mDisplay[lane * DisplaySize];
+
+        copyToMachine(lane, mScalarMachine, false);
+        if (memoryCount > 0)
+            mScalarMachine.mMemory.writeBlock(address, memory + address, memoryCount);
+        if (usesDisplay)
+            std::copy_n(display, DisplaySize, mScalarMachine.mDisplayMemory.begin());
+        try {
+            // unknown opcodes: Chip8::step() warns and carries on
+            if (opcode != UnknownOpcode && !OpcodeHandler::execute(opcode, decoded, mScalarMachine, mCompatibilityMode[lane]))
+                mStatus[lane] = LaneStatus::Halted;
+        } catch (const std::out_of_range&) {
+            mStatus[lane] = LaneStatus::Crashed;
+        }
+        copyFromMachine(lane, mScalarMachine, false);
+        if (writesMemory && memoryCount > 0)
+            mScalarMachine.mMemory.readBlock(address, memory + address, memoryCount);
+        if (usesDisplay)
+            std::copy_n(mScalarMachine.mDisplayMemory.begin(), DisplaySize, display);
+    }
+
+}
@@ -1,19 +1,219 @@
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <Chip8Renderer/Chip8Renderer.hpp>
 #include <Chip8Core/Chip8.hpp>
+#include <Chip8Core/InstructionTrace.hpp>
+#include <Chip8Core/LatencyProbe.hpp>
 #include <Chip8Core/Opcodes.hpp>
+#include <Chip8Core/Probes.hpp>
+#include <Chip8Core/Session.hpp>
+#include <Chip8Core/StreamServer.hpp>
+
+namespace {
+
+	volatile std::sig_atomic_t gStopRequested = 0;
+
+	void printUsage() {
+		std::cout << "Usage: Chip8Emulator [rom]\n"
+			"       Chip8Emulator [--backend <session>] [--stream <port>] <rom> [options]\n"
+			"       Chip8Emulator --viewer <session>\n"
+			"       Chip8Emulator --latency-probe <samples> [--headless] [options]\n\n"
+			"Without options the emulator runs in a window. With --backend it runs headless and publishes\n"
+			"every frame into the shared memory session (e.g. /chip8), which any number of --viewer\n"
+			"processes render and send their input to. With --stream it runs headless and streams the\n"
+			"display to TCP and WebSocket clients (see Chip8StreamClient). With --latency-probe it runs a\n"
+			"test ROM, presses keys itself and reports the latency until the display has changed and, in the\n"
+			"window, until the frame has been presented (--headless measures the emulation core alone).\n\n"
+			"Options:\n"
+			"  --cycles-per-frame <n>    instructions per frame in headless mode (default: 8)\n"
+			"  --stream-address <ip>     address to accept stream clients on (default: 127.0.0.1)\n"
+			"  --trace <file>            write every executed instruction into a trace file (see Chip8Trace)\n"
+			"  --headless                run the latency probe without a window\n";
+	}
+
+	int runLatencyProbe(size_t sampleCount, uint64_t cyclesPerFrame) {
+		Chip8::Chip8 chip8;
+		chip8.loadROM(Chip8::LatencyProbe::TestRom.data(), Chip8::LatencyProbe::TestRom.size());
+		std::signal(SIGINT, [](int) { gStopRequested = 1; });
+		std::signal(SIGTERM, [](int) { gStopRequested = 1; });
+
+		// the same frame loop as runHeadless(): the input is polled once per frame
+		Chip8::LatencyProbe probe(sampleCount, false, 50'000'000);
+		using Clock = std::chrono::steady_clock;
+		constexpr auto frameInterval = std::chrono::nanoseconds(1'000'000'000 / 60);
+		auto nextFrame = Clock::now();
+		while (!gStopRequested && !probe.isFinished()) {
+			if (const auto event = probe.poll(chip8, Chip8::getProbeTime())) {
+				if (event->pressed)
+					chip8.triggerKeyDown(event->key);
+				else
+					chip8.triggerKeyUp(event->key);
+			}
+			for (uint64_t cycle = 0; cycle < cyclesPerFrame; ++cycle) {
+				chip8.step();
+				probe.checkDisplay(chip8, Chip8::getProbeTime());
+			}
+			chip8.clockTimers();
+			nextFrame += frameInterval;
+			std::this_thread::sleep_until(nextFrame);
+		}
+		probe.printReport(std::cout);
+		return 0;
+	}
+
+	int runHeadless(const std::string& sessionName, std::optional<uint16_t> streamPort, const std::string& streamAddress,
+		const std::string& romPath, uint64_t cyclesPerFrame, Chip8::InstructionTracer* tracer) {
+		Chip8::Chip8 chip8;
+		chip8.setTracer(tracer);
+		if (!chip8.loadROM(romPath)) {
+			std::cerr << "Could not open " << romPath << "\n";
+			return 1;
+		}
+		std::signal(SIGINT, [](int) { gStopRequested = 1; });
+		std::signal(SIGTERM, [](int) { gStopRequested = 1; });
+
+		try {
+			std::unique_ptr<Chip8::SessionBackend> backend;
+			std::unique_ptr<Chip8::StreamServer> streamServer;
+			if (!sessionName.empty()) {
+				backend = std::make_unique<Chip8::SessionBackend>(sessionName);
+				std::cout << "Publishing session " << sessionName << "\n";
+			}
+			if (streamPort) {
+				streamServer = std::make_unique<Chip8::StreamServer>(streamPort.value(), streamAddress);
+				std::cout << "Streaming on " << streamAddress << ":" << streamServer->getPort() << "\n";
+			}
+			std::cout << "Press Ctrl+C to stop\n";
+			using Clock = std::chrono::steady_clock;
+			constexpr auto frameInterval = std::chrono::nanoseconds(1'000'000'000 / 60);
+			auto nextFrame = Clock::now();
+			bool halted = false;
+			while (!gStopRequested) {
+				if (backend)
+					backend->pollInput(chip8);
+				if (streamServer)
+					streamServer->pollInput(chip8);
+				for (uint64_t cycle = 0; cycle < cyclesPerFrame && !halted; ++cycle)
+					halted = !chip8.step();
+				chip8.clockTimers();
+				if (backend)
+					backend->publish(chip8);
+				if (streamServer)
+					streamServer->publish(chip8);
+				nextFrame += frameInterval;
+				std::this_thread::sleep_until(nextFrame);
+			}
+			if (backend)
+				std::cout << "Published " << backend->getFrameCount() << " frames\n";
+			if (streamServer) {
+				const auto statistics = streamServer->getStatistics();
+				std::cout << "Streamed " << statistics.framesSent << " frames (" << statistics.keyframesSent << " keyframes, "
+					<< statistics.framesDropped << " dropped), "
+					<< (statistics.framesSent > 0 ? static_cast<double>(statistics.bytesSent) / static_cast<double>(statistics.framesSent) : 0.0)
+					<< " bytes/frame\n";
+			}
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+		return 0;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	const std::vector<std::string> arguments(argv + 1, argv + argc);
+	std::string backendSession;
+	std::string viewerSession;
+	std::optional<uint16_t> streamPort;
+	std::string streamAddress = "127.0.0.1";
+	std::string romPath = "roms/test.ch8";
+	uint64_t cyclesPerFrame = 8;
+	std::string tracePath;
+	size_t latencySamples = 0;
+	bool headless = false;
+	try {
+		for (size_t i = 0; i < arguments.size(); ++i) {
+			const auto& argument = arguments[i];
+			const auto nextArgument = [&]() -> const std::string& {
+				if (i + 1 >= arguments.size())
+					throw std::invalid_argument("missing value for " + argument);
+				return arguments[++i];
+			};
+			if (argument == "--help" || argument == "-h") {
+				printUsage();
+				return 0;
+			} else if (argument == "--backend") {
+				backendSession = nextArgument();
+			} else if (argument == "--viewer") {
+				viewerSession = nextArgument();
+			} else if (argument == "--stream") {
+				const auto& value = nextArgument();
+				const bool isNumber = !value.empty() && value.size() <= 5
+					&& std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; });
+				if (!isNumber || std::stoul(value) > 0xFFFF)
+					throw std::invalid_argument("invalid port " + value + " (expected 0 to 65535)");
+				streamPort = static_cast<uint16_t>(std::stoul(value));
+			} else if (argument == "--stream-address") {
+				streamAddress = nextArgument();
+			} else if (argument == "--cycles-per-frame") {
+				cyclesPerFrame = std::stoull(nextArgument());
+			} else if (argument == "--trace") {
+				tracePath = nextArgument();
+			} else if (argument == "--latency-probe") {
+				latencySamples = std::stoul(nextArgument());
+			} else if (argument == "--headless") {
+				headless = true;
+			} else if (argument.front() != '-') {
+				romPath = argument;
+			} else {
+				throw std::invalid_argument("unknown option " + argument);
+			}
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		printUsage();
+		return 1;
+	}
+	std::unique_ptr<Chip8::InstructionTracer> tracer;
+	if (!tracePath.empty()) {
+		try {
+			tracer = std::make_unique<Chip8::InstructionTracer>(tracePath);
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+	}
+	if (latencySamples > 0 && headless)
+		return runLatencyProbe(latencySamples, cyclesPerFrame);
+	if (!backendSession.empty() || streamPort)
+		return runHeadless(backendSession, streamPort, streamAddress, romPath, cyclesPerFrame, tracer.get());
 
-int main() {
 	Chip8::Chip8 chip8;
-	if (!chip8.loadROM("roms/test.ch8"))
+	if (viewerSession.empty() && !chip8.loadROM(romPath))
 		std::cout << "Could not open file!\n";
+	chip8.setTracer(tracer.get());
 
 	Chip8Renderer renderer(chip8);
 	if (!renderer.createWindow()) {
 		std::cout << "Failed to open window\n";
 	}
+	if (!viewerSession.empty() && !renderer.connectToSession(viewerSession)) {
+		renderer.free();
+		return 1;
+	}
+	if (latencySamples > 0)
+		renderer.startLatencyProbe(latencySamples);
 	renderer.startRenderLoop();
 	renderer.free();
-}
\ No newline at end of file
+}
@@ -1,7 +1,18 @@
 #include "Chip8Renderer/Chip8Renderer.hpp"
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+#include <stdexcept>
 #include <unordered_map>
+#include <random>
+#include <sstream>
+#include <string>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -21,6 +32,8 @@
 #endif
 #include "Chip8Renderer/OpenFileDialog.hpp"
 #include "Chip8Renderer/Input.hpp"
+#include "Chip8Core/ThreadPool.hpp"
+#include "Chip8Core/Disassembler.hpp"
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) noexcept;
@@ -29,17 +42,39 @@ void processInput(GLFWwindow* window) noexcept;
 // settings
 constexpr unsigned int SCR_WIDTH = 1440;
 constexpr unsigned int SCR_HEIGHT = 810;
+constexpr char const * LIBRARY_INDEX_FILE = "rom_library.idx";
+constexpr char const * ROM_DATABASE_DIRECTORY = "database";
+constexpr char const * OPCODE_STATISTICS_FILE = "opcode_statistics.json";
+constexpr char const * HEAT_MAP_FILE = "heat_map.csv";
+constexpr char const * MEMORY_REPORT_FILE = "memory_report.json";
+constexpr char const * FRAME_TRACE_FILE = "frame_trace.json";
+constexpr char const * CONTROL_FLOW_CACHE_DIRECTORY = "control_flow_cache";
+constexpr char const * CONTROL_FLOW_GRAPH_FILE = "control_flow.dot";
+constexpr char const * KEY_MAPPING_FILE = "key_mapping.json";
+constexpr int64_t FRAME_TRACE_DURATION = 5'000'000'000; // nanoseconds
 
 Chip8Renderer::Chip8Renderer(Chip8::Chip8& chip8) noexcept
     : mWindow(nullptr), mChip8(chip8), mScaleFactor(0.03f), mPixelColor{1.0f, 1.0f, 1.0f}
     , mBackgroundColor{0.26f, 0.26f, 0.26f}, mClearColor{}, mRunning(false), mStepping(false)
     , mLastInstruction(0x0000), mUpdatesPerSecond(480)
+    , mRewindBudgetMiB(static_cast<int>(Chip8::RewindBuffer::DefaultMemoryBudget / (1024u * 1024u))), mRecording(false)
+    , mLibraryInitialized(false), mLibraryDirectory{"roms"}, mLibraryFilter{}, mSessionFrame{}
+    , mProfiling(false), mProfilerSortColumn(1), mProfilerSortDescending(true), mHotAddressCount(16)
+    , mMemoryProfiling(false), mFrameTimeProbe("frame"), mTraceCaptureEnd(0), mFollowProgramCounter(true)
+    , mLastListedProgramCounter(0xFFFF), mBreakpointCondition{}, mWatchAddress{}, mWatchCount(1)
+    , mLastWriteAddress{}, mDisassemblyScrollTarget(-1)
 {
+    mDebugger.attach(&mChip8);
+    mHistory.start(mChip8);
     mLastTimerClockTime = mTimerClock.restart();
     mLastUpdateClockTime = mUpdateClock.restart();
 }
 
 void Chip8Renderer::free() {
+    mDebugger.attach(nullptr);
+    mHistory.stop(mChip8);
+    mChip8.setProfiler(nullptr);
+    mChip8.setMemoryProfiler(nullptr);
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -78,49 +113,149 @@ bool Chip8Renderer::createWindow() {
     ImGui_ImplOpenGL3_Init(glsl_version);
 
     // connect input
+    std::string error;
+    if (std::ifstream(KEY_MAPPING_FILE).good() && !Input::loadKeyMapping(KEY_MAPPING_FILE, error))
+        mMessage = std::string("Invalid key mapping in ") + KEY_MAPPING_FILE + ": " + error;
     Input::setKeyDownCallback([&](uint8_t key) -> void{
-        mChip8.triggerKeyDown(key);
+        if (mSessionViewer)
+            mSessionViewer->sendKey(key, true);
+        else
+            mInputQueue.push(mUpdateClock.getElapsedTime(), key, true);
     });
     Input::setKeyUpCallback([&](uint8_t key) -> void {
-        mChip8.triggerKeyUp(key);
+        if (mSessionViewer)
+            mSessionViewer->sendKey(key, false);
+        else
+            mInputQueue.push(mUpdateClock.getElapsedTime(), key, false);
     });
 
     return true;
 }
 
+bool Chip8Renderer::connectToSession(const std::string& name) {
+    try {
+        mSessionViewer = std::make_unique<Chip8::SessionViewer>(name);
+    } catch (const std::runtime_error& e) {
+        std::cout << "Could not connect to session: " << e.what() << std::endl;
+        return false;
+    }
+    mSessionName = name;
+    mRunning = false;
+    stopMovie();
+    mRewindBuffer.clear();
+    mHistory.stop(mChip8);
+    return true;
+}
+
+void Chip8Renderer::startLatencyProbe(size_t sampleCount) {
+    mRewindBuffer.clear();
+    stopMovie();
+    mInputQueue.clear();
+    mChip8.loadROM(Chip8::LatencyProbe::TestRom.data(), Chip8::LatencyProbe::TestRom.size());
+    mHistory.start(mChip8);
+    mControlFlow = Chip8::ControlFlowAnalysis::analyze(mChip8.getMemory());
+    mRomPath.clear();
+    mLatencyProbe.emplace(sampleCount, true);
+    mRunning = true;
+    mLastTimerClockTime = mTimerClock.restart();
+    mLastUpdateClockTime = mUpdateClock.restart();
+}
+
 void Chip8Renderer::startRenderLoop() {
     constexpr float frameInterval = 1.f / 60.f;
+    constexpr double viewerPollInterval = 0.001; // far below the frame interval of the backend
     while (!glfwWindowShouldClose(mWindow)) {
-        glfwPollEvents();
-        processInput(mWindow);
+        {
+            Chip8::ScopedProbe probe("input");
+            glfwPollEvents();
+            processInput(mWindow);
+            if (mLatencyProbe) {
+                if (const auto event = mLatencyProbe->poll(mChip8, Chip8::getProbeTime()))
+                    Input::injectKey(event->key, event->pressed);
+            }
+        }
+        // while running, the events are applied at the cycle that corresponds to their time (see below)
+        if (!mRunning)
+            mInputQueue.flush(mChip8);
 
         if (mStepping) {
             mLastInstruction = mChip8.getNextInstruction();
-            mChip8.step();
-            mChip8.clockTimers();
+            stepEmulation();
+            if (!isMovieDrivingTimers())
+                mChip8.clockTimers();
             mStepping = false;
+            pauseAtStop();
         }
 
-        while (mRunning && (mUpdateClock.getElapsedTime() - mLastUpdateClockTime >= 1.f / mUpdatesPerSecond)) {
-            mLastInstruction = mChip8.getNextInstruction();
-            mChip8.step();
-            mLastUpdateClockTime += 1.f / mUpdatesPerSecond;
+        if (mRunning && (mUpdateClock.getElapsedTime() - mLastUpdateClockTime >= 1.f / mUpdatesPerSecond)) {
+            Chip8::ScopedProbe probe("emulation");
+            while (mRunning && (mUpdateClock.getElapsedTime() - mLastUpdateClockTime >= 1.f / mUpdatesPerSecond)) {
+                mInputQueue.apply(mChip8, mLastUpdateClockTime);
+                mLastInstruction = mChip8.getNextInstruction();
+                stepEmulation();
+                if (mLatencyProbe)
+                    mLatencyProbe->checkDisplay(mChip8, Chip8::getProbeTime());
+                mLastUpdateClockTime += 1.f / mUpdatesPerSecond;
+                if (pauseAtStop())
+                    mLastUpdateClockTime = mUpdateClock.getElapsedTime(); // do not catch up after continuing
+            }
+        }
+
+        if (mSessionViewer) {
+            // client mode: the backend runs the emulation, every new frame is rendered as soon as it has been read
+            const uint64_t lastFrameNumber = mSessionFrame.frameNumber;
+            if (mSessionViewer->read(mSessionFrame) && mSessionFrame.frameNumber != lastFrameNumber) {
+                Chip8::ScopedProbe probe("frame");
+                mChip8.loadState(mSessionFrame.state);
+                renderFrame();
+            } else {
+                // the session has no signal for new frames, so poll it, but without spinning; input events end the
+                // wait early and are sent right away
+                glfwWaitEventsTimeout(viewerPollInterval);
+            }
+            continue;
         }
 
         if (mTimerClock.getElapsedTime() - mLastTimerClockTime >= frameInterval) {
+            Chip8::ScopedProbe probe("frame");
             // clock timers
             if (mRunning) {
-                mChip8.clockTimers();
+                Chip8::ScopedProbe timerProbe("timers");
+                if (!isMovieDrivingTimers())
+                    mChip8.clockTimers();
+                mRewindBuffer.push(mChip8);
             }
-            // render
-            renderDisplay();
-            renderImGui();
-            glfwSwapBuffers(mWindow);
+            renderFrame();
             mLastTimerClockTime = mTimerClock.getElapsedTime();
         }
     }
 }
 
+void Chip8Renderer::renderFrame() {
+    {
+        Chip8::ScopedProbe probe("renderDisplay");
+        renderDisplay();
+    }
+    {
+        Chip8::ScopedProbe probe("renderImGui");
+        renderImGui();
+    }
+    {
+        Chip8::ScopedProbe probe("swapBuffers");
+        glfwSwapBuffers(mWindow);
+    }
+    if (mLatencyProbe) {
+        mLatencyProbe->present(Chip8::getProbeTime());
+        if (mLatencyProbe->isFinished()) {
+            std::ostringstream report;
+            mLatencyProbe->printReport(report);
+            std::cout << report.str();
+            mMessage = report.str();
+            mLatencyProbe.reset();
+        }
+    }
+}
+
 void Chip8Renderer::renderDisplay() const {
     float ratio;
     int width, height;
@@ -151,26 +286,55 @@ void Chip8Renderer::renderDisplay() const {
     }
 }
 
+bool Chip8Renderer::loadROM(const std::string& filename, bool revalidate) {
+    mRewindBuffer.clear();
+    mInputQueue.clear();
+    stopMovie();
+    const auto rom = mRomStore.load(filename, revalidate);
+    if (!rom)
+        return false;
+    mChip8.loadROM(*rom);
+    mControlFlow = Chip8::ControlFlowAnalysis::analyzeCached(CONTROL_FLOW_CACHE_DIRECTORY, rom->getHash(), mChip8.getMemory());
+    mChip8.seedRandom(std::random_device{}());
+    mHistory.start(mChip8);
+    mRomPath = filename;
+    return true;
+}
+
 void Chip8Renderer::renderImGui() {
     // ImGui
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    if (mSessionViewer) {
+        renderSessionWindow();
+        renderFrameTimeWindow();
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        return;
+    }
+
     ImGui::Begin("Chip 8 Emulator");
     if (ImGui::Button("Load ROM file...")) {
         auto path = OpenFileDialog::open();
         if (path.has_value()) {
-            auto filename = path.value();
-            if (mChip8.loadROM(filename))
-                mMessage = "ROM has been loaded!";
-            else
-                mMessage = "Could not load ROM!";
+            mMessage = (loadROM(path.value(), false) ? "ROM has been loaded!" : "Could not load ROM!");
         }
     }
     ImGui::SameLine();
+    if (ImGui::Button("Reload") && !mRomPath.empty()) {
+        // picks up changes of the file, otherwise the cached ROM is used
+        mMessage = (loadROM(mRomPath, true) ? "ROM has been reloaded!" : "Could not reload ROM!");
+    }
+    ImGui::SameLine();
     if (ImGui::Button("Eject")) {
         mChip8.reset();
+        mRomPath.clear();
+        mControlFlow = Chip8::ControlFlowAnalysis{};
+        mRewindBuffer.clear();
+        mHistory.start(mChip8);
+        stopMovie();
         mMessage = "ROM has been ejected!";
         mLastInstruction = Chip8::Instruction(0x0000);
     }
@@ -197,12 +361,12 @@ void Chip8Renderer::renderImGui() {
     ImGui::Text("Delay timer: %d", mChip8.getDelayTimer());
     ImGui::Text("Sound timer: %d", mChip8.getSoundTimer());
     if (mLastInstruction.getValue() != 0x0000)
-        ImGui::Text("Last instruction: 0x%04X", mLastInstruction.getValue());
+        ImGui::Text("Last instruction: 0x%04X  %s", mLastInstruction.getValue(), Chip8::disassemble(mLastInstruction).c_str());
     else
         ImGui::Text("Last instruction: <none>");
     auto instruction = mChip8.getNextInstruction();
     if (instruction.getValue() != 0x0000)
-        ImGui::Text("Next instruction: 0x%04X", instruction.getValue());
+        ImGui::Text("Next instruction: 0x%04X  %s", instruction.getValue(), Chip8::disassemble(instruction).c_str());
     else {
         ImGui::Text("Next instruction: <none>");
         mMessage = "End of program reached!";
@@ -272,21 +436,804 @@ void Chip8Renderer::renderImGui() {
     ImGui::SameLine();
     if (ImGui::Button("Restart")) {
         mChip8.reset(false);
+        mRewindBuffer.clear();
+        mHistory.start(mChip8);
+        stopMovie();
         mMessage = "Program restarted!";
         mLastInstruction = Chip8::Instruction(0x0000);
     }
 
     ImGui::Separator();
 
+    renderRewindControls();
+
+    ImGui::Separator();
+
+    renderMovieControls();
+
+    ImGui::Separator();
+
+    if (mLatencyProbe)
+        ImGui::Text("Measuring the input latency: %zu samples", mLatencyProbe->getSamples().size());
     ImGui::Text("%s", mMessage.c_str());
 
     ImGui::End();
 
+    renderLibraryWindow();
+    renderProfilerWindow();
+    renderDisassemblyWindow();
+    renderControlFlowWindow();
+    renderFrameTimeWindow();
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+void Chip8Renderer::renderRewindControls() {
+    ImGui::Text("Rewind");
+    ImGui::Button("Hold to rewind");
+    if (ImGui::IsItemActive() && mRewindBuffer.size() > 0) {
+        // rewinding pauses the emulation, pressing "Run" continues from the restored frame
+        mRunning = false;
+        mMoviePlayer.reset();
+        mRewindBuffer.stepBack(mChip8);
+        mHistory.start(mChip8);
+        mLastInstruction = Chip8::Instruction(0x0000);
+    }
+
+    ImGui::PushItemWidth(170);
+    if (mRewindBuffer.size() > 0) {
+        int position = static_cast<int>(mRewindBuffer.getPosition());
+        if (ImGui::SliderInt("history", &position, 0, static_cast<int>(mRewindBuffer.size()) - 1)) {
+            mRunning = false;
+            mMoviePlayer.reset();
+            mRewindBuffer.restore(static_cast<size_t>(position), mChip8);
+            mHistory.start(mChip8);
+            mLastInstruction = Chip8::Instruction(0x0000);
+        }
+    }
+    if (ImGui::SliderInt("budget (MiB)", &mRewindBudgetMiB, 1, 256))
+        mRewindBuffer.setMemoryBudget(static_cast<size_t>(mRewindBudgetMiB) * 1024u * 1024u);
+    ImGui::PopItemWidth();
+    ImGui::Text("%zu frames (%.2f s), %.1f KiB used", mRewindBuffer.size(),
+        static_cast<double>(mRewindBuffer.size()) / 60.0,
+        static_cast<double>(mRewindBuffer.getMemoryUsage()) / 1024.0);
+}
+
+void Chip8Renderer::renderMovieControls() {
+    constexpr char const * recordingFilename = "recording.c8m";
+    ImGui::Text("Input movie");
+    if (mRecording) {
+        if (ImGui::Button("Stop recording")) {
+            mMovie.stopRecording(mChip8);
+            mRecording = false;
+            if (mMovie.save(recordingFilename))
+                mMessage = std::string("Movie has been saved to ") + recordingFilename + "!";
+            else
+                mMessage = "Could not save movie!";
+        }
+    } else if (ImGui::Button("Record")) {
+        mMoviePlayer.reset();
+        mMovie.startRecording(mChip8);
+        mRecording = true;
+        mMessage = "Recording movie...";
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Play movie...")) {
+        auto path = OpenFileDialog::open();
+        if (path.has_value()) {
+            stopMovie();
+            std::string error;
+            if (mMovie.load(path.value(), error)) {
+                mMoviePlayer.emplace(mMovie);
+                mMoviePlayer->start(mChip8);
+                mRewindBuffer.clear();
+                mHistory.start(mChip8);
+                mLastInstruction = Chip8::Instruction(0x0000);
+                mMessage = "Playing movie...";
+            } else {
+                mMessage = "Could not load movie: " + error;
+            }
+        }
+    }
+    if (mRecording)
+        ImGui::Text("%zu events recorded", mMovie.getEvents().size());
+    else if (mMoviePlayer)
+        ImGui::Text("Playing, cycle %llu", static_cast<unsigned long long>(mChip8.getCycleCount()));
+}
+
+void Chip8Renderer::renderLibraryWindow() {
+    if (!mLibraryInitialized) {
+        // the persisted index makes the library available without scanning at startup
+        std::string error;
+        mRomDatabase.load(ROM_DATABASE_DIRECTORY, error);
+        mRomLibrary.loadIndex(LIBRARY_INDEX_FILE);
+        mLibraryInitialized = true;
+    }
+
+    ImGui::Begin("ROM library");
+    ImGui::PushItemWidth(200);
+    ImGui::InputText("directory", mLibraryDirectory, sizeof(mLibraryDirectory));
+    ImGui::SameLine();
+    if (ImGui::Button("Scan")) {
+        Chip8::ThreadPool threadPool;
+        const size_t hashed = mRomLibrary.scan({ mLibraryDirectory }, mRomDatabase, threadPool);
+        mRomLibrary.saveIndex(LIBRARY_INDEX_FILE);
+        mMessage = "Found " + std::to_string(mRomLibrary.getEntries().size()) + " ROMs (" + std::to_string(hashed) + " new or changed)!";
+    }
+    ImGui::InputText("search", mLibraryFilter, sizeof(mLibraryFilter));
+    ImGui::PopItemWidth();
+    ImGui::Text("%zu ROMs, %zu known to the database", mRomLibrary.getEntries().size(), mRomDatabase.size());
+
+    ImGui::BeginChild("roms");
+    for (const size_t index : mRomLibrary.search(mLibraryFilter)) {
+        const auto& entry = mRomLibrary.getEntries()[index];
+        ImGui::PushID(static_cast<int>(index));
+        const bool selected = (entry.path == mRomPath);
+        if (ImGui::Selectable(entry.title.c_str(), selected)) {
+            if (loadROM(entry.path, true)) {
+                mChip8.setCompatibilityMode(entry.compatibilityMode);
+                if (entry.tickrate > 0)
+                    mUpdatesPerSecond = static_cast<int>(entry.tickrate) * 60; // the tickrate counts instructions per frame
+                mMessage = "ROM has been loaded!";
+            } else {
+                mMessage = "Could not load ROM!";
+            }
+        }
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("%s\n%s%s", entry.path.c_str(), (entry.known ? entry.platform.c_str() : "unknown ROM"),
+                (entry.compatibilityMode == Chip8::CompatibilityMode::OriginalChip8 ? " (CHIP-8 quirks)" : " (SuperChip quirks)"));
+        ImGui::PopID();
+    }
+    ImGui::EndChild();
+    ImGui::End();
+}
+
+void Chip8Renderer::renderSessionWindow() {
+    const auto& frameLatency = mSessionViewer->getFrameLatency();
+    const auto& inputLatency = mSessionViewer->getInputLatency();
+    ImGui::Begin("Session");
+    ImGui::Text("Session: %s (viewer %zu)", mSessionName.c_str(), mSessionViewer->getViewerIndex());
+    ImGui::Text("Frame: %llu", static_cast<unsigned long long>(mSessionFrame.frameNumber));
+    ImGui::Text("Program counter: 0x%03X", mChip8.getProgramCounter());
+    ImGui::Text("Delay timer: %d  Sound timer: %d", mChip8.getDelayTimer(), mChip8.getSoundTimer());
+
+    ImGui::Separator();
+
+    // all values in milliseconds
+    ImGui::Text("Frame latency: %.3f (mean %.3f, max %.3f)", frameLatency.last * 1e3, frameLatency.mean * 1e3, frameLatency.maximum * 1e3);
+    ImGui::Text("Input latency: %.3f (mean %.3f, max %.3f, %llu samples)", inputLatency.last * 1e3, inputLatency.mean * 1e3,
+        inputLatency.maximum * 1e3, static_cast<unsigned long long>(inputLatency.samples));
+    ImGui::End();
+}
+
+void Chip8Renderer::renderProfilerWindow() {
+    ImGui::Begin("Profiler");
+    if (!Chip8::Profiler::Enabled) {
+        ImGui::Text("The emulator has been built without CHIP8_ENABLE_PROFILING.");
+        ImGui::End();
+        return;
+    }
+    if (ImGui::Checkbox("Profile instructions", &mProfiling))
+        mChip8.setProfiler(mProfiling ? &mProfiler : nullptr);
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Profile memory", &mMemoryProfiling))
+        mChip8.setMemoryProfiler(mMemoryProfiling ? &mMemoryProfiler : nullptr);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset")) {
+        mProfiler.reset();
+        mMemoryProfiler.reset();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export JSON")) {
+        std::ofstream file(OPCODE_STATISTICS_FILE);
+        mProfiler.writeJson(file);
+        file << "\n";
+        mMessage = (file.good() ? std::string("Opcode statistics have been written to ") + OPCODE_STATISTICS_FILE + "!"
+            : std::string("Could not write ") + OPCODE_STATISTICS_FILE + "!");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export heat map")) {
+        std::ofstream file(HEAT_MAP_FILE);
+        file << "address,executions\n";
+        mProfiler.writeHeatMapCsv(file);
+        mMessage = (file.good() ? std::string("The heat map has been written to ") + HEAT_MAP_FILE + "!"
+            : std::string("Could not write ") + HEAT_MAP_FILE + "!");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export memory report")) {
+        std::ofstream file(MEMORY_REPORT_FILE);
+        mMemoryProfiler.writeReportJson(file);
+        file << "\n";
+        mMessage = (file.good() ? std::string("The memory report has been written to ") + MEMORY_REPORT_FILE + "!"
+            : std::string("Could not write ") + MEMORY_REPORT_FILE + "!");
+    }
+    ImGui::Text("%llu instructions, %.3f ms", static_cast<unsigned long long>(mProfiler.getTotalExecutions()),
+        static_cast<double>(mProfiler.getTotalTime()) * 1e-6);
+
+    if (ImGui::CollapsingHeader("Opcodes", ImGuiTreeNodeFlags_DefaultOpen))
+        renderOpcodeTable();
+    if (ImGui::CollapsingHeader("Heat map", ImGuiTreeNodeFlags_DefaultOpen))
+        renderHeatMap();
+    if (ImGui::CollapsingHeader("Memory map"))
+        renderMemoryMap();
+    ImGui::End();
+}
+
+void Chip8Renderer::renderOpcodeTable() {
+    const uint64_t totalExecutions = mProfiler.getTotalExecutions();
+
+    // sorted by the column whose header has been clicked last, clicking again reverses the order
+    const auto getSortKey = [this](size_t opcodeIndex) -> double {
+        const auto& statistics = mProfiler.getOpcodeStatistics(opcodeIndex);
+        switch (mProfilerSortColumn) {
+            case 0:
+                return static_cast<double>(opcodeIndex);
+            case 3:
+                return static_cast<double>(statistics.totalTime);
+            case 4:
+                return (statistics.executions > 0 ? static_cast<double>(statistics.totalTime) / static_cast<double>(statistics.executions) : 0.0);
+            default:
+                return static_cast<double>(statistics.executions);
+        }
+    };
+    std::vector<size_t> rows(Chip8::Profiler::OpcodeCount);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::stable_sort(rows.begin(), rows.end(), [&](size_t lhs, size_t rhs) {
+        return (mProfilerSortDescending ? getSortKey(lhs) > getSortKey(rhs) : getSortKey(lhs) < getSortKey(rhs));
+    });
+
+    ImGui::Columns(5, "opcodes");
+    static const char* const headers[] = { "Opcode", "Executions", "Share", "Time (us)", "Mean (ns)" };
+    for (int column = 0; column < 5; ++column) {
+        const bool sorted = (column == mProfilerSortColumn || (column == 2 && mProfilerSortColumn == 1));
+        const std::string label = std::string(headers[column]) + (sorted ? (mProfilerSortDescending ? " v" : " ^") : "");
+        if (ImGui::Selectable(label.c_str(), sorted)) {
+            const int sortColumn = (column == 2 ? 1 : column); // the share is sorted like the executions
+            mProfilerSortDescending = (sortColumn == mProfilerSortColumn ? !mProfilerSortDescending : sortColumn != 0);
+            mProfilerSortColumn = sortColumn;
+        }
+        ImGui::NextColumn();
+    }
+    ImGui::Separator();
+    for (const size_t opcodeIndex : rows) {
+        const auto& statistics = mProfiler.getOpcodeStatistics(opcodeIndex);
+        if (statistics.executions == 0)
+            continue;
+        ImGui::Text("%s", Chip8::Profiler::getOpcodeName(opcodeIndex));
+        if (ImGui::IsItemHovered()) {
+            float histogram[Chip8::Profiler::DurationBuckets];
+            for (size_t bucket = 0; bucket < Chip8::Profiler::DurationBuckets; ++bucket)
+                histogram[bucket] = static_cast<float>(statistics.histogram[bucket]);
+            ImGui::BeginTooltip();
+            ImGui::Text("Execution times (bucket i: 2^i to 2^(i+1) ns)");
+            ImGui::PlotHistogram("##histogram", histogram, static_cast<int>(Chip8::Profiler::DurationBuckets), 0, nullptr, 0.f, FLT_MAX, ImVec2(240, 80));
+            ImGui::EndTooltip();
+        }
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(statistics.executions));
+        ImGui::NextColumn();
+        ImGui::Text("%.1f%%", 100.0 * static_cast<double>(statistics.executions) / static_cast<double>(totalExecutions));
+        ImGui::NextColumn();
+        ImGui::Text("%.1f", static_cast<double>(statistics.totalTime) * 1e-3);
+        ImGui::NextColumn();
+        ImGui::Text("%.1f", static_cast<double>(statistics.totalTime) / static_cast<double>(statistics.executions));
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void Chip8Renderer::renderHeatMap() {
+    // one cell per address, 64 addresses per row; the colors are scaled logarithmically, so idle loops do not hide the rest
+    constexpr size_t columns = 64;
+    constexpr float cellSize = 5.f;
+    const auto& counts = mProfiler.getAddressCounts();
+    const uint64_t totalExecutions = mProfiler.getTotalExecutions();
+    const double logarithmicMaximum = std::log1p(static_cast<double>(*std::max_element(counts.begin(), counts.end())));
+    const auto getHeatColor = [logarithmicMaximum](uint64_t count) {
+        // black, red, yellow, white
+        const float heat = (logarithmicMaximum > 0.0 ? static_cast<float>(std::log1p(static_cast<double>(count)) / logarithmicMaximum) : 0.f);
+        return ImGui::GetColorU32(ImVec4(std::clamp(3.f * heat, 0.f, 1.f), std::clamp(3.f * heat - 1.f, 0.f, 1.f),
+            std::clamp(3.f * heat - 2.f, 0.f, 1.f), 1.f));
+    };
+    const auto disassembleAddress = [this](size_t address) {
+        if (address + 1 >= Chip8::Chip8::MemorySize)
+            return std::string("-");
+        const auto& memory = mChip8.getMemory();
+        return Chip8::disassemble(Chip8::Instruction(memory.read(address), memory.read(address + 1)));
+    };
+
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 size(columns * cellSize, (Chip8::Profiler::AddressCount / columns) * cellSize);
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), getHeatColor(0));
+    for (size_t address = 0; address < counts.size(); ++address) {
+        if (counts[address] == 0)
+            continue;
+        const ImVec2 cell(origin.x + (address % columns) * cellSize, origin.y + (address / columns) * cellSize);
+        drawList->AddRectFilled(cell, ImVec2(cell.x + cellSize, cell.y + cellSize), getHeatColor(counts[address]));
+    }
+    const size_t programCounter = mChip8.getProgramCounter() % Chip8::Profiler::AddressCount;
+    const ImVec2 programCounterCell(origin.x + (programCounter % columns) * cellSize, origin.y + (programCounter / columns) * cellSize);
+    drawList->AddRect(programCounterCell, ImVec2(programCounterCell.x + 2.f * cellSize, programCounterCell.y + cellSize),
+        ImGui::GetColorU32(ImVec4(0.3f, 0.6f, 1.f, 1.f)));
+    ImGui::InvisibleButton("heat map", size);
+    if (ImGui::IsItemHovered()) {
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+        const size_t column = std::min(static_cast<size_t>((mouse.x - origin.x) / cellSize), columns - 1);
+        const size_t row = static_cast<size_t>((mouse.y - origin.y) / cellSize);
+        const size_t address = std::min(row * columns + column, Chip8::Profiler::AddressCount - 1);
+        ImGui::SetTooltip("0x%03X: %s\n%llu executions", static_cast<unsigned>(address), disassembleAddress(address).c_str(),
+            static_cast<unsigned long long>(counts[address]));
+    }
+
+    ImGui::PushItemWidth(170);
+    ImGui::SliderInt("hot addresses", &mHotAddressCount, 1, 64);
+    ImGui::PopItemWidth();
+    ImGui::Columns(4, "hot addresses");
+    ImGui::Text("Address");
+    ImGui::NextColumn();
+    ImGui::Text("Executions");
+    ImGui::NextColumn();
+    ImGui::Text("Share");
+    ImGui::NextColumn();
+    ImGui::Text("Instruction");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const uint16_t address : mProfiler.getHotAddresses(static_cast<size_t>(mHotAddressCount))) {
+        ImGui::Text("0x%03X", address);
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(counts[address]));
+        ImGui::NextColumn();
+        ImGui::Text("%.1f%%", 100.0 * static_cast<double>(counts[address]) / static_cast<double>(totalExecutions));
+        ImGui::NextColumn();
+        ImGui::Text("%s", disassembleAddress(address).c_str());
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void Chip8Renderer::renderMemoryMap() {
+    // the same layout as the heat map: the hue shows the region, the brightness how often the address has been accessed
+    constexpr size_t columns = 64;
+    constexpr float cellSize = 5.f;
+    static const ImVec4 regionColors[Chip8::MemoryProfiler::RegionCount] = {
+        ImVec4(0.f, 0.f, 0.f, 1.f), ImVec4(0.3f, 0.6f, 1.f, 1.f), ImVec4(0.3f, 1.f, 0.4f, 1.f), ImVec4(1.f, 0.7f, 0.2f, 1.f)
+    };
+    const auto getAccessCount = [this](size_t address) {
+        const auto& statistics = mMemoryProfiler.getAddressStatistics(static_cast<uint16_t>(address));
+        return statistics.reads + statistics.writes + statistics.executions + statistics.spriteReads;
+    };
+    uint64_t maximumCount = 0;
+    for (size_t address = 0; address < Chip8::MemoryProfiler::AddressCount; ++address)
+        maximumCount = std::max(maximumCount, getAccessCount(address));
+    const double logarithmicMaximum = std::log1p(static_cast<double>(maximumCount));
+    const auto selfModifyingCode = mMemoryProfiler.getSelfModifyingCode();
+
+    const auto regionSizes = mMemoryProfiler.getRegionSizes();
+    for (size_t region = 1; region < Chip8::MemoryProfiler::RegionCount; ++region) {
+        ImGui::ColorButton(Chip8::MemoryProfiler::getRegionName(static_cast<Chip8::MemoryProfiler::Region>(region)), regionColors[region],
+            ImGuiColorEditFlags_NoTooltip, ImVec2(10, 10));
+        ImGui::SameLine();
+        ImGui::Text("%s: %zu bytes", Chip8::MemoryProfiler::getRegionName(static_cast<Chip8::MemoryProfiler::Region>(region)), regionSizes[region]);
+        ImGui::SameLine();
+    }
+    ImGui::TextColored(ImVec4(1.f, 0.2f, 0.2f, 1.f), "self-modified: %zu", selfModifyingCode.size());
+
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 size(columns * cellSize, (Chip8::MemoryProfiler::AddressCount / columns) * cellSize);
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), ImGui::GetColorU32(regionColors[0]));
+    const auto getCell = [&origin](size_t address) {
+        return ImVec2(origin.x + (address % columns) * cellSize, origin.y + (address / columns) * cellSize);
+    };
+    for (size_t address = 0; address < Chip8::MemoryProfiler::AddressCount; ++address) {
+        const auto region = mMemoryProfiler.getRegion(static_cast<uint16_t>(address));
+        if (region == Chip8::MemoryProfiler::Region::Unused)
+            continue;
+        // rarely accessed addresses stay visible at a third of the brightness
+        const float brightness = (logarithmicMaximum > 0.0
+            ? 0.33f + 0.67f * static_cast<float>(std::log1p(static_cast<double>(getAccessCount(address))) / logarithmicMaximum) : 1.f);
+        const auto& color = regionColors[static_cast<size_t>(region)];
+        const ImVec2 cell = getCell(address);
+        drawList->AddRectFilled(cell, ImVec2(cell.x + cellSize, cell.y + cellSize),
+            ImGui::GetColorU32(ImVec4(color.x * brightness, color.y * brightness, color.z * brightness, 1.f)));
+    }
+    for (const auto& code : selfModifyingCode) {
+        const ImVec2 cell = getCell(code.address);
+        drawList->AddRect(cell, ImVec2(cell.x + 2.f * cellSize, cell.y + cellSize), ImGui::GetColorU32(ImVec4(1.f, 0.2f, 0.2f, 1.f)));
+    }
+    const ImVec2 programCounterCell = getCell(mChip8.getProgramCounter() % Chip8::MemoryProfiler::AddressCount);
+    drawList->AddRect(programCounterCell, ImVec2(programCounterCell.x + 2.f * cellSize, programCounterCell.y + cellSize),
+        ImGui::GetColorU32(ImVec4(1.f, 1.f, 1.f, 1.f)));
+    ImGui::InvisibleButton("memory map", size);
+    if (ImGui::IsItemHovered()) {
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+        const size_t column = std::min(static_cast<size_t>((mouse.x - origin.x) / cellSize), columns - 1);
+        const size_t row = static_cast<size_t>((mouse.y - origin.y) / cellSize);
+        const auto address = static_cast<uint16_t>(std::min(row * columns + column, Chip8::MemoryProfiler::AddressCount - 1));
+        const auto& statistics = mMemoryProfiler.getAddressStatistics(address);
+        ImGui::SetTooltip("0x%03X: %s\n%llu reads, %llu writes\n%llu executions (%llu after a write)\n%llu sprite reads",
+            static_cast<unsigned>(address), Chip8::MemoryProfiler::getRegionName(mMemoryProfiler.getRegion(address)),
+            static_cast<unsigned long long>(statistics.reads), static_cast<unsigned long long>(statistics.writes),
+            static_cast<unsigned long long>(statistics.executions), static_cast<unsigned long long>(statistics.executionsAfterWrite),
+            static_cast<unsigned long long>(statistics.spriteReads));
+    }
+
+    if (selfModifyingCode.empty()) {
+        ImGui::Text("No instruction has been executed after it had been written.");
+        return;
+    }
+    ImGui::Columns(4, "self-modifying code");
+    ImGui::Text("Address");
+    ImGui::NextColumn();
+    ImGui::Text("Writes");
+    ImGui::NextColumn();
+    ImGui::Text("Executions");
+    ImGui::NextColumn();
+    ImGui::Text("First write / execution");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const auto& code : selfModifyingCode) {
+        ImGui::Text("0x%03X", code.address);
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(code.writes));
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(code.executionsAfterWrite));
+        ImGui::NextColumn();
+        ImGui::Text("cycle %llu / %llu", static_cast<unsigned long long>(code.firstWriteCycle),
+            static_cast<unsigned long long>(code.firstModifiedExecutionCycle));
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void Chip8Renderer::renderDisassemblyWindow() {
+    {
+        Chip8::ScopedProbe probe("disassembly");
+        mDisassembly.update(mChip8.getMemory());
+    }
+
+    ImGui::Begin("Disassembly");
+    if (!Chip8::Profiler::Enabled)
+        ImGui::Text("The emulator has been built without CHIP8_ENABLE_PROFILING, breakpoints have no effect.");
+    ImGui::Checkbox("Follow program counter", &mFollowProgramCounter);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear breakpoints"))
+        mDebugger.clear();
+    ImGui::PushItemWidth(200);
+    ImGui::InputText("condition", mBreakpointCondition, sizeof(mBreakpointCondition));
+    ImGui::PopItemWidth();
+    ImGui::TextDisabled("Click a line to toggle a breakpoint (with the condition, e.g. V3 == 0x10 && I >= 0x300).");
+    if (ImGui::CollapsingHeader("Watchpoints"))
+        renderWatchControls();
+    if (ImGui::CollapsingHeader("Time travel", ImGuiTreeNodeFlags_DefaultOpen))
+        renderTimeTravelControls();
+    ImGui::Separator();
+
+    // one row per instruction, aligned to the program counter (instructions can start at odd addresses)
+    const uint16_t programCounter = mChip8.getProgramCounter();
+    const size_t parity = programCounter % 2u;
+    const int rowCount = static_cast<int>(Chip8::DisassemblyListing::AddressCount / 2u);
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    static const ImVec4 breakpointColor{ 1.f, 0.35f, 0.35f, 1.f };
+    const bool analyzed = !mControlFlow.getBlocks().empty();
+
+    ImGui::BeginChild("listing");
+    if (mFollowProgramCounter && programCounter != mLastListedProgramCounter) {
+        const float rowTop = static_cast<float>(programCounter / 2u) * rowHeight;
+        if (rowTop < ImGui::GetScrollY() || rowTop + rowHeight > ImGui::GetScrollY() + ImGui::GetWindowHeight())
+            ImGui::SetScrollY(rowTop - 0.5f * (ImGui::GetWindowHeight() - rowHeight));
+    }
+    mLastListedProgramCounter = programCounter;
+    if (mDisassemblyScrollTarget >= 0) {
+        ImGui::SetScrollY(static_cast<float>(mDisassemblyScrollTarget / 2) * rowHeight);
+        mDisassemblyScrollTarget = -1;
+    }
+
+    // only the visible rows are submitted, which keeps the cost independent of the size of the address space
+    ImGuiListClipper clipper;
+    clipper.Begin(rowCount, rowHeight);
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const auto address = static_cast<uint16_t>(static_cast<size_t>(row) * 2u + parity);
+            if (address >= Chip8::DisassemblyListing::AddressCount)
+                continue;
+            const bool breakpoint = mDebugger.hasBreakpoint(address);
+            const std::string condition = (breakpoint ? mDebugger.getCondition(address) : std::string{});
+            // the bytes the control-flow analysis has not found to be code are most likely data
+            const auto kind = mControlFlow.getByteKind(address);
+            const bool data = (analyzed && !mControlFlow.isInstructionStart(address));
+            char label[128];
+            std::snprintf(label, sizeof(label), "%c 0x%03X  %04X  %-18s%s%s%s", (breakpoint ? '*' : ' '), static_cast<unsigned>(address),
+                static_cast<unsigned>(mDisassembly.getInstruction(address).getValue()), mDisassembly.getLine(address).c_str(),
+                (data && kind == Chip8::ControlFlowAnalysis::ByteKind::Sprite ? "; sprite" : ""),
+                (condition.empty() ? "" : " if "), condition.c_str());
+            ImGui::PushID(row);
+            if (breakpoint || data)
+                ImGui::PushStyleColor(ImGuiCol_Text, (breakpoint ? breakpointColor : ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled)));
+            if (ImGui::Selectable(label, address == programCounter)) {
+                std::string error;
+                if (breakpoint)
+                    mDebugger.removeBreakpoint(address);
+                else if (!mDebugger.setBreakpoint(address, mBreakpointCondition, error))
+                    mMessage = "Invalid condition: " + error;
+            }
+            if (breakpoint || data)
+                ImGui::PopStyleColor();
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+    ImGui::EndChild();
+    ImGui::End();
+}
+
+void Chip8Renderer::renderControlFlowWindow() {
+    ImGui::Begin("Control flow");
+    using ByteKind = Chip8::ControlFlowAnalysis::ByteKind;
+    const auto& blocks = mControlFlow.getBlocks();
+    if (blocks.empty()) {
+        ImGui::Text("Load a ROM to analyze its control flow.");
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("code: %zu bytes, sprites: %zu bytes, unknown: %zu bytes", mControlFlow.countBytes(ByteKind::Code),
+        mControlFlow.countBytes(ByteKind::Sprite), mControlFlow.countBytes(ByteKind::Unknown));
+    const auto indirectJumps = mControlFlow.getIndirectJumps();
+    std::string indirectJumpList;
+    for (const auto address : indirectJumps) {
+        char text[8];
+        std::snprintf(text, sizeof(text), " 0x%03X", static_cast<unsigned>(address));
+        indirectJumpList += text;
+    }
+    ImGui::Text("%zu basic blocks, indirect jumps (not followed):%s", blocks.size(), (indirectJumps.empty() ? " none" : indirectJumpList.c_str()));
+    if (ImGui::Button("Export DOT")) {
+        std::ofstream file(CONTROL_FLOW_GRAPH_FILE);
+        mControlFlow.writeDot(file);
+        mMessage = (file.good() ? std::string("Control-flow graph has been written to ") + CONTROL_FLOW_GRAPH_FILE
+            : "Could not write the control-flow graph!");
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("Click a block to show it in the disassembly.");
+    ImGui::Separator();
+
+    ImGui::Columns(4, "blocks");
+    ImGui::Text("start"); ImGui::NextColumn();
+    ImGui::Text("end"); ImGui::NextColumn();
+    ImGui::Text("terminator"); ImGui::NextColumn();
+    ImGui::Text("successors"); ImGui::NextColumn();
+    ImGui::Separator();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(blocks.size()));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const auto& block = blocks[static_cast<size_t>(row)];
+            char start[8];
+            std::snprintf(start, sizeof(start), "0x%03X", static_cast<unsigned>(block.start));
+            ImGui::PushID(row);
+            if (ImGui::Selectable(start, false, ImGuiSelectableFlags_SpanAllColumns)) {
+                mDisassemblyScrollTarget = block.start;
+                mFollowProgramCounter = false;
+            }
+            ImGui::PopID();
+            ImGui::NextColumn();
+            ImGui::Text("0x%03X", static_cast<unsigned>(block.end));
+            ImGui::NextColumn();
+            ImGui::Text("%s", Chip8::ControlFlowAnalysis::getTerminatorName(block.terminator));
+            ImGui::NextColumn();
+            std::string successors;
+            for (const auto successor : block.successors) {
+                char text[8];
+                std::snprintf(text, sizeof(text), "0x%03X ", static_cast<unsigned>(successor));
+                successors += text;
+            }
+            ImGui::Text("%s", successors.c_str());
+            ImGui::NextColumn();
+        }
+    }
+    clipper.End();
+    ImGui::Columns(1);
+    ImGui::End();
+}
+
+void Chip8Renderer::renderWatchControls() {
+    ImGui::PushItemWidth(80);
+    ImGui::InputText("address", mWatchAddress, sizeof(mWatchAddress), ImGuiInputTextFlags_CharsHexadecimal);
+    ImGui::SameLine();
+    ImGui::InputInt("bytes", &mWatchCount);
+    ImGui::PopItemWidth();
+    mWatchCount = std::clamp(mWatchCount, 1, static_cast<int>(Chip8::Debugger::AddressCount));
+    const bool watch = ImGui::Button("Watch");
+    ImGui::SameLine();
+    if (watch || ImGui::Button("Unwatch")) {
+        const auto address = std::strtoul(mWatchAddress, nullptr, 16);
+        if (address + static_cast<unsigned long>(mWatchCount) <= Chip8::Debugger::AddressCount)
+            mDebugger.setMemoryWatch(static_cast<uint16_t>(address), static_cast<size_t>(mWatchCount), watch);
+        else
+            mMessage = "The watched addresses are out of range!";
+    }
+
+    ImGui::Text("Registers:");
+    for (uint8_t i = 0; i <= 0xF; ++i) {
+        bool watched = (mDebugger.getRegisterWatchMask() & (1u << i)) != 0;
+        char label[4];
+        std::snprintf(label, sizeof(label), "V%X", static_cast<unsigned>(i));
+        if (i % 8 != 0)
+            ImGui::SameLine();
+        if (ImGui::Checkbox(label, &watched))
+            mDebugger.setRegisterWatch(i, watched);
+    }
+}
+
+void Chip8Renderer::renderTimeTravelControls() {
+    // each action pauses the emulation and re-executes the recorded history up to the restored cycle
+    Clock clock;
+    bool restored = false;
+    bool attempted = false;
+    if (mRecording) {
+        // the movie would keep the input of the cycles after the restored one
+        ImGui::TextDisabled("Stop recording the movie to run backwards.");
+    } else {
+        if (ImGui::Button("Step back")) {
+            attempted = true;
+            restored = mHistory.stepBack(mChip8);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Reverse continue")) {
+            attempted = true;
+            restored = mHistory.reverseContinue(mChip8, mDebugger);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Back to last write of")) {
+            attempted = true;
+            restored = mHistory.runBackToLastWrite(mChip8, static_cast<uint16_t>(std::strtoul(mLastWriteAddress, nullptr, 16)
+                % Chip8::Chip8::MemorySize));
+        }
+        ImGui::SameLine();
+        ImGui::PushItemWidth(60);
+        ImGui::InputText("##lastWriteAddress", mLastWriteAddress, sizeof(mLastWriteAddress), ImGuiInputTextFlags_CharsHexadecimal);
+        ImGui::PopItemWidth();
+    }
+    if (attempted) {
+        mRunning = false;
+        mMoviePlayer.reset();
+        mDebugger.takeStop();
+        mLastInstruction = Chip8::Instruction(0x0000);
+        char text[96];
+        if (restored)
+            std::snprintf(text, sizeof(text), "Cycle %llu has been restored in %.1f ms!",
+                static_cast<unsigned long long>(mChip8.getCycleCount()), static_cast<double>(clock.getElapsedTime()) * 1e3);
+        else
+            std::snprintf(text, sizeof(text), "Not found in the history!");
+        mMessage = text;
+    }
+    ImGui::Text("History: cycles %llu to %llu, %zu checkpoints, %.1f KiB",
+        static_cast<unsigned long long>(mHistory.getFirstCycle()), static_cast<unsigned long long>(mChip8.getCycleCount()),
+        mHistory.getCheckpointCount(), static_cast<double>(mHistory.getMemoryUsage()) / 1024.0);
+}
+
+bool Chip8Renderer::pauseAtStop() {
+    const auto stop = mDebugger.takeStop();
+    if (!stop)
+        return false;
+    mRunning = false;
+    char text[96];
+    switch (stop->reason) {
+        case Chip8::Debugger::StopReason::Breakpoint:
+            std::snprintf(text, sizeof(text), "Breakpoint at 0x%03X reached!", static_cast<unsigned>(stop->target));
+            break;
+        case Chip8::Debugger::StopReason::MemoryWatch:
+            std::snprintf(text, sizeof(text), "0x%03X has been written by the instruction at 0x%03X!",
+                static_cast<unsigned>(stop->target), static_cast<unsigned>(stop->address));
+            break;
+        default:
+            std::snprintf(text, sizeof(text), "V%X has been changed by the instruction at 0x%03X!",
+                static_cast<unsigned>(stop->target), static_cast<unsigned>(stop->address));
+            break;
+    }
+    mMessage = text;
+    return true;
+}
+
+void Chip8Renderer::renderFrameTimeWindow() {
+    // the probes of the previous frames (including the end of the last "frame" probe)
+    const auto events = Chip8::collectProbeEvents();
+    mProbeStatistics.add(events);
+    mProbeStatistics.update();
+    if (mTraceCaptureEnd != 0) {
+        mTraceCapture.insert(mTraceCapture.end(), events.begin(), events.end());
+        if (Chip8::getProbeTime() >= mTraceCaptureEnd) {
+            std::ofstream file(FRAME_TRACE_FILE);
+            Chip8::writeChromeTrace(file, mTraceCapture);
+            mMessage = (file.good() ? std::string("The trace has been written to ") + FRAME_TRACE_FILE + "!"
+                : std::string("Could not write ") + FRAME_TRACE_FILE + "!");
+            mTraceCapture.clear();
+            mTraceCaptureEnd = 0;
+        }
+    }
+
+    ImGui::Begin("Frame times");
+    if (mTraceCaptureEnd == 0) {
+        if (ImGui::Button("Capture trace")) {
+            mTraceCapture.clear();
+            mTraceCaptureEnd = Chip8::getProbeTime() + FRAME_TRACE_DURATION;
+        }
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Records all probes for %d seconds and writes them to %s (open it with Perfetto)",
+                static_cast<int>(FRAME_TRACE_DURATION / 1'000'000'000), FRAME_TRACE_FILE);
+    } else {
+        ImGui::Text("Capturing... %zu events", mTraceCapture.size());
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+        mProbeStatistics.clear();
+    ImGui::Text("%llu events dropped", static_cast<unsigned long long>(Chip8::getProbeBuffer().getDroppedCount()));
+
+    // all values in milliseconds, over the latest events of every probe
+    ImGui::Columns(4, "probes");
+    ImGui::Text("Probe");
+    ImGui::NextColumn();
+    ImGui::Text("p50");
+    ImGui::NextColumn();
+    ImGui::Text("p95");
+    ImGui::NextColumn();
+    ImGui::Text("p99");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const auto& [name, series] : mProbeStatistics.getSeries()) {
+        if (ImGui::Selectable(name.c_str(), name == mFrameTimeProbe, ImGuiSelectableFlags_SpanAllColumns))
+            mFrameTimeProbe = name;
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", static_cast<double>(series.p50.back()));
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", static_cast<double>(series.p95.back()));
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", static_cast<double>(series.p99.back()));
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    const auto selected = mProbeStatistics.getSeries().find(mFrameTimeProbe);
+    if (selected != mProbeStatistics.getSeries().end()) {
+        ImGui::Separator();
+        const auto& series = selected->second;
+        const float maximum = std::max(*std::max_element(series.p99.begin(), series.p99.end()), 1e-3f);
+        for (const auto& [label, history] : { std::make_pair("p50", &series.p50), std::make_pair("p95", &series.p95), std::make_pair("p99", &series.p99) }) {
+            const std::string overlay = mFrameTimeProbe + " " + label + ": " + std::to_string(history->back()) + " ms";
+            ImGui::PlotLines(label, history->data(), static_cast<int>(history->size()), 0, overlay.c_str(), 0.f, maximum, ImVec2(0, 50));
+        }
+    }
+    ImGui::End();
+}
+
+bool Chip8Renderer::stepEmulation() {
+    if (!mMoviePlayer) {
+        const bool result = mChip8.step();
+        mHistory.update(mChip8);
+        return result;
+    }
+    const bool result = mMoviePlayer->step(mChip8);
+    mHistory.update(mChip8);
+    if (mMoviePlayer->isFinished()) {
+        mMoviePlayer.reset();
+        mMessage = "Movie playback finished!";
+    }
+    return result;
+}
+
+bool Chip8Renderer::isMovieDrivingTimers() const noexcept {
+    return mMoviePlayer.has_value() && mMovie.drivesTimers();
+}
+
+void Chip8Renderer::stopMovie() {
+    if (mRecording) {
+        mMovie.stopRecording(mChip8);
+        mRecording = false;
+    }
+    mMoviePlayer.reset();
+}
+
 void Chip8Renderer::centerWindow(GLFWwindow* window, GLFWmonitor* monitor) {
     // taken from: https://vallentin.dev/2014/02/07/glfw-center-window
     if (!monitor)
@@ -1,15 +1,74 @@
 #include "Chip8Renderer/Input.hpp"
 
 #include <iostream>
-#include <unordered_map>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 #include <gsl/gsl>
 
-std::bitset<0x10> Input::mPressedKeys = std::bitset<0x10>();
+#include "Chip8Core/Json.hpp"
+
+namespace {
+
+	using KeyTable = std::array<int8_t, GLFW_KEY_LAST + 1>;
+
+	KeyTable makeEmptyKeyTable() noexcept {
+		KeyTable result;
+		result.fill(-1);
+		return result;
+	}
+
+	KeyTable makeDefaultKeyTable() noexcept {
+		// the keypad of the COSMAC VIP on the left side of a QWERTY keyboard
+		constexpr std::pair<int, int8_t> defaultMapping[] = {
+			{ GLFW_KEY_1, 0x1 }, { GLFW_KEY_2, 0x2 }, { GLFW_KEY_3, 0x3 }, { GLFW_KEY_4, 0xC },
+			{ GLFW_KEY_Q, 0x4 }, { GLFW_KEY_W, 0x5 }, { GLFW_KEY_E, 0x6 }, { GLFW_KEY_R, 0xD },
+			{ GLFW_KEY_A, 0x7 }, { GLFW_KEY_S, 0x8 }, { GLFW_KEY_D, 0x9 }, { GLFW_KEY_F, 0xE },
+			{ GLFW_KEY_Z, 0xA }, { GLFW_KEY_X, 0x0 }, { GLFW_KEY_C, 0xB }, { GLFW_KEY_V, 0xF },
+		};
+		KeyTable result = makeEmptyKeyTable();
+		for (const auto& [glfwKey, chip8Key] : defaultMapping)
+			result[gsl::narrow_cast<size_t>(glfwKey)] = chip8Key;
+		return result;
+	}
+
+	int findKeyCode(const std::string& name) noexcept {
+		if (name.size() == 1 && name[0] >= 'A' && name[0] <= 'Z')
+			return GLFW_KEY_A + (name[0] - 'A');
+		if (name.size() == 1 && name[0] >= '0' && name[0] <= '9')
+			return GLFW_KEY_0 + (name[0] - '0');
+		if (name.size() == 4 && name.compare(0, 3, "KP_") == 0 && name[3] >= '0' && name[3] <= '9')
+			return GLFW_KEY_KP_0 + (name[3] - '0');
+		constexpr std::pair<const char*, int> namedKeys[] = {
+			{ "SPACE", GLFW_KEY_SPACE }, { "ENTER", GLFW_KEY_ENTER }, { "TAB", GLFW_KEY_TAB },
+			{ "BACKSPACE", GLFW_KEY_BACKSPACE }, { "UP", GLFW_KEY_UP }, { "DOWN", GLFW_KEY_DOWN },
+			{ "LEFT", GLFW_KEY_LEFT }, { "RIGHT", GLFW_KEY_RIGHT }, { "COMMA", GLFW_KEY_COMMA },
+			{ "PERIOD", GLFW_KEY_PERIOD }, { "SEMICOLON", GLFW_KEY_SEMICOLON }, { "SLASH", GLFW_KEY_SLASH },
+			{ "MINUS", GLFW_KEY_MINUS }, { "EQUAL", GLFW_KEY_EQUAL }, { "KP_ADD", GLFW_KEY_KP_ADD },
+			{ "KP_SUBTRACT", GLFW_KEY_KP_SUBTRACT }, { "KP_MULTIPLY", GLFW_KEY_KP_MULTIPLY },
+			{ "KP_DIVIDE", GLFW_KEY_KP_DIVIDE }, { "KP_DECIMAL", GLFW_KEY_KP_DECIMAL }, { "KP_ENTER", GLFW_KEY_KP_ENTER },
+			{ "LEFT_SHIFT", GLFW_KEY_LEFT_SHIFT }, { "RIGHT_SHIFT", GLFW_KEY_RIGHT_SHIFT },
+			{ "LEFT_CONTROL", GLFW_KEY_LEFT_CONTROL }, { "RIGHT_CONTROL", GLFW_KEY_RIGHT_CONTROL },
+		};
+		for (const auto& [keyName, code] : namedKeys) {
+			if (name == keyName)
+				return code;
+		}
+		return GLFW_KEY_UNKNOWN;
+	}
+
+}
+
+std::array<uint8_t, 0x10> Input::mPressCounts = {};
+std::array<int8_t, GLFW_KEY_LAST + 1> Input::mKeyTable = makeDefaultKeyTable();
+std::array<int8_t, GLFW_KEY_LAST + 1> Input::mHeldKeys = makeEmptyKeyTable();
 Input::KeyCallbackFunction Input::mKeyDownCallback = nullptr;
 Input::KeyCallbackFunction Input::mKeyUpCallback = nullptr;
 
 bool Input::isKeyPressed(uint8_t key) noexcept {
-	return mPressedKeys[key];
+	return mPressCounts[key] > 0;
 }
 
 void Input::setKeyDownCallback(KeyCallbackFunction function) noexcept {
@@ -20,33 +79,89 @@ void Input::setKeyUpCallback(KeyCallbackFunction function) noexcept {
 	mKeyUpCallback = function;
 }
 
-void Input::glfwKeyCallbackFunction(GLFWwindow* /*window*/, int key, int /*scancode*/, int action, int /*mods*/) {
-	const static std::unordered_map<uint8_t, int> keyMapping = {
-		{ gsl::narrow<uint8_t>(0x1), GLFW_KEY_1 },
-		{ gsl::narrow<uint8_t>(0x2), GLFW_KEY_2 },
-		{ gsl::narrow<uint8_t>(0x3), GLFW_KEY_3 },
-		{ gsl::narrow<uint8_t>(0xC), GLFW_KEY_4 },
-		{ gsl::narrow<uint8_t>(0x4), GLFW_KEY_Q },
-		{ gsl::narrow<uint8_t>(0x5), GLFW_KEY_W },
-		{ gsl::narrow<uint8_t>(0x6), GLFW_KEY_E },
-		{ gsl::narrow<uint8_t>(0xD), GLFW_KEY_R },
-		{ gsl::narrow<uint8_t>(0x7), GLFW_KEY_A },
-		{ gsl::narrow<uint8_t>(0x8), GLFW_KEY_S },
-		{ gsl::narrow<uint8_t>(0x9), GLFW_KEY_D },
-		{ gsl::narrow<uint8_t>(0xE), GLFW_KEY_F },
-		{ gsl::narrow<uint8_t>(0xA), GLFW_KEY_Z },
-		{ gsl::narrow<uint8_t>(0x0), GLFW_KEY_X },
-		{ gsl::narrow<uint8_t>(0xB), GLFW_KEY_C },
-		{ gsl::narrow<uint8_t>(0xF), GLFW_KEY_V },
-	};
-	for (const auto& [chip8key, glfwKeyCode] : keyMapping) {
-		if (key == glfwKeyCode) {
-			if (mPressedKeys[chip8key] && action == GLFW_RELEASE && mKeyUpCallback)
-				mKeyUpCallback(chip8key);
-			else if (!mPressedKeys[chip8key] && action == GLFW_PRESS && mKeyDownCallback)
-				mKeyDownCallback(chip8key);
-			mPressedKeys[chip8key] = (action == GLFW_PRESS || action == GLFW_REPEAT);
-			break;
+void Input::resetKeyMapping() noexcept {
+	mKeyTable = makeDefaultKeyTable();
+}
+
+bool Input::loadKeyMapping(const std::string& filename, std::string& error) {
+	std::ifstream file(filename);
+	if (!file.good()) {
+		error = "could not open " + filename;
+		return false;
+	}
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	const auto document = Chip8::parseJson(stream.str(), error);
+	if (!document)
+		return false;
+	if (!document->isObject()) {
+		error = "the key mapping has to be an object";
+		return false;
+	}
+
+	KeyTable table = mKeyTable;
+	for (const auto& [keyText, value] : document->asObject()) {
+		size_t length = 0;
+		int chip8Key = -1;
+		try {
+			chip8Key = std::stoi(keyText, &length, 16);
+		} catch (const std::logic_error&) {}
+		if (length != keyText.size() || chip8Key < 0x0 || chip8Key > 0xF) {
+			error = "unknown CHIP-8 key '" + keyText + "'";
+			return false;
+		}
+		const auto names = (value.isArray() ? value.asArray() : Chip8::JsonValue::Array{ value });
+		// the listed names replace all previous keys of the CHIP-8 key
+		for (auto& entry : table) {
+			if (entry == chip8Key)
+				entry = -1;
 		}
+		for (const auto& name : names) {
+			const int code = findKeyCode(name.asString());
+			if (code == GLFW_KEY_UNKNOWN) {
+				error = "unknown key '" + name.asString() + "' for CHIP-8 key " + keyText;
+				return false;
+			}
+			table[gsl::narrow_cast<size_t>(code)] = gsl::narrow_cast<int8_t>(chip8Key);
+		}
+	}
+	mKeyTable = table;
+	return true;
+}
+
+int Input::getMappedKey(int glfwKey) noexcept {
+	if (glfwKey < 0 || glfwKey > GLFW_KEY_LAST)
+		return -1;
+	return mKeyTable[gsl::narrow_cast<size_t>(glfwKey)];
+}
+
+void Input::injectKey(uint8_t key, bool pressed) {
+	const auto chip8key = gsl::narrow_cast<uint8_t>(key & 0xF);
+	auto& count = mPressCounts[chip8key];
+	if (pressed) {
+		if (count == std::numeric_limits<uint8_t>::max())
+			return;
+		if (count++ == 0 && mKeyDownCallback)
+			mKeyDownCallback(chip8key);
+	} else if (count > 0) {
+		if (--count == 0 && mKeyUpCallback)
+			mKeyUpCallback(chip8key);
+	}
+}
+
+void Input::glfwKeyCallbackFunction(GLFWwindow* /*window*/, int key, int /*scancode*/, int action, int /*mods*/) {
+	if (key < 0 || key > GLFW_KEY_LAST)
+		return;
+	// the held keys remember which CHIP-8 key they pressed, so repeats are not counted and a release
+	// matches its press even if the mapping changed in between
+	auto& heldKey = mHeldKeys[gsl::narrow_cast<size_t>(key)];
+	if (action == GLFW_RELEASE) {
+		if (heldKey >= 0)
+			injectKey(gsl::narrow_cast<uint8_t>(heldKey), false);
+		heldKey = -1;
+	} else if (heldKey < 0) {
+		heldKey = gsl::narrow_cast<int8_t>(getMappedKey(key));
+		if (heldKey >= 0)
+			injectKey(gsl::narrow_cast<uint8_t>(heldKey), true);
 	}
 }
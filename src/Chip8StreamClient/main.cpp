@@ -0,0 +1,123 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <Chip8Core/Chip8.hpp>
+#include <Chip8Core/StreamClient.hpp>
+
+namespace {
+
+	void printUsage() {
+		std::cout << "Usage: Chip8StreamClient [options] <port>\n"
+			"Connects to a stream server (Chip8Emulator --backend ... --stream <port>), decodes the frames\n"
+			"and reports bytes per frame and the end-to-end input latency once per second.\n\n"
+			"Options:\n"
+			"  --host <name>     host to connect to (default: 127.0.0.1)\n"
+			"  --seconds <n>     stop after n seconds (default: run until the server disconnects)\n"
+			"  --press <key>     press and release the key (hex) twice per second to measure input latency\n"
+			"  --display         print the display after every report\n";
+	}
+
+	void printDisplay(const Chip8::Chip8::PackedDisplay& display) {
+		for (size_t y = 0; y < Chip8::Chip8::DisplayHeight; ++y) {
+			for (size_t x = 0; x < Chip8::Chip8::DisplayWidth; ++x) {
+				const size_t index = y * Chip8::Chip8::DisplayWidth + x;
+				std::cout << ((display[index / 8] >> (7 - index % 8)) & 1 ? '#' : '.');
+			}
+			std::cout << "\n";
+		}
+	}
+
+}
+
+int main(int argc, char** argv) {
+	const std::vector<std::string> arguments(argv + 1, argv + argc);
+	std::string host = "127.0.0.1";
+	std::optional<uint16_t> port;
+	double seconds = 0.0;
+	std::optional<uint8_t> pressedKey;
+	bool showDisplay = false;
+	try {
+		for (size_t i = 0; i < arguments.size(); ++i) {
+			const auto& argument = arguments[i];
+			const auto nextArgument = [&]() -> const std::string& {
+				if (i + 1 >= arguments.size())
+					throw std::invalid_argument("missing value for " + argument);
+				return arguments[++i];
+			};
+			if (argument == "--help" || argument == "-h") {
+				printUsage();
+				return 0;
+			} else if (argument == "--host") {
+				host = nextArgument();
+			} else if (argument == "--seconds") {
+				seconds = std::stod(nextArgument());
+			} else if (argument == "--press") {
+				const auto key = std::stoul(nextArgument(), nullptr, 16);
+				if (key > 0xF)
+					throw std::invalid_argument("invalid key");
+				pressedKey = static_cast<uint8_t>(key);
+			} else if (argument == "--display") {
+				showDisplay = true;
+			} else if (!port && argument.front() != '-') {
+				port = static_cast<uint16_t>(std::stoul(argument));
+			} else {
+				throw std::invalid_argument("unknown option " + argument);
+			}
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		printUsage();
+		return 1;
+	}
+	if (!port) {
+		printUsage();
+		return 1;
+	}
+
+	try {
+		Chip8::StreamClient client(host, port.value());
+		using Clock = std::chrono::steady_clock;
+		const auto startTime = Clock::now();
+		auto nextReport = startTime + std::chrono::seconds(1);
+		auto nextKeyEvent = startTime;
+		bool keyDown = false;
+		uint64_t reportedFrames = 0;
+		uint64_t reportedBytes = 0;
+		std::cout << std::fixed << std::setprecision(2);
+		while (client.isConnected() && (seconds <= 0.0 || Clock::now() - startTime < std::chrono::duration<double>(seconds))) {
+			client.receiveFrame(0.1);
+			const auto time = Clock::now();
+			if (pressedKey && time >= nextKeyEvent) {
+				keyDown = !keyDown;
+				client.sendKey(pressedKey.value(), keyDown);
+				nextKeyEvent = time + std::chrono::milliseconds(250);
+			}
+			if (time < nextReport)
+				continue;
+			nextReport += std::chrono::seconds(1);
+			const auto& statistics = client.getStatistics();
+			const auto& latency = client.getInputLatency();
+			const uint64_t frames = statistics.frames - reportedFrames;
+			std::cout << frames << " frames, "
+				<< (frames > 0 ? static_cast<double>(statistics.bytesReceived - reportedBytes) / static_cast<double>(frames) : 0.0) << " bytes/frame, "
+				<< statistics.keyframes << " keyframes total";
+			if (latency.samples > 0)
+				std::cout << ", input latency " << latency.last * 1e3 << " ms (mean " << latency.mean * 1e3 << ", max " << latency.maximum * 1e3 << ")";
+			std::cout << "\n";
+			reportedFrames = statistics.frames;
+			reportedBytes = statistics.bytesReceived;
+			if (showDisplay)
+				printDisplay(client.getDecoder().getDisplay());
+		}
+		if (!client.isConnected())
+			std::cout << "The server has closed the connection\n";
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
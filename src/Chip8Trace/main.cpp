@@ -0,0 +1,251 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <Chip8Core/Disassembler.hpp>
+#include <Chip8Core/InstructionTrace.hpp>
+#include <Chip8Core/Opcodes.hpp>
+#include <Chip8Core/Profiler.hpp>
+
+namespace {
+
+	constexpr size_t DiffContext = 8;
+
+	void printUsage() {
+		std::cout << "Usage: Chip8Trace <command> [options] <trace>...\n"
+			"Decodes instruction traces (Chip8Emulator --trace <file>, Chip8Batch --trace-dir <dir>).\n\n"
+			"Commands:\n"
+			"  dump <trace>         print the records, one per line\n"
+			"  stats <trace>        print the number of records, the compression and the most frequent\n"
+			"                       opcodes and addresses\n"
+			"  diff <trace> <trace> print the first record the traces differ in and the records before it;\n"
+			"                       exits with 1 if the traces differ\n\n"
+			"Options (dump):\n"
+			"  --from <cycle>       skip records before the cycle\n"
+			"  --to <cycle>         stop after the cycle\n"
+			"  --pc <addr>[-<addr>] only print instructions at the address or in the range (hex)\n"
+			"  --opcode <name>      only print instructions of an opcode (e.g. DXYN)\n"
+			"  --limit <n>          print at most n records\n";
+	}
+
+	struct Filter {
+		uint64_t fromCycle = 0;
+		uint64_t toCycle = std::numeric_limits<uint64_t>::max();
+		uint16_t fromAddress = 0x0000;
+		uint16_t toAddress = 0xFFFF;
+		std::string opcode;
+		uint64_t limit = std::numeric_limits<uint64_t>::max();
+	};
+
+	bool matches(const Filter& filter, const Chip8::TraceRecord& record) {
+		return record.cycle >= filter.fromCycle && record.cycle <= filter.toCycle
+			&& record.address >= filter.fromAddress && record.address <= filter.toAddress
+			&& (filter.opcode.empty() || filter.opcode == Chip8::Profiler::getOpcodeName(Chip8::getOpcodeIndex(record.instruction)));
+	}
+
+	void printRecord(std::ostream& output, const Chip8::TraceRecord& record, const char* prefix = "") {
+		const auto flags = output.flags();
+		output << prefix << std::dec << std::setw(10) << std::setfill(' ') << record.cycle << "  "
+			<< std::hex << std::uppercase << std::setfill('0')
+			<< std::setw(3) << record.address << "  " << std::setw(4) << record.instruction << "  "
+			<< std::left << std::setw(18) << std::setfill(' ') << Chip8::disassemble(record.instruction) << std::right
+			<< " I=" << std::setw(3) << std::setfill('0') << record.addressRegister;
+		if (record.changedRegister != Chip8::TraceRecord::NoRegister)
+			output << "  V" << static_cast<int>(record.changedRegister) << "=" << std::setw(2) << static_cast<int>(record.value);
+		output << "\n";
+		output.flags(flags);
+	}
+
+	bool open(Chip8::TraceReader& reader, const std::string& filename) {
+		if (reader.open(filename))
+			return true;
+		std::cerr << "Could not open " << filename << " (missing or not a trace file)\n";
+		return false;
+	}
+
+	bool reportError(const Chip8::TraceReader& reader, const std::string& filename) {
+		if (reader.hasError())
+			std::cerr << "Warning: " << filename << " is truncated or malformed, only the records before the error have been read\n";
+		return reader.hasError();
+	}
+
+	int dump(const std::string& filename, const Filter& filter) {
+		Chip8::TraceReader reader;
+		if (!open(reader, filename))
+			return 1;
+		Chip8::TraceRecord record;
+		uint64_t printed = 0;
+		while (printed < filter.limit && reader.next(record)) {
+			if (record.cycle > filter.toCycle)
+				break;
+			if (matches(filter, record)) {
+				printRecord(std::cout, record);
+				++printed;
+			}
+		}
+		return (reportError(reader, filename) ? 1 : 0);
+	}
+
+	int stats(const std::string& filename) {
+		Chip8::TraceReader reader;
+		if (!open(reader, filename))
+			return 1;
+		std::array<uint64_t, Chip8::Profiler::OpcodeCount> opcodeCounts{};
+		std::vector<uint64_t> addressCounts(0x10000);
+		uint64_t count = 0;
+		uint64_t firstCycle = 0;
+		uint64_t lastCycle = 0;
+		Chip8::TraceRecord record;
+		while (reader.next(record)) {
+			if (count++ == 0)
+				firstCycle = record.cycle;
+			lastCycle = record.cycle;
+			++opcodeCounts[Chip8::getOpcodeIndex(record.instruction)];
+			++addressCounts[record.address];
+		}
+		const bool error = reportError(reader, filename);
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		const auto size = static_cast<uint64_t>(file.tellg());
+		std::cout << "records:  " << count << "\n"
+			<< "cycles:   " << firstCycle << " to " << lastCycle << "\n"
+			<< "size:     " << size << " bytes (" << std::fixed << std::setprecision(2)
+			<< (count > 0 ? static_cast<double>(size) / static_cast<double>(count) : 0.0) << " per record, "
+			<< sizeof(Chip8::TraceRecord) << " uncompressed)\n";
+
+		std::vector<size_t> opcodes(opcodeCounts.size());
+		for (size_t i = 0; i < opcodes.size(); ++i)
+			opcodes[i] = i;
+		std::stable_sort(opcodes.begin(), opcodes.end(), [&](size_t lhs, size_t rhs) { return opcodeCounts[lhs] > opcodeCounts[rhs]; });
+		std::cout << "\nopcodes:\n";
+		for (const auto index : opcodes) {
+			if (opcodeCounts[index] == 0)
+				break;
+			std::cout << "  " << std::left << std::setw(8) << Chip8::Profiler::getOpcodeName(index) << std::right
+				<< std::setw(12) << opcodeCounts[index] << std::setw(8) << std::setprecision(2)
+				<< 100.0 * static_cast<double>(opcodeCounts[index]) / static_cast<double>(count) << " %\n";
+		}
+
+		std::vector<size_t> addresses(addressCounts.size());
+		for (size_t i = 0; i < addresses.size(); ++i)
+			addresses[i] = i;
+		const size_t hotCount = std::min<size_t>(10, addresses.size());
+		std::partial_sort(addresses.begin(), addresses.begin() + static_cast<std::ptrdiff_t>(hotCount), addresses.end(),
+			[&](size_t lhs, size_t rhs) { return (addressCounts[lhs] != addressCounts[rhs] ? addressCounts[lhs] > addressCounts[rhs] : lhs < rhs); });
+		std::cout << "\nhottest addresses:\n";
+		for (size_t i = 0; i < hotCount && addressCounts[addresses[i]] > 0; ++i) {
+			std::cout << "  " << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << addresses[i]
+				<< std::dec << std::setfill(' ') << std::setw(12) << addressCounts[addresses[i]] << "\n";
+		}
+		return (error ? 1 : 0);
+	}
+
+	int diff(const std::string& firstFilename, const std::string& secondFilename) {
+		Chip8::TraceReader first;
+		Chip8::TraceReader second;
+		if (!open(first, firstFilename) || !open(second, secondFilename))
+			return 2;
+		std::deque<Chip8::TraceRecord> context;
+		uint64_t index = 0;
+		Chip8::TraceRecord firstRecord;
+		Chip8::TraceRecord secondRecord;
+		while (true) {
+			const bool hasFirst = first.next(firstRecord);
+			const bool hasSecond = second.next(secondRecord);
+			if (reportError(first, firstFilename) || reportError(second, secondFilename))
+				return 2;
+			if (!hasFirst && !hasSecond) {
+				std::cout << "The traces are identical (" << index << " records).\n";
+				return 0;
+			}
+			if (hasFirst != hasSecond || firstRecord != secondRecord) {
+				std::cout << "The traces differ at record " << index << ":\n";
+				for (const auto& record : context)
+					printRecord(std::cout, record, "  ");
+				if (hasFirst)
+					printRecord(std::cout, firstRecord, "< ");
+				else
+					std::cout << "< (end of " << firstFilename << ")\n";
+				if (hasSecond)
+					printRecord(std::cout, secondRecord, "> ");
+				else
+					std::cout << "> (end of " << secondFilename << ")\n";
+				return 1;
+			}
+			context.push_back(firstRecord);
+			if (context.size() > DiffContext)
+				context.pop_front();
+			++index;
+		}
+	}
+
+	uint16_t parseAddress(const std::string& text) {
+		const auto value = std::stoul(text, nullptr, 16);
+		if (value > 0xFFFF)
+			throw std::invalid_argument("invalid address " + text);
+		return static_cast<uint16_t>(value);
+	}
+
+}
+
+int main(int argc, char** argv) {
+	const std::vector<std::string> arguments(argv + 1, argv + argc);
+	std::string command;
+	std::vector<std::string> filenames;
+	Filter filter;
+	try {
+		for (size_t i = 0; i < arguments.size(); ++i) {
+			const auto& argument = arguments[i];
+			const auto nextArgument = [&]() -> const std::string& {
+				if (i + 1 >= arguments.size())
+					throw std::invalid_argument("missing value for " + argument);
+				return arguments[++i];
+			};
+			if (argument == "--help" || argument == "-h") {
+				printUsage();
+				return 0;
+			} else if (argument == "--from") {
+				filter.fromCycle = std::stoull(nextArgument());
+			} else if (argument == "--to") {
+				filter.toCycle = std::stoull(nextArgument());
+			} else if (argument == "--pc") {
+				const auto& range = nextArgument();
+				const auto separator = range.find('-');
+				filter.fromAddress = parseAddress(range.substr(0, separator));
+				filter.toAddress = (separator == std::string::npos ? filter.fromAddress : parseAddress(range.substr(separator + 1)));
+			} else if (argument == "--opcode") {
+				filter.opcode = nextArgument();
+				std::transform(filter.opcode.begin(), filter.opcode.end(), filter.opcode.begin(),
+					[](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+			} else if (argument == "--limit") {
+				filter.limit = std::stoull(nextArgument());
+			} else if (!argument.empty() && argument.front() == '-') {
+				throw std::invalid_argument("unknown option " + argument);
+			} else if (command.empty()) {
+				command = argument;
+			} else {
+				filenames.push_back(argument);
+			}
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		printUsage();
+		return 2;
+	}
+
+	if (command == "dump" && filenames.size() == 1)
+		return dump(filenames[0], filter);
+	if (command == "stats" && filenames.size() == 1)
+		return stats(filenames[0]);
+	if (command == "diff" && filenames.size() == 2)
+		return diff(filenames[0], filenames[1]);
+	printUsage();
+	return 2;
+}
@@ -0,0 +1,363 @@
+// Runs the ROM regression suite: every case runs a ROM headless with scripted inputs and compares
+// hashes of the display and the machine state at checkpoints against golden values, as well as
+// single values derived by hand from the listings of the ROMs. Built with
+// CHIP8_REGRESSION_AOT, the ROMs run as translations of Chip8Aot that are linked into the executable.
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef CHIP8_REGRESSION_AOT
+#include <Chip8Core/AotRuntime.hpp>
+#endif
+#include <Chip8Core/BatchRunner.hpp>
+#include <Chip8Core/Chip8.hpp>
+#include <Chip8Core/Hash.hpp>
+#include <Chip8Core/ThreadPool.hpp>
+
+namespace {
+
+	struct KeyEvent {
+		uint64_t frame;
+		bool down;
+		uint8_t key;
+	};
+
+	struct Checkpoint {
+		uint64_t frame;
+		uint64_t displayHash;
+		uint64_t stateHash;
+		size_t line; ///< index of the line in the golden file (rewritten by --update)
+	};
+
+	enum class LocationType {
+		Register,
+		AddressPointer,
+		Memory
+	};
+
+	/** @brief A value derived by hand from the listing of a ROM, compared after the given number of frames. */
+	struct Expectation {
+		uint64_t frame;
+		std::string location; ///< V0 to VF, I or M<address>
+		LocationType type;
+		uint16_t index; ///< register number or memory address
+		uint16_t value;
+	};
+
+	struct RegressionCase {
+		std::string name;
+		std::string romPath;
+		Chip8::CompatibilityMode compatibilityMode = Chip8::CompatibilityMode::SuperChip;
+		uint64_t cyclesPerFrame = 10;
+		std::vector<KeyEvent> keyEvents;
+		std::vector<Checkpoint> checkpoints;
+		std::vector<Expectation> expectations;
+	};
+
+	struct CaseResult {
+		bool passed = true;
+		std::vector<Checkpoint> actual;
+		std::string message;
+	};
+
+	void printUsage() {
+		std::cout << "Usage: RegressionTests <golden file> [options]\n"
+			"Runs the ROM regression suite and compares the results against the golden values.\n\n"
+			"Options:\n"
+			"  --case <name>    only run the given case (can be repeated)\n"
+			"  --threads <n>    number of worker threads (default: all cores)\n"
+			"  --update         write the actual hashes back into the golden file\n";
+	}
+
+	std::string formatHash(uint64_t hash) {
+		std::ostringstream result;
+		result << std::hex << std::setw(16) << std::setfill('0') << hash;
+		return result.str();
+	}
+
+	std::string getDirectory(const std::string& path) {
+		const auto separator = path.find_last_of("/\\");
+		return (separator == std::string::npos ? std::string() : path.substr(0, separator + 1));
+	}
+
+	bool parseLocation(const std::string& location, Expectation& expectation) {
+		unsigned index = 0;
+		std::istringstream stream(location.size() > 1 ? location.substr(1) : std::string());
+		if (location == "I") {
+			expectation.type = LocationType::AddressPointer;
+		} else if (location.front() == 'V' && location.size() == 2 && stream >> std::hex >> index && index <= 0xF) {
+			expectation.type = LocationType::Register;
+		} else if (location.front() == 'M' && stream >> std::hex >> index && stream.eof() && index <= 0xFFF) {
+			expectation.type = LocationType::Memory;
+		} else {
+			return false;
+		}
+		expectation.location = location;
+		expectation.index = static_cast<uint16_t>(index);
+		return true;
+	}
+
+	uint16_t readLocation(const Chip8::Chip8& chip8, const Expectation& expectation) {
+		switch (expectation.type) {
+		case LocationType::Register:
+			return chip8.getRegister(static_cast<uint8_t>(expectation.index));
+		case LocationType::AddressPointer:
+			return chip8.getAddressPointer();
+		case LocationType::Memory:
+			return chip8.getMemory().read(expectation.index);
+		}
+		return 0;
+	}
+
+	std::string formatValue(uint16_t value) {
+		std::ostringstream result;
+		result << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << value;
+		return result.str();
+	}
+
+	// the format is described in roms/README.md
+	bool parseGoldenFile(const std::vector<std::string>& lines, const std::string& romDirectory,
+		std::vector<RegressionCase>& cases, std::string& error) {
+		for (size_t i = 0; i < lines.size(); ++i) {
+			std::istringstream line(lines[i]);
+			std::string command;
+			if (!(line >> command) || command.front() == '#')
+				continue;
+			const auto fail = [&](const std::string& message) {
+				error = "line " + std::to_string(i + 1) + ": " + message;
+				return false;
+			};
+			if (command == "case") {
+				RegressionCase regressionCase;
+				std::string rom, profile;
+				if (!(line >> regressionCase.name >> rom >> profile))
+					return fail("expected: case <name> <rom> <profile> [cycles-per-frame]");
+				const auto compatibilityMode = Chip8::parseCompatibilityMode(profile);
+				if (!compatibilityMode)
+					return fail("unknown profile '" + profile + "'");
+				regressionCase.romPath = romDirectory + rom;
+				regressionCase.compatibilityMode = compatibilityMode.value();
+				if (line >> regressionCase.cyclesPerFrame && regressionCase.cyclesPerFrame == 0)
+					return fail("cycles per frame must not be 0");
+				cases.push_back(std::move(regressionCase));
+				continue;
+			}
+			if (cases.empty())
+				return fail("'" + command + "' outside of a case");
+			auto& regressionCase = cases.back();
+			if (command == "key") {
+				KeyEvent event;
+				std::string direction;
+				unsigned key;
+				if (!(line >> event.frame >> direction >> std::hex >> key) || key > 0xF || (direction != "down" && direction != "up"))
+					return fail("expected: key <frame> down|up <key>");
+				event.down = (direction == "down");
+				event.key = static_cast<uint8_t>(key);
+				regressionCase.keyEvents.push_back(event);
+			} else if (command == "check") {
+				Checkpoint checkpoint{ 0, 0, 0, i };
+				if (!(line >> checkpoint.frame))
+					return fail("expected: check <frame> [<display hash> <state hash>]");
+				line >> std::hex >> checkpoint.displayHash >> checkpoint.stateHash; // missing until --update
+				if (!regressionCase.checkpoints.empty() && checkpoint.frame <= regressionCase.checkpoints.back().frame)
+					return fail("checkpoints must be in ascending order");
+				regressionCase.checkpoints.push_back(checkpoint);
+			} else if (command == "expect") {
+				Expectation expectation;
+				std::string location;
+				unsigned value;
+				if (!(line >> expectation.frame >> location >> std::hex >> value) || !parseLocation(location, expectation) || value > 0xFFFF)
+					return fail("expected: expect <frame> V0-VF|I|M<address> <value>");
+				expectation.value = static_cast<uint16_t>(value);
+				regressionCase.expectations.push_back(expectation);
+			} else {
+				return fail("unknown command '" + command + "'");
+			}
+		}
+		return true;
+	}
+
+	CaseResult runCase(const RegressionCase& regressionCase) {
+		CaseResult result;
+		Chip8::Chip8 chip8;
+		chip8.setLoggingEnabled(false);
+		if (!chip8.loadROM(regressionCase.romPath)) {
+			result.passed = false;
+			result.message = "could not load " + regressionCase.romPath;
+			return result;
+		}
+		chip8.setCompatibilityMode(regressionCase.compatibilityMode);
+#ifdef CHIP8_REGRESSION_AOT
+		const auto program = Chip8::AotRuntime::findProgram(chip8);
+		if (!program) {
+			result.passed = false;
+			result.message = regressionCase.romPath + " has not been translated";
+			return result;
+		}
+		Chip8::AotRuntime runtime(*program);
+#endif
+
+		uint64_t lastFrame = (regressionCase.checkpoints.empty() ? 0 : regressionCase.checkpoints.back().frame);
+		for (const auto& expectation : regressionCase.expectations)
+			lastFrame = std::max(lastFrame, expectation.frame);
+		bool halted = false;
+		auto nextEvent = regressionCase.keyEvents.begin();
+		auto nextCheckpoint = regressionCase.checkpoints.begin();
+		const auto fail = [&result](uint64_t frame, const std::string& message) {
+			if (result.passed)
+				result.message = "frame " + std::to_string(frame) + ": " + message;
+			result.passed = false;
+		};
+		try {
+			for (uint64_t frame = 0;; ++frame) {
+				if (nextCheckpoint != regressionCase.checkpoints.end() && nextCheckpoint->frame == frame) {
+					Chip8::Chip8::State state;
+					chip8.saveState(state);
+					const auto& display = chip8.getPackedDisplay();
+					result.actual.push_back({ frame, Chip8::fnv1a64(display.data(), display.size()),
+						Chip8::fnv1a64(state.data(), state.size()), nextCheckpoint->line });
+					if (result.actual.back().displayHash != nextCheckpoint->displayHash || result.actual.back().stateHash != nextCheckpoint->stateHash)
+						fail(frame, "expected " + formatHash(nextCheckpoint->displayHash) + " " + formatHash(nextCheckpoint->stateHash) + ", got "
+							+ formatHash(result.actual.back().displayHash) + " " + formatHash(result.actual.back().stateHash));
+					++nextCheckpoint;
+				}
+				for (const auto& expectation : regressionCase.expectations) {
+					if (expectation.frame != frame)
+						continue;
+					const auto value = readLocation(chip8, expectation);
+					if (value != expectation.value)
+						fail(frame, "expected " + expectation.location + " = " + formatValue(expectation.value) + ", got " + formatValue(value));
+				}
+				if (frame == lastFrame)
+					break;
+				for (; nextEvent != regressionCase.keyEvents.end() && nextEvent->frame <= frame; ++nextEvent) {
+					if (nextEvent->down)
+						chip8.triggerKeyDown(nextEvent->key);
+					else
+						chip8.triggerKeyUp(nextEvent->key);
+				}
+#ifdef CHIP8_REGRESSION_AOT
+				if (!halted)
+					halted = !runtime.run(chip8, regressionCase.cyclesPerFrame);
+#else
+				for (uint64_t cycle = 0; cycle < regressionCase.cyclesPerFrame && !halted; ++cycle)
+					halted = !chip8.step();
+#endif
+				chip8.clockTimers();
+			}
+		} catch (const std::exception& e) {
+			result.passed = false;
+			result.message = std::string("crashed: ") + e.what();
+		}
+		return result;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	const std::vector<std::string> arguments(argv + 1, argv + argc);
+	std::string goldenPath;
+	std::vector<std::string> selectedCases;
+	size_t threadCount = 0;
+	bool update = false;
+	try {
+		for (size_t i = 0; i < arguments.size(); ++i) {
+			const auto& argument = arguments[i];
+			const bool hasValue = (i + 1 < arguments.size());
+			if (argument == "--case" && hasValue) {
+				selectedCases.push_back(arguments[++i]);
+			} else if (argument == "--threads" && hasValue) {
+				threadCount = std::stoul(arguments[++i]);
+			} else if (argument == "--update") {
+				update = true;
+			} else if (argument == "--help" || argument == "-h") {
+				printUsage();
+				return 0;
+			} else if (goldenPath.empty() && argument.front() != '-') {
+				goldenPath = argument;
+			} else {
+				std::cerr << "Invalid argument: " << argument << "\n";
+				printUsage();
+				return 1;
+			}
+		}
+	} catch (const std::exception&) {
+		std::cerr << "Invalid number\n";
+		return 1;
+	}
+	if (goldenPath.empty()) {
+		printUsage();
+		return 1;
+	}
+
+	std::vector<std::string> lines;
+	{
+		std::ifstream file(goldenPath);
+		if (!file.good()) {
+			std::cerr << "Could not open " << goldenPath << "\n";
+			return 1;
+		}
+		for (std::string line; std::getline(file, line);)
+			lines.push_back(line);
+	}
+	std::vector<RegressionCase> cases;
+	std::string error;
+	if (!parseGoldenFile(lines, getDirectory(goldenPath), cases, error)) {
+		std::cerr << goldenPath << ": " << error << "\n";
+		return 1;
+	}
+	if (!selectedCases.empty()) {
+		for (const auto& name : selectedCases) {
+			if (std::none_of(cases.begin(), cases.end(), [&name](const RegressionCase& c) { return c.name == name; })) {
+				std::cerr << "Unknown case " << name << "\n";
+				return 1;
+			}
+		}
+		cases.erase(std::remove_if(cases.begin(), cases.end(), [&selectedCases](const RegressionCase& c) {
+			return std::find(selectedCases.begin(), selectedCases.end(), c.name) == selectedCases.end();
+		}), cases.end());
+	}
+
+	std::vector<CaseResult> results(cases.size());
+	{
+		Chip8::ThreadPool threadPool(threadCount);
+		threadPool.parallelFor(cases.size(), [&cases, &results](size_t index) {
+			results[index] = runCase(cases[index]);
+		});
+	}
+
+	size_t failures = 0;
+	for (size_t i = 0; i < cases.size(); ++i) {
+		if (results[i].passed) {
+			std::cout << "[  OK  ] " << cases[i].name << " (" << cases[i].checkpoints.size() << " checkpoints, "
+				<< cases[i].expectations.size() << " expectations)\n";
+		} else {
+			++failures;
+			std::cout << "[ FAIL ] " << cases[i].name << ": " << results[i].message << "\n";
+		}
+	}
+
+	if (update) {
+		for (const auto& result : results) {
+			for (const auto& checkpoint : result.actual)
+				lines[checkpoint.line] = "check " + std::to_string(checkpoint.frame) + " "
+					+ formatHash(checkpoint.displayHash) + " " + formatHash(checkpoint.stateHash);
+		}
+		std::ofstream file(goldenPath);
+		for (const auto& line : lines)
+			file << line << "\n";
+		if (!file.good()) {
+			std::cerr << "Could not write " << goldenPath << "\n";
+			return 1;
+		}
+		std::cout << "Updated " << goldenPath << "\n";
+		return 0;
+	}
+
+	std::cout << (cases.size() - failures) << " of " << cases.size() << " cases passed\n";
+	return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,127 @@
+; alu.ch8: results of the logic and arithmetic instructions and of the skip instructions.
+; Hand-written for the regression suite and assembled by hand; the opcode column is the
+; content of the .ch8 file. Results are printed as two hexadecimal digits each, five per row.
+; The print routine uses V0 to V4; the ROM halts with a jump to itself.
+; Expected state after halting: V0 = AA, V5 = V6 = 3C, V7 = 01, V9 = 04, 2D4..2D6 = 02 05 04.
+;
+; address  opcode  instruction         comment
+
+start:
+  200      00E0    CLS                 ; V1, V2: cursor of print
+  202      6100    LD V1, 0x00
+  204      6200    LD V2, 0x00
+  206      655A    LD V5, 0x5A         ; 8XY1: 5A | 0F = 5F
+  208      660F    LD V6, 0x0F
+  20A      8561    OR V5, V6
+  20C      87F0    LD V7, VF
+  20E      8050    LD V0, V5
+  210      22AC    CALL 0x2AC
+  212      655A    LD V5, 0x5A         ; 8XY2: 5A & 0F = 0A
+  214      660F    LD V6, 0x0F
+  216      8562    AND V5, V6
+  218      87F0    LD V7, VF
+  21A      8050    LD V0, V5
+  21C      22AC    CALL 0x2AC
+  21E      655A    LD V5, 0x5A         ; 8XY3: 5A ^ FF = A5
+  220      66FF    LD V6, 0xFF
+  222      8563    XOR V5, V6
+  224      87F0    LD V7, VF
+  226      8050    LD V0, V5
+  228      22AC    CALL 0x2AC
+  22A      6512    LD V5, 0x12         ; 8XY4: 12 + 34 = 46, VF = 00
+  22C      6634    LD V6, 0x34
+  22E      8564    ADD V5, V6
+  230      87F0    LD V7, VF
+  232      8050    LD V0, V5
+  234      22AC    CALL 0x2AC
+  236      8070    LD V0, V7
+  238      22AC    CALL 0x2AC
+  23A      6534    LD V5, 0x34         ; 8XY5: 34 - 12 = 22, VF = 01
+  23C      6612    LD V6, 0x12
+  23E      8565    SUB V5, V6
+  240      87F0    LD V7, VF
+  242      8050    LD V0, V5
+  244      22AC    CALL 0x2AC
+  246      8070    LD V0, V7
+  248      22AC    CALL 0x2AC
+  24A      6512    LD V5, 0x12         ; 8XY7: 34 - 12 = 22, VF = 01
+  24C      6634    LD V6, 0x34
+  24E      8567    SUBN V5, V6
+  250      87F0    LD V7, VF
+  252      8050    LD V0, V5
+  254      22AC    CALL 0x2AC
+  256      8070    LD V0, V7
+  258      22AC    CALL 0x2AC
+  25A      65F0    LD V5, 0xF0         ; 7XNN: F0 + 20 = 10, VF unchanged
+  25C      7520    ADD V5, 0x20
+  25E      8050    LD V0, V5
+  260      22AC    CALL 0x2AC
+  262      6581    LD V5, 0x81         ; 8XY6 with X = Y: 81 >> 1 = 40, VF = 01
+  264      8556    SHR V5, V5
+  266      87F0    LD V7, VF
+  268      8050    LD V0, V5
+  26A      22AC    CALL 0x2AC
+  26C      8070    LD V0, V7
+  26E      22AC    CALL 0x2AC
+  270      6581    LD V5, 0x81         ; 8XYE with X = Y: 81 << 1 = 02, VF = 01
+  272      855E    SHL V5, V5
+  274      87F0    LD V7, VF
+  276      8050    LD V0, V5
+  278      22AC    CALL 0x2AC
+  27A      8070    LD V0, V7
+  27C      22AC    CALL 0x2AC
+  27E      65FE    LD V5, 0xFE         ; FX33: 254 -> 02 05 04 at 2D4
+  280      A2D4    LD I, 0x2D4
+  282      F533    LD B, V5
+  284      F265    LD V2, [I]          ; V0, V1, V2 = 02, 05, 04
+  286      8010    LD V0, V1           ; prints 05 (tens) and 04 (ones), V1 and V2 are the cursor again
+  288      8920    LD V9, V2
+  28A      6100    LD V1, 0x00
+  28C      6218    LD V2, 0x18
+  28E      22AC    CALL 0x2AC
+  290      8090    LD V0, V9
+  292      22AC    CALL 0x2AC
+  294      653C    LD V5, 0x3C         ; 5XY0 skips, 4XNN skips: prints AA, any other path prints EE
+  296      663C    LD V6, 0x3C
+  298      5560    SE V5, V6
+  29A      12A6    JP 0x2A6
+  29C      453D    SNE V5, 0x3D
+  29E      12A6    JP 0x2A6
+  2A0      60AA    LD V0, 0xAA
+  2A2      22AC    CALL 0x2AC
+
+halt:
+  2A4      12A4    JP 0x2A4
+
+failed:
+  2A6      60EE    LD V0, 0xEE
+  2A8      22AC    CALL 0x2AC
+  2AA      12A4    JP 0x2A4
+
+print:
+  2AC      8300    LD V3, V0           ; prints V0 as two hexadecimal digits at (V1, V2)
+  2AE      8336    SHR V3, V3          ; high nibble
+  2B0      8336    SHR V3, V3
+  2B2      8336    SHR V3, V3
+  2B4      8336    SHR V3, V3
+  2B6      F329    LD F, V3            ; I = font sprite of the digit
+  2B8      D125    DRW V1, V2, 5       ; changes VF
+  2BA      7105    ADD V1, 0x05
+  2BC      8300    LD V3, V0           ; low nibble
+  2BE      640F    LD V4, 0x0F
+  2C0      8342    AND V3, V4
+  2C2      F329    LD F, V3
+  2C4      D125    DRW V1, V2, 5
+  2C6      7107    ADD V1, 0x07        ; next column, five results per row
+  2C8      413C    SNE V1, 0x3C
+  2CA      12CE    JP 0x2CE
+  2CC      00EE    RET
+
+print_newline:
+  2CE      6100    LD V1, 0x00
+  2D0      7206    ADD V2, 0x06        ; next row
+  2D2      00EE    RET
+
+bcd:
+  2D4      0000    DB 0x00, 0x00       ; FX33 result
+  2D6      0000    DB 0x00, 0x00
@@ -0,0 +1,117 @@
+; flags.ch8: VF after carries and borrows at the edges of the value range.
+; Hand-written for the regression suite and assembled by hand; the opcode column is the
+; content of the .ch8 file. Results are printed as two hexadecimal digits each, five per row.
+; The print routine uses V0 to V4; the ROM halts with a jump to itself.
+; Expected state after halting: V5 = 01, V6 = 90, V7 = 01; V0 = 01 by the description of 8XY4,
+; but the emulator gives 91 (see golden.txt).
+;
+; address  opcode  instruction         comment
+
+start:
+  200      00E0    CLS                 ; V1, V2: cursor of print
+  202      6100    LD V1, 0x00
+  204      6200    LD V2, 0x00
+  206      65FF    LD V5, 0xFF         ; 8XY4: FF + 01 = 00, VF = 01
+  208      6601    LD V6, 0x01
+  20A      8564    ADD V5, V6
+  20C      87F0    LD V7, VF
+  20E      8050    LD V0, V5
+  210      22A2    CALL 0x2A2
+  212      8070    LD V0, V7
+  214      22A2    CALL 0x2A2
+  216      6580    LD V5, 0x80         ; 8XY4: 80 + 80 = 00, VF = 01
+  218      6680    LD V6, 0x80
+  21A      8564    ADD V5, V6
+  21C      87F0    LD V7, VF
+  21E      8050    LD V0, V5
+  220      22A2    CALL 0x2A2
+  222      8070    LD V0, V7
+  224      22A2    CALL 0x2A2
+  226      657F    LD V5, 0x7F         ; 8XY4: 7F + 80 = FF, VF = 00
+  228      6680    LD V6, 0x80
+  22A      8564    ADD V5, V6
+  22C      87F0    LD V7, VF
+  22E      8050    LD V0, V5
+  230      22A2    CALL 0x2A2
+  232      8070    LD V0, V7
+  234      22A2    CALL 0x2A2
+  236      6510    LD V5, 0x10         ; 8XY5: 10 - 10 = 00, equal operands (see golden.txt)
+  238      6610    LD V6, 0x10
+  23A      8565    SUB V5, V6
+  23C      87F0    LD V7, VF
+  23E      8050    LD V0, V5
+  240      22A2    CALL 0x2A2
+  242      8070    LD V0, V7
+  244      22A2    CALL 0x2A2
+  246      6500    LD V5, 0x00         ; 8XY5: 00 - 01 = FF, VF = 00
+  248      6601    LD V6, 0x01
+  24A      8565    SUB V5, V6
+  24C      87F0    LD V7, VF
+  24E      8050    LD V0, V5
+  250      22A2    CALL 0x2A2
+  252      8070    LD V0, V7
+  254      22A2    CALL 0x2A2
+  256      65FF    LD V5, 0xFF         ; 8XY5: FF - FE = 01, VF = 01
+  258      66FE    LD V6, 0xFE
+  25A      8565    SUB V5, V6
+  25C      87F0    LD V7, VF
+  25E      8050    LD V0, V5
+  260      22A2    CALL 0x2A2
+  262      8070    LD V0, V7
+  264      22A2    CALL 0x2A2
+  266      6510    LD V5, 0x10         ; 8XY7: 10 - 10 = 00, equal operands (see golden.txt)
+  268      6610    LD V6, 0x10
+  26A      8567    SUBN V5, V6
+  26C      87F0    LD V7, VF
+  26E      8050    LD V0, V5
+  270      22A2    CALL 0x2A2
+  272      8070    LD V0, V7
+  274      22A2    CALL 0x2A2
+  276      6501    LD V5, 0x01         ; 8XY7: 00 - 01 = FF, VF = 00
+  278      6600    LD V6, 0x00
+  27A      8567    SUBN V5, V6
+  27C      87F0    LD V7, VF
+  27E      8050    LD V0, V5
+  280      22A2    CALL 0x2A2
+  282      8070    LD V0, V7
+  284      22A2    CALL 0x2A2
+  286      65FE    LD V5, 0xFE         ; 8XY7: FF - FE = 01, VF = 01
+  288      66FF    LD V6, 0xFF
+  28A      8567    SUBN V5, V6
+  28C      87F0    LD V7, VF
+  28E      8050    LD V0, V5
+  290      22A2    CALL 0x2A2
+  292      8070    LD V0, V7
+  294      22A2    CALL 0x2A2
+  296      6F90    LD VF, 0x90         ; 8XY4 with VF as VX: 90 + 90 = 20 and a carry, the flag is written last: VF = 01
+  298      6690    LD V6, 0x90
+  29A      8F64    ADD VF, V6
+  29C      80F0    LD V0, VF
+  29E      22A2    CALL 0x2A2
+
+halt:
+  2A0      12A0    JP 0x2A0
+
+print:
+  2A2      8300    LD V3, V0           ; prints V0 as two hexadecimal digits at (V1, V2)
+  2A4      8336    SHR V3, V3          ; high nibble
+  2A6      8336    SHR V3, V3
+  2A8      8336    SHR V3, V3
+  2AA      8336    SHR V3, V3
+  2AC      F329    LD F, V3            ; I = font sprite of the digit
+  2AE      D125    DRW V1, V2, 5       ; changes VF
+  2B0      7105    ADD V1, 0x05
+  2B2      8300    LD V3, V0           ; low nibble
+  2B4      640F    LD V4, 0x0F
+  2B6      8342    AND V3, V4
+  2B8      F329    LD F, V3
+  2BA      D125    DRW V1, V2, 5
+  2BC      7107    ADD V1, 0x07        ; next column, five results per row
+  2BE      413C    SNE V1, 0x3C
+  2C0      12C4    JP 0x2C4
+  2C2      00EE    RET
+
+print_newline:
+  2C4      6100    LD V1, 0x00
+  2C6      7206    ADD V2, 0x06        ; next row
+  2C8      00EE    RET
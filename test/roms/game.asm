@@ -0,0 +1,66 @@
+; game.ch8: a game-like loop with random obstacles and a ball synchronized to the delay timer.
+; Hand-written for the regression suite and assembled by hand; the opcode column is the
+; content of the .ch8 file. The obstacles depend on the random seed, so after the first frame
+; (12 cycles) only the setup is known: VA = 05 (one obstacle drawn), VD = 00, I = 25C.
+;
+; address  opcode  instruction         comment
+
+start:
+  200      00E0    CLS                 ; VD: collisions
+  202      6D00    LD VD, 0x00
+  204      6B01    LD VB, 0x01         ; VB, VC: direction of the ball
+  206      6C01    LD VC, 0x01
+  208      A25C    LD I, 0x25C         ; obstacle sprite
+  20A      6A06    LD VA, 0x06         ; VA: obstacles left to draw
+
+obstacles:
+  20C      C53F    RND V5, 0x3F        ; random position
+  20E      C61F    RND V6, 0x1F
+  210      D563    DRW V5, V6, 3
+  212      7AFF    ADD VA, 0xFF        ; VA -= 1
+  214      3A00    SE VA, 0x00
+  216      120C    JP 0x20C
+  218      670A    LD V7, 0x0A         ; V7, V8: position of the ball
+  21A      6805    LD V8, 0x05
+  21C      A25F    LD I, 0x25F
+  21E      D781    DRW V7, V8, 1
+
+frame:
+  220      6901    LD V9, 0x01         ; waits for one timer clock
+  222      F915    LD DT, V9
+  224      F907    LD V9, DT
+  226      3900    SE V9, 0x00
+  228      1224    JP 0x224
+  22A      A25F    LD I, 0x25F         ; erases and moves the ball
+  22C      D781    DRW V7, V8, 1
+  22E      87B4    ADD V7, VB
+  230      88C4    ADD V8, VC
+  232      3700    SE V7, 0x00         ; bounces off the edges of the screen
+  234      1238    JP 0x238
+  236      6B01    LD VB, 0x01
+  238      373F    SE V7, 0x3F
+  23A      123E    JP 0x23E
+  23C      6BFF    LD VB, 0xFF
+  23E      3800    SE V8, 0x00
+  240      1244    JP 0x244
+  242      6C01    LD VC, 0x01
+  244      381F    SE V8, 0x1F
+  246      124A    JP 0x24A
+  248      6CFF    LD VC, 0xFF
+  24A      D781    DRW V7, V8, 1       ; draws the ball, VF = 01 if it hit an obstacle
+  24C      3F01    SE VF, 0x01
+  24E      1220    JP 0x220
+  250      7D01    ADD VD, 0x01        ; counts the collision, beeps and stores VD as BCD at 260
+  252      6903    LD V9, 0x03
+  254      F918    LD ST, V9
+  256      A260    LD I, 0x260
+  258      FD33    LD B, VD
+  25A      1220    JP 0x220
+
+sprites:
+  25C      E0A0    DB 0xE0, 0xA0       ; obstacle: E0 A0 E0
+  25E      E080    DB 0xE0, 0x80       ; ball at 25F: 80
+
+score:
+  260      0000    DB 0x00, 0x00
+  262      00      DB 0x00
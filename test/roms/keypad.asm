@@ -0,0 +1,85 @@
+; keypad.ch8: FX0A reads four keys, then keys 2, 4, 6 and 8 move a block until key 0 is pressed.
+; Hand-written for the regression suite and assembled by hand; the opcode column is the
+; content of the .ch8 file. Results are printed as two hexadecimal digits each, five per row.
+; The print routine uses V0 to V4; the ROM halts with a jump to itself.
+; Key 0 is only seen after the two-clock wait, so it has to be held for more than two frames.
+; Expected state after the keys 1, A, 3, F and 0: VA = 0F, VB = 00, VC = 00.
+;
+; address  opcode  instruction         comment
+
+start:
+  200      00E0    CLS                 ; V1, V2: cursor of print
+  202      6100    LD V1, 0x00
+  204      6200    LD V2, 0x00
+  206      6B04    LD VB, 0x04         ; VB: keys left to read
+
+read_key:
+  208      F00A    LD V0, K            ; FX0A waits for a key
+  20A      8A00    LD VA, V0           ; VA = the key, printed
+  20C      2250    CALL 0x250
+
+wait_release:
+  20E      EA9E    SKP VA              ; waits until the key is released
+  210      1214    JP 0x214
+  212      120E    JP 0x20E
+  214      7BFF    ADD VB, 0xFF        ; VB -= 1
+  216      3B00    SE VB, 0x00
+  218      1208    JP 0x208
+  21A      651C    LD V5, 0x1C         ; V5, V6: position of the block
+  21C      6614    LD V6, 0x14
+  21E      A278    LD I, 0x278
+
+move:
+  220      D562    DRW V5, V6, 2       ; draws the block
+  222      6C02    LD VC, 0x02         ; waits two timer clocks
+  224      FC15    LD DT, VC
+  226      FC07    LD VC, DT
+  228      3C00    SE VC, 0x00
+  22A      1226    JP 0x226
+  22C      D562    DRW V5, V6, 2       ; erases the block
+  22E      6C04    LD VC, 0x04         ; key 4: left
+  230      ECA1    SKNP VC
+  232      75FF    ADD V5, 0xFF
+  234      6C06    LD VC, 0x06         ; key 6: right
+  236      ECA1    SKNP VC
+  238      7501    ADD V5, 0x01
+  23A      6C02    LD VC, 0x02         ; key 2: up
+  23C      ECA1    SKNP VC
+  23E      76FF    ADD V6, 0xFF
+  240      6C08    LD VC, 0x08         ; key 8: down
+  242      ECA1    SKNP VC
+  244      7601    ADD V6, 0x01
+  246      6C00    LD VC, 0x00         ; key 0: leaves the loop with VC = 00
+  248      EC9E    SKP VC
+  24A      1220    JP 0x220
+  24C      D562    DRW V5, V6, 2       ; draws the block for the last time
+
+halt:
+  24E      124E    JP 0x24E
+
+print:
+  250      8300    LD V3, V0           ; prints V0 as two hexadecimal digits at (V1, V2)
+  252      8336    SHR V3, V3          ; high nibble
+  254      8336    SHR V3, V3
+  256      8336    SHR V3, V3
+  258      8336    SHR V3, V3
+  25A      F329    LD F, V3            ; I = font sprite of the digit
+  25C      D125    DRW V1, V2, 5       ; changes VF
+  25E      7105    ADD V1, 0x05
+  260      8300    LD V3, V0           ; low nibble
+  262      640F    LD V4, 0x0F
+  264      8342    AND V3, V4
+  266      F329    LD F, V3
+  268      D125    DRW V1, V2, 5
+  26A      7107    ADD V1, 0x07        ; next column, five results per row
+  26C      413C    SNE V1, 0x3C
+  26E      1272    JP 0x272
+  270      00EE    RET
+
+print_newline:
+  272      6100    LD V1, 0x00
+  274      7206    ADD V2, 0x06        ; next row
+  276      00EE    RET
+
+block:
+  278      C0C0    DB 0xC0, 0xC0       ; 2x2 block
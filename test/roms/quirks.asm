@@ -0,0 +1,104 @@
+; quirks.ch8: the instructions that depend on the quirk profile, BNNN and sprite clipping.
+; Hand-written for the regression suite and assembled by hand; the opcode column is the
+; content of the .ch8 file. Results are printed as two hexadecimal digits each, five per row.
+; The print routine uses V0 to V4; the ROM halts with a jump to itself.
+; Expected state after halting: V0 = 01, V9 = 22, 29F = 11, 2A0 = 22, with the CHIP-8 profile
+; V7 = 01 and 2A1 = 11, with the SCHIP profile V7 = 00 and 2A1 = 00.
+;
+; address  opcode  instruction         comment
+
+start:
+  200      00E0    CLS                 ; V1, V2: cursor of print
+  202      6100    LD V1, 0x00
+  204      6200    LD V2, 0x00
+  206      6510    LD V5, 0x10         ; 8XY6: CHIP-8 shifts VY: 03 >> 1 = 01, VF = 01; SCHIP shifts VX: 10 >> 1 = 08, VF = 00
+  208      6603    LD V6, 0x03
+  20A      8566    SHR V5, V6
+  20C      87F0    LD V7, VF
+  20E      8050    LD V0, V5
+  210      2272    CALL 0x272
+  212      8070    LD V0, V7
+  214      2272    CALL 0x272
+  216      6510    LD V5, 0x10         ; 8XYE: CHIP-8 shifts VY: 81 << 1 = 02, VF = 01; SCHIP shifts VX: 10 << 1 = 20, VF = 00
+  218      6681    LD V6, 0x81
+  21A      856E    SHL V5, V6
+  21C      87F0    LD V7, VF
+  21E      8050    LD V0, V5
+  220      2272    CALL 0x272
+  222      8070    LD V0, V7
+  224      2272    CALL 0x272
+  226      8810    LD V8, V1           ; FX65 twice: CHIP-8 advances I to 29D, V0 = 04; SCHIP keeps I, V0 = 01
+  228      A29A    LD I, 0x29A
+  22A      F265    LD V2, [I]
+  22C      F065    LD V0, [I]
+  22E      8180    LD V1, V8
+  230      6200    LD V2, 0x00
+  232      2272    CALL 0x272
+  234      8810    LD V8, V1           ; FX55 twice: CHIP-8 writes 11 22 11 to 29F..2A1; SCHIP writes 11 22 to 29F, 2A0
+  236      6011    LD V0, 0x11
+  238      6122    LD V1, 0x22
+  23A      A29F    LD I, 0x29F
+  23C      F155    LD [I], V1
+  23E      F055    LD [I], V0
+  240      A29F    LD I, 0x29F         ; V0, V1 = 11, 22 in both modes
+  242      F165    LD V1, [I]
+  244      8910    LD V9, V1
+  246      8180    LD V1, V8
+  248      2272    CALL 0x272
+  24A      8090    LD V0, V9
+  24C      2272    CALL 0x272
+  24E      6004    LD V0, 0x04         ; BNNN jumps to 252 + V0, skipping both loads of V0: prints 04
+  250      B252    JP V0, 0x252
+  252      60B0    LD V0, 0xB0
+  254      60B4    LD V0, 0xB4
+  256      2272    CALL 0x272
+  258      A2A3    LD I, 0x2A3         ; 8x8 sprite at (60, 28) is clipped at the edges, VF = 00
+  25A      653C    LD V5, 0x3C
+  25C      661C    LD V6, 0x1C
+  25E      D568    DRW V5, V6, 8
+  260      80F0    LD V0, VF
+  262      2272    CALL 0x272
+  264      A2A3    LD I, 0x2A3         ; drawn again at (62, 30), overlapping the clipped part: VF = 01
+  266      653E    LD V5, 0x3E
+  268      661E    LD V6, 0x1E
+  26A      D568    DRW V5, V6, 8
+  26C      80F0    LD V0, VF
+  26E      2272    CALL 0x272
+
+halt:
+  270      1270    JP 0x270
+
+print:
+  272      8300    LD V3, V0           ; prints V0 as two hexadecimal digits at (V1, V2)
+  274      8336    SHR V3, V3          ; high nibble
+  276      8336    SHR V3, V3
+  278      8336    SHR V3, V3
+  27A      8336    SHR V3, V3
+  27C      F329    LD F, V3            ; I = font sprite of the digit
+  27E      D125    DRW V1, V2, 5       ; changes VF
+  280      7105    ADD V1, 0x05
+  282      8300    LD V3, V0           ; low nibble
+  284      640F    LD V4, 0x0F
+  286      8342    AND V3, V4
+  288      F329    LD F, V3
+  28A      D125    DRW V1, V2, 5
+  28C      7107    ADD V1, 0x07        ; next column, five results per row
+  28E      413C    SNE V1, 0x3C
+  290      1294    JP 0x294
+  292      00EE    RET
+
+print_newline:
+  294      6100    LD V1, 0x00
+  296      7206    ADD V2, 0x06        ; next row
+  298      00EE    RET
+
+table:
+  29A      0102    DB 0x01, 0x02       ; read by FX65: 01 02 03 04 05
+  29C      0304    DB 0x03, 0x04
+  29E      0500    DB 0x05, 0x00       ; 29F..2A1: written by FX55
+  2A0      0000    DB 0x00, 0x00
+  2A2      00FF    DB 0x00, 0xFF       ; 2A3..2AA: block (8 rows of FF)
+  2A4      FFFF    DB 0xFF, 0xFF
+  2A6      FFFF    DB 0xFF, 0xFF
+  2A8      FFFF    DB 0xFF, 0xFF
+  2AA      FF      DB 0xFF
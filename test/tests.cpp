@@ -8,12 +8,65 @@
 #pragma warning(default: 26812 26495)
 #endif
 
+#ifdef _MSC_VER
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
 #include <random>
+#include <cstdio>
+#include <clocale>
+#include <locale>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <numeric>
+#include <algorithm>
 #include <gsl/gsl>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include <Chip8Core/Chip8.hpp>
 #include <Chip8Core/Memory.hpp>
 #include <Chip8Core/Instruction.hpp>
+#include <Chip8Core/RewindBuffer.hpp>
+#include <Chip8Core/InputMovie.hpp>
+#include <Chip8Core/InputQueue.hpp>
+#include <Chip8Core/ThreadPool.hpp>
+#include <Chip8Core/BatchRunner.hpp>
+#include <Chip8Core/VectorMachine.hpp>
+#include <Chip8Core/Environment.hpp>
+#include <Chip8Core/SharedMemory.hpp>
+#include <Chip8Core/Hash.hpp>
+#include <Chip8Core/RomStore.hpp>
+#include <Chip8Core/Json.hpp>
+#include <Chip8Core/RomLibrary.hpp>
+#include <Chip8Core/Session.hpp>
+#include <Chip8Core/FrameCodec.hpp>
+#include <Chip8Core/StreamClient.hpp>
+#include <Chip8Core/StreamServer.hpp>
+#include <Chip8Core/Profiler.hpp>
+#include <Chip8Core/Debugger.hpp>
+#include <Chip8Core/Disassembler.hpp>
+#include <Chip8Core/ControlFlowAnalysis.hpp>
+#include <Chip8Core/AotCompiler.hpp>
+#include <Chip8Core/AotRuntime.hpp>
+#include <Chip8Core/ExecutionHistory.hpp>
+#include <Chip8Core/Probes.hpp>
+#include <Chip8Core/LatencyProbe.hpp>
+#include <Chip8Core/InstructionTrace.hpp>
+#include <Chip8Core/MemoryProfiler.hpp>
 
 using namespace Chip8;
 
@@ -35,6 +88,39 @@ namespace {
 		ASSERT_THROW(memory.write(0x1000, 0), std::out_of_range);
 	}
 
+	TEST_F(MemoryTests, CopiesShareUnwrittenPages) {
+		memory.write(0x010, 0x12);
+		memory.write(0x210, 0x34);
+		ASSERT_EQ(memory.getPrivatePageCount(), 2u);
+
+		auto copy = memory;
+		ASSERT_EQ(memory.getPrivatePageCount(), 0u);
+		ASSERT_EQ(copy.getPrivatePageCount(), 0u);
+
+		copy.write(0x211, 0x56);
+		ASSERT_EQ(copy.getPrivatePageCount(), 1u);
+		ASSERT_EQ(copy.read(0x210), 0x34);
+		ASSERT_EQ(copy.read(0x211), 0x56);
+		ASSERT_EQ(memory.read(0x211), 0x00);
+		ASSERT_EQ(memory.read(0x010), copy.read(0x010));
+	}
+
+	TEST_F(MemoryTests, SharedPagesAreNeverModified) {
+		auto page = std::make_shared<Chip8Memory<UnderlyingType>::Page>();
+		page->fill(0xAB);
+		memory.setPage(0x3, page);
+		memory.write(0x300, 0x01);
+		ASSERT_EQ(page->at(0x00), 0xAB);
+		ASSERT_EQ(memory.read(0x300), 0x01);
+		ASSERT_EQ(memory.read(0x301), 0xAB);
+
+		const std::array<UnderlyingType, 2> block = { 0xAB, 0xAB };
+		auto other = std::make_shared<Chip8Memory<UnderlyingType>::Page>(*page);
+		memory.setPage(0x4, other);
+		memory.writeBlock(0x410, block.data(), block.size()); // same content, page stays shared
+		ASSERT_EQ(memory.getPage(0x4), other);
+	}
+
 	TEST_F(MemoryTests, WriteValue_ReadValue) {
 		std::default_random_engine generator;
 		std::uniform_int_distribution<int> distribution(0x00, 0xFF /* = 0x1000 - 0x0001 */);
@@ -75,6 +161,22 @@ namespace {
 		ASSERT_EQ(chip8.getProgramCounter(), chip8.ProgramOffset);
 	}
 
+	TEST_F(ProgramCounterTest, ForkedInstancesAreIndependent) {
+		chip8.reset();
+		chip8.getMemory().write(chip8.ProgramOffset, 0xA3); // set address pointer to 0x300
+		chip8.getMemory().write(chip8.ProgramOffset + 1, 0x00);
+		chip8.getMemory().write(chip8.ProgramOffset + 2, 0xF0); // store V0 at 0x300
+		chip8.getMemory().write(chip8.ProgramOffset + 3, 0x55);
+		chip8.step();
+		auto fork = chip8;
+		fork.setRegister(0x0, 0x42);
+		fork.step();
+		chip8.step();
+		ASSERT_EQ(fork.getMemory().read(0x300), 0x42);
+		ASSERT_EQ(chip8.getMemory().read(0x300), 0x00);
+		ASSERT_EQ(fork.getMemory().read(0x0), 0xF0); // font is still there
+	}
+
 	TEST_F(ProgramCounterTest, ProgramCounterIncreasesCorrectlyUponStep) {
 		chip8.getMemory().write(chip8.ProgramOffset, 0x00E0); // instruction is needed for the program counter to increase
 		chip8.step();
@@ -498,6 +600,2073 @@ namespace {
 		chip8.step();
 		ASSERT_EQ(chip8.getProgramCounter(), chip8.ProgramOffset + 0x4);
 	}
+
+	TEST_F(OpcodeTest, ReturnFromSubroutine_EmptyStack) { // 0x00EE
+		chip8.setLoggingEnabled(false);
+		writeInstruction(0x00EE); // instruction = return from subroutine without a call
+		ASSERT_FALSE(chip8.step()); // stops the program instead of throwing
+	}
+
+	TEST_F(OpcodeTest, SkipNextInstructionIfKeyIsPressed_InvalidKey) { // EX9E
+		chip8.setRegister(0xA, 0x20);
+		writeInstruction(0xEA9E); // skip next instruction if the key in VA (0x20, no such key) is pressed
+		ASSERT_FALSE(chip8.isKeyPressed(0x20));
+		chip8.step();
+		ASSERT_EQ(chip8.getProgramCounter(), chip8.ProgramOffset + 0x2);
+	}
+
+	TEST_F(OpcodeTest, LoadROMFromMemory) {
+		const std::vector<uint8_t> rom = { 0x6A, 0x42, 0x12, 0x00 }; // VA = 0x42, jump to 0x200
+		chip8.setRegister(0xB, 0x1);
+		chip8.loadROM(rom.data(), rom.size());
+		ASSERT_EQ(chip8.getRegister(0xB), 0x0); // the machine has been reset
+		ASSERT_EQ(chip8.getMemory().read(chip8.ProgramOffset + 0x3), 0x00);
+		chip8.step();
+		ASSERT_EQ(chip8.getRegister(0xA), 0x42);
+
+		// oversized ROMs are cut off at the end of the memory
+		const std::vector<uint8_t> largeROM(chip8.MemorySize, 0xAB);
+		chip8.loadROM(largeROM.data(), largeROM.size());
+		ASSERT_EQ(chip8.getMemory().read(gsl::narrow<uint16_t>(chip8.MemorySize - 1)), 0xAB);
+	}
+}
+
+namespace {
+	class StateTest : public ::testing::Test {
+	protected:
+		::Chip8::Chip8 chip8;
+
+		// counts V0 up and draws the font sprite of its lowest nibble in an endless loop
+		void writeCounterProgram() {
+			const uint16_t program[] = { 0x7001, 0x00E0, 0xF029, 0xD125, 0x2210, 0x1200, 0x0000, 0x0000, 0x00EE };
+			uint16_t address = ::Chip8::Chip8::ProgramOffset;
+			for (const auto instruction : program) {
+				chip8.getMemory().write(address++, gsl::narrow<uint8_t>(instruction >> 8));
+				chip8.getMemory().write(address++, gsl::narrow<uint8_t>(instruction & 0xFF));
+			}
+		}
+	};
+
+	TEST_F(StateTest, SaveAndLoadStateRestoresMachine) {
+		chip8.reset();
+		writeCounterProgram();
+		for (int i = 0; i < 13; i++)
+			chip8.step();
+		chip8.triggerKeyDown(0x7);
+		::Chip8::Chip8::State saved;
+		chip8.saveState(saved);
+
+		::Chip8::Chip8 other;
+		other.loadState(saved);
+		::Chip8::Chip8::State restored;
+		other.saveState(restored);
+		ASSERT_EQ(saved, restored);
+		ASSERT_EQ(other.getProgramCounter(), chip8.getProgramCounter());
+		ASSERT_EQ(other.getRegister(0x0), chip8.getRegister(0x0));
+		ASSERT_TRUE(other.isKeyPressed(0x7));
+		for (size_t y = 0; y < ::Chip8::Chip8::DisplayHeight; ++y) {
+			for (size_t x = 0; x < ::Chip8::Chip8::DisplayWidth; ++x)
+				ASSERT_EQ(other.getPixel(x, y), chip8.getPixel(x, y));
+		}
+	}
+
+	// the rewind buffer runs the counter program of StateTest
+	class RewindBufferTest : public StateTest {};
+
+	TEST_F(RewindBufferTest, RestoresEveryFrame) {
+		chip8.reset();
+		writeCounterProgram();
+		RewindBuffer rewindBuffer(RewindBuffer::DefaultMemoryBudget, 8);
+		std::vector<::Chip8::Chip8::State> history;
+		for (int frame = 0; frame < 50; frame++) {
+			for (int i = 0; i < 7; i++)
+				chip8.step();
+			chip8.clockTimers();
+			rewindBuffer.push(chip8);
+			history.emplace_back();
+			chip8.saveState(history.back());
+		}
+		ASSERT_EQ(rewindBuffer.size(), history.size());
+
+		::Chip8::Chip8::State state;
+		for (size_t i = history.size() - 1; i > 0; --i) {
+			ASSERT_TRUE(rewindBuffer.stepBack(chip8));
+			chip8.saveState(state);
+			ASSERT_EQ(state, history[i - 1]);
+		}
+		ASSERT_FALSE(rewindBuffer.stepBack(chip8));
+
+		for (const size_t index : { 37u, 3u, 49u, 16u, 17u, 0u }) {
+			ASSERT_TRUE(rewindBuffer.restore(index, chip8));
+			chip8.saveState(state);
+			ASSERT_EQ(state, history[index]);
+		}
+	}
+
+	TEST_F(RewindBufferTest, DiscardsFramesAfterRestoredPosition) {
+		chip8.reset();
+		writeCounterProgram();
+		RewindBuffer rewindBuffer;
+		for (int frame = 0; frame < 10; frame++) {
+			chip8.step();
+			rewindBuffer.push(chip8);
+		}
+		ASSERT_TRUE(rewindBuffer.restore(4, chip8));
+		chip8.step();
+		rewindBuffer.push(chip8);
+		ASSERT_EQ(rewindBuffer.size(), 6u);
+		ASSERT_EQ(rewindBuffer.getPosition(), 5u);
+	}
+
+	TEST_F(RewindBufferTest, StaysWithinMemoryBudget) {
+		chip8.reset();
+		writeCounterProgram();
+		constexpr size_t budget = 16u * 1024u;
+		RewindBuffer rewindBuffer(budget, 10);
+		for (int frame = 0; frame < 2000; frame++) {
+			for (int i = 0; i < 7; i++)
+				chip8.step();
+			rewindBuffer.push(chip8);
+			ASSERT_LE(rewindBuffer.getMemoryUsage(), budget);
+		}
+		ASSERT_GT(rewindBuffer.size(), 10u);
+		ASSERT_LT(rewindBuffer.size(), 2000u);
+		// the oldest retained frame can still be restored
+		ASSERT_TRUE(rewindBuffer.restore(0, chip8));
+	}
+}
+
+namespace {
+	class DeterminismTest : public ::testing::Test {
+	protected:
+		::Chip8::Chip8 chip8;
+
+		// draws a random sprite at the position given by the keys pressed, then waits for a key
+		void writeProgram() {
+			const uint16_t program[] = {
+				0xC0FF, 0xC1FF, 0xA300, 0xF055, 0x6200, 0x6300, 0xE09E, 0x7201, 0xE19E, 0x7301,
+				0xD232, 0xF40A, 0xF415, 0x1200,
+			};
+			uint16_t address = ::Chip8::Chip8::ProgramOffset;
+			for (const auto instruction : program) {
+				chip8.getMemory().write(address++, gsl::narrow<uint8_t>(instruction >> 8));
+				chip8.getMemory().write(address++, gsl::narrow<uint8_t>(instruction & 0xFF));
+			}
+		}
+	};
+
+	TEST_F(DeterminismTest, RandomNumbersDependOnlyOnSeed) {
+		chip8.getMemory().write(chip8.ProgramOffset, 0xC0);
+		chip8.getMemory().write(chip8.ProgramOffset + 1, 0xFF); // V0 = random
+		chip8.getMemory().write(chip8.ProgramOffset + 2, 0x12);
+		chip8.getMemory().write(chip8.ProgramOffset + 3, 0x00); // jump back
+		::Chip8::Chip8 other = chip8;
+		chip8.seedRandom(1234);
+		other.seedRandom(1234);
+		std::bitset<0x100> seenValues;
+		for (int i = 0; i < 10'000; i++) {
+			chip8.step();
+			other.step();
+			ASSERT_EQ(chip8.getRegister(0x0), other.getRegister(0x0));
+			if (i % 2 == 0)
+				seenValues[chip8.getRegister(0x0)] = true;
+		}
+		ASSERT_TRUE(seenValues.all()); // including 0xFF
+
+		other.seedRandom(4321);
+		other.step();
+		other.step();
+		chip8.seedRandom(1234);
+		chip8.step();
+		chip8.step();
+		ASSERT_NE(chip8.getRegister(0x0), other.getRegister(0x0));
+	}
+
+	TEST_F(DeterminismTest, ReplayedMovieReproducesSession) {
+		chip8.reset();
+		writeProgram();
+		chip8.seedRandom(42);
+		InputMovie movie;
+		movie.startRecording(chip8);
+		std::default_random_engine generator(7);
+		std::uniform_int_distribution<int> distribution(0x0, 0xF);
+		for (int frame = 0; frame < 300; frame++) {
+			if (frame % 5 == 0)
+				chip8.triggerKeyDown(gsl::narrow<uint8_t>(distribution(generator)));
+			if (frame % 7 == 0)
+				chip8.triggerKeyUp(gsl::narrow<uint8_t>(distribution(generator)));
+			for (int i = 0; i < 9; i++)
+				chip8.step();
+			chip8.clockTimers();
+		}
+		movie.stopRecording(chip8);
+		::Chip8::Chip8::State expected;
+		chip8.saveState(expected);
+
+		const std::string filename = "test_movie.c8m";
+		ASSERT_TRUE(movie.save(filename));
+		InputMovie loadedMovie;
+		std::string error;
+		ASSERT_TRUE(loadedMovie.load(filename, error));
+		std::remove(filename.c_str());
+		InputMovie missingMovie;
+		ASSERT_FALSE(missingMovie.load(filename, error));
+		ASSERT_EQ(error, "could not read " + filename);
+		ASSERT_TRUE(loadedMovie.drivesTimers());
+		ASSERT_EQ(loadedMovie.getEvents().size(), movie.getEvents().size());
+
+		::Chip8::Chip8 replay;
+		MoviePlayer player(loadedMovie);
+		player.start(replay);
+		while (replay.getCycleCount() < chip8.getCycleCount())
+			player.step(replay);
+		player.applyEvents(replay);
+		ASSERT_TRUE(player.isFinished());
+		::Chip8::Chip8::State actual;
+		replay.saveState(actual);
+		ASSERT_EQ(actual, expected);
+	}
+}
+
+namespace {
+	class BatchTest : public ::testing::Test {
+	protected:
+		// writes a ROM to disk and returns its filename
+		std::string writeROM(const std::string& filename, std::initializer_list<uint16_t> program) {
+			std::ofstream file(filename, std::ios::binary);
+			for (const auto instruction : program) {
+				file.put(static_cast<char>(instruction >> 8));
+				file.put(static_cast<char>(instruction & 0xFF));
+			}
+			mFiles.push_back(filename);
+			return filename;
+		}
+
+		void TearDown() override {
+			for (const auto& filename : mFiles)
+				std::remove(filename.c_str());
+		}
+
+	private:
+		std::vector<std::string> mFiles;
+	};
+
+	TEST(ThreadPoolTest, RunsAllTasks) {
+		ThreadPool threadPool(4);
+		ASSERT_EQ(threadPool.getThreadCount(), 4u);
+		std::atomic<int> counter = 0;
+		for (int i = 0; i < 100; i++) {
+			threadPool.submit([&threadPool, &counter]() {
+				// tasks spawned from within a worker go to its own queue
+				for (int j = 0; j < 10; j++)
+					threadPool.submit([&counter]() { counter++; });
+			});
+		}
+		threadPool.wait();
+		ASSERT_EQ(counter, 1000);
+
+		std::vector<int> values(1000, 0);
+		threadPool.parallelFor(values.size(), [&values](size_t index) { values[index] = static_cast<int>(index); });
+		for (size_t i = 0; i < values.size(); i++)
+			ASSERT_EQ(values[i], static_cast<int>(i));
+	}
+
+	TEST(ThreadPoolTest, RunsNestedLoopsInline) {
+		ThreadPool threadPool(2);
+		std::vector<std::vector<int>> values(8, std::vector<int>(100, 0));
+		threadPool.parallelFor(values.size(), [&threadPool, &values](size_t outer) {
+			threadPool.parallelFor(values[outer].size(), [&values, outer](size_t inner) {
+				values[outer][inner] = static_cast<int>(outer * inner);
+			});
+		});
+		for (size_t outer = 0; outer < values.size(); outer++) {
+			for (size_t inner = 0; inner < values[outer].size(); inner++)
+				ASSERT_EQ(values[outer][inner], static_cast<int>(outer * inner));
+		}
+	}
+
+	TEST(ThreadPoolTest, RethrowsExceptions) {
+		ThreadPool threadPool(2);
+		threadPool.submit([]() { throw std::runtime_error("task failed"); });
+		ASSERT_THROW(threadPool.wait(), std::runtime_error);
+		threadPool.wait(); // the exception is only reported once
+	}
+
+	TEST_F(BatchTest, ParsesManifest) {
+		std::istringstream manifest(
+			"# comment\n"
+			"\n"
+			"a.ch8\n"
+			"b.ch8, chip8, 500\n"
+			"c.ch8,,,c.c8m\n");
+		BatchJob defaultJob;
+		defaultJob.cycleBudget = 1234;
+		std::string error;
+		const auto jobs = parseBatchManifest(manifest, defaultJob, error);
+		ASSERT_TRUE(jobs);
+		ASSERT_EQ(jobs->size(), 3u);
+		ASSERT_EQ((*jobs)[0].romPath, "a.ch8");
+		ASSERT_EQ((*jobs)[0].cycleBudget, 1234u);
+		ASSERT_EQ((*jobs)[0].compatibilityMode, CompatibilityMode::SuperChip);
+		ASSERT_EQ((*jobs)[1].romPath, "b.ch8");
+		ASSERT_EQ((*jobs)[1].cycleBudget, 500u);
+		ASSERT_EQ((*jobs)[1].compatibilityMode, CompatibilityMode::OriginalChip8);
+		ASSERT_EQ((*jobs)[2].moviePath, "c.c8m");
+
+		std::istringstream invalidManifest("a.ch8\nb.ch8,gameboy\n");
+		ASSERT_FALSE(parseBatchManifest(invalidManifest, defaultJob, error));
+		ASSERT_EQ(error, "line 2: unknown profile 'gameboy'");
+	}
+
+	TEST_F(BatchTest, ReportsStopReasons) {
+		std::vector<BatchJob> jobs(4);
+		jobs[0].romPath = writeROM("batch_loop.ch8", { 0x00E0, 0xA200, 0xD005, 0x7001, 0x1202 });
+		jobs[0].cycleBudget = 1000;
+		jobs[1].romPath = writeROM("batch_halt.ch8", { 0x6001, 0x0000 });
+		jobs[2].romPath = writeROM("batch_overflow.ch8", { 0x2200 });
+		jobs[3].romPath = "does_not_exist.ch8";
+
+		ThreadPool threadPool(2);
+		const auto results = runBatchJobs(jobs, threadPool);
+		ASSERT_EQ(results.size(), jobs.size());
+		ASSERT_EQ(results[0].stopReason, StopReason::CycleBudgetReached);
+		ASSERT_EQ(results[0].cycles, 1000u);
+		ASSERT_EQ(results[1].stopReason, StopReason::Halted);
+		ASSERT_EQ(results[1].cycles, 2u);
+		ASSERT_EQ(results[2].stopReason, StopReason::Halted);
+		ASSERT_EQ(results[3].stopReason, StopReason::LoadFailed);
+
+		// the same job always produces the same display
+		ASSERT_EQ(runBatchJob(jobs[0]).displayHash, results[0].displayHash);
+		ASSERT_NE(results[0].displayHash, results[1].displayHash);
+
+		std::ostringstream csv;
+		writeBatchResultsCsv(csv, jobs, results);
+		const auto text = csv.str();
+		ASSERT_EQ(std::count(text.begin(), text.end(), '\n'), 5);
+	}
+}
+
+namespace {
+	class VectorMachineTest : public ::testing::Test {
+	protected:
+		::Chip8::Chip8 prototype;
+
+		// exercises every instruction; random numbers and keys make the lanes diverge and reconverge
+		void writeProgram() {
+			const uint16_t program[] = {
+				0x6000, 0xA300, 0xC0FF, 0xC10F, 0x8014, 0x8015, 0x8017, 0x8016, // 0x200
+				0x801E, 0x8F04, 0x80F5, 0x8011, 0x8012, 0x8013, 0x3003, 0x7201, // 0x210
+				0x4105, 0x7301, 0x5010, 0x7401, 0x9010, 0x7501, 0xF033, 0xF265, // 0x220
+				0xF255, 0xA300, 0xF129, 0xD235, 0xE19E, 0x7601, 0xE1A1, 0xF40A, // 0x230
+				0xF015, 0xF707, 0xF118, 0xF51E, 0x2250, 0x6000, 0xB202, 0x0000, // 0x240
+				0x7801, 0x00EE, // 0x250
+			};
+			prototype.reset();
+			uint16_t address = ::Chip8::Chip8::ProgramOffset;
+			for (const auto instruction : program) {
+				prototype.getMemory().write(address++, gsl::narrow<uint8_t>(instruction >> 8));
+				prototype.getMemory().write(address++, gsl::narrow<uint8_t>(instruction & 0xFF));
+			}
+		}
+	};
+
+	TEST_F(VectorMachineTest, LanesMatchIndependentMachines) {
+		writeProgram();
+		constexpr size_t laneCount = 40; // not a multiple of the vector width
+		std::vector<::Chip8::Chip8> machines(laneCount, prototype);
+		VectorMachine vectorMachine(laneCount, prototype);
+		for (size_t lane = 0; lane < laneCount; lane++) {
+			machines[lane].seedRandom(lane % 7); // some lanes share their seed and stay in lockstep
+			vectorMachine.seedRandom(lane, lane % 7);
+			if (lane % 3 == 0) {
+				machines[lane].setCompatibilityMode(CompatibilityMode::OriginalChip8);
+				vectorMachine.setLane(lane, machines[lane]);
+			}
+		}
+
+		std::default_random_engine generator(3);
+		std::uniform_int_distribution<int> distribution(0x0, 0xF);
+		::Chip8::Chip8 lane;
+		::Chip8::Chip8::State expected;
+		::Chip8::Chip8::State actual;
+		for (int frame = 0; frame < 200; frame++) {
+			for (size_t i = 0; i < laneCount; i++) {
+				const auto key = gsl::narrow<uint8_t>(distribution(generator));
+				if (frame % 2 == 0) {
+					machines[i].triggerKeyDown(key);
+					vectorMachine.triggerKeyDown(i, key);
+				} else {
+					machines[i].triggerKeyUp(key);
+					vectorMachine.triggerKeyUp(i, key);
+				}
+			}
+			for (int cycle = 0; cycle < 10; cycle++) {
+				for (auto& machine : machines)
+					ASSERT_TRUE(machine.step());
+				vectorMachine.step();
+			}
+			for (auto& machine : machines)
+				machine.clockTimers();
+			vectorMachine.clockTimers();
+
+			ASSERT_EQ(vectorMachine.getRunningLaneCount(), laneCount);
+			for (size_t i = 0; i < laneCount; i++) {
+				vectorMachine.getLane(i, lane);
+				lane.saveState(actual);
+				machines[i].saveState(expected);
+				ASSERT_EQ(actual, expected) << "lane " << i << ", frame " << frame;
+			}
+		}
+		const auto& statistics = vectorMachine.getStatistics();
+		ASSERT_GT(statistics.vectorLaneSteps, statistics.scalarLaneSteps / 4);
+		ASSERT_GT(statistics.scalarLaneSteps, 0u);
+	}
+
+	TEST_F(VectorMachineTest, StopsLanesIndividually) {
+		prototype.reset();
+		const uint16_t program[] = { 0x4000, 0x0000, 0x3002, 0x00EE, 0x1208 };
+		uint16_t address = ::Chip8::Chip8::ProgramOffset;
+		for (const auto instruction : program) {
+			prototype.getMemory().write(address++, gsl::narrow<uint8_t>(instruction >> 8));
+			prototype.getMemory().write(address++, gsl::narrow<uint8_t>(instruction & 0xFF));
+		}
+		VectorMachine vectorMachine(3, prototype);
+		::Chip8::Chip8 machine = prototype;
+		machine.setRegister(0x0, 0x1);
+		vectorMachine.setLane(1, machine);
+		machine.setRegister(0x0, 0x2);
+		vectorMachine.setLane(2, machine);
+		for (int i = 0; i < 10; i++)
+			vectorMachine.step();
+		ASSERT_EQ(vectorMachine.getLaneStatus(0), VectorMachine::LaneStatus::Halted); // zero instruction
+		ASSERT_EQ(vectorMachine.getLaneStatus(1), VectorMachine::LaneStatus::Halted); // return from empty stack
+		ASSERT_EQ(vectorMachine.getLaneStatus(2), VectorMachine::LaneStatus::Running); // endless loop
+		ASSERT_EQ(vectorMachine.getRunningLaneCount(), 1u);
+		ASSERT_EQ(vectorMachine.getProgramCounter(2), 0x208);
+	}
+}
+
+namespace {
+	class EnvironmentTest : public ::testing::Test {
+	protected:
+		::Chip8::Chip8 initialMachine;
+
+		// draws the digit of the pressed key (or 0) at a random position, halts when key F is pressed
+		void writeProgram() {
+			const uint16_t program[] = {
+				0x00E0, 0x630F, 0xE3A1, 0x0000, 0x6000, 0xE09E, 0x1210, 0x1218, // 0x200
+				0x7001, 0x3010, 0x120A, 0x6000, 0xF029, 0xC13F, 0xC21F, 0xD125, // 0x210
+				0x1202, // 0x220
+			};
+			initialMachine.reset();
+			uint16_t address = ::Chip8::Chip8::ProgramOffset;
+			for (const auto instruction : program) {
+				initialMachine.getMemory().write(address++, gsl::narrow<uint8_t>(instruction >> 8));
+				initialMachine.getMemory().write(address++, gsl::narrow<uint8_t>(instruction & 0xFF));
+			}
+		}
+	};
+
+	TEST_F(EnvironmentTest, ObservationsMatchDisplays) {
+		writeProgram();
+		constexpr size_t environmentCount = 8;
+		ThreadPool threadPool(2);
+		VectorEnvironment environment(environmentCount, initialMachine, 10, &threadPool);
+		std::vector<uint8_t> observations(environment.getObservationBufferSize(), 0xAA);
+		std::vector<EnvironmentInfo> infos(environmentCount);
+		environment.reset(observations.data());
+		ASSERT_TRUE(std::all_of(observations.begin(), observations.end(), [](uint8_t value) { return value == 0x0; }));
+
+		std::vector<uint16_t> actions(environmentCount, 0x0);
+		for (int i = 0; i < 20; i++) {
+			for (size_t j = 0; j < environmentCount; j++)
+				actions[j] = gsl::narrow<uint16_t>(0x1 << ((i + j) % 8));
+			environment.step(actions.data(), 3, observations.data(), infos.data());
+			for (size_t j = 0; j < environmentCount; j++) {
+				ASSERT_FALSE(infos[j].done);
+				ASSERT_EQ(infos[j].frameCount, 3u * (i + 1));
+				ASSERT_EQ(infos[j].cycleCount, 30u * (i + 1));
+				const auto& display = environment.getMachine(j).getPackedDisplay();
+				ASSERT_TRUE(std::equal(display.begin(), display.end(), observations.begin() + j * VectorEnvironment::ObservationSize));
+				ASSERT_TRUE(environment.getMachine(j).isKeyPressed(gsl::narrow<uint8_t>((i + j) % 8)));
+			}
+		}
+		// the environments have been seeded differently
+		ASSERT_FALSE(std::equal(observations.begin(), observations.begin() + VectorEnvironment::ObservationSize,
+			observations.begin() + VectorEnvironment::ObservationSize));
+
+		actions[2] = 0x8000; // key F halts the program
+		environment.step(actions.data(), 10, observations.data(), infos.data());
+		ASSERT_TRUE(infos[2].done);
+		ASSERT_FALSE(infos[2].crashed);
+		ASSERT_FALSE(infos[3].done);
+		environment.reset({ 2 }, observations.data());
+		environment.step(actions.data(), 1, observations.data(), infos.data());
+		ASSERT_EQ(infos[2].frameCount, 1u);
+	}
+
+#ifdef CHIP8_ENABLE_PROFILING
+	TEST_F(EnvironmentTest, DoesNotCopyHooks) {
+		writeProgram();
+		Profiler profiler;
+		Debugger debugger;
+		initialMachine.setProfiler(&profiler);
+		debugger.attach(&initialMachine);
+		debugger.setBreakpoint(0x202);
+		constexpr size_t environmentCount = 4;
+		VectorEnvironment environment(environmentCount, initialMachine);
+		std::vector<uint8_t> observations(environment.getObservationBufferSize());
+		std::vector<uint16_t> actions(environmentCount, 0x0);
+		environment.reset(observations.data());
+		environment.step(actions.data(), 3, observations.data(), nullptr);
+		for (size_t i = 0; i < environmentCount; ++i) {
+			ASSERT_EQ(environment.getMachine(i).getProfiler(), nullptr);
+			ASSERT_EQ(environment.getMachine(i).getDebugger(), nullptr);
+		}
+		ASSERT_EQ(profiler.getTotalExecutions(), 0u);
+		ASSERT_FALSE(debugger.takeStop());
+		debugger.attach(nullptr);
+		initialMachine.setProfiler(nullptr);
+	}
+#endif
+
+	TEST(SharedMemoryTest, IsVisibleThroughOtherMapping) {
+		SharedMemory created("/chip8_test_shared_memory", 4096);
+		ASSERT_EQ(created.size(), 4096u);
+		created.data()[0] = 0x12;
+		created.data()[4095] = 0x34;
+		SharedMemory opened(created.getName(), 0, SharedMemory::Mode::Open);
+		ASSERT_GE(opened.size(), 4096u);
+		ASSERT_EQ(opened.data()[0], 0x12);
+		ASSERT_EQ(opened.data()[4095], 0x34);
+		opened.data()[1] = 0x56;
+		ASSERT_EQ(created.data()[1], 0x56);
+		ASSERT_THROW(SharedMemory("/chip8_test_does_not_exist", 0, SharedMemory::Mode::Open), std::runtime_error);
+	}
+}
+
+namespace {
+	TEST(HashTest, Sha1) {
+		ASSERT_EQ(toHexString(sha1("", 0)), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+		ASSERT_EQ(toHexString(sha1("abc", 3)), "a9993e364706816aba3e25717850c26c9cd0d89d");
+		const std::string twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"; // padding needs a second block
+		ASSERT_EQ(toHexString(sha1(twoBlocks.data(), twoBlocks.size())), "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+		const std::string million(1'000'000, 'a');
+		ASSERT_EQ(toHexString(sha1(million.data(), million.size())), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	}
+
+	class RomStoreTest : public ::testing::Test {
+	protected:
+		void writeFile(const std::string& filename, const std::vector<uint8_t>& content) {
+			std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+			if (std::find(mFiles.begin(), mFiles.end(), filename) == mFiles.end())
+				mFiles.push_back(filename);
+		}
+
+		void TearDown() override {
+			for (const auto& filename : mFiles)
+				std::remove(filename.c_str());
+		}
+
+	private:
+		std::vector<std::string> mFiles;
+	};
+
+	TEST_F(RomStoreTest, LoadsAndCachesByContent) {
+		std::vector<uint8_t> content(0x180);
+		for (size_t i = 0; i < content.size(); i++)
+			content[i] = static_cast<uint8_t>(i * 7);
+		writeFile("rom_store_a.ch8", content);
+		writeFile("rom_store_b.ch8", content);
+
+		RomStore romStore;
+		const auto rom = romStore.load("rom_store_a.ch8");
+		ASSERT_TRUE(rom);
+		ASSERT_EQ(rom->getSize(), content.size());
+		ASSERT_EQ(rom->getPages().size(), 2u);
+		ASSERT_EQ(rom->getHash(), sha1(content.data(), content.size()));
+		ASSERT_EQ(romStore.load("rom_store_a.ch8"), rom);
+		ASSERT_EQ(romStore.load("rom_store_b.ch8"), rom); // same content, same ROM
+		ASSERT_EQ(romStore.find(rom->getHash()), rom);
+		ASSERT_EQ(romStore.size(), 1u);
+		ASSERT_FALSE(romStore.load("rom_store_does_not_exist.ch8"));
+
+		// loading shares the pages, the machine is the same as after loading the file
+		::Chip8::Chip8 fromStore;
+		fromStore.loadROM(*rom);
+		::Chip8::Chip8 fromFile;
+		ASSERT_TRUE(fromFile.loadROM("rom_store_a.ch8"));
+		::Chip8::Chip8::State expected, actual;
+		fromFile.saveState(expected);
+		fromStore.saveState(actual);
+		ASSERT_EQ(actual, expected);
+		ASSERT_EQ(fromStore.getMemory().getPage(Rom::FirstPage), rom->getPages()[0]);
+		fromStore.getMemory().write(::Chip8::Chip8::ProgramOffset, 0xFF); // copy-on-write
+		ASSERT_EQ(rom->getPages()[0]->at(0), content[0]);
+	}
+
+	TEST_F(RomStoreTest, RevalidatesChangedFiles) {
+		writeFile("rom_store_reload.ch8", { 0x12, 0x00 });
+		RomStore romStore;
+		const auto first = romStore.load("rom_store_reload.ch8");
+		ASSERT_TRUE(first);
+		writeFile("rom_store_reload.ch8", { 0x12, 0x00, 0x00, 0xE0 });
+		ASSERT_EQ(romStore.load("rom_store_reload.ch8"), first); // cached without revalidation
+		const auto second = romStore.load("rom_store_reload.ch8", true);
+		ASSERT_TRUE(second);
+		ASSERT_EQ(second->getSize(), 4u);
+		ASSERT_EQ(romStore.load("rom_store_reload.ch8", true), second); // unchanged since
+	}
+}
+
+namespace {
+	TEST(JsonTest, ParsesDocuments) {
+		std::string error;
+		const auto document = parseJson(R"( {"a": [1, -2.5e1, true, null], "b": {"c": "x\"é😀"}} )", error);
+		ASSERT_TRUE(document);
+		ASSERT_EQ(document.value()["a"].asArray().size(), 4u);
+		ASSERT_EQ(document.value()["a"].asArray()[1].asNumber(), -25.0);
+		ASSERT_TRUE(document.value()["a"].asArray()[2].asBool());
+		ASSERT_TRUE(document.value()["a"].asArray()[3].isNull());
+		ASSERT_EQ(document.value()["b"]["c"].asString(), "x\"\xC3\xA9\xF0\x9F\x98\x80");
+		ASSERT_TRUE(document.value()["missing"]["deeper"].isNull());
+
+		const std::string tooDeep(1000, '[');
+		for (const char* invalid : { "", "[1,]", "{\"a\" 1}", "\"open", "[1] 2", "tru", "01x", tooDeep.c_str() }) {
+			error.clear();
+			ASSERT_FALSE(parseJson(invalid, error)) << invalid;
+			ASSERT_FALSE(error.empty());
+		}
+	}
+
+	TEST(JsonTest, ParsesNumbersIndependentlyOfTheLocale) {
+		// a decimal comma in the global C++ locale and, if one is installed, in the C locale
+		struct DecimalComma : std::numpunct<char> {
+			char do_decimal_point() const override { return ','; }
+		};
+		const auto previousLocale = std::locale::global(std::locale(std::locale::classic(), new DecimalComma));
+		const std::string previousCLocale = std::setlocale(LC_NUMERIC, nullptr);
+		for (const char* name : { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8" }) {
+			if (std::setlocale(LC_NUMERIC, name))
+				break;
+		}
+		std::string error;
+		const auto document = parseJson("[1.5, -2.25e1, 0.125]", error);
+		std::setlocale(LC_NUMERIC, previousCLocale.c_str());
+		std::locale::global(previousLocale);
+		ASSERT_TRUE(document) << error;
+		ASSERT_EQ(document.value().asArray()[0].asNumber(), 1.5);
+		ASSERT_EQ(document.value().asArray()[1].asNumber(), -22.5);
+		ASSERT_EQ(document.value().asArray()[2].asNumber(), 0.125);
+	}
+
+	class RomLibraryTest : public ::testing::Test {
+	protected:
+		const std::string mDirectory = "rom_library_test";
+		const std::string mIndex = "rom_library_test.idx";
+
+		void SetUp() override {
+			fs::remove_all(mDirectory);
+			fs::create_directories(mDirectory + "/sub");
+		}
+
+		void TearDown() override {
+			fs::remove_all(mDirectory);
+			std::remove(mIndex.c_str());
+		}
+
+		void writeFile(const std::string& filename, const std::string& content) {
+			std::ofstream file(filename, std::ios::binary);
+			file << content;
+		}
+
+		// a database in the format of chip-8-database that knows the ROM "known"
+		RomDatabase createDatabase() {
+			const std::string hash = toHexString(sha1("known", 5));
+			const std::string programs = R"([{"title": "Known Game", "roms": {")" + hash
+				+ R"(": {"file": "known.ch8", "platforms": ["originalChip8", "superchip"], "tickrate": 15}}}])";
+			const std::string platforms = R"([{"id": "originalChip8", "quirks": {"shift": false, "memoryLeaveIUnchanged": false}},
+				{"id": "superchip", "quirks": {"shift": true, "memoryLeaveIUnchanged": true}}])";
+			RomDatabase database;
+			std::string error;
+			EXPECT_TRUE(database.loadFromJson(programs, platforms, error)) << error;
+			return database;
+		}
+	};
+
+	TEST_F(RomLibraryTest, LooksUpQuirks) {
+		const auto database = createDatabase();
+		ASSERT_EQ(database.size(), 1u);
+		const auto* entry = database.find(sha1("known", 5));
+		ASSERT_NE(entry, nullptr);
+		ASSERT_EQ(entry->title, "Known Game");
+		ASSERT_EQ(entry->platform, "originalChip8");
+		ASSERT_EQ(entry->compatibilityMode, CompatibilityMode::OriginalChip8);
+		ASSERT_EQ(entry->tickrate, 15u);
+		ASSERT_EQ(database.find(sha1("unknown", 7)), nullptr);
+
+		RomDatabase invalidDatabase;
+		std::string error;
+		ASSERT_FALSE(invalidDatabase.loadFromJson("{}", "", error));
+	}
+
+	TEST_F(RomLibraryTest, ScansAndPersistsIndex) {
+		const auto database = createDatabase();
+		writeFile(mDirectory + "/known.ch8", "known");
+		writeFile(mDirectory + "/sub/Other Game.ch8", "other");
+		writeFile(mDirectory + "/readme.txt", "not a ROM");
+
+		ThreadPool threadPool(2);
+		RomLibrary library;
+		ASSERT_EQ(library.scan({ mDirectory }, database, threadPool), 2u);
+		ASSERT_EQ(library.getEntries().size(), 2u);
+		const auto known = library.search("known");
+		ASSERT_EQ(known.size(), 1u);
+		ASSERT_EQ(library.getEntries()[known[0]].title, "Known Game");
+		ASSERT_EQ(library.getEntries()[known[0]].compatibilityMode, CompatibilityMode::OriginalChip8);
+		const auto other = library.search("OTHER");
+		ASSERT_EQ(other.size(), 1u);
+		ASSERT_FALSE(library.getEntries()[other[0]].known);
+		ASSERT_EQ(library.getEntries()[other[0]].title, "Other Game");
+		ASSERT_EQ(library.search("").size(), 2u);
+
+		ASSERT_TRUE(library.saveIndex(mIndex));
+		RomLibrary loaded;
+		ASSERT_TRUE(loaded.loadIndex(mIndex));
+		ASSERT_EQ(loaded.getEntries().size(), 2u);
+		ASSERT_EQ(loaded.getEntries()[known[0]].hash, sha1("known", 5));
+		ASSERT_EQ(loaded.getEntries()[known[0]].tickrate, 15u);
+		ASSERT_EQ(loaded.scan({ mDirectory }, database, threadPool), 0u); // nothing has changed
+		ASSERT_FALSE(loaded.loadIndex("rom_library_does_not_exist.idx"));
+	}
+
+#ifdef __linux__
+	TEST_F(RomLibraryTest, PersistsPathsWithSeparators) {
+		// tabs and line breaks separate the fields and entries of the index
+		const auto database = createDatabase();
+		writeFile(mDirectory + "/tab\there.ch8", "tab");
+		writeFile(mDirectory + "/new\nline \\ and\r.ch8", "line");
+		ThreadPool threadPool(2);
+		RomLibrary library;
+		ASSERT_EQ(library.scan({ mDirectory }, database, threadPool), 2u);
+		ASSERT_TRUE(library.saveIndex(mIndex));
+		RomLibrary loaded;
+		ASSERT_TRUE(loaded.loadIndex(mIndex));
+		ASSERT_EQ(loaded.getEntries().size(), 2u);
+		for (size_t i = 0; i < 2; ++i) {
+			ASSERT_EQ(loaded.getEntries()[i].path, library.getEntries()[i].path);
+			ASSERT_EQ(loaded.getEntries()[i].title, library.getEntries()[i].title);
+		}
+		ASSERT_EQ(loaded.scan({ mDirectory }, database, threadPool), 0u);
+	}
+#endif
+}
+
+namespace {
+	// V0 counts the loop iterations and is stored at 0x300, so every consistent state has V0 == [0x300]
+	const std::array<uint8_t, 8> SessionCounterRom = { 0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x12, 0x00 };
+
+	TEST(SessionTest, PublishesFrames) {
+		SessionBackend backend("/chip8_test_session");
+		SessionViewer viewer("/chip8_test_session");
+		ASSERT_EQ(backend.getViewerCount(), 1u);
+		SessionFrame frame;
+		ASSERT_FALSE(viewer.read(frame));
+
+		Chip8::Chip8 chip8;
+		chip8.loadROM(SessionCounterRom.data(), SessionCounterRom.size());
+		for (int i = 0; i < 4 * 3; ++i)
+			chip8.step();
+		backend.publish(chip8);
+		ASSERT_TRUE(viewer.read(frame));
+		ASSERT_EQ(frame.frameNumber, 1u);
+		Chip8::Chip8 mirror;
+		mirror.loadState(frame.state);
+		ASSERT_EQ(mirror.getRegister(0x0), 3);
+		ASSERT_EQ(mirror.getProgramCounter(), chip8.getProgramCounter());
+		ASSERT_EQ(mirror.getCycleCount(), chip8.getCycleCount());
+		ASSERT_EQ(viewer.getFrameLatency().samples, 1u);
+		ASSERT_TRUE(viewer.read(frame));
+		ASSERT_EQ(viewer.getFrameLatency().samples, 1u); // the same frame is only measured once
+		ASSERT_THROW(SessionViewer("/chip8_test_session_does_not_exist"), std::runtime_error);
+	}
+
+	TEST(SessionTest, EchoesInput) {
+		SessionBackend backend("/chip8_test_session");
+		Chip8::Chip8 chip8;
+		{
+			SessionViewer first("/chip8_test_session");
+			SessionViewer second("/chip8_test_session");
+			ASSERT_NE(first.getViewerIndex(), second.getViewerIndex());
+			ASSERT_TRUE(second.sendKey(0x5, true));
+			ASSERT_TRUE(second.sendKey(0xA, true));
+			ASSERT_TRUE(second.sendKey(0x5, false));
+			ASSERT_EQ(backend.pollInput(chip8), 3u);
+			ASSERT_FALSE(chip8.isKeyPressed(0x5));
+			ASSERT_TRUE(chip8.isKeyPressed(0xA));
+			ASSERT_EQ(backend.pollInput(chip8), 0u);
+			backend.publish(chip8);
+			SessionFrame frame;
+			ASSERT_TRUE(first.read(frame));
+			ASSERT_TRUE(second.read(frame));
+			ASSERT_EQ(first.getInputLatency().samples, 0u);
+			ASSERT_EQ(second.getInputLatency().samples, 1u);
+			ASSERT_GT(second.getInputLatency().last, 0.0);
+
+			size_t sent = 0;
+			while (first.sendKey(0x1, true))
+				++sent;
+			ASSERT_GT(sent, 0u); // the ring is full now
+			ASSERT_EQ(backend.pollInput(chip8), sent);
+			ASSERT_TRUE(first.sendKey(0x1, false));
+
+			std::vector<std::unique_ptr<SessionViewer>> viewers;
+			while (viewers.size() + 2 < SessionFrame::MaximumViewers)
+				viewers.push_back(std::make_unique<SessionViewer>("/chip8_test_session"));
+			ASSERT_EQ(backend.getViewerCount(), SessionFrame::MaximumViewers);
+			ASSERT_THROW(SessionViewer("/chip8_test_session"), std::runtime_error);
+		}
+		ASSERT_EQ(backend.getViewerCount(), 0u);
+	}
+
+#ifdef __linux__
+	TEST(SessionTest, ReclaimsChannelsOfCrashedViewers) {
+		SessionBackend backend("/chip8_test_session");
+		for (size_t i = 0; i < SessionFrame::MaximumViewers; ++i) {
+			const pid_t child = fork();
+			ASSERT_NE(child, -1);
+			if (child == 0) {
+				// the viewer is never destroyed, just like in a crashed process
+				new SessionViewer("/chip8_test_session");
+				_exit(0);
+			}
+			ASSERT_EQ(waitpid(child, nullptr, 0), child);
+		}
+		ASSERT_EQ(backend.getViewerCount(), 0u);
+		std::vector<std::unique_ptr<SessionViewer>> viewers;
+		while (viewers.size() < SessionFrame::MaximumViewers)
+			viewers.push_back(std::make_unique<SessionViewer>("/chip8_test_session"));
+		ASSERT_EQ(backend.getViewerCount(), SessionFrame::MaximumViewers);
+		ASSERT_THROW(SessionViewer("/chip8_test_session"), std::runtime_error);
+	}
+#endif
+
+	TEST(SessionTest, ReadsConsistentFramesWhilePublishing) {
+		SessionBackend backend("/chip8_test_session");
+		SessionViewer viewer("/chip8_test_session");
+		std::atomic<bool> done = false;
+		std::thread writer([&backend, &done]() {
+			Chip8::Chip8 chip8;
+			chip8.loadROM(SessionCounterRom.data(), SessionCounterRom.size());
+			for (int frame = 0; frame < 20'000; ++frame) {
+				for (int i = 0; i < 4; ++i)
+					chip8.step();
+				backend.publish(chip8);
+			}
+			done = true;
+		});
+		SessionFrame frame;
+		Chip8::Chip8 mirror;
+		uint64_t lastFrameNumber = 0;
+		size_t reads = 0;
+		size_t inconsistentReads = 0;
+		while (!done || reads == 0) {
+			if (!viewer.read(frame))
+				continue;
+			++reads;
+			mirror.loadState(frame.state);
+			if (frame.frameNumber < lastFrameNumber || mirror.getMemory().read(0x300) != mirror.getRegister(0x0)
+				|| mirror.getCycleCount() != 4 * frame.frameNumber || mirror.getRegister(0x0) != static_cast<uint8_t>(frame.frameNumber))
+				++inconsistentReads;
+			lastFrameNumber = frame.frameNumber;
+		}
+		writer.join();
+		ASSERT_GT(reads, 0u);
+		ASSERT_EQ(inconsistentReads, 0u);
+	}
+}
+
+namespace {
+	TEST(FrameCodecTest, RunLengthEncodingRoundTrips) {
+		std::mt19937 random(42);
+		std::vector<std::vector<uint8_t>> inputs = { {}, { 0x12 }, std::vector<uint8_t>(1000, 0x00), { 1, 1, 2, 2, 3, 3, 3, 4 } };
+		std::vector<uint8_t> mixed;
+		for (int i = 0; i < 2000; ++i)
+			mixed.insert(mixed.end(), random() % 6, static_cast<uint8_t>(random() % 4));
+		inputs.push_back(mixed);
+		for (const auto& input : inputs) {
+			std::vector<uint8_t> encoded;
+			encodeRle(input.data(), input.size(), encoded);
+			std::vector<uint8_t> decoded(input.size());
+			ASSERT_TRUE(decodeRle(encoded.data(), encoded.size(), decoded.data(), decoded.size()));
+			ASSERT_EQ(decoded, input);
+		}
+		std::vector<uint8_t> encoded;
+		encodeRle(inputs[2].data(), inputs[2].size(), encoded);
+		ASSERT_EQ(encoded.size(), 2u * ((1000 + 127) / 128)); // runs of at most 128 bytes
+		std::vector<uint8_t> decoded(999);
+		ASSERT_FALSE(decodeRle(encoded.data(), encoded.size(), decoded.data(), decoded.size()));
+		const std::vector<uint8_t> truncated = { 0x05, 0x01 };
+		ASSERT_FALSE(decodeRle(truncated.data(), truncated.size(), decoded.data(), decoded.size()));
+	}
+
+	TEST(FrameCodecTest, SendsDirtyRowsAndKeyframes) {
+		FrameEncoder encoder(3);
+		FrameDecoder decoder;
+		Chip8::Chip8::PackedDisplay display{};
+		std::vector<uint8_t> message;
+		ASSERT_TRUE(encoder.encode(display, 0, message));
+		ASSERT_TRUE(decoder.decode(message.data(), message.size()));
+		ASSERT_LT(message.size(), StreamFrameHeaderSize + 8u); // an empty display compresses to a few runs
+
+		display[5 * StreamRowSize + 2] = 0xA5;
+		display[31 * StreamRowSize + 7] = 0x01;
+		message.clear();
+		ASSERT_FALSE(encoder.encode(display, 1234, message));
+		ASSERT_EQ(message[0], static_cast<uint8_t>(StreamMessageType::Delta));
+		ASSERT_EQ(message[13] | (message[14] << 8) | (message[15] << 16) | (static_cast<uint32_t>(message[16]) << 24), (1u << 5) | (1u << 31));
+		ASSERT_TRUE(decoder.decode(message.data(), message.size()));
+		ASSERT_EQ(decoder.getDisplay(), display);
+		ASSERT_EQ(decoder.getInputEcho(), 1234);
+		ASSERT_EQ(decoder.getSequence(), 1u);
+
+		// a missed delta desynchronizes the decoder until the next keyframe
+		message.clear();
+		ASSERT_FALSE(encoder.encode(display, 0, message));
+		message.clear();
+		display[0] = 0xFF;
+		ASSERT_TRUE(encoder.encode(display, 0, message)); // the interval has elapsed
+		ASSERT_TRUE(decoder.decode(message.data(), message.size()));
+		ASSERT_EQ(decoder.getDisplay(), display);
+		message.clear();
+		encoder.encode(display, 0, message);
+		message.clear();
+		encoder.encode(display, 0, message);
+		ASSERT_FALSE(decoder.decode(message.data(), message.size()));
+		ASSERT_FALSE(decoder.isSynchronized());
+		encoder.requestKeyframe();
+		message.clear();
+		ASSERT_TRUE(encoder.encode(display, 0, message));
+		ASSERT_TRUE(decoder.decode(message.data(), message.size()));
+		ASSERT_TRUE(decoder.isSynchronized());
+		ASSERT_FALSE(decoder.decode(message.data(), StreamFrameHeaderSize - 1));
+
+		message.clear();
+		encodeKeyEvent({ 0xB, true, -5 }, message);
+		const auto event = decodeKeyEvent(message.data(), message.size());
+		ASSERT_TRUE(event.has_value());
+		ASSERT_EQ(event->key, 0xB);
+		ASSERT_TRUE(event->pressed);
+		ASSERT_EQ(event->time, -5);
+		message[1] = 0x10;
+		ASSERT_FALSE(decodeKeyEvent(message.data(), message.size()).has_value());
+	}
+
+	TEST(StreamServerTest, ComputesWebSocketAcceptKey) {
+		// the example from RFC 6455
+		ASSERT_EQ(getWebSocketAcceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+	}
+
+#ifdef __linux__
+	// a minimal WebSocket client (RFC 6455) on a blocking socket
+	class WebSocketTestClient {
+	public:
+		explicit WebSocketTestClient(uint16_t port)
+			: mSocket(socket(AF_INET, SOCK_STREAM, 0))
+		{
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(port);
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			if (mSocket < 0 || connect(mSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+				throw std::runtime_error("could not connect");
+		}
+
+		~WebSocketTestClient() {
+			close(mSocket);
+		}
+
+		WebSocketTestClient(const WebSocketTestClient&) = delete;
+		WebSocketTestClient& operator=(const WebSocketTestClient&) = delete;
+
+		void send(const std::string& text) const {
+			ASSERT_EQ(::send(mSocket, text.data(), text.size(), MSG_NOSIGNAL), static_cast<ssize_t>(text.size()));
+		}
+
+		// sends a final frame, masked like every frame of a client
+		void sendFrame(uint8_t opcode, const std::vector<uint8_t>& payload) const {
+			std::string frame{ static_cast<char>(0x80 | opcode) };
+			if (payload.size() < 126) {
+				frame += static_cast<char>(0x80 | payload.size());
+			} else {
+				frame += static_cast<char>(0x80 | 126);
+				frame += static_cast<char>(payload.size() >> 8);
+				frame += static_cast<char>(payload.size() & 0xFF);
+			}
+			const std::array<uint8_t, 4> mask = { 0x37, 0xFA, 0x21, 0x3D };
+			frame.append(mask.begin(), mask.end());
+			for (size_t i = 0; i < payload.size(); ++i)
+				frame += static_cast<char>(payload[i] ^ mask[i % 4]);
+			send(frame);
+		}
+
+		// returns false if the connection has been closed or nothing has arrived within the timeout
+		bool receive(uint8_t* data, size_t size, int timeoutMilliseconds = 1000) const {
+			for (size_t received = 0; received < size;) {
+				pollfd descriptor{ mSocket, POLLIN, 0 };
+				if (poll(&descriptor, 1, timeoutMilliseconds) <= 0)
+					return false;
+				const ssize_t count = recv(mSocket, data + received, size - received, 0);
+				if (count <= 0)
+					return false;
+				received += static_cast<size_t>(count);
+			}
+			return true;
+		}
+
+		std::string receiveResponse() const {
+			std::string response;
+			char character;
+			while (response.find("\r\n\r\n") == std::string::npos && receive(reinterpret_cast<uint8_t*>(&character), 1))
+				response += character;
+			return response;
+		}
+
+		// receives an unmasked frame from the server (opcode, payload)
+		std::optional<std::pair<uint8_t, std::vector<uint8_t>>> receiveFrame(int timeoutMilliseconds = 1000) const {
+			std::array<uint8_t, 2> header;
+			if (!receive(header.data(), header.size(), timeoutMilliseconds) || (header[1] & 0x80))
+				return std::nullopt;
+			size_t size = header[1];
+			if (size == 126) {
+				std::array<uint8_t, 2> extendedSize;
+				if (!receive(extendedSize.data(), extendedSize.size()))
+					return std::nullopt;
+				size = (static_cast<size_t>(extendedSize[0]) << 8) | extendedSize[1];
+			}
+			std::vector<uint8_t> payload(size);
+			if (!receive(payload.data(), payload.size()))
+				return std::nullopt;
+			return std::make_pair(static_cast<uint8_t>(header[0] & 0x0F), payload);
+		}
+
+	private:
+		int mSocket;
+	};
+
+	TEST(StreamServerTest, StreamsToLoopbackClients) {
+		StreamServer server(0);
+		ASSERT_NE(server.getPort(), 0);
+		StreamClient client("127.0.0.1", server.getPort());
+		for (int i = 0; i < 200 && server.getClientCount() < 1; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		ASSERT_EQ(server.getClientCount(), 1u);
+
+		// the client is only served after its hello has arrived, so publish until the keyframe is received
+		Chip8::Chip8 chip8;
+		const std::array<uint8_t, 6> rom = { 0x60, 0x05, 0xF0, 0x29, 0xD0, 0x05 }; // draw the sprite of the digit 5
+		chip8.loadROM(rom.data(), rom.size());
+		bool received = false;
+		for (int i = 0; i < 200 && !received; ++i) {
+			server.publish(chip8);
+			received = client.receiveFrame(0.01);
+		}
+		ASSERT_TRUE(received);
+		ASSERT_EQ(client.getDecoder().getLastFrameType(), StreamMessageType::Keyframe);
+		for (int i = 0; i < 3; ++i)
+			chip8.step();
+		server.publish(chip8);
+		while (client.getDecoder().getDisplay() != chip8.getPackedDisplay())
+			ASSERT_TRUE(client.receiveFrame(1.0));
+		ASSERT_EQ(client.getDecoder().getLastFrameType(), StreamMessageType::Delta);
+
+		ASSERT_TRUE(client.sendKey(0x7, true));
+		size_t applied = 0;
+		for (int i = 0; i < 200 && applied == 0; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			applied = server.pollInput(chip8);
+		}
+		ASSERT_EQ(applied, 1u);
+		ASSERT_TRUE(chip8.isKeyPressed(0x7));
+		server.publish(chip8);
+		while (client.getInputLatency().samples == 0)
+			ASSERT_TRUE(client.receiveFrame(1.0));
+		ASSERT_GT(client.getInputLatency().last, 0.0);
+		ASSERT_EQ(client.getStatistics().sequenceErrors, 0u);
+
+		const auto statistics = server.getStatistics();
+		ASSERT_GE(statistics.framesSent, 3u);
+		ASSERT_GE(statistics.keyframesSent, 1u);
+		ASSERT_EQ(statistics.keyEventsReceived, 1u);
+	}
+
+	TEST(StreamServerTest, StreamsOverWebSockets) {
+		StreamServer server(0);
+		WebSocketTestClient client(server.getPort());
+		client.send("GET /stream HTTP/1.1\r\n"
+			"Host: 127.0.0.1\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+			"Sec-WebSocket-Version: 13\r\n\r\n");
+		const auto response = client.receiveResponse();
+		ASSERT_EQ(response.rfind("HTTP/1.1 101 Switching Protocols\r\n", 0), 0u) << response;
+		ASSERT_NE(response.find("\r\nSec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"), std::string::npos) << response;
+
+		// the first binary frame is a keyframe
+		Chip8::Chip8 chip8;
+		const std::array<uint8_t, 6> rom = { 0x60, 0x05, 0xF0, 0x29, 0xD0, 0x05 };
+		chip8.loadROM(rom.data(), rom.size());
+		for (int i = 0; i < 3; ++i)
+			chip8.step();
+		server.publish(chip8);
+		auto frame = client.receiveFrame();
+		ASSERT_TRUE(frame);
+		ASSERT_EQ(frame->first, 0x2);
+		FrameDecoder decoder;
+		ASSERT_TRUE(decoder.decode(frame->second.data(), frame->second.size()));
+		ASSERT_EQ(decoder.getLastFrameType(), StreamMessageType::Keyframe);
+		ASSERT_EQ(decoder.getDisplay(), chip8.getPackedDisplay());
+
+		// a masked key event reaches the emulator and is echoed in the next frame
+		std::vector<uint8_t> message;
+		encodeKeyEvent({ 0x7, true, 42 }, message);
+		client.sendFrame(0x2, message);
+		size_t applied = 0;
+		for (int i = 0; i < 200 && applied == 0; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			applied = server.pollInput(chip8);
+		}
+		ASSERT_EQ(applied, 1u);
+		ASSERT_TRUE(chip8.isKeyPressed(0x7));
+		server.publish(chip8);
+		frame = client.receiveFrame();
+		ASSERT_TRUE(frame);
+		ASSERT_TRUE(decoder.decode(frame->second.data(), frame->second.size()));
+		ASSERT_EQ(decoder.getLastFrameType(), StreamMessageType::Delta);
+		ASSERT_EQ(decoder.getInputEcho(), 42);
+
+		// pings are answered with the same payload, control frames above 125 bytes close the connection
+		client.sendFrame(0x9, { 'p', 'i', 'n', 'g' });
+		frame = client.receiveFrame();
+		ASSERT_TRUE(frame);
+		ASSERT_EQ(frame->first, 0xA);
+		ASSERT_EQ(frame->second, (std::vector<uint8_t>{ 'p', 'i', 'n', 'g' }));
+		client.sendFrame(0x9, std::vector<uint8_t>(126, 0x55));
+		frame = client.receiveFrame();
+		ASSERT_TRUE(frame);
+		ASSERT_EQ(frame->first, 0x8);
+		ASSERT_EQ(frame->second, (std::vector<uint8_t>{ 0x03, 0xEA })); // 1002: protocol error
+		ASSERT_FALSE(client.receiveFrame());
+	}
+
+	TEST(StreamServerTest, RejectsInvalidWebSocketUpgrades) {
+		StreamServer server(0);
+		// returns the response and whether the connection has been closed afterwards
+		const auto requestUpgrade = [&server](const std::string& requestLine, const std::string& headers) {
+			WebSocketTestClient client(server.getPort());
+			client.send(requestLine + "\r\nHost: 127.0.0.1\r\n" + headers + "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n");
+			const auto response = client.receiveResponse();
+			uint8_t byte;
+			return std::make_pair(response, !client.receive(&byte, 1, 100));
+		};
+		const auto isRejected = [&requestUpgrade](const std::string& requestLine, const std::string& headers) {
+			const auto [response, closed] = requestUpgrade(requestLine, headers);
+			return response.rfind("HTTP/1.1 400 ", 0) == 0 && closed;
+		};
+		const std::string upgrade = "Upgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n";
+		ASSERT_EQ(requestUpgrade("GET / HTTP/1.1", upgrade + "Sec-WebSocket-Version: 13\r\n").first.rfind("HTTP/1.1 101 ", 0), 0u);
+		ASSERT_TRUE(isRejected("GET / HTTP/1.0", upgrade + "Sec-WebSocket-Version: 13\r\n"));
+		ASSERT_TRUE(isRejected("GET  HTTP/1.1", upgrade + "Sec-WebSocket-Version: 13\r\n"));
+		ASSERT_TRUE(isRejected("GET / HTTP/1.1", "Connection: Upgrade\r\nSec-WebSocket-Version: 13\r\n"));
+		ASSERT_TRUE(isRejected("GET / HTTP/1.1", "Upgrade: websocket\r\nSec-WebSocket-Version: 13\r\n"));
+		ASSERT_TRUE(isRejected("GET / HTTP/1.1", upgrade + "Broken header\r\n"));
+		const auto [response, closed] = requestUpgrade("GET / HTTP/1.1", upgrade + "Sec-WebSocket-Version: 8\r\n");
+		ASSERT_EQ(response.rfind("HTTP/1.1 426 ", 0), 0u) << response;
+		ASSERT_NE(response.find("\r\nSec-WebSocket-Version: 13\r\n"), std::string::npos) << response;
+		ASSERT_TRUE(closed);
+	}
+
+	TEST(StreamServerTest, ClosesClientsWithoutHandshake) {
+		StreamServer server(0, "127.0.0.1", 60, std::chrono::milliseconds(50));
+		WebSocketTestClient silentClient(server.getPort());
+		WebSocketTestClient incompleteClient(server.getPort());
+		incompleteClient.send("GET / HTTP/1.1\r\n");
+		uint8_t byte;
+		ASSERT_FALSE(silentClient.receive(&byte, 1, 2000));
+		ASSERT_FALSE(incompleteClient.receive(&byte, 1, 2000));
+		for (int i = 0; i < 200 && server.getClientCount() > 0; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		ASSERT_EQ(server.getClientCount(), 0u);
+	}
+#endif
+}
+
+#ifdef CHIP8_ENABLE_PROFILING
+namespace {
+	TEST(ProfilerTest, CountsExecutionsPerOpcode) {
+		Chip8::Chip8 chip8;
+		chip8.loadROM(SessionCounterRom.data(), SessionCounterRom.size());
+		Profiler profiler;
+		chip8.setProfiler(&profiler);
+		for (int i = 0; i < 4 * 10; ++i)
+			chip8.step();
+		chip8.setProfiler(nullptr);
+		chip8.step(); // not recorded anymore
+
+		ASSERT_EQ(profiler.getTotalExecutions(), 40u);
+		for (const char* name : { "7XNN", "ANNN", "FX55", "1NNN" }) {
+			const size_t opcodeIndex = getOpcodeIndex(std::get<1>(*std::find_if(Opcodes.begin(), Opcodes.end(),
+				[name](const auto& opcode) { return std::string(std::get<0>(opcode)) == name; })));
+			ASSERT_STREQ(Profiler::getOpcodeName(opcodeIndex), name);
+			const auto& statistics = profiler.getOpcodeStatistics(opcodeIndex);
+			ASSERT_EQ(statistics.executions, 10u);
+			ASSERT_EQ(std::accumulate(statistics.histogram.begin(), statistics.histogram.end(), uint64_t{ 0 }), 10u);
+		}
+		ASSERT_EQ(profiler.getOpcodeStatistics(Opcodes.size()).executions, 0u);
+		ASSERT_STREQ(Profiler::getOpcodeName(Opcodes.size()), "unknown");
+
+		std::ostringstream output;
+		profiler.writeJson(output);
+		std::string error;
+		const auto document = parseJson(output.str(), error);
+		ASSERT_TRUE(document) << error;
+		ASSERT_EQ((*document)["total_executions"].asNumber(), 40.0);
+		ASSERT_EQ((*document)["opcodes"].asArray().size(), Profiler::OpcodeCount);
+		ASSERT_EQ((*document)["opcodes"].asArray()[23]["opcode"].asString(), "DXYN");
+
+		profiler.reset();
+		ASSERT_EQ(profiler.getTotalExecutions(), 0u);
+		ASSERT_EQ(profiler.getTotalTime(), 0u);
+	}
+
+	TEST(ProfilerTest, RecordsHeatMap) {
+		// a subroutine at 0x208 is called three times, then the program idles at 0x206
+		const std::array<uint8_t, 12> rom = { 0x22, 0x08, 0x30, 0x03, 0x12, 0x00, 0x12, 0x06, 0x70, 0x01, 0x00, 0xEE };
+		Chip8::Chip8 chip8;
+		chip8.loadROM(rom.data(), rom.size());
+		Profiler profiler;
+		chip8.setProfiler(&profiler);
+		for (int i = 0; i < 2 * 5 + 4 + 10; ++i)
+			chip8.step();
+
+		const auto& counts = profiler.getAddressCounts();
+		ASSERT_EQ(counts[0x200], 3u);
+		ASSERT_EQ(counts[0x204], 2u);
+		ASSERT_EQ(counts[0x206], 10u);
+		ASSERT_EQ(counts[0x20A], 3u);
+		ASSERT_EQ(std::accumulate(counts.begin(), counts.end(), uint64_t{ 0 }), 24u);
+		ASSERT_EQ(profiler.getHotAddresses(3), (std::vector<uint16_t>{ 0x206, 0x200, 0x202 }));
+		ASSERT_EQ(profiler.getHotAddresses(100).size(), 6u);
+
+		std::ostringstream heatMap;
+		profiler.writeHeatMapCsv(heatMap);
+		ASSERT_EQ(heatMap.str(), "200,3\n202,3\n204,2\n206,10\n208,3\n20A,3\n");
+		// the format of the caller's stream is neither used nor changed
+		std::ostringstream formatted;
+		formatted << std::hex << std::setfill('*');
+		profiler.writeHeatMapCsv(formatted);
+		formatted << std::setw(3) << 10;
+		ASSERT_EQ(formatted.str(), heatMap.str() + "**a");
+		profiler.reset();
+		ASSERT_TRUE(profiler.getHotAddresses(10).empty());
+	}
+}
+#endif
+
+namespace {
+	TEST(ProbesTest, CollectsEventsOfAllThreads) {
+		collectProbeEvents(); // discard the events of other tests
+		{
+			ScopedProbe probe("outer");
+			ScopedProbe innerProbe("inner");
+		}
+		std::thread([]() { ScopedProbe probe("worker"); }).join();
+		const auto events = collectProbeEvents();
+		ASSERT_EQ(events.size(), 3u);
+		ASSERT_STREQ(events[0].name, "outer"); // ordered by start time
+		ASSERT_STREQ(events[1].name, "inner");
+		ASSERT_STREQ(events[2].name, "worker");
+		ASSERT_GE(events[0].duration, events[1].duration);
+		ASSERT_EQ(events[0].thread, events[1].thread);
+		ASSERT_NE(events[0].thread, events[2].thread);
+		ASSERT_TRUE(collectProbeEvents().empty());
+
+		std::ostringstream trace;
+		writeChromeTrace(trace, events);
+		std::string error;
+		const auto document = parseJson(trace.str(), error);
+		ASSERT_TRUE(document) << error;
+		const auto& traceEvents = (*document)["traceEvents"].asArray();
+		ASSERT_EQ(traceEvents.size(), 3u + 2u); // and the names of both threads
+		ASSERT_EQ(traceEvents[0]["ph"].asString(), "X");
+		ASSERT_EQ(traceEvents[0]["ts"].asNumber(), 0.0);
+		ASSERT_EQ(traceEvents[3]["ph"].asString(), "M");
+	}
+
+	TEST(ProbesTest, DropsEventsWhenFull) {
+		ProbeBuffer buffer(7);
+		for (size_t i = 0; i < ProbeBuffer::Capacity; ++i)
+			ASSERT_TRUE(buffer.push("probe", static_cast<int64_t>(i), 1));
+		ASSERT_FALSE(buffer.push("probe", 0, 1));
+		ASSERT_EQ(buffer.getDroppedCount(), 1u);
+		std::vector<ProbeEvent> events;
+		ASSERT_EQ(buffer.drain(events), ProbeBuffer::Capacity);
+		ASSERT_EQ(events.back().start, static_cast<int64_t>(ProbeBuffer::Capacity - 1));
+		ASSERT_EQ(events.back().thread, 7u);
+		ASSERT_TRUE(buffer.push("probe", 0, 1));
+	}
+
+	TEST(ProbesTest, ComputesRollingPercentiles) {
+		std::vector<double> values = { 5.0, 1.0, 4.0, 2.0, 3.0 };
+		ASSERT_EQ(getPercentile(values, 50.0), 3.0);
+		ASSERT_EQ(getPercentile(values, 99.0), 5.0);
+		ASSERT_EQ(getPercentile(values, 0.0), 1.0);
+
+		ProbeStatistics statistics(100, 2);
+		std::vector<ProbeEvent> events;
+		for (int64_t i = 1; i <= 100; ++i)
+			events.push_back({ "frame", 0, i * 1'000'000, 0 });
+		statistics.add(events);
+		statistics.update();
+		statistics.update();
+		statistics.update();
+		const auto& series = statistics.getSeries().at("frame");
+		ASSERT_EQ(series.p50.size(), 2u);
+		ASSERT_FLOAT_EQ(series.p50.back(), 50.f);
+		ASSERT_FLOAT_EQ(series.p95.back(), 95.f);
+		ASSERT_FLOAT_EQ(series.p99.back(), 99.f);
+	}
+}
+
+namespace {
+	TEST(InstructionTraceTest, EncodesAndDecodesBlocks) {
+		std::vector<TraceRecord> records;
+		for (uint16_t i = 0; i < 100; ++i)
+			records.push_back({ 1000u + i, gsl::narrow_cast<uint16_t>(0x200 + 2 * i), 0x7101, 0x300, 0x1, gsl::narrow_cast<uint8_t>(i) });
+		records.push_back({ 5000, 0x204, 0xA456, 0x456, TraceRecord::NoRegister, 0 }); // jump in cycle and address
+		records.push_back({ 5001, 0x206, 0xF00A, 0x456, 0xF, 0xFF });
+
+		std::vector<uint8_t> block;
+		encodeTraceBlock(records.data(), records.size(), block);
+		ASSERT_EQ(block[0], records.size()); // the header holds the record count and the encoded size
+		ASSERT_EQ(block.size() - 8, static_cast<size_t>(block[4] | (block[5] << 8)));
+		ASSERT_LT(block.size(), records.size() * 6);
+		std::vector<TraceRecord> decoded;
+		ASSERT_TRUE(decodeTraceBlock(block.data() + 8, block.size() - 8, records.size(), decoded));
+		ASSERT_EQ(decoded, records);
+
+		decoded.clear();
+		ASSERT_FALSE(decodeTraceBlock(block.data() + 8, block.size() - 9, records.size(), decoded));
+		decoded.clear();
+		ASSERT_FALSE(decodeTraceBlock(block.data() + 8, block.size() - 8, records.size() - 1, decoded));
+
+		// a block size beyond the end of the file is rejected before anything is allocated
+		const std::string filename = "test_corrupt.c8trace";
+		for (const uint8_t sizeByte : { uint8_t{ 0x10 }, uint8_t{ 0x7F } }) {
+			{
+				std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+				const std::array<uint8_t, 13> header = { 'C', '8', 'T', 'R', 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, sizeByte };
+				output.write(reinterpret_cast<const char*>(header.data()), header.size());
+				output.write(reinterpret_cast<const char*>(block.data() + 8), static_cast<std::streamsize>(block.size() - 8));
+			}
+			TraceReader reader;
+			ASSERT_TRUE(reader.open(filename));
+			TraceRecord record;
+			ASSERT_FALSE(reader.next(record));
+			ASSERT_TRUE(reader.hasError());
+		}
+		std::remove(filename.c_str());
+	}
+
+#ifdef CHIP8_ENABLE_PROFILING
+	TEST(InstructionTraceTest, TracesEmulator) {
+		const std::string filename = "test_trace.c8trace";
+		const size_t stepCount = 2 * InstructionTracer::BlockSize + 10;
+		{
+			Chip8::Chip8 chip8;
+			chip8.loadROM(SessionCounterRom.data(), SessionCounterRom.size());
+			InstructionTracer tracer(filename);
+			chip8.setTracer(&tracer);
+			for (size_t i = 0; i < stepCount; ++i)
+				chip8.step();
+			chip8.setTracer(nullptr);
+			chip8.step(); // not recorded anymore
+			tracer.flush();
+			ASSERT_EQ(tracer.getRecordCount(), stepCount);
+			ASSERT_LT(tracer.getBytesWritten(), stepCount * 4);
+		}
+
+		TraceReader reader;
+		ASSERT_TRUE(reader.open(filename));
+		TraceRecord record;
+		size_t count = 0;
+		const std::array<uint16_t, 4> instructions = { 0x7001, 0xA300, 0xF055, 0x1200 };
+		while (reader.next(record)) {
+			ASSERT_EQ(record.cycle, count + 1);
+			ASSERT_EQ(record.address, 0x200 + 2 * (count % 4));
+			ASSERT_EQ(record.instruction, instructions[count % 4]);
+			ASSERT_EQ(record.addressRegister, (count == 0 ? 0x000 : 0x300));
+			ASSERT_EQ(record.changedRegister, (count % 4 == 0 ? 0x0 : TraceRecord::NoRegister));
+			ASSERT_EQ(record.value, (count % 4 == 0 ? gsl::narrow_cast<uint8_t>(count / 4 + 1) : 0));
+			++count;
+		}
+		ASSERT_FALSE(reader.hasError());
+		ASSERT_EQ(count, stepCount);
+
+		// a truncated file is read up to the last complete block
+		{
+			std::ifstream input(filename, std::ios::binary);
+			const std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+			input.close();
+			std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+			output.write(contents.data(), static_cast<std::streamsize>(contents.size() - 3));
+		}
+		ASSERT_TRUE(reader.open(filename));
+		count = 0;
+		while (reader.next(record))
+			++count;
+		ASSERT_TRUE(reader.hasError());
+		ASSERT_EQ(count, 2 * InstructionTracer::BlockSize);
+		std::remove(filename.c_str());
+		ASSERT_FALSE(reader.open(filename));
+	}
+#endif
+}
+
+#ifdef CHIP8_ENABLE_PROFILING
+namespace {
+	TEST(MemoryProfilerTest, ClassifiesRegionsAndFindsSelfModifyingCode) {
+		// writes JP 0x210 to 0x210, draws and reads the sprite at 0x214 and then runs into the written loop
+		const std::array<uint8_t, 22> rom = {
+			0x60, 0x12, 0x61, 0x10, 0xA2, 0x10, 0xF1, 0x55, 0xA2, 0x14, 0xD0, 0x11, 0xF1, 0x65, 0x60, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0xFF, 0x00
+		};
+		Chip8::Chip8 chip8;
+		chip8.loadROM(rom.data(), rom.size());
+		MemoryProfiler profiler;
+		chip8.setMemoryProfiler(&profiler);
+		for (int i = 0; i < 8 + 5; ++i)
+			ASSERT_TRUE(chip8.step());
+
+		ASSERT_EQ(profiler.getAddressStatistics(0x210).writes, 1u);
+		ASSERT_EQ(profiler.getAddressStatistics(0x210).executions, 5u);
+		ASSERT_EQ(profiler.getAddressStatistics(0x214).spriteReads, 1u);
+		ASSERT_EQ(profiler.getAddressStatistics(0x214).reads, 1u);
+		ASSERT_EQ(profiler.getAddressStatistics(0x215).reads, 1u);
+		ASSERT_EQ(profiler.getRegion(0x200), MemoryProfiler::Region::Code);
+		ASSERT_EQ(profiler.getRegion(0x211), MemoryProfiler::Region::Code);
+		ASSERT_EQ(profiler.getRegion(0x212), MemoryProfiler::Region::Unused);
+		ASSERT_EQ(profiler.getRegion(0x214), MemoryProfiler::Region::Sprite);
+		ASSERT_EQ(profiler.getRegion(0x215), MemoryProfiler::Region::Data);
+		ASSERT_EQ(profiler.getRegionSizes(), (std::array<size_t, MemoryProfiler::RegionCount>{ MemoryProfiler::AddressCount - 20, 18, 1, 1 }));
+
+		const auto selfModifyingCode = profiler.getSelfModifyingCode();
+		ASSERT_EQ(selfModifyingCode.size(), 1u);
+		ASSERT_EQ(selfModifyingCode[0].address, 0x210);
+		ASSERT_EQ(selfModifyingCode[0].writes, 2u);
+		ASSERT_EQ(selfModifyingCode[0].executionsAfterWrite, 5u);
+		ASSERT_EQ(selfModifyingCode[0].firstWriteCycle, 4u);
+		ASSERT_EQ(selfModifyingCode[0].firstModifiedExecutionCycle, 9u);
+
+		std::ostringstream report;
+		profiler.writeReportJson(report);
+		std::string error;
+		const auto document = parseJson(report.str(), error);
+		ASSERT_TRUE(document) << error;
+		ASSERT_EQ((*document)["regions"]["code"].asNumber(), 18.0);
+		ASSERT_EQ((*document)["self_modifying_code"].asArray()[0]["address"].asString(), "210");
+
+		profiler.reset();
+		ASSERT_TRUE(profiler.getSelfModifyingCode().empty());
+		ASSERT_EQ(profiler.getRegion(0x200), MemoryProfiler::Region::Unused);
+	}
+}
+#endif
+
+namespace {
+	TEST(DisassemblerTest, DisassemblesAllOpcodes) {
+		ASSERT_EQ(disassemble(0x00E0), "CLS");
+		ASSERT_EQ(disassemble(0x00EE), "RET");
+		ASSERT_EQ(disassemble(0x1234), "JP 0x234");
+		ASSERT_EQ(disassemble(0x3A0F), "SE VA, 0x0F");
+		ASSERT_EQ(disassemble(0x8AB4), "ADD VA, VB");
+		ASSERT_EQ(disassemble(0xB300), "JP V0, 0x300");
+		ASSERT_EQ(disassemble(0xD125), "DRW V1, V2, 5");
+		ASSERT_EQ(disassemble(0xF355), "LD [I], V3");
+		ASSERT_EQ(disassemble(0xF365), "LD V3, [I]");
+		ASSERT_EQ(disassemble(0x5AB1), "DW 0x5AB1");
+		for (const auto& opcode : Opcodes)
+			ASSERT_EQ(disassemble(std::get<1>(opcode)).rfind("DW", 0), std::string::npos) << std::get<0>(opcode);
+	}
+
+	TEST(DisassemblerTest, UpdatesListingIncrementally) {
+		Chip8Memory<uint8_t> memory;
+		const std::array<uint8_t, 4> program{ 0x12, 0x00, 0x00, 0xE0 };
+		memory.writeBlock(0x200, program.data(), program.size());
+		DisassemblyListing listing;
+		ASSERT_EQ(listing.update(memory), DisassemblyListing::AddressCount);
+		ASSERT_EQ(listing.getLine(0x200), "JP 0x200");
+		ASSERT_EQ(listing.getLine(0x201), "SYS 0x000");
+		ASSERT_EQ(listing.getLine(0x202), "CLS");
+		ASSERT_EQ(listing.getInstruction(0x202).getValue(), 0x00E0);
+		ASSERT_EQ(listing.update(memory), 0u);
+
+		// a changed byte affects its own line and the previous one
+		memory.write(0x201, 0x04);
+		ASSERT_EQ(listing.update(memory), 2u);
+		ASSERT_EQ(listing.getLine(0x200), "JP 0x204");
+		ASSERT_EQ(listing.getLine(0x201), "SYS 0x400");
+		memory.write(0x3FF, 0x00); // writes that do not change the value are not disassembled again
+		ASSERT_EQ(listing.update(memory), 0u);
+		memory.write(0xFFF, 0xA1);
+		ASSERT_EQ(listing.update(memory), 2u);
+		ASSERT_EQ(listing.getLine(0xFFF), "LD I, 0x100");
+
+		listing.invalidate();
+		ASSERT_EQ(listing.update(memory), DisassemblyListing::AddressCount);
+	}
+}
+
+namespace {
+	TEST(DebuggerTest, CompilesConditions) {
+		Chip8::Chip8 chip8;
+		chip8.setRegister(0x3, 0x10);
+		std::string error;
+		const auto condition = compileCondition("v3 == 0x10 && PC > 512 || VA != 0", error);
+		ASSERT_TRUE(condition) << error;
+		ASSERT_FALSE((*condition)(chip8)); // PC is 0x200
+		chip8.setRegister(0xA, 1);
+		ASSERT_TRUE((*condition)(chip8));
+		ASSERT_TRUE((*compileCondition("I <= 0 && DT >= 0 && ST < 1", error))(chip8));
+
+		ASSERT_FALSE(compileCondition("V3 ==", error));
+		ASSERT_EQ(error, "missing operand at the end");
+		ASSERT_FALSE(compileCondition("VG == 1", error));
+		ASSERT_EQ(error, "unknown operand 'VG'");
+		ASSERT_FALSE(compileCondition("V3 = 1", error));
+		ASSERT_FALSE(compileCondition("V3 == 0x10000", error));
+		ASSERT_FALSE(compileCondition("V3 == 1 &&", error));
+		ASSERT_FALSE(compileCondition("V3 == 1 V4", error));
+		ASSERT_FALSE(compileCondition("", error));
+
+		Debugger debugger;
+		ASSERT_TRUE(debugger.isEmpty());
+		ASSERT_FALSE(debugger.setBreakpoint(0x200, "V3 >", error));
+		ASSERT_TRUE(debugger.isEmpty());
+		ASSERT_TRUE(debugger.setBreakpoint(0x200, "V3 > 2", error));
+		ASSERT_EQ(debugger.getCondition(0x200), "V3 > 2");
+		debugger.setBreakpoint(0x202);
+		ASSERT_EQ(debugger.getBreakpoints(), (std::vector<uint16_t>{ 0x200, 0x202 }));
+		ASSERT_EQ(debugger.getCondition(0x202), "");
+	}
+}
+
+#ifdef CHIP8_ENABLE_PROFILING
+namespace {
+	TEST(DebuggerTest, StopsAtBreakpointsAndWatchpoints) {
+		// V0 = 5, I = 0x300, then V0 += 1 and its BCD is stored at I in a loop
+		const std::array<uint8_t, 10> rom = { 0x60, 0x05, 0xA3, 0x00, 0x70, 0x01, 0xF0, 0x33, 0x12, 0x04 };
+		Chip8::Chip8 chip8;
+		chip8.loadROM(rom.data(), rom.size());
+		Debugger debugger;
+		debugger.attach(&chip8);
+		std::string error;
+		ASSERT_TRUE(debugger.setBreakpoint(0x208, "V0 == 8", error)) << error;
+		const auto runUntilStop = [&]() {
+			for (int i = 0; i < 100; ++i) {
+				EXPECT_TRUE(chip8.step());
+				if (auto stop = debugger.takeStop())
+					return stop;
+			}
+			return std::optional<Debugger::Stop>{};
+		};
+
+		auto stop = runUntilStop();
+		ASSERT_TRUE(stop);
+		ASSERT_EQ(stop->reason, Debugger::StopReason::Breakpoint);
+		ASSERT_EQ(stop->address, 0x206);
+		ASSERT_EQ(stop->target, 0x208);
+		ASSERT_EQ(stop->cycle, 10u);
+		ASSERT_EQ(chip8.getRegister(0x0), 8);
+
+		debugger.removeBreakpoint(0x208);
+		debugger.setMemoryWatch(0x302, 1, true);
+		stop = runUntilStop();
+		ASSERT_TRUE(stop);
+		ASSERT_EQ(stop->reason, Debugger::StopReason::MemoryWatch);
+		ASSERT_EQ(stop->address, 0x206);
+		ASSERT_EQ(stop->target, 0x302);
+		ASSERT_EQ(chip8.getMemory().read(0x302), 9);
+
+		debugger.setMemoryWatch(0x302, 1, false);
+		debugger.setRegisterWatch(0x0, true);
+		stop = runUntilStop();
+		ASSERT_TRUE(stop);
+		ASSERT_EQ(stop->reason, Debugger::StopReason::RegisterWatch);
+		ASSERT_EQ(stop->address, 0x204);
+		ASSERT_EQ(stop->target, 0x0);
+
+		debugger.clear();
+		ASSERT_TRUE(debugger.isEmpty());
+		for (int i = 0; i < 10; ++i)
+			ASSERT_TRUE(chip8.step());
+		ASSERT_FALSE(debugger.takeStop());
+	}
+
+	TEST(DebuggerTest, StopsAtTheFirstInstruction) {
+		const std::array<uint8_t, 4> rom = { 0x60, 0x05, 0x12, 0x00 };
+		Chip8::Chip8 chip8;
+		Debugger debugger;
+		debugger.attach(&chip8);
+		debugger.setBreakpoint(0x200);
+		chip8.loadROM(rom.data(), rom.size());
+
+		// the first step stops before the instruction is executed
+		ASSERT_TRUE(chip8.step());
+		auto stop = debugger.takeStop();
+		ASSERT_TRUE(stop);
+		ASSERT_EQ(stop->reason, Debugger::StopReason::Breakpoint);
+		ASSERT_EQ(stop->address, 0x200);
+		ASSERT_EQ(stop->target, 0x200);
+		ASSERT_EQ(stop->cycle, 0u);
+		ASSERT_EQ(chip8.getProgramCounter(), 0x200);
+		ASSERT_EQ(chip8.getCycleCount(), 0u);
+		ASSERT_EQ(chip8.getRegister(0x0), 0);
+
+		// continuing executes it, and the jump back reaches the breakpoint as usual
+		ASSERT_TRUE(chip8.step());
+		ASSERT_FALSE(debugger.takeStop());
+		ASSERT_EQ(chip8.getRegister(0x0), 5);
+		ASSERT_TRUE(chip8.step());
+		stop = debugger.takeStop();
+		ASSERT_TRUE(stop);
+		ASSERT_EQ(stop->address, 0x202);
+		ASSERT_EQ(stop->cycle, 2u);
+
+		// a condition is checked at the entry, too
+		std::string error;
+		ASSERT_TRUE(debugger.setBreakpoint(0x200, "V0 == 5", error)) << error;
+		chip8.loadROM(rom.data(), rom.size());
+		ASSERT_TRUE(chip8.step());
+		ASSERT_FALSE(debugger.takeStop());
+		ASSERT_EQ(chip8.getCycleCount(), 1u);
+	}
+}
+#endif
+
+namespace {
+	// the history runs the program of DeterminismTest
+	class ExecutionHistoryTest : public DeterminismTest {};
+
+	TEST_F(ExecutionHistoryTest, RestoresPastCycles) {
+		chip8.reset();
+		writeProgram();
+		chip8.seedRandom(42);
+		ExecutionHistory history(ExecutionHistory::DefaultMemoryBudget, 64);
+		history.start(chip8);
+		std::default_random_engine generator(7);
+		std::uniform_int_distribution<int> distribution(0x0, 0xF);
+		std::vector<std::pair<uint64_t, ::Chip8::Chip8::State>> expectedStates;
+		for (int frame = 0; frame < 300; frame++) {
+			if (frame % 5 == 0)
+				chip8.triggerKeyDown(gsl::narrow<uint8_t>(distribution(generator)));
+			if (frame % 7 == 0)
+				chip8.triggerKeyUp(gsl::narrow<uint8_t>(distribution(generator)));
+			for (int i = 0; i < 9; i++) {
+				chip8.step();
+				history.update(chip8);
+				if (chip8.getCycleCount() % 37 == 0 || frame == 150) {
+					expectedStates.emplace_back(chip8.getCycleCount(), ::Chip8::Chip8::State{});
+					chip8.saveState(expectedStates.back().second);
+				}
+			}
+			chip8.clockTimers();
+		}
+		ASSERT_GT(history.getCheckpointCount(), 40u);
+
+		// restoring a cycle discards the history after it, so the cycles are visited backwards
+		::Chip8::Chip8::State actual;
+		for (auto iterator = expectedStates.rbegin(); iterator != expectedStates.rend(); ++iterator) {
+			ASSERT_TRUE(history.seek(chip8, iterator->first));
+			chip8.saveState(actual);
+			ASSERT_EQ(actual, iterator->second) << "cycle " << iterator->first;
+		}
+		const uint64_t cycle = chip8.getCycleCount();
+		ASSERT_TRUE(history.stepBack(chip8));
+		ASSERT_EQ(chip8.getCycleCount(), cycle - 1);
+		ASSERT_FALSE(history.seek(chip8, cycle));
+		ASSERT_TRUE(history.seek(chip8, 0));
+		ASSERT_FALSE(history.stepBack(chip8));
+		ASSERT_EQ(history.getCheckpointCount(), 1u);
+	}
+
+	TEST_F(ExecutionHistoryTest, StaysWithinMemoryBudget) {
+		chip8.reset();
+		writeProgram();
+		constexpr size_t budget = 16u * 1024u;
+		ExecutionHistory history(budget, 16);
+		history.start(chip8);
+		for (int frame = 0; frame < 1000; frame++) {
+			for (int i = 0; i < 9; i++) {
+				chip8.step();
+				history.update(chip8);
+			}
+			chip8.clockTimers();
+			ASSERT_LE(history.getMemoryUsage(), budget);
+		}
+		ASSERT_GT(history.getFirstCycle(), 0u);
+		// the checkpoints are delta encoded, full states would not even fit four times
+		ASSERT_GT(history.getCheckpointCount(), 4 * budget / ::Chip8::Chip8::StateSize);
+		ASSERT_FALSE(history.seek(chip8, history.getFirstCycle() - 1));
+		ASSERT_TRUE(history.seek(chip8, history.getFirstCycle()));
+	}
+
+#ifdef CHIP8_ENABLE_PROFILING
+	TEST_F(ExecutionHistoryTest, RunsBackToStopsAndWrites) {
+		// the loop of DebuggerTest.StopsAtBreakpointsAndWatchpoints with V0 starting at 5
+		const std::array<uint8_t, 10> rom = { 0x60, 0x05, 0xA3, 0x00, 0x70, 0x01, 0xF0, 0x33, 0x12, 0x04 };
+		chip8.loadROM(rom.data(), rom.size());
+		ExecutionHistory history(ExecutionHistory::DefaultMemoryBudget, 16);
+		history.start(chip8);
+		for (int i = 0; i < 100; ++i) {
+			ASSERT_TRUE(chip8.step());
+			history.update(chip8);
+		}
+
+		// the last FX33 wrote V0 = 38 (+1 per three cycles)
+		ASSERT_TRUE(history.runBackToLastWrite(chip8, 0x302));
+		ASSERT_EQ(chip8.getProgramCounter(), 0x206);
+		ASSERT_EQ(chip8.getRegister(0x0), 38);
+		ASSERT_EQ(chip8.getCycleCount(), 99u);
+		ASSERT_TRUE(history.runBackToLastWrite(chip8, 0x302));
+		ASSERT_EQ(chip8.getRegister(0x0), 37);
+		ASSERT_FALSE(history.runBackToLastWrite(chip8, 0x303));
+
+		Debugger debugger;
+		debugger.attach(&chip8);
+		std::string error;
+		ASSERT_TRUE(debugger.setBreakpoint(0x208, "V0 == 8 || V0 == 20", error)) << error;
+		ASSERT_TRUE(history.reverseContinue(chip8, debugger));
+		ASSERT_EQ(chip8.getProgramCounter(), 0x208);
+		ASSERT_EQ(chip8.getRegister(0x0), 20);
+		ASSERT_TRUE(history.reverseContinue(chip8, debugger));
+		ASSERT_EQ(chip8.getRegister(0x0), 8);
+		ASSERT_EQ(chip8.getCycleCount(), 10u);
+		ASSERT_FALSE(history.reverseContinue(chip8, debugger));
+		ASSERT_EQ(chip8.getCycleCount(), 10u);
+		ASSERT_FALSE(debugger.takeStop());
+
+		// running forwards again records a new future
+		for (int i = 0; i < 40; ++i) {
+			ASSERT_TRUE(chip8.step());
+			history.update(chip8);
+		}
+		debugger.takeStop();
+		ASSERT_TRUE(history.reverseContinue(chip8, debugger));
+		ASSERT_EQ(chip8.getRegister(0x0), 20);
+	}
+
+	TEST_F(ExecutionHistoryTest, DoesNotRecordReplaysTwice) {
+		const std::array<uint8_t, 10> rom = { 0x60, 0x05, 0xA3, 0x00, 0x70, 0x01, 0xF0, 0x33, 0x12, 0x04 };
+		chip8.loadROM(rom.data(), rom.size());
+		InputMovie movie;
+		movie.startRecording(chip8);
+		Profiler profiler;
+		chip8.setProfiler(&profiler);
+		ExecutionHistory history(ExecutionHistory::DefaultMemoryBudget, 100);
+		history.start(chip8);
+		for (int i = 1; i <= 3000; ++i) {
+			ASSERT_TRUE(chip8.step());
+			if (i % 10 == 0)
+				chip8.clockTimers();
+			if (i % 500 == 0)
+				chip8.triggerKeyDown(0x5);
+			history.update(chip8);
+		}
+		const auto events = movie.getEvents();
+		ASSERT_EQ(profiler.getTotalExecutions(), 3000u);
+
+		// the replays neither add events to the movie nor instructions to the profiler
+		ASSERT_TRUE(history.stepBack(chip8));
+		ASSERT_EQ(chip8.getCycleCount(), 2999u);
+		Debugger debugger;
+		debugger.attach(&chip8);
+		std::string error;
+		ASSERT_TRUE(debugger.setBreakpoint(0x208, "V0 == 20", error)) << error;
+		ASSERT_TRUE(history.reverseContinue(chip8, debugger));
+		ASSERT_EQ(chip8.getRegister(0x0), 20);
+		ASSERT_EQ(movie.getEvents().size(), events.size());
+		ASSERT_TRUE(std::equal(events.begin(), events.end(), movie.getEvents().begin(),
+			[](const InputMovie::Event& a, const InputMovie::Event& b) { return a.cycle == b.cycle && a.type == b.type && a.key == b.key; }));
+		ASSERT_EQ(profiler.getTotalExecutions(), 3000u);
+		ASSERT_EQ(chip8.getInputRecorder(), &movie);
+		ASSERT_EQ(chip8.getProfiler(), &profiler);
+		ASSERT_EQ(chip8.getDebugger(), &debugger);
+	}
+#endif
+}
+
+namespace {
+	TEST(ControlFlowTest, SeparatesCodeFromData) {
+		Chip8Memory<uint8_t> memory;
+		const std::array<uint8_t, 37> program{
+			0xA2, 0x20, // 200: LD I, 0x220
+			0xD0, 0x15, // 202: DRW V0, V1, 5
+			0x22, 0x10, // 204: CALL 0x210
+			0x30, 0x01, // 206: SE V0, 0x01
+			0x12, 0x0C, // 208: JP 0x20C
+			0xB3, 0x00, // 20A: JP V0, 0x300
+			0x12, 0x0C, // 20C: JP 0x20C
+			0xFF, 0xFF, // 20E: data behind the loop
+			0x70, 0x01, // 210: ADD V0, 0x01
+			0x00, 0xEE, // 212: RET
+			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			0xF0, 0x90, 0x90, 0x90, 0xF0 // 220: the sprite of "0"
+		};
+		memory.writeBlock(0x200, program.data(), program.size());
+		const auto analysis = ControlFlowAnalysis::analyze(memory);
+
+		using Kind = ControlFlowAnalysis::ByteKind;
+		for (uint16_t address = 0x200; address < 0x20E; ++address)
+			ASSERT_EQ(analysis.getByteKind(address), Kind::Code);
+		ASSERT_EQ(analysis.getByteKind(0x20E), Kind::Unknown);
+		ASSERT_EQ(analysis.getByteKind(0x212), Kind::Code);
+		ASSERT_EQ(analysis.getByteKind(0x214), Kind::Unknown);
+		for (uint16_t address = 0x220; address < 0x225; ++address)
+			ASSERT_EQ(analysis.getByteKind(address), Kind::Sprite);
+		ASSERT_EQ(analysis.getByteKind(0x225), Kind::Unknown);
+		ASSERT_EQ(analysis.countBytes(Kind::Code), 18u);
+		ASSERT_EQ(analysis.countBytes(Kind::Sprite), 5u);
+		ASSERT_TRUE(analysis.isInstructionStart(0x202));
+		ASSERT_FALSE(analysis.isInstructionStart(0x203));
+
+		using Block = ControlFlowAnalysis::Block;
+		using Terminator = ControlFlowAnalysis::Terminator;
+		const std::vector<Block> expectedBlocks{
+			{ 0x200, 0x206, Terminator::Call, { 0x210, 0x206 } },
+			{ 0x206, 0x208, Terminator::Skip, { 0x208, 0x20A } },
+			{ 0x208, 0x20A, Terminator::Jump, { 0x20C } },
+			{ 0x20A, 0x20C, Terminator::IndirectJump, {} },
+			{ 0x20C, 0x20E, Terminator::Jump, { 0x20C } },
+			{ 0x210, 0x214, Terminator::Return, {} },
+		};
+		ASSERT_EQ(analysis.getBlocks(), expectedBlocks);
+		ASSERT_EQ(analysis.getIndirectJumps(), std::vector<uint16_t>{ 0x20A });
+		ASSERT_EQ(analysis.findBlock(0x202)->start, 0x200);
+		ASSERT_EQ(analysis.findBlock(0x20E), nullptr);
+
+		std::ostringstream dot;
+		analysis.writeDot(dot);
+		ASSERT_NE(dot.str().find("b200 -> b210;"), std::string::npos);
+		ASSERT_NE(dot.str().find("b200 -> b206 [style=dashed];"), std::string::npos);
+		ASSERT_NE(dot.str().find("202: DRW V0, V1, 5\\l"), std::string::npos);
+
+		const std::string filename = "test_control_flow.c8cfa";
+		ASSERT_TRUE(analysis.save(filename));
+		ControlFlowAnalysis loaded;
+		ASSERT_TRUE(loaded.load(filename, memory));
+		std::remove(filename.c_str());
+		ASSERT_EQ(loaded.getBlocks(), expectedBlocks);
+		ASSERT_EQ(loaded.getByteKind(0x220), Kind::Sprite);
+		ASSERT_TRUE(loaded.isInstructionStart(0x212));
+		std::ostringstream loadedDot;
+		loaded.writeDot(loadedDot);
+		ASSERT_EQ(loadedDot.str(), dot.str());
+		ASSERT_FALSE(loaded.load(filename, memory));
+	}
+
+	TEST(ControlFlowTest, CachesAnalysesByRomHash) {
+		const std::string directory = "test_control_flow_cache";
+		const auto hash = sha1("rom", 3);
+		Chip8Memory<uint8_t> memory;
+		const std::array<uint8_t, 2> program{ 0x12, 0x00 };
+		memory.writeBlock(0x200, program.data(), program.size());
+		ASSERT_EQ(ControlFlowAnalysis::analyzeCached(directory, hash, memory).getBlocks().size(), 1u);
+		ASSERT_TRUE(fs::exists(fs::path(directory) / (toHexString(hash) + ".c8cfa")));
+
+		// a ROM with the same hash is not analyzed again (a cleared memory would give a block that halts),
+		// but its disassembly is generated from the memory instead of being taken from the cache
+		memory.clear();
+		const auto cached = ControlFlowAnalysis::analyzeCached(directory, hash, memory);
+		ASSERT_EQ(cached.getBlocks().size(), 1u);
+		ASSERT_EQ(cached.getBlocks()[0].terminator, ControlFlowAnalysis::Terminator::Jump);
+		std::ostringstream dot;
+		cached.writeDot(dot);
+		ASSERT_NE(dot.str().find("200: " + disassemble(Instruction(0x0000)) + "\\l"), std::string::npos) << dot.str();
+		fs::remove_all(directory);
+	}
+}
+
+namespace {
+	// the queue drives the program of DeterminismTest
+	class InputQueueTest : public DeterminismTest {};
+
+	TEST_F(InputQueueTest, AppliesEventsAtTheirCycle) {
+		chip8.reset();
+		writeProgram();
+		InputQueue queue;
+		queue.push(0.0300, 0x7, true); // out of order
+		queue.push(0.0105, 0x5, true);
+		queue.push(0.0106, 0x5, false);
+		ASSERT_EQ(queue.size(), 3u);
+		InputMovie movie;
+		movie.startRecording(chip8);
+		// one instruction per millisecond
+		for (int i = 0; i < 40; i++) {
+			queue.apply(chip8, i * 0.001);
+			chip8.step();
+		}
+		movie.stopRecording(chip8);
+		ASSERT_EQ(queue.size(), 0u);
+
+		// the release within the same millisecond is held back for one instruction
+		const auto& events = movie.getEvents();
+		ASSERT_EQ(events.size(), 3u);
+		ASSERT_EQ(events[0].cycle, 11u);
+		ASSERT_EQ(events[0].type, InputMovie::EventType::KeyDown);
+		ASSERT_EQ(events[0].key, 0x5);
+		ASSERT_EQ(events[1].cycle, 12u);
+		ASSERT_EQ(events[1].type, InputMovie::EventType::KeyUp);
+		ASSERT_EQ(events[2].cycle, 30u);
+		ASSERT_EQ(events[2].key, 0x7);
+		ASSERT_TRUE(chip8.isKeyPressed(0x7));
+
+		queue.push(1.0, 0x7, false);
+		ASSERT_EQ(queue.flush(chip8), 1u);
+		ASSERT_FALSE(chip8.isKeyPressed(0x7));
+	}
+}
+
+namespace {
+	TEST(LatencyProbeTest, MeasuresInputLatency) {
+		::Chip8::Chip8 chip8;
+		chip8.loadROM(LatencyProbe::TestRom.data(), LatencyProbe::TestRom.size());
+		LatencyProbe probe(20, true, 50'000'000, 1);
+		// a frontend that polls its input at the start of every frame, executes 8 instructions (1 µs each)
+		// and presents the frame 5 ms later
+		constexpr int64_t frameInterval = 16'666'667;
+		int64_t frameStart = 1'000'000'000;
+		for (int frame = 0; frame < 1000 && !probe.isFinished(); ++frame, frameStart += frameInterval) {
+			if (const auto event = probe.poll(chip8, frameStart)) {
+				if (event->pressed)
+					chip8.triggerKeyDown(event->key);
+				else
+					chip8.triggerKeyUp(event->key);
+			}
+			for (int64_t i = 1; i <= 8; ++i) {
+				chip8.step();
+				probe.checkDisplay(chip8, frameStart + i * 1000);
+			}
+			probe.present(frameStart + 5'000'000);
+		}
+		ASSERT_TRUE(probe.isFinished());
+		ASSERT_EQ(probe.getTimeoutCount(), 0u);
+		ASSERT_EQ(probe.getSamples().size(), 20u);
+		for (const auto& sample : probe.getSamples()) {
+			ASSERT_GT(sample.displayTime, sample.pressTime);
+			ASSERT_LE(sample.displayTime - sample.pressTime, frameInterval + 8000);
+			ASSERT_GT(sample.presentTime - sample.displayTime, 4'990'000);
+			ASSERT_LT(sample.presentTime - sample.displayTime, 5'000'000);
+		}
+		const auto display = probe.getDisplayLatency();
+		const auto present = probe.getPresentLatency();
+		ASSERT_LE(display.p50, display.p95);
+		ASSERT_LE(display.p99, display.maximum);
+		ASSERT_NEAR(present.p50 - display.p50, 5.0, 0.01);
+		std::ostringstream report;
+		probe.printReport(report);
+		ASSERT_NE(report.str().find("20 samples, 0 timeouts"), std::string::npos);
+	}
+}
+
+namespace {
+	// overwrites the instruction at 0x204 with LD V2, 0x02 and executes it again
+	const std::array<uint8_t, 20> SelfModifyingRom{
+		0x60, 0x62, // 200: LD V0, 0x62
+		0x61, 0x02, // 202: LD V1, 0x02
+		0x62, 0x01, // 204: LD V2, 0x01
+		0x73, 0x01, // 206: ADD V3, 0x01
+		0x33, 0x02, // 208: SE V3, 0x02
+		0x12, 0x0E, // 20A: JP 0x20E
+		0x00, 0x00, // 20C: (halts)
+		0xA2, 0x04, // 20E: LD I, 0x204
+		0xF1, 0x55, // 210: LD [I], V1
+		0x12, 0x04, // 212: JP 0x204
+	};
+
+	// stands in for the translation of 0x204, but sets another value, so that the test can tell when it runs
+	bool translateLoadV2(AotRuntime::Machine& machine) {
+		machine.v[0x2] = 0xAA;
+		machine.pc = 0x206;
+		machine.cycleCount += 1;
+		return true;
+	}
+
+	TEST(AotTest, SplitsTheRomIntoBlocks) {
+		const AotCompiler compiler(SelfModifyingRom.data(), SelfModifyingRom.size());
+		const auto& blocks = compiler.getBlocks();
+		const std::vector<std::array<uint16_t, 3>> expectedBlocks{
+			{ 0x200, 0x204, 2 }, // ends at the jump target
+			{ 0x204, 0x20A, 3 }, // ends at the skip
+			{ 0x20A, 0x20C, 1 }, // the zero word is left to the interpreter
+			{ 0x20E, 0x212, 2 }, // ends after the store
+			{ 0x212, 0x214, 1 },
+		};
+		ASSERT_EQ(blocks.size(), expectedBlocks.size());
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			ASSERT_EQ(blocks[i].start, expectedBlocks[i][0]);
+			ASSERT_EQ(blocks[i].end, expectedBlocks[i][1]);
+			ASSERT_EQ(blocks[i].instructionCount, expectedBlocks[i][2]);
+		}
+		std::ostringstream source;
+		compiler.writeSource(source, "selfModifyingProgram", "self-modifying.ch8");
+		ASSERT_NE(source.str().find("bool block0204(Chip8::AotRuntime::Machine& machine) {"), std::string::npos);
+		ASSERT_NE(source.str().find("// 0x0210: LD [I], V1"), std::string::npos);
+		ASSERT_NE(source.str().find("registerProgram(selfModifyingProgram)"), std::string::npos);
+
+		// the target of an indirect jump is translated if V0 is known
+		const std::array<uint8_t, 10> indirectJump{ 0x60, 0x04, 0xB2, 0x04, 0x00, 0x00, 0x00, 0x00, 0x12, 0x08 };
+		const AotCompiler indirectCompiler(indirectJump.data(), indirectJump.size());
+		ASSERT_EQ(indirectCompiler.getBlocks().size(), 2u);
+		ASSERT_EQ(indirectCompiler.getBlocks().back().start, 0x208);
+
+		ASSERT_EQ(AotCompiler::getDefaultSymbol("games/Pong 2.ch8"), "Pong_2Program");
+		ASSERT_EQ(AotCompiler::getDefaultSymbol("15puzzle"), "rom15puzzleProgram");
+		ASSERT_TRUE(AotCompiler::isValidSymbol("_pong2"));
+		ASSERT_FALSE(AotCompiler::isValidSymbol("2pong"));
+		ASSERT_FALSE(AotCompiler::isValidSymbol("pong-2"));
+	}
+
+	TEST(AotTest, InterpretsOverwrittenCode) {
+		const std::array<AotRuntime::Block, 1> blocks{ { { 0x204, 0x206, 1, translateLoadV2 } } };
+		const AotRuntime::Program program{ "self-modifying.ch8", SelfModifyingRom.data(), SelfModifyingRom.size(), blocks.data(), blocks.size() };
+		AotRuntime runtime(program);
+		Chip8::Chip8 chip8;
+		chip8.setLoggingEnabled(false);
+		runtime.loadROM(chip8);
+
+		ASSERT_TRUE(runtime.run(chip8, 3));
+		ASSERT_EQ(chip8.getRegister(0x2), 0xAA);
+		ASSERT_EQ(chip8.getProgramCounter(), 0x206);
+		ASSERT_EQ(chip8.getCycleCount(), 3u);
+		ASSERT_EQ(runtime.getStatistics().compiledCycles, 1u);
+
+		// the second time, 0x204 holds LD V2, 0x02 and runs in the interpreter until the program halts
+		ASSERT_FALSE(runtime.run(chip8, 100));
+		ASSERT_EQ(chip8.getRegister(0x2), 0x02);
+		ASSERT_EQ(chip8.getProgramCounter(), 0x20C);
+		ASSERT_EQ(chip8.getCycleCount(), 13u);
+		ASSERT_EQ(runtime.getStatistics().compiledCycles, 1u);
+		ASSERT_EQ(runtime.getStatistics().interpretedCycles, 12u);
+
+		// a freshly loaded ROM runs the translation again
+		runtime.loadROM(chip8);
+		ASSERT_TRUE(runtime.run(chip8, 3));
+		ASSERT_EQ(chip8.getRegister(0x2), 0xAA);
+	}
 }
 
 int main(int argc, char **argv) {